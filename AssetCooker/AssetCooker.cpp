@@ -0,0 +1,812 @@
+//
+// AssetCooker.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Cooks every model in the resource directory into the binary format the game maps at startup,
+// compiles the levels into the instance tables the game reads at startup,
+// and checks that the game can upload the DDS textures a mip range at a time
+// Then packs the loose resource files (not the cooked ones, which the game writes itself) into the asset pack the game maps at startup
+// Usage: AssetCooker [resource directory] [--force] [--jobs count] [--compress]
+// --compress stores the geometry with MeshCodec, checks that it decodes to the same meshes and reports the compression and decode speed
+// (it also compresses the packed files that LzCodec makes smaller)
+// (the decode speed is per thread, use --jobs 1 to measure it without the other jobs running)
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include "CookedMesh.h"
+#include "AssetPack.h"
+#include "DdsFile.h"
+#include "FileReadQueue.h"
+#include "LevelLayout.h"
+#include "MeshCodec.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+
+#define COOKER_VERSION 2					// Increase whenever the import or the optimizations change so every file is cooked again
+#define COOKED_DIRECTORY_NAME "Cooked"		// Must match COOKED_MESH_DIRECTORY in the game
+#define MANIFEST_FILE_NAME "manifest.txt"
+#define ASSET_PACK_FILE_NAME "assets.pack"		// Must match ASSET_PACK_FILE_PATH in the game
+#define MIN_DECODE_BENCHMARK_SECONDS 0.05	// Each compressed file is decoded repeatedly for at least this long
+
+namespace fs = std::filesystem;
+
+struct ManifestEntry
+{
+	std::string strSource;					// File names are relative to the resource directory
+	uint64_t dependencyHash;				// Hash of the source, its dependencies and the cooker version
+	std::string strOutput;
+	int iSubmeshCount;
+	int iVertexCount;
+	int iIndexCount;
+	std::vector<std::string> dependencies;	// Read by the import besides the source (e.g. .mtl libraries)
+};
+
+struct CookJob
+{
+	std::string strSource;
+	ManifestEntry previousEntry;
+	bool bHasPreviousEntry;
+	ManifestEntry entry;
+	bool bIsSkipped;
+	bool bIsSuccessful;
+	std::string strReport;
+	uint64_t vertexBytes;					// Uncompressed and compressed geometry sizes (only with --compress)
+	uint64_t compressedVertexBytes;
+	uint64_t indexBytes;
+	uint64_t compressedIndexBytes;
+	double dVertexDecodeSeconds;			// Time to decode the compressed vertices and indices once (only with --compress)
+	double dIndexDecodeSeconds;
+};
+
+namespace
+{
+	// Files that were submitted to the read queue are hashed from it
+	uint64_t HashDependencies(const fs::path &resourceDirectory, const std::string &strSource, const std::vector<std::string> &dependencies, bool bCompress,
+							  FileReadQueue &readQueue, bool &bIsComplete)
+	{
+		// Changing the compression cooks every file again too
+		uint32_t version = COOKER_VERSION * 1000 + COOKED_MESH_VERSION;
+		uint64_t hash = HashCookedMeshData(&version, sizeof(version));
+		hash = HashCookedMeshData(&bCompress, sizeof(bCompress), hash);
+		bIsComplete = true;
+
+		std::vector<std::string> files = { strSource };
+		files.insert(files.end(), dependencies.begin(), dependencies.end());
+		for (auto &strFile : files)
+		{
+			std::string strFilePath = (resourceDirectory / strFile).string();
+			const char *pData = nullptr;
+			size_t size = 0;
+			MappedFile file;
+			if (readQueue.Wait(strFilePath, pData, size) || file.Open(strFilePath.c_str()))
+			{
+				hash = HashCookedMeshData(strFile.data(), strFile.size(), hash);
+				hash = pData != nullptr ? HashCookedMeshData(pData, size, hash) : HashCookedMeshData(file.GetData(), file.GetSize(), hash);
+			}
+			else
+			{
+				bIsComplete = false;
+			}
+		}
+		return hash;
+	}
+
+	std::string FindMissingDependency(const fs::path &resourceDirectory, const std::string &strSource, const std::vector<std::string> &dependencies)
+	{
+		std::string strMissing;
+		std::error_code error;
+		std::vector<std::string> files = { strSource };
+		files.insert(files.end(), dependencies.begin(), dependencies.end());
+		for (auto &strFile : files)
+		{
+			if (!fs::is_regular_file(resourceDirectory / strFile, error))
+			{
+				strMissing += (strMissing.empty() ? "" : ", ") + strFile;
+			}
+		}
+		return strMissing.empty() ? "a dependency" : strMissing;
+	}
+
+	std::map<std::string, ManifestEntry> ReadManifest(const fs::path &manifestPath)
+	{
+		// One tab separated line per source: source, dependency hash, output, submesh, vertex and index counts, dependencies (| separated)
+		std::map<std::string, ManifestEntry> entries;
+		std::ifstream file(manifestPath);
+		std::string strLine;
+		while (std::getline(file, strLine))
+		{
+			if (strLine.empty() || strLine[0] == '#')
+			{
+				continue;
+			}
+
+			std::vector<std::string> fields;
+			std::stringstream stream(strLine);
+			std::string strField;
+			while (std::getline(stream, strField, '\t'))
+			{
+				fields.push_back(strField);
+			}
+			if (fields.size() < 6)
+			{
+				continue;
+			}
+
+			ManifestEntry entry;
+			entry.strSource = fields[0];
+			entry.dependencyHash = strtoull(fields[1].c_str(), nullptr, 16);
+			entry.strOutput = fields[2];
+			entry.iSubmeshCount = atoi(fields[3].c_str());
+			entry.iVertexCount = atoi(fields[4].c_str());
+			entry.iIndexCount = atoi(fields[5].c_str());
+			if (fields.size() > 6)
+			{
+				std::stringstream dependencyStream(fields[6]);
+				while (std::getline(dependencyStream, strField, '|'))
+				{
+					entry.dependencies.push_back(strField);
+				}
+			}
+			entries[entry.strSource] = entry;
+		}
+		return entries;
+	}
+
+	bool WriteManifest(const fs::path &manifestPath, const std::vector<CookJob> &jobs)
+	{
+		std::ofstream file(manifestPath, std::ios::trunc);
+		if (file.fail())
+		{
+			return false;
+		}
+
+		file << "# Written by AssetCooker: source, dependency hash, output, submeshes, vertices, indices, dependencies\n";
+		for (auto &job : jobs)
+		{
+			if (!job.bIsSuccessful)
+			{
+				continue;
+			}
+			const ManifestEntry &entry = job.entry;
+			char hash[17];
+			snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(entry.dependencyHash));
+			file << entry.strSource << '\t' << hash << '\t' << entry.strOutput << '\t' << entry.iSubmeshCount << '\t'
+				 << entry.iVertexCount << '\t' << entry.iIndexCount << '\t';
+			for (size_t i = 0; i < entry.dependencies.size(); i++)
+			{
+				file << (i > 0 ? "|" : "") << entry.dependencies[i];
+			}
+			file << '\n';
+		}
+		return !file.fail();
+	}
+
+	void ComputeBounds(const std::vector<CookedVertex> &vertices, CookedSubmesh &submesh)
+	{
+		float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (auto &vertex : vertices)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				minimum[i] = std::min(minimum[i], vertex.position[i]);
+				maximum[i] = std::max(maximum[i], vertex.position[i]);
+			}
+		}
+		if (vertices.empty())
+		{
+			return;
+		}
+
+		float fRadiusSquared = 0.0f;
+		for (int i = 0; i < 3; i++)
+		{
+			submesh.boxCenter[i] = (minimum[i] + maximum[i]) * 0.5f;
+			submesh.boxExtents[i] = (maximum[i] - minimum[i]) * 0.5f;
+			submesh.sphereCenter[i] = submesh.boxCenter[i];
+		}
+		for (auto &vertex : vertices)
+		{
+			float fDistanceSquared = 0.0f;
+			for (int i = 0; i < 3; i++)
+			{
+				float fDelta = vertex.position[i] - submesh.sphereCenter[i];
+				fDistanceSquared += fDelta * fDelta;
+			}
+			fRadiusSquared = std::max(fRadiusSquared, fDistanceSquared);
+		}
+		submesh.sphereRadius = sqrtf(fRadiusSquared);
+	}
+
+	bool IsSameTriangle(const uint32_t *a, const uint32_t *b)
+	{
+		// The index codec can rotate triangles, which keeps their winding
+		for (int i = 0; i < 3; i++)
+		{
+			if (a[0] == b[i] && a[1] == b[(i + 1) % 3] && a[2] == b[(i + 2) % 3])
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Opens the file like the game does and compares it with the submeshes it was written from
+	bool CheckCompressedFile(const fs::path &filePath, const std::vector<ImportedSubmesh> &submeshes, CookJob &job)
+	{
+		CookedMeshFile file;
+		if (!file.Open(filePath.string().c_str(), sizeof(CookedVertex)))
+		{
+			job.strReport = "failed to decode " + job.entry.strOutput;
+			return false;
+		}
+
+		for (size_t i = 0; i < submeshes.size(); i++)
+		{
+			const ImportedSubmesh &submesh = submeshes[i];
+			const CookedSubmesh &cookedSubmesh = *file.GetSubmesh(static_cast<int>(i));
+			const uint32_t *pIndices = file.GetIndexData(cookedSubmesh);
+			bool bIsSame = cookedSubmesh.vertexCount == submesh.vertices.size() && cookedSubmesh.indexCount == submesh.indices.size() &&
+						   memcmp(file.GetVertexData(cookedSubmesh), submesh.vertices.data(), submesh.vertices.size() * sizeof(CookedVertex)) == 0;
+			for (size_t j = 0; bIsSame && j + 2 < submesh.indices.size(); j += 3)
+			{
+				bIsSame = IsSameTriangle(&pIndices[j], &submesh.indices[j]);
+			}
+			if (!bIsSame)
+			{
+				job.strReport = "submesh " + std::to_string(i) + " of " + job.entry.strOutput + " does not decode to the cooked geometry";
+				return false;
+			}
+		}
+
+		const CookedMeshHeader &header = *file.GetHeader();
+		job.vertexBytes = uint64_t(header.vertexCount) * header.vertexSize;
+		job.compressedVertexBytes = header.vertexDataSize;
+		job.indexBytes = uint64_t(header.indexCount) * sizeof(uint32_t);
+		job.compressedIndexBytes = header.indexDataSize;
+		return true;
+	}
+
+	// Calls the function repeatedly and returns the average time of one call
+	template<typename Function>
+	double MeasureSeconds(const Function &function)
+	{
+		int iCallCount = 0;
+		double dSeconds = 0.0;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		while (dSeconds < MIN_DECODE_BENCHMARK_SECONDS)
+		{
+			function();
+			iCallCount++;
+			dSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		}
+		return dSeconds / iCallCount;
+	}
+
+	// Times decoding the vertices and the indices of every submesh, separately
+	void MeasureDecodeSpeed(const std::vector<ImportedSubmesh> &submeshes, CookJob &job)
+	{
+		std::vector<std::vector<uint8_t>> encodedVertices(submeshes.size());
+		std::vector<std::vector<uint8_t>> encodedIndices(submeshes.size());
+		size_t maxVertexCount = 0;
+		size_t maxIndexCount = 0;
+		for (size_t i = 0; i < submeshes.size(); i++)
+		{
+			MeshCodec::EncodeVertices(submeshes[i].vertices.data(), submeshes[i].vertices.size(), sizeof(CookedVertex), encodedVertices[i]);
+			MeshCodec::EncodeIndices(submeshes[i].indices.data(), submeshes[i].indices.size(), encodedIndices[i]);
+			maxVertexCount = std::max(maxVertexCount, submeshes[i].vertices.size());
+			maxIndexCount = std::max(maxIndexCount, submeshes[i].indices.size());
+		}
+
+		std::vector<CookedVertex> vertices(maxVertexCount);
+		std::vector<uint32_t> indices(maxIndexCount);
+		job.dVertexDecodeSeconds = MeasureSeconds([&]()
+		{
+			for (size_t i = 0; i < submeshes.size(); i++)
+			{
+				MeshCodec::DecodeVertices(encodedVertices[i].data(), encodedVertices[i].size(), vertices.data(), submeshes[i].vertices.size(), sizeof(CookedVertex));
+			}
+		});
+		job.dIndexDecodeSeconds = MeasureSeconds([&]()
+		{
+			for (size_t i = 0; i < submeshes.size(); i++)
+			{
+				MeshCodec::DecodeIndices(encodedIndices[i].data(), encodedIndices[i].size(), indices.data(), submeshes[i].indices.size(),
+										 static_cast<uint32_t>(submeshes[i].vertices.size()));
+			}
+		});
+	}
+
+	void Cook(const fs::path &resourceDirectory, bool bCompress, FileReadQueue &readQueue, CookJob &job)
+	{
+		fs::path sourcePath = resourceDirectory / job.strSource;
+		bool bIsObj = sourcePath.extension() == ".obj";
+
+		std::vector<ImportedSubmesh> submeshes;
+		std::vector<std::string> dependencies;
+		bool bIsImported = bIsObj ? MeshImporter::ImportObj(sourcePath.string(), submeshes, dependencies) : MeshImporter::ImportTxt(sourcePath.string(), submeshes);
+		if (!bIsImported)
+		{
+			job.strReport = "failed to import";
+			return;
+		}
+
+		// Dependencies are stored relative to the resource directory (the source itself is always the first one)
+		job.entry.dependencies.clear();
+		for (size_t i = 1; i < dependencies.size(); i++)
+		{
+			job.entry.dependencies.push_back(fs::path(dependencies[i]).lexically_relative(resourceDirectory).generic_string());
+		}
+		bool bIsComplete = false;
+		job.entry.dependencyHash = HashDependencies(resourceDirectory, job.strSource, job.entry.dependencies, bCompress, readQueue, bIsComplete);
+		if (!bIsComplete)
+		{
+			// The import went ahead without the file (e.g. a missing .mtl), so the cooked file would not match the source
+			job.strReport = "cannot read " + FindMissingDependency(resourceDirectory, job.strSource, job.entry.dependencies);
+			return;
+		}
+
+		CookedMeshWriter writer(sizeof(CookedVertex));
+		writer.SetCompression(bCompress, bCompress);
+		int iSourceVertexCount = 0;
+		float fAcmrBefore = 0.0f;
+		float fAcmrAfter = 0.0f;
+		job.entry.iVertexCount = 0;
+		job.entry.iIndexCount = 0;
+		for (auto &submesh : submeshes)
+		{
+			iSourceVertexCount += static_cast<int>(submesh.vertices.size());
+
+			// Text models list every corner of every triangle, so welding shares most of their vertices
+			MeshOptimizer::WeldVertices(submesh.vertices, submesh.indices);
+			fAcmrBefore += MeshOptimizer::ComputeAcmr(submesh.indices, submesh.vertices.size()) * submesh.indices.size();
+			MeshOptimizer::OptimizeVertexCache(submesh.indices, submesh.vertices.size());
+			MeshOptimizer::OptimizeVertexFetch(submesh.vertices, submesh.indices);
+			fAcmrAfter += MeshOptimizer::ComputeAcmr(submesh.indices, submesh.vertices.size()) * submesh.indices.size();
+
+			CookedSubmesh cookedSubmesh = {};
+			cookedSubmesh.lodCount = 1;
+			cookedSubmesh.lods[0] = { 0, static_cast<uint32_t>(submesh.indices.size()), FLT_MAX };
+			for (int i = 0; i < 4; i++)
+			{
+				cookedSubmesh.transform[i * 5] = 1.0f;
+			}
+			ComputeBounds(submesh.vertices, cookedSubmesh);
+			memcpy(cookedSubmesh.diffuseColor, submesh.diffuseColor, sizeof(cookedSubmesh.diffuseColor));
+			if (submesh.strTexturePath.size() < MAX_COOKED_TEXTURE_PATH_LENGTH)
+			{
+				strcpy(cookedSubmesh.texturePath, submesh.strTexturePath.c_str());
+			}
+
+			writer.AddSubmesh(cookedSubmesh, submesh.vertices.data(), static_cast<uint32_t>(submesh.vertices.size()),
+							  submesh.indices.data(), static_cast<uint32_t>(submesh.indices.size()));
+			job.entry.iVertexCount += static_cast<int>(submesh.vertices.size());
+			job.entry.iIndexCount += static_cast<int>(submesh.indices.size());
+		}
+		job.entry.iSubmeshCount = static_cast<int>(submeshes.size());
+
+		// The game checks the hash of the source and its material libraries, the LODs and meshlets are built by the game on first load
+		std::vector<std::string> materialLibraries(dependencies.begin() + (dependencies.empty() ? 0 : 1), dependencies.end());
+		uint64_t sourceHash = CookedMeshWriter::HashDependencies(CookedMeshWriter::HashFile(sourcePath.string().c_str()), materialLibraries);
+		if (!writer.Write((resourceDirectory / job.entry.strOutput).string(), sourceHash, GEOMETRY_ONLY_SETTINGS_HASH))
+		{
+			job.strReport = "failed to write " + job.entry.strOutput;
+			return;
+		}
+
+		char report[256];
+		if (job.entry.iIndexCount > 0)
+		{
+			snprintf(report, sizeof(report), "%d submeshes, %d -> %d vertices, ACMR %.3f -> %.3f", job.entry.iSubmeshCount, iSourceVertexCount,
+					 job.entry.iVertexCount, fAcmrBefore / job.entry.iIndexCount, fAcmrAfter / job.entry.iIndexCount);
+		}
+		else
+		{
+			snprintf(report, sizeof(report), "%d submeshes, %d vertices", job.entry.iSubmeshCount, job.entry.iVertexCount);
+		}
+		std::string strReport = report;
+
+		if (bCompress)
+		{
+			if (!CheckCompressedFile(resourceDirectory / job.entry.strOutput, submeshes, job))
+			{
+				return;
+			}
+			MeasureDecodeSpeed(submeshes, job);
+			snprintf(report, sizeof(report), ", vertices %.1f -> %.1f KB (decoded at %.2f GB/s), indices %.1f -> %.1f KB (decoded at %.2f GB/s)",
+					 job.vertexBytes / 1024.0, job.compressedVertexBytes / 1024.0, job.vertexBytes / job.dVertexDecodeSeconds / 1e9, job.indexBytes / 1024.0,
+					 job.compressedIndexBytes / 1024.0, job.indexBytes / job.dIndexDecodeSeconds / 1e9);
+			strReport += report;
+		}
+
+		job.strReport = strReport;
+		job.bIsSuccessful = true;
+	}
+
+	bool CompileLevel(const fs::path &resourceDirectory, const std::string &strLevel, bool bForce, std::string &strReport)
+	{
+		// Same table path and source hash as the game, so it finds the table up to date
+		fs::path levelPath = resourceDirectory / strLevel;
+		fs::path tablePath = resourceDirectory / COOKED_DIRECTORY_NAME / (strLevel + LEVEL_TABLE_EXTENSION);
+		uint64_t sourceHash = CookedMeshWriter::HashFile(levelPath.string().c_str());
+		LevelLayoutFile file;
+		bool bIsUpToDate = !bForce && file.Open(tablePath.string().c_str(), sourceHash);
+		if (!bIsUpToDate)
+		{
+			std::string strError;
+			if (!LevelLayoutCompiler::Compile(levelPath.string().c_str(), tablePath.string(), sourceHash, strError))
+			{
+				strReport = strError;
+				return false;
+			}
+			if (!file.Open(tablePath.string().c_str(), sourceHash))
+			{
+				strReport = "failed to read back " + tablePath.filename().string();
+				return false;
+			}
+		}
+
+		char report[256];
+		snprintf(report, sizeof(report), "%s%d models, %d instances, %.1f KB", bIsUpToDate ? "up to date, " : "", file.GetGroupCount(), file.GetInstanceCount(),
+				 fs::file_size(tablePath) / 1024.0);
+		strReport = report;
+		return true;
+	}
+
+	bool CheckTexture(const fs::path &texturePath, std::string &strReport)
+	{
+		DdsFile file;
+		if (!file.Open(texturePath.string().c_str()))
+		{
+			strReport = file.GetData() != nullptr ? "unsupported or truncated DDS file" : "failed to open";
+			return false;
+		}
+
+		// The mips have to be contiguous and end with the file (anything else is not uploaded)
+		const DdsTextureInfo &info = file.GetInfo();
+		uint64_t expectedOffset = file.GetMip(0, 0).offset;
+		for (uint32_t i = 0; i < info.uiArraySize; i++)
+		{
+			for (uint32_t j = 0; j < info.uiMipCount; j++)
+			{
+				if (file.GetMip(i, j).offset != expectedOffset)
+				{
+					strReport = "mip " + std::to_string(j) + " of slice " + std::to_string(i) + " is not where the previous mip ends";
+					return false;
+				}
+				expectedOffset += file.GetMip(i, j).size;
+			}
+		}
+		uint64_t dataSize = file.GetMipRangeSize(0, info.uiMipCount);
+		if (file.GetMip(0, 0).offset + dataSize != file.GetSize())
+		{
+			strReport = std::to_string(file.GetSize() - file.GetMip(0, 0).offset - dataSize) + " bytes after the last mip";
+			return false;
+		}
+
+		char report[256];
+		snprintf(report, sizeof(report), "%ux%u format %u, %u mips, %u slices, %.1f KB (%.1f KB without the top mip)", info.uiWidth, info.uiHeight,
+				 info.uiFormat, info.uiMipCount, info.uiArraySize, dataSize / 1024.0, file.GetMipRangeSize(1, info.uiMipCount) / 1024.0);
+		strReport = report;
+		return true;
+	}
+
+	bool BuildAssetPack(const fs::path &resourceDirectory, bool bCompress, std::string &strReport)
+	{
+		// Every loose file in the resource directory, sorted so the pack only changes when the files do
+		std::vector<std::string> files;
+		std::error_code error;
+		for (auto &directoryEntry : fs::directory_iterator(resourceDirectory, error))
+		{
+			fs::path extension = directoryEntry.path().extension();
+			if (directoryEntry.is_regular_file() && extension != ".pack" && extension != ".tmp")
+			{
+				files.push_back(directoryEntry.path().filename().string());
+			}
+		}
+		std::sort(files.begin(), files.end());
+
+		AssetPackWriter writer;
+		writer.SetCompression(bCompress);
+		for (auto &strFile : files)
+		{
+			if (!writer.AddFile(strFile, (resourceDirectory / strFile).string().c_str()))
+			{
+				strReport = "cannot pack " + strFile;
+				return false;
+			}
+		}
+
+		AssetPackStats stats;
+		bool bIsUpToDate = false;
+		if (!writer.Write((resourceDirectory / ASSET_PACK_FILE_NAME).string(), stats, bIsUpToDate))
+		{
+			strReport = "cannot write the file";
+			return false;
+		}
+
+		// The pack is mapped by the game, so it is checked the same way
+		AssetPack pack;
+		if (!pack.Open((resourceDirectory / ASSET_PACK_FILE_NAME).string().c_str(), resourceDirectory.string()))
+		{
+			strReport = "cannot open the written file";
+			return false;
+		}
+		for (auto &strFile : files)
+		{
+			const char *pData = nullptr;
+			size_t size = 0;
+			MappedFile file;
+			if (!pack.Find((resourceDirectory / strFile).string(), pData, size) || !file.Open((resourceDirectory / strFile).string().c_str()) ||
+				size != file.GetSize() || memcmp(pData, file.GetData(), size) != 0)
+			{
+				strReport = strFile + " does not read back the same from the pack";
+				return false;
+			}
+		}
+
+		char report[256];
+		snprintf(report, sizeof(report), "%s%d files (%d shared, %d compressed), %.1f -> %.1f KB", bIsUpToDate ? "up to date, " : "", stats.iEntryCount,
+				 stats.iSharedCount, stats.iCompressedCount, stats.fileBytes / 1024.0, stats.storedBytes / 1024.0);
+		strReport = report;
+		return true;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	fs::path resourceDirectory = "Resources";
+	bool bForce = false;
+	bool bCompress = false;
+	unsigned int uiJobCount = std::max(1u, std::thread::hardware_concurrency());
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--force") == 0)
+		{
+			bForce = true;
+		}
+		else if (strcmp(argv[i], "--compress") == 0)
+		{
+			bCompress = true;
+		}
+		else if (strcmp(argv[i], "--jobs") == 0)
+		{
+			int iJobCount = i + 1 < argc ? atoi(argv[++i]) : 0;
+			if (iJobCount < 1)
+			{
+				fprintf(stderr, "--jobs needs a number of jobs\n");
+				return 1;
+			}
+			uiJobCount = static_cast<unsigned int>(iJobCount);
+		}
+		else if (strncmp(argv[i], "--", 2) == 0)
+		{
+			fprintf(stderr, "Unknown option %s\nUsage: AssetCooker [resource directory] [--force] [--jobs count] [--compress]\n", argv[i]);
+			return 1;
+		}
+		else
+		{
+			resourceDirectory = argv[i];
+		}
+	}
+
+	// A mistyped directory is reported rather than cooked into (only the cooked directory inside it is created)
+	std::error_code error;
+	if (!fs::is_directory(resourceDirectory, error))
+	{
+		fprintf(stderr, "%s is not a directory\n", resourceDirectory.string().c_str());
+		return 1;
+	}
+	fs::create_directory(resourceDirectory / COOKED_DIRECTORY_NAME, error);
+	if (error)
+	{
+		fprintf(stderr, "Cannot create %s: %s\n", (resourceDirectory / COOKED_DIRECTORY_NAME).string().c_str(), error.message().c_str());
+		return 1;
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// Find the sources (the same models the game loads) and the textures
+	std::vector<std::string> sources;
+	std::vector<std::string> staticProps;
+	std::vector<std::string> textures;
+	std::vector<std::string> levels;
+	for (auto &directoryEntry : fs::directory_iterator(resourceDirectory, error))
+	{
+		fs::path extension = directoryEntry.path().extension();
+		if (directoryEntry.is_regular_file() && (extension == ".obj" || extension == ".txt"))
+		{
+			// The game would reject a mesh cooked here for a static prop (see IsStaticPropSource), so it cooks them itself
+			std::string strFileName = directoryEntry.path().filename().string();
+			if (IsStaticPropSource(strFileName.c_str()))
+			{
+				staticProps.push_back(strFileName);
+			}
+			else
+			{
+				sources.push_back(strFileName);
+			}
+		}
+		else if (directoryEntry.is_regular_file() && extension == ".dds")
+		{
+			textures.push_back(directoryEntry.path().filename().string());
+		}
+		else if (directoryEntry.is_regular_file() && extension == ".level")
+		{
+			levels.push_back(directoryEntry.path().filename().string());
+		}
+	}
+	std::sort(sources.begin(), sources.end());
+	std::sort(staticProps.begin(), staticProps.end());
+	std::sort(textures.begin(), textures.end());
+	std::sort(levels.begin(), levels.end());
+
+	fs::path manifestPath = resourceDirectory / COOKED_DIRECTORY_NAME / MANIFEST_FILE_NAME;
+	std::map<std::string, ManifestEntry> previousEntries = ReadManifest(manifestPath);
+
+	// Meshes that earlier versions cooked for the static props are rejected by the game, so they are removed to save it the check
+	for (auto &strStaticProp : staticProps)
+	{
+		auto previousEntry = previousEntries.find(strStaticProp);
+		if (previousEntry != previousEntries.end())
+		{
+			fs::remove(resourceDirectory / previousEntry->second.strOutput, error);
+		}
+	}
+
+	std::vector<CookJob> jobs(sources.size());
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		CookJob &job = jobs[i];
+		job.strSource = sources[i];
+		job.entry.strSource = sources[i];
+		job.entry.strOutput = std::string(COOKED_DIRECTORY_NAME) + "/" + sources[i] + ".mesh";
+		auto previousEntry = previousEntries.find(sources[i]);
+		job.bHasPreviousEntry = previousEntry != previousEntries.end();
+		if (job.bHasPreviousEntry)
+		{
+			job.previousEntry = previousEntry->second;
+		}
+		job.bIsSkipped = false;
+		job.bIsSuccessful = false;
+		job.vertexBytes = 0;
+		job.compressedVertexBytes = 0;
+		job.indexBytes = 0;
+		job.compressedIndexBytes = 0;
+		job.dVertexDecodeSeconds = 0.0;
+		job.dIndexDecodeSeconds = 0.0;
+	}
+
+	// Every file the up-to-date checks hash is read at once, before the workers start, rather than one after another by each worker
+	FileReadQueue readQueue;
+	for (auto &job : jobs)
+	{
+		if (!bForce && job.bHasPreviousEntry)
+		{
+			readQueue.Submit((resourceDirectory / job.strSource).string());
+			for (auto &strDependency : job.previousEntry.dependencies)
+			{
+				readQueue.Submit((resourceDirectory / strDependency).string());
+			}
+		}
+	}
+
+	// Each worker takes the next job until there are none left
+	std::atomic<size_t> nextJob(0);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < std::min<size_t>(uiJobCount, jobs.size()); i++)
+	{
+		workers.emplace_back([&]()
+		{
+			for (size_t j = nextJob++; j < jobs.size(); j = nextJob++)
+			{
+				CookJob &job = jobs[j];
+				auto jobStartTime = std::chrono::high_resolution_clock::now();
+
+				// Skip sources whose content (and dependencies) have not changed since they were cooked
+				if (!bForce && job.bHasPreviousEntry && fs::exists(resourceDirectory / job.previousEntry.strOutput))
+				{
+					bool bIsComplete = false;
+					uint64_t hash = HashDependencies(resourceDirectory, job.strSource, job.previousEntry.dependencies, bCompress, readQueue, bIsComplete);
+					if (bIsComplete && hash == job.previousEntry.dependencyHash)
+					{
+						job.entry = job.previousEntry;
+						job.bIsSkipped = true;
+						job.bIsSuccessful = true;
+						job.strReport = "up to date";
+						continue;
+					}
+				}
+
+				Cook(resourceDirectory, bCompress, readQueue, job);
+				float fMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - jobStartTime).count();
+				job.strReport += " (" + std::to_string(fMilliseconds) + " ms)";
+			}
+		});
+	}
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+
+	int iCookedCount = 0;
+	int iSkippedCount = 0;
+	int iFailedCount = 0;
+	uint64_t geometryBytes = 0;
+	uint64_t compressedGeometryBytes = 0;
+	double dDecodeSeconds = 0.0;
+	for (auto &job : jobs)
+	{
+		printf("%-24s %s\n", job.strSource.c_str(), job.strReport.c_str());
+		iCookedCount += job.bIsSuccessful && !job.bIsSkipped ? 1 : 0;
+		iSkippedCount += job.bIsSkipped ? 1 : 0;
+		iFailedCount += job.bIsSuccessful ? 0 : 1;
+		geometryBytes += job.vertexBytes + job.indexBytes;
+		compressedGeometryBytes += job.compressedVertexBytes + job.compressedIndexBytes;
+		dDecodeSeconds += job.dVertexDecodeSeconds + job.dIndexDecodeSeconds;
+	}
+	for (auto &strStaticProp : staticProps)
+	{
+		printf("%-24s left to the game (static prop import profile)\n", strStaticProp.c_str());
+	}
+	if (compressedGeometryBytes > 0)
+	{
+		printf("Compressed the geometry of the cooked files from %.1f to %.1f KB (%.2f:1), decoded at %.2f GB/s%s\n", geometryBytes / 1024.0,
+			   compressedGeometryBytes / 1024.0, static_cast<double>(geometryBytes) / compressedGeometryBytes, geometryBytes / dDecodeSeconds / 1e9,
+			   MeshCodec::IsVertexDecoderVectorized() ? "" : " (without SSE2)");
+	}
+
+	printf("%s", readQueue.GetReport().c_str());
+
+	// Textures are not cooked, only checked (they are small enough to parse every time)
+	for (auto &strTexture : textures)
+	{
+		std::string strReport;
+		if (!CheckTexture(resourceDirectory / strTexture, strReport))
+		{
+			iFailedCount++;
+		}
+		printf("%-24s %s\n", strTexture.c_str(), strReport.c_str());
+	}
+
+	// Levels are compiled on this thread (they only hold placements, so they compile quickly)
+	for (auto &strLevel : levels)
+	{
+		std::string strReport;
+		if (!CompileLevel(resourceDirectory, strLevel, bForce, strReport))
+		{
+			iFailedCount++;
+		}
+		printf("%-24s %s\n", strLevel.c_str(), strReport.c_str());
+	}
+
+	std::string strPackReport;
+	if (!BuildAssetPack(resourceDirectory, bCompress, strPackReport))
+	{
+		iFailedCount++;
+	}
+	printf("%-24s %s\n", ASSET_PACK_FILE_NAME, strPackReport.c_str());
+
+	if (!WriteManifest(manifestPath, jobs))
+	{
+		fprintf(stderr, "Cannot write %s\n", manifestPath.string().c_str());
+		return 1;
+	}
+
+	float fMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	printf("%d cooked, %d up to date, %d failed in %.1f ms on %u threads\n", iCookedCount, iSkippedCount, iFailedCount, fMilliseconds,
+		   static_cast<unsigned int>(workers.size()));
+
+	return iFailedCount == 0 ? 0 : 1;
+}
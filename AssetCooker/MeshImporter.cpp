@@ -0,0 +1,104 @@
+//
+// MeshImporter.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// RasterTek Tutorial 8: Loading Maya 2011 Models (http://www.rastertek.com/dx11tut08.html)
+//
+
+#include <cstring>
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "ObjModelParser.h"
+#include "MeshImporter.h"
+
+bool MeshImporter::ImportObj(const std::string &strFilePath, std::vector<ImportedSubmesh> &submeshes, std::vector<std::string> &dependencies)
+{
+	// The material libraries are listed even if they cannot be read, so the cook is not mistaken for a complete one
+	std::vector<std::string> materialLibraries;
+	if (!ObjModelParser::FindMaterialLibraries(strFilePath.c_str(), materialLibraries))
+	{
+		return false;
+	}
+	dependencies.push_back(strFilePath);
+	dependencies.insert(dependencies.end(), materialLibraries.begin(), materialLibraries.end());
+
+	std::vector<ObjSubmesh> objSubmeshes;
+	if (!ObjModelParser::Parse(strFilePath.c_str(), objSubmeshes))
+	{
+		return false;
+	}
+
+	for (auto &objSubmesh : objSubmeshes)
+	{
+		ImportedSubmesh submesh;
+		submesh.vertices.swap(objSubmesh.vertices);
+		submesh.indices.swap(objSubmesh.indices);
+
+		// Same material as Model::ProcessObjSubmesh records when the game imports the file
+		memset(submesh.diffuseColor, 0, sizeof(submesh.diffuseColor));
+		if (!objSubmesh.strTexturePath.empty() && objSubmesh.strTexturePath.size() < MAX_COOKED_TEXTURE_PATH_LENGTH)
+		{
+			submesh.strTexturePath = objSubmesh.strTexturePath;
+		}
+		else if (objSubmesh.diffuseColor[3] > 0.0f)
+		{
+			memcpy(submesh.diffuseColor, objSubmesh.diffuseColor, sizeof(submesh.diffuseColor));
+		}
+		submeshes.push_back(submesh);
+	}
+
+	return true;
+}
+
+bool MeshImporter::ImportTxt(const std::string &strFilePath, std::vector<ImportedSubmesh> &submeshes)
+{
+	MappedFile file;
+	if (!file.Open(strFilePath.c_str()) || file.GetSize() == 0)
+	{
+		return false;
+	}
+
+	// "Vertex Count: 6" followed by "Data:" and 8 floats per vertex
+	const char *pCurrent = file.GetData();
+	const char *pEnd = pCurrent + file.GetSize();
+	pCurrent = static_cast<const char*>(memchr(pCurrent, ':', pEnd - pCurrent));
+	if (pCurrent == nullptr)
+	{
+		return false;
+	}
+	int iVertexCount = 0;
+	pCurrent = NumberParser::ParseInt(pCurrent + 1, pEnd, iVertexCount);
+	if (pCurrent == nullptr || iVertexCount < 0)
+	{
+		return false;
+	}
+	pCurrent = static_cast<const char*>(memchr(pCurrent, ':', pEnd - pCurrent));
+	if (pCurrent == nullptr)
+	{
+		return false;
+	}
+	pCurrent++;
+
+	ImportedSubmesh submesh;
+	submesh.vertices.resize(iVertexCount);
+	memset(submesh.diffuseColor, 0, sizeof(submesh.diffuseColor));
+	float *pValues = reinterpret_cast<float*>(submesh.vertices.data());
+	for (size_t i = 0; i < submesh.vertices.size() * 8; i++)
+	{
+		pCurrent = NumberParser::ParseFloat(pCurrent, pEnd, pValues[i]);
+		if (pCurrent == nullptr)
+		{
+			return false;
+		}
+	}
+
+	submesh.indices.resize(iVertexCount);
+	for (int i = 0; i < iVertexCount; i++)
+	{
+		submesh.indices[i] = i;
+	}
+	submeshes.push_back(submesh);
+
+	return true;
+}
@@ -0,0 +1,31 @@
+//
+// MeshImporter.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// RasterTek Tutorial 8: Loading Maya 2011 Models (http://www.rastertek.com/dx11tut08.html)
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CookedMeshFormat.h"
+
+struct ImportedSubmesh
+{
+	std::vector<CookedVertex> vertices;
+	std::vector<uint32_t> indices;
+	float diffuseColor[4];					// Alpha is 0 if the default texture is used
+	std::string strTexturePath;				// Relative to the directory of the source file
+};
+
+class MeshImporter
+{
+public:
+	// Parsed with the game's ObjModelParser, so the submeshes and materials are the ones the game's fast import produces
+	// The files the import depends on (the .obj and its .mtl libraries) are appended to dependencies
+	static bool ImportObj(const std::string &strFilePath, std::vector<ImportedSubmesh> &submeshes, std::vector<std::string> &dependencies);
+	// Text models list every corner of every triangle, so the indices are sequential until the vertices are welded
+	static bool ImportTxt(const std::string &strFilePath, std::vector<ImportedSubmesh> &submeshes);
+};
@@ -0,0 +1,255 @@
+//
+// MeshOptimizer.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Linear-Speed Vertex Cache Optimisation (https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html)
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+//
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include "MeshOptimizer.h"
+
+#define CACHE_SIZE 32				// Size of the simulated LRU cache used for scoring
+#define CACHE_DECAY_POWER 1.5f
+#define LAST_TRIANGLE_SCORE 0.75f	// Vertices of the previous triangle are scored slightly lower so strips are not favoured
+#define VALENCE_BOOST_SCALE 2.0f	// Vertices with few remaining triangles are preferred so they can leave the cache
+#define VALENCE_BOOST_POWER 0.5f
+
+namespace
+{
+	struct VertexHasher
+	{
+		size_t operator()(const CookedVertex &vertex) const
+		{
+			return static_cast<size_t>(HashCookedMeshData(&vertex, sizeof(CookedVertex)));
+		}
+	};
+
+	struct VertexEqual
+	{
+		bool operator()(const CookedVertex &a, const CookedVertex &b) const
+		{
+			return memcmp(&a, &b, sizeof(CookedVertex)) == 0;
+		}
+	};
+
+	float GetVertexScore(int iCachePosition, int iRemainingTriangleCount)
+	{
+		if (iRemainingTriangleCount == 0)
+		{
+			return -1.0f;
+		}
+
+		float fScore = 0.0f;
+		if (iCachePosition >= 0)
+		{
+			if (iCachePosition < 3)
+			{
+				fScore = LAST_TRIANGLE_SCORE;
+			}
+			else
+			{
+				float fScale = 1.0f / (CACHE_SIZE - 3);
+				fScore = powf(1.0f - (iCachePosition - 3) * fScale, CACHE_DECAY_POWER);
+			}
+		}
+
+		return fScore + VALENCE_BOOST_SCALE * powf(static_cast<float>(iRemainingTriangleCount), -VALENCE_BOOST_POWER);
+	}
+}
+
+void MeshOptimizer::WeldVertices(std::vector<CookedVertex> &vertices, std::vector<uint32_t> &indices)
+{
+	std::unordered_map<CookedVertex, uint32_t, VertexHasher, VertexEqual> uniqueVertices;
+	uniqueVertices.reserve(vertices.size());
+
+	std::vector<CookedVertex> weldedVertices;
+	weldedVertices.reserve(vertices.size());
+	std::vector<uint32_t> remap(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		auto result = uniqueVertices.emplace(vertices[i], static_cast<uint32_t>(weldedVertices.size()));
+		if (result.second)
+		{
+			weldedVertices.push_back(vertices[i]);
+		}
+		remap[i] = result.first->second;
+	}
+
+	for (auto &index : indices)
+	{
+		index = remap[index];
+	}
+	vertices.swap(weldedVertices);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles that use each vertex (offsets into one shared list)
+	std::vector<int> remainingTriangleCounts(vertexCount, 0);
+	for (auto index : indices)
+	{
+		remainingTriangleCounts[index]++;
+	}
+	std::vector<size_t> vertexTriangleOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		vertexTriangleOffsets[i + 1] = vertexTriangleOffsets[i] + remainingTriangleCounts[i];
+	}
+	std::vector<uint32_t> vertexTriangles(indices.size());
+	std::vector<size_t> vertexTriangleCounts(vertexCount, 0);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		uint32_t index = indices[i];
+		vertexTriangles[vertexTriangleOffsets[index] + vertexTriangleCounts[index]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		vertexScores[i] = GetVertexScore(-1, remainingTriangleCounts[i]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> isTriangleEmitted(triangleCount, false);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	std::vector<uint32_t> cache;			// Most recently used first
+	cache.reserve(CACHE_SIZE + 3);
+	size_t nextTriangleCursor = 0;			// Used when no triangle in the cache is left
+
+	int iBestTriangle = -1;
+	float fBestScore = -1.0f;
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		if (triangleScores[i] > fBestScore)
+		{
+			fBestScore = triangleScores[i];
+			iBestTriangle = static_cast<int>(i);
+		}
+	}
+
+	while (iBestTriangle >= 0)
+	{
+		// Emit the triangle and move its vertices to the front of the cache
+		isTriangleEmitted[iBestTriangle] = true;
+		std::vector<uint32_t> newCache;
+		newCache.reserve(CACHE_SIZE + 3);
+		for (int i = 0; i < 3; i++)
+		{
+			uint32_t index = indices[iBestTriangle * 3 + i];
+			result.push_back(index);
+			newCache.push_back(index);
+			remainingTriangleCounts[index]--;
+		}
+		for (auto index : cache)
+		{
+			if (index != newCache[0] && index != newCache[1] && index != newCache[2])
+			{
+				newCache.push_back(index);
+			}
+		}
+
+		// Rescore the vertices in the cache (and the ones that just left it) and their remaining triangles
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			uint32_t index = newCache[i];
+			cachePositions[index] = i < CACHE_SIZE ? static_cast<int>(i) : -1;
+			vertexScores[index] = GetVertexScore(cachePositions[index], remainingTriangleCounts[index]);
+		}
+		iBestTriangle = -1;
+		fBestScore = -1.0f;
+		for (auto index : newCache)
+		{
+			for (size_t j = vertexTriangleOffsets[index]; j < vertexTriangleOffsets[index + 1]; j++)
+			{
+				uint32_t triangle = vertexTriangles[j];
+				if (isTriangleEmitted[triangle])
+				{
+					continue;
+				}
+				triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+				if (triangleScores[triangle] > fBestScore)
+				{
+					fBestScore = triangleScores[triangle];
+					iBestTriangle = static_cast<int>(triangle);
+				}
+			}
+		}
+		if (newCache.size() > CACHE_SIZE)
+		{
+			newCache.resize(CACHE_SIZE);
+		}
+		cache.swap(newCache);
+
+		// Continue from the next unemitted triangle if the cache has nothing left to offer
+		if (iBestTriangle < 0)
+		{
+			while (nextTriangleCursor < triangleCount && isTriangleEmitted[nextTriangleCursor])
+			{
+				nextTriangleCursor++;
+			}
+			if (nextTriangleCursor < triangleCount)
+			{
+				iBestTriangle = static_cast<int>(nextTriangleCursor);
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<CookedVertex> &vertices, std::vector<uint32_t> &indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<CookedVertex> orderedVertices;
+	orderedVertices.reserve(vertices.size());
+	for (auto &index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = static_cast<uint32_t>(orderedVertices.size());
+			orderedVertices.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(orderedVertices);
+}
+
+float MeshOptimizer::ComputeAcmr(const std::vector<uint32_t> &indices, size_t vertexCount, int iCacheSize)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0f;
+	}
+
+	// Each vertex remembers when it entered the FIFO, so a lookup is a subtraction
+	std::vector<size_t> cacheEntryTimes(vertexCount, 0);
+	size_t time = iCacheSize + 1;
+	size_t missCount = 0;
+	for (auto index : indices)
+	{
+		if (time - cacheEntryTimes[index] > static_cast<size_t>(iCacheSize))
+		{
+			cacheEntryTimes[index] = time++;
+			missCount++;
+		}
+	}
+
+	return static_cast<float>(missCount) / (indices.size() / 3);
+}
@@ -0,0 +1,27 @@
+//
+// MeshOptimizer.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Linear-Speed Vertex Cache Optimisation (https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html)
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "CookedMeshFormat.h"
+
+class MeshOptimizer
+{
+public:
+	// Merges vertices whose position, texture coordinates and normal are bit for bit identical
+	static void WeldVertices(std::vector<CookedVertex> &vertices, std::vector<uint32_t> &indices);
+	// Reorders the triangles so vertices are reused while they are still in the post-transform cache
+	static void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+	// Reorders the vertices by first use so they are fetched in order (unused vertices are removed)
+	static void OptimizeVertexFetch(std::vector<CookedVertex> &vertices, std::vector<uint32_t> &indices);
+	// Average cache miss ratio (transformed vertices per triangle) for a FIFO cache like the hardware's
+	static float ComputeAcmr(const std::vector<uint32_t> &indices, size_t vertexCount, int iCacheSize = 16);
+};
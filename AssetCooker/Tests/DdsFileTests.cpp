@@ -0,0 +1,291 @@
+//
+// DdsFileTests.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// DDS (https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dx-graphics-dds-pguide)
+// DDS_HEADER_DXT10 (https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dds-header-dxt10)
+//
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "DdsFile.h"
+#include "UnitTests.h"
+
+#define DXGI_FORMAT_R8G8B8A8_UNORM 28
+#define DXGI_FORMAT_BC1_UNORM 71
+#define DXGI_FORMAT_BC3_UNORM 77
+#define DXGI_FORMAT_B8G8R8A8_UNORM 87
+
+namespace
+{
+	// Index of each field in the magic and DDS_HEADER, as 32-bit words
+	enum DdsWord : int
+	{
+		MagicWord = 0,
+		HeaderSizeWord,
+		HeightWord = 3,
+		WidthWord,
+		MipCountWord = 7,
+		PixelFormatSizeWord = 19,
+		PixelFormatFlagsWord,
+		FourCCWord,
+		BitCountWord,
+		RedMaskWord,
+		GreenMaskWord,
+		BlueMaskWord,
+		AlphaMaskWord,
+		Caps2Word = 28,
+		DdsWordCount = 32,
+		// DDS_HEADER_DXT10, which follows when the FourCC is DX10
+		FormatWord = DdsWordCount,
+		DimensionWord,
+		MiscFlagWord,
+		ArraySizeWord,
+		Dx10WordCount = DdsWordCount + 5
+	};
+
+	uint32_t FourCC(const char *code)
+	{
+		uint32_t fourCC = 0;
+		memcpy(&fourCC, code, strnlen(code, sizeof(fourCC)));
+		return fourCC;
+	}
+
+	// Header of a 2D texture with the FourCC (DX10 adds the extended header), followed by dataSize bytes of mip data
+	std::vector<uint8_t> MakeFile(uint32_t uiWidth, uint32_t uiHeight, uint32_t uiMipCount, const char *fourCC, size_t dataSize)
+	{
+		bool bIsDx10 = strcmp(fourCC, "DX10") == 0;
+		std::vector<uint32_t> words(bIsDx10 ? Dx10WordCount : DdsWordCount, 0);
+		words[MagicWord] = FourCC("DDS ");
+		words[HeaderSizeWord] = 124;
+		words[HeightWord] = uiHeight;
+		words[WidthWord] = uiWidth;
+		words[MipCountWord] = uiMipCount;
+		words[PixelFormatSizeWord] = 32;
+		words[PixelFormatFlagsWord] = 0x4;
+		words[FourCCWord] = FourCC(fourCC);
+		if (bIsDx10)
+		{
+			words[DimensionWord] = 3;
+			words[ArraySizeWord] = 1;
+		}
+
+		std::vector<uint8_t> file(words.size() * sizeof(uint32_t) + dataSize, 0);
+		memcpy(file.data(), words.data(), words.size() * sizeof(uint32_t));
+		return file;
+	}
+
+	void SetWord(std::vector<uint8_t> &file, int iWord, uint32_t word)
+	{
+		memcpy(&file[iWord * sizeof(uint32_t)], &word, sizeof(word));
+	}
+
+	bool Parse(DdsFile &ddsFile, const std::vector<uint8_t> &file)
+	{
+		return ddsFile.Parse(file.data(), file.size());
+	}
+
+	// Every mip follows the previous one, and the last one ends with the file
+	bool AreMipsContiguous(DdsFile &ddsFile, size_t fileSize)
+	{
+		const DdsTextureInfo &info = ddsFile.GetInfo();
+		uint64_t offset = ddsFile.GetMip(0, 0).offset;
+		for (uint32_t i = 0; i < info.uiArraySize; i++)
+		{
+			for (uint32_t j = 0; j < info.uiMipCount; j++)
+			{
+				if (ddsFile.GetMip(i, j).offset != offset)
+				{
+					return false;
+				}
+				offset += ddsFile.GetMip(i, j).size;
+			}
+		}
+		return offset == fileSize;
+	}
+
+	void TestBlockCompressedMips()
+	{
+		// 8x8 BC1 has 2x2 blocks of 8 bytes, then 1 block for each of the 4x4, 2x2 and 1x1 mips
+		std::vector<uint8_t> file = MakeFile(8, 8, 4, "DXT1", 32 + 8 + 8 + 8);
+		DdsFile ddsFile;
+		CHECK(Parse(ddsFile, file));
+		CHECK(ddsFile.GetInfo().uiFormat == DXGI_FORMAT_BC1_UNORM);
+		CHECK(ddsFile.GetInfo().bIsBlockCompressed);
+		CHECK(ddsFile.GetInfo().uiArraySize == 1);
+		CHECK(ddsFile.GetMip(0, 0).offset == 128);
+		CHECK(ddsFile.GetMip(0, 0).uiRowPitch == 16 && ddsFile.GetMip(0, 0).uiRowCount == 2);
+		CHECK(ddsFile.GetMip(0, 3).uiWidth == 1 && ddsFile.GetMip(0, 3).uiHeight == 1 && ddsFile.GetMip(0, 3).size == 8);
+		CHECK(AreMipsContiguous(ddsFile, file.size()));
+		CHECK(ddsFile.GetMipRangeSize(0, 4) == 56);
+		CHECK(ddsFile.GetMipRangeSize(1, 4) == 24);
+		CHECK(ddsFile.GetMipData(0, 1) == file.data() + 128 + 32);
+	}
+
+	void TestBlockCompressedMipsThatAreNotMultiplesOf4()
+	{
+		// Partial blocks are stored whole: 6x10 is 2x3 blocks, 3x5 is 1x2 and 1x2 is 1x1 (16 bytes each in BC3)
+		std::vector<uint8_t> file = MakeFile(6, 10, 3, "DXT5", (6 + 2 + 1) * 16);
+		DdsFile ddsFile;
+		CHECK(Parse(ddsFile, file));
+		CHECK(ddsFile.GetInfo().uiFormat == DXGI_FORMAT_BC3_UNORM);
+		CHECK(ddsFile.GetMip(0, 0).uiRowPitch == 32 && ddsFile.GetMip(0, 0).uiRowCount == 3);
+		CHECK(ddsFile.GetMip(0, 1).uiWidth == 3 && ddsFile.GetMip(0, 1).uiHeight == 5 && ddsFile.GetMip(0, 1).size == 32);
+		CHECK(ddsFile.GetMip(0, 2).uiWidth == 1 && ddsFile.GetMip(0, 2).uiHeight == 2 && ddsFile.GetMip(0, 2).size == 16);
+		CHECK(AreMipsContiguous(ddsFile, file.size()));
+		CHECK(DdsFile::GetMipSize(DXGI_FORMAT_BC3_UNORM, 3, 5) == 32);
+		CHECK(DdsFile::GetMipSize(DXGI_FORMAT_BC1_UNORM, 5, 1) == 16);
+	}
+
+	void TestUncompressedFormats()
+	{
+		// 32-bit BGRA from the legacy pixel format masks, 3x3 and 1x1 mips
+		std::vector<uint8_t> file = MakeFile(3, 3, 2, "", (9 + 1) * 4);
+		SetWord(file, PixelFormatFlagsWord, 0x41);
+		SetWord(file, BitCountWord, 32);
+		SetWord(file, RedMaskWord, 0x00FF0000);
+		SetWord(file, GreenMaskWord, 0x0000FF00);
+		SetWord(file, BlueMaskWord, 0x000000FF);
+		SetWord(file, AlphaMaskWord, 0xFF000000);
+		DdsFile ddsFile;
+		CHECK(Parse(ddsFile, file));
+		CHECK(ddsFile.GetInfo().uiFormat == DXGI_FORMAT_B8G8R8A8_UNORM);
+		CHECK(!ddsFile.GetInfo().bIsBlockCompressed);
+		CHECK(ddsFile.GetMip(0, 0).uiRowPitch == 12 && ddsFile.GetMip(0, 0).uiRowCount == 3);
+		CHECK(AreMipsContiguous(ddsFile, file.size()));
+	}
+
+	void TestTruncatedFiles()
+	{
+		// Every size short of the whole file is rejected, from an empty file to one missing the last byte of the smallest mip
+		std::vector<uint8_t> file = MakeFile(8, 8, 4, "DXT1", 56);
+		DdsFile ddsFile;
+		CHECK(Parse(ddsFile, file));
+		for (size_t size = 0; size < file.size(); size++)
+		{
+			if (ddsFile.Parse(file.data(), size))
+			{
+				fprintf(stderr, "Parsed a file truncated to %d bytes\n", static_cast<int>(size));
+				CHECK(false);
+				break;
+			}
+		}
+
+		std::vector<uint8_t> arrayFile = MakeFile(4, 4, 1, "DX10", 3 * 64);
+		SetWord(arrayFile, FormatWord, DXGI_FORMAT_R8G8B8A8_UNORM);
+		SetWord(arrayFile, ArraySizeWord, 3);
+		CHECK(Parse(ddsFile, arrayFile));
+		arrayFile.pop_back();
+		CHECK(!Parse(ddsFile, arrayFile));
+		arrayFile.resize(Dx10WordCount * sizeof(uint32_t) - 1);
+		CHECK(!Parse(ddsFile, arrayFile));
+	}
+
+	void TestTextureArrays()
+	{
+		// Each slice holds its whole mip chain (4x4 and 2x2 RGBA) before the next slice starts
+		std::vector<uint8_t> file = MakeFile(4, 4, 2, "DX10", 3 * (64 + 16));
+		SetWord(file, FormatWord, DXGI_FORMAT_R8G8B8A8_UNORM);
+		SetWord(file, ArraySizeWord, 3);
+		DdsFile ddsFile;
+		CHECK(Parse(ddsFile, file));
+		CHECK(ddsFile.GetInfo().uiArraySize == 3);
+		CHECK(!ddsFile.GetInfo().bIsCubeMap);
+		CHECK(ddsFile.GetMip(0, 0).offset == 148);
+		CHECK(ddsFile.GetMip(2, 1).offset == 148 + 2 * 80 + 64);
+		CHECK(ddsFile.GetMip(2, 1).uiWidth == 2 && ddsFile.GetMip(2, 1).size == 16);
+		CHECK(AreMipsContiguous(ddsFile, file.size()));
+		CHECK(ddsFile.GetMipRangeSize(1, 1) == 3 * 16);
+	}
+
+	void TestCubeMaps()
+	{
+		// A DX10 cube array has 6 slices per cube
+		std::vector<uint8_t> file = MakeFile(4, 4, 1, "DX10", 2 * 6 * 8);
+		SetWord(file, FormatWord, DXGI_FORMAT_BC1_UNORM);
+		SetWord(file, MiscFlagWord, 0x4);
+		SetWord(file, ArraySizeWord, 2);
+		DdsFile ddsFile;
+		CHECK(Parse(ddsFile, file));
+		CHECK(ddsFile.GetInfo().bIsCubeMap);
+		CHECK(ddsFile.GetInfo().uiArraySize == 12);
+		CHECK(AreMipsContiguous(ddsFile, file.size()));
+
+		// A legacy cube map has to have every face
+		std::vector<uint8_t> legacyFile = MakeFile(4, 4, 1, "DXT1", 6 * 8);
+		SetWord(legacyFile, Caps2Word, 0x200 | 0xFE00);
+		CHECK(Parse(ddsFile, legacyFile));
+		CHECK(ddsFile.GetInfo().bIsCubeMap);
+		CHECK(ddsFile.GetInfo().uiArraySize == 6);
+		SetWord(legacyFile, Caps2Word, 0x200 | 0x0E00);
+		CHECK(!Parse(ddsFile, legacyFile));
+	}
+
+	void TestUnsupportedFiles()
+	{
+		DdsFile ddsFile;
+
+		std::vector<uint8_t> file = MakeFile(4, 4, 1, "ABCD", 64);
+		CHECK(!Parse(ddsFile, file));
+		CHECK(ddsFile.GetInfo().uiFormat == 0);
+
+		file = MakeFile(4, 4, 1, "DX10", 64);
+		SetWord(file, FormatWord, 1);	// R32G32B32A32_TYPELESS
+		CHECK(!Parse(ddsFile, file));
+
+		file = MakeFile(4, 4, 1, "DX10", 64);
+		SetWord(file, FormatWord, DXGI_FORMAT_R8G8B8A8_UNORM);
+		SetWord(file, DimensionWord, 4);	// Volume texture
+		CHECK(!Parse(ddsFile, file));
+
+		file = MakeFile(4, 4, 1, "DXT1", 8);
+		SetWord(file, Caps2Word, 0x200000);	// Legacy volume texture
+		CHECK(!Parse(ddsFile, file));
+
+		file = MakeFile(4, 4, MAX_DDS_MIP_COUNT + 1, "DXT1", (MAX_DDS_MIP_COUNT + 1) * 8);
+		CHECK(!Parse(ddsFile, file));
+
+		file = MakeFile(0, 4, 1, "DXT1", 8);
+		CHECK(!Parse(ddsFile, file));
+
+		file = MakeFile(4, 4, 1, "DXT1", 8);
+		SetWord(file, MagicWord, FourCC("DDS!"));
+		CHECK(!Parse(ddsFile, file));
+	}
+
+	void TestHostileHeaders()
+	{
+		// Headers that claim far more data than the file has are rejected without laying out (or allocating) their mips
+		DdsFile ddsFile;
+		std::vector<uint8_t> file = MakeFile(4, 4, 1, "DX10", 2 * 64);
+		SetWord(file, FormatWord, DXGI_FORMAT_R8G8B8A8_UNORM);
+		SetWord(file, MiscFlagWord, 0x4);
+		SetWord(file, ArraySizeWord, 0xFFFFFFFF);
+		CHECK(!Parse(ddsFile, file));
+		SetWord(file, ArraySizeWord, 0x2AAAAAAB);	// Wraps to 2 slices if multiplied by 6 in 32 bits
+		CHECK(!Parse(ddsFile, file));
+		SetWord(file, MiscFlagWord, 0);
+		SetWord(file, ArraySizeWord, 0x80000000);
+		CHECK(!Parse(ddsFile, file));
+
+		file = MakeFile(0xFFFFFFFF, 0xFFFFFFFF, 1, "DX10", 64);
+		SetWord(file, FormatWord, 2);	// R32G32B32A32_FLOAT, whose rows overflow 32 bits
+		CHECK(!Parse(ddsFile, file));
+		file = MakeFile(0xFFFFFFFF, 0xFFFFFFFF, 1, "DXT5", 64);
+		CHECK(!Parse(ddsFile, file));
+	}
+}
+
+void UnitTests::TestDdsFile()
+{
+	TestBlockCompressedMips();
+	TestBlockCompressedMipsThatAreNotMultiplesOf4();
+	TestUncompressedFormats();
+	TestTruncatedFiles();
+	TestTextureArrays();
+	TestCubeMaps();
+	TestUnsupportedFiles();
+	TestHostileHeaders();
+}
@@ -0,0 +1,171 @@
+//
+// TextureCacheTests.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// IUnknown (https://docs.microsoft.com/en-us/windows/win32/api/unknwn/nn-unknwn-iunknown)
+//
+
+#include <cstring>
+#include <string>
+#include "TextureCache.h"
+#include "UnitTests.h"
+
+namespace
+{
+	// Counts its references instead of deleting itself, so the tests can see who still holds it
+	class MockTextureView : public ID3D11ShaderResourceView
+	{
+	public:
+		ULONG m_ulReferenceCount = 0;
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void **ppObject) override
+		{
+			*ppObject = nullptr;
+			return E_NOINTERFACE;
+		}
+		ULONG STDMETHODCALLTYPE AddRef() override { return ++m_ulReferenceCount; }
+		ULONG STDMETHODCALLTYPE Release() override { return --m_ulReferenceCount; }
+
+		void STDMETHODCALLTYPE GetDevice(ID3D11Device **ppDevice) override { *ppDevice = nullptr; }
+		HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { return E_NOTIMPL; }
+		void STDMETHODCALLTYPE GetResource(ID3D11Resource **ppResource) override { *ppResource = nullptr; }
+		void STDMETHODCALLTYPE GetDesc(D3D11_SHADER_RESOURCE_VIEW_DESC *pDesc) override { memset(pDesc, 0, sizeof(*pDesc)); }
+	};
+
+	// Hands out the view with the creator's reference, like the texture loaders, and counts how often it was asked to
+	TextureCache::CreateFunction Creator(MockTextureView &view, int &iCreateCount)
+	{
+		return [&view, &iCreateCount](ID3D11ShaderResourceView **ppTexture)
+		{
+			iCreateCount++;
+			view.AddRef();
+			*ppTexture = &view;
+			return S_OK;
+		};
+	}
+
+	uint64_t Key(const char *name)
+	{
+		return TextureCache::HashKey("test", name, strlen(name));
+	}
+
+	void TestHitsAndMisses()
+	{
+		MockTextureView view;
+		int iCreateCount = 0;
+		{
+			TextureCache cache(nullptr);
+			ID3D11ShaderResourceView *pFirst = cache.GetTexture(Key("a"), Creator(view, iCreateCount));
+			CHECK(pFirst == &view);
+			CHECK(iCreateCount == 1);
+			CHECK(view.m_ulReferenceCount == 2); // The cache's and the caller's
+
+			ID3D11ShaderResourceView *pSecond = cache.GetTexture(Key("a"), Creator(view, iCreateCount));
+			CHECK(pSecond == &view);
+			CHECK(iCreateCount == 1);
+			CHECK(view.m_ulReferenceCount == 3);
+			CHECK(cache.GetReport() == "Texture cache: 1 textures, 1 hits, 1 misses\n");
+
+			pFirst->Release();
+			pSecond->Release();
+		}
+		CHECK(view.m_ulReferenceCount == 0);
+	}
+
+	void TestKeysOfDifferentKinds()
+	{
+		const char data[] = "abcd";
+		CHECK(TextureCache::HashKey("color", data, 4) != TextureCache::HashKey("memory", data, 4));
+		CHECK(TextureCache::HashKey("color", data, 4) == TextureCache::HashKey("color", data, 4));
+	}
+
+	void TestCreateFailures()
+	{
+		TextureCache cache(nullptr);
+		int iCreateCount = 0;
+		auto failingCreator = [&iCreateCount](ID3D11ShaderResourceView **ppTexture)
+		{
+			iCreateCount++;
+			*ppTexture = nullptr;
+			return E_FAIL;
+		};
+		CHECK(cache.GetTexture(Key("a"), failingCreator) == nullptr);
+		CHECK(cache.GetTexture(Key("a"), failingCreator) == nullptr); // Failures are not cached, so it is tried again
+		CHECK(iCreateCount == 2);
+
+		// Succeeding without a texture is a failure too
+		CHECK(cache.GetTexture(Key("b"), [](ID3D11ShaderResourceView **ppTexture) { *ppTexture = nullptr; return S_OK; }) == nullptr);
+		CHECK(cache.GetReport() == "Texture cache: 0 textures, 0 hits, 0 misses\n");
+	}
+
+	// The cache is not locked while a texture is created, so the creator can get the same key from the cache, as another thread would
+	void TestFirstInsertWins()
+	{
+		MockTextureView firstView;
+		MockTextureView secondView;
+		int iFirstCreateCount = 0;
+		int iSecondCreateCount = 0;
+		{
+			TextureCache cache(nullptr);
+			ID3D11ShaderResourceView *pInner = nullptr;
+			ID3D11ShaderResourceView *pOuter = cache.GetTexture(Key("a"), [&](ID3D11ShaderResourceView **ppTexture)
+			{
+				pInner = cache.GetTexture(Key("a"), Creator(firstView, iFirstCreateCount));
+				return Creator(secondView, iSecondCreateCount)(ppTexture);
+			});
+
+			CHECK(pInner == &firstView);
+			CHECK(pOuter == &firstView);
+			CHECK(iFirstCreateCount == 1);
+			CHECK(iSecondCreateCount == 1);
+			CHECK(firstView.m_ulReferenceCount == 3); // The cache's and both callers'
+			CHECK(secondView.m_ulReferenceCount == 0);
+
+			pInner->Release();
+			pOuter->Release();
+		}
+		CHECK(firstView.m_ulReferenceCount == 0);
+	}
+
+	void TestReleaseUnused()
+	{
+		MockTextureView usedView;
+		MockTextureView unusedView;
+		int iCreateCount = 0;
+		{
+			TextureCache cache(nullptr);
+			ID3D11ShaderResourceView *pUsed = cache.GetTexture(Key("used"), Creator(usedView, iCreateCount));
+			cache.GetTexture(Key("unused"), Creator(unusedView, iCreateCount))->Release();
+
+			CHECK(cache.ReleaseUnused() == 1);
+			CHECK(unusedView.m_ulReferenceCount == 0);
+			CHECK(usedView.m_ulReferenceCount == 2);
+			CHECK(cache.ReleaseUnused() == 0);
+
+			// A released texture is created again the next time it is needed
+			ID3D11ShaderResourceView *pUnused = cache.GetTexture(Key("unused"), Creator(unusedView, iCreateCount));
+			CHECK(iCreateCount == 3);
+			CHECK(unusedView.m_ulReferenceCount == 2);
+			CHECK(cache.GetReport() == "Texture cache: 2 textures, 0 hits, 3 misses\n");
+
+			pUsed->Release();
+			pUnused->Release();
+			CHECK(cache.ReleaseUnused() == 2);
+			CHECK(cache.GetReport() == "Texture cache: 0 textures, 0 hits, 3 misses\n");
+		}
+		CHECK(usedView.m_ulReferenceCount == 0);
+		CHECK(unusedView.m_ulReferenceCount == 0);
+	}
+}
+
+void UnitTests::TestTextureCache()
+{
+	TestHitsAndMisses();
+	TestKeysOfDifferentKinds();
+	TestCreateFailures();
+	TestFirstInsertWins();
+	TestReleaseUnused();
+}
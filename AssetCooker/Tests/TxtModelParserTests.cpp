@@ -0,0 +1,130 @@
+//
+// TxtModelParserTests.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// RasterTek Tutorial 8: Loading Maya 2011 Models (http://www.rastertek.com/dx11tut08.html)
+//
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "TxtModelParser.h"
+#include "UnitTests.h"
+
+#define MIN_PARSE_BENCHMARK_SECONDS 0.05	// Each file is parsed repeatedly by both parsers for at least this long
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// Calls the parser repeatedly and returns the average time of one call in milliseconds
+	double MeasureMilliseconds(VertexData* (*Parse)(const char*, int&), const char *filePath)
+	{
+		int iCallCount = 0;
+		double dSeconds = 0.0;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		while (dSeconds < MIN_PARSE_BENCHMARK_SECONDS)
+		{
+			int iVertexCount = 0;
+			delete[] Parse(filePath, iVertexCount);
+			iCallCount++;
+			dSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		}
+		return dSeconds * 1000.0 / iCallCount;
+	}
+
+	// The parser must read exactly what the stream based loader reads, byte for byte
+	bool ParsesLikeStream(const char *filePath, int iExpectedVertexCount)
+	{
+		int iVertexCount = 0;
+		VertexData *vertexData = TxtModelParser::Parse(filePath, iVertexCount);
+		int iStreamVertexCount = 0;
+		VertexData *streamVertexData = TxtModelParser::ParseWithStream(filePath, iStreamVertexCount);
+
+		bool bIsIdentical = vertexData != nullptr && streamVertexData != nullptr && iVertexCount == iExpectedVertexCount &&
+							iStreamVertexCount == iExpectedVertexCount && memcmp(vertexData, streamVertexData, sizeof(VertexData) * iVertexCount) == 0;
+
+		delete[] vertexData;
+		delete[] streamVertexData;
+
+		return bIsIdentical;
+	}
+
+	void WriteFile(const fs::path &path, const char *text)
+	{
+		std::ofstream file(path, std::ios::binary);
+		file << text;
+	}
+
+	void TestGameModels()
+	{
+		const char *filePaths[] = { GAME_RESOURCE_DIRECTORY "plane.txt", GAME_RESOURCE_DIRECTORY "skydome.txt" };
+		const int vertexCounts[] = { 6, 2280 };
+		for (int i = 0; i < 2; i++)
+		{
+			CHECK(ParsesLikeStream(filePaths[i], vertexCounts[i]));
+			printf("%s: %d vertices parsed in %.3f ms (stream: %.3f ms)\n", fs::path(filePaths[i]).filename().string().c_str(), vertexCounts[i],
+				   MeasureMilliseconds(TxtModelParser::Parse, filePaths[i]), MeasureMilliseconds(TxtModelParser::ParseWithStream, filePaths[i]));
+		}
+	}
+
+	// Windows line endings, exponents, signs and a last line without a line ending
+	void TestNumberFormats()
+	{
+		fs::path path = fs::temp_directory_path() / "TxtModelParserTests.txt";
+		WriteFile(path, "Vertex Count: 2\r\n\r\nData:\r\n\r\n"
+						"-1.5 0 2.25e1 0.0 1.0 -0 1 0\r\n"
+						"3.4028e38 -1e-3 0.1 1 0.333333 0.577350 -0.577350 0.577350");
+		CHECK(ParsesLikeStream(path.string().c_str(), 2));
+		fs::remove(path);
+	}
+
+	void TestBadFiles()
+	{
+		int iVertexCount = 0;
+		CHECK(TxtModelParser::Parse(GAME_RESOURCE_DIRECTORY "missing.txt", iVertexCount) == nullptr);
+
+		fs::path path = fs::temp_directory_path() / "TxtModelParserTests.txt";
+		WriteFile(path, "Vertex Count: 2\n\nData:\n\n0 0 0 0 0 0 1 0\n0 0 0");
+		CHECK(TxtModelParser::Parse(path.string().c_str(), iVertexCount) == nullptr); // Fewer values than the vertex count needs
+		WriteFile(path, "Vertex Count 2");
+		CHECK(TxtModelParser::Parse(path.string().c_str(), iVertexCount) == nullptr);
+		WriteFile(path, "");
+		CHECK(TxtModelParser::Parse(path.string().c_str(), iVertexCount) == nullptr);
+		fs::remove(path);
+	}
+
+	void TestWeldVertices()
+	{
+		int iVertexCount = 0;
+		VertexData *vertexData = TxtModelParser::Parse(GAME_RESOURCE_DIRECTORY "plane.txt", iVertexCount);
+		CHECK(vertexData != nullptr);
+		if (vertexData == nullptr)
+		{
+			return;
+		}
+		std::vector<VertexData> originalVertices(vertexData, vertexData + iVertexCount);
+
+		// The plane's two triangles share two corners
+		std::vector<uint32_t> indices = TxtModelParser::WeldVertices(vertexData, iVertexCount);
+		CHECK(iVertexCount == 4);
+		CHECK(indices.size() == originalVertices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			CHECK(indices[i] < uint32_t(iVertexCount) && memcmp(&vertexData[indices[i]], &originalVertices[i], sizeof(VertexData)) == 0);
+		}
+
+		delete[] vertexData;
+	}
+}
+
+void UnitTests::TestTxtModelParser()
+{
+	TestGameModels();
+	TestNumberFormats();
+	TestBadFiles();
+	TestWeldVertices();
+}
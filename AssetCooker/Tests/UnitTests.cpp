@@ -0,0 +1,56 @@
+//
+// UnitTests.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Usage: AssetCookerTests [test name]
+// Runs every test if no name is given, returns 0 if every check passed
+//
+
+#include <cstring>
+#include "UnitTests.h"
+
+int UnitTests::iFailedCheckCount = 0;
+
+namespace
+{
+	struct UnitTest
+	{
+		const char *name;
+		void (*Run)();
+	};
+
+	const UnitTest tests[] =
+	{
+		{ "DdsFile", UnitTests::TestDdsFile },
+		{ "TxtModelParser", UnitTests::TestTxtModelParser },
+#if HAS_DIRECTXMATH
+		{ "VertexQuantization", UnitTests::TestVertexQuantization },
+#endif
+#if HAS_D3D11
+		{ "TextureCache", UnitTests::TestTextureCache },
+#endif
+	};
+}
+
+int main(int argc, char *argv[])
+{
+	int iRunCount = 0;
+	for (auto &test : tests)
+	{
+		if (argc < 2 || strcmp(argv[1], test.name) == 0)
+		{
+			int iPreviousFailedCount = UnitTests::iFailedCheckCount;
+			test.Run();
+			printf("%-24s %s\n", test.name, UnitTests::iFailedCheckCount == iPreviousFailedCount ? "passed" : "FAILED");
+			iRunCount++;
+		}
+	}
+
+	if (iRunCount == 0)
+	{
+		fprintf(stderr, "No test is called %s\n", argv[1]);
+		return 1;
+	}
+
+	return UnitTests::iFailedCheckCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+//
+// UnitTests.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Unit tests of the game code that builds without a Direct3D device, run by CTest
+//
+
+#pragma once
+
+#include <cstdio>
+
+// Reports the failed check and carries on with the test, so one run shows every failure
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			UnitTests::iFailedCheckCount++; \
+		} \
+	} while (false)
+
+class UnitTests
+{
+public:
+	static int iFailedCheckCount;
+
+	static void TestDdsFile();
+	static void TestTxtModelParser();
+#if HAS_DIRECTXMATH
+	static void TestVertexQuantization();
+#endif
+#if HAS_D3D11
+	static void TestTextureCache();
+#endif
+};
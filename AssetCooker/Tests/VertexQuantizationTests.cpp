@@ -0,0 +1,174 @@
+//
+// VertexQuantizationTests.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// A Survey of Efficient Representations for Independent Unit Vectors (http://jcgt.org/published/0003/02/01)
+//
+
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "UnitTests.h"
+#include "VertexQuantization.h"
+
+#define POSITION_STEP (1.0f / 32767.0f)		// Step of a snorm16 position, relative to the extents of the bounds
+#define MAX_NORMAL_ERROR 0.001f
+#define MAX_TEXCOORD_RELATIVE_ERROR (1.0f / 2048.0f)	// Half a step of the 11-bit significand of a half float
+#define RANDOM_VERTEX_COUNT 10000
+
+namespace
+{
+	XMFLOAT3 RandomUnitVector(std::mt19937 &random)
+	{
+		std::normal_distribution<float> distribution;
+		XMFLOAT3 vector;
+		do
+		{
+			vector = XMFLOAT3(distribution(random), distribution(random), distribution(random));
+		} while (vector.x * vector.x + vector.y * vector.y + vector.z * vector.z < 1e-6f);
+		XMStoreFloat3(&vector, XMVector3Normalize(XMLoadFloat3(&vector)));
+		return vector;
+	}
+
+	// Random vertices inside the bounds, with two at opposite corners so the bounds are tight
+	std::vector<Vertex> MakeVertices(XMFLOAT3 center, XMFLOAT3 extents, std::mt19937 &random)
+	{
+		std::uniform_real_distribution<float> unitDistribution(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> textureDistribution(-4.0f, 4.0f);
+		std::vector<Vertex> vertices(RANDOM_VERTEX_COUNT);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			float fCorner = i == 0 ? -1.0f : 1.0f;
+			vertices[i].position = i < 2 ?
+				XMFLOAT3(center.x + fCorner * extents.x, center.y + fCorner * extents.y, center.z + fCorner * extents.z) :
+				XMFLOAT3(center.x + unitDistribution(random) * extents.x, center.y + unitDistribution(random) * extents.y,
+						 center.z + unitDistribution(random) * extents.z);
+			vertices[i].textureCoordinates = XMFLOAT2(textureDistribution(random), textureDistribution(random));
+			vertices[i].normal = RandomUnitVector(random);
+		}
+		return vertices;
+	}
+
+	// Rounding to the nearest step leaves an error of at most half a step on every axis, and close to half a step on some vertex
+	void TestPositionError(XMFLOAT3 center, XMFLOAT3 extents, std::mt19937 &random)
+	{
+		std::vector<Vertex> vertices = MakeVertices(center, extents, random);
+		QuantizationBounds bounds = VertexQuantization::ComputeBounds(BoundingBox(center, extents));
+		std::vector<QuantizedVertex> quantizedVertices;
+		VertexQuantization::Encode(vertices, bounds, quantizedVertices);
+		CHECK(quantizedVertices.size() == vertices.size());
+		CHECK(VertexQuantization::ValidateEncoding(vertices, quantizedVertices, bounds));
+
+		const float *boundsCenter = &bounds.center.x;
+		const float *boundsExtents = &bounds.extents.x;
+		float maxError[3] = {};
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			Vertex decodedVertex = VertexQuantization::Decode(quantizedVertices[i], bounds);
+			const float *position = &vertices[i].position.x;
+			const float *decodedPosition = &decodedVertex.position.x;
+			for (int j = 0; j < 3; j++)
+			{
+				maxError[j] = std::max(maxError[j], fabsf(decodedPosition[j] - position[j]));
+			}
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			float fHalfStep = boundsExtents[j] * POSITION_STEP * 0.5f;
+			float fRoundingError = (fabsf(boundsCenter[j]) + boundsExtents[j]) * 4.0f * FLT_EPSILON;
+			CHECK(maxError[j] <= fHalfStep + fRoundingError);
+			if (boundsExtents[j] > 1.0f)
+			{
+				CHECK(maxError[j] > fHalfStep * 0.9f);
+			}
+		}
+	}
+
+	void TestPositions()
+	{
+		std::mt19937 random(1);
+		TestPositionError(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), random);
+		TestPositionError(XMFLOAT3(0.5f, -2.0f, 3.0f), XMFLOAT3(20.0f, 4.0f, 0.25f), random);
+		TestPositionError(XMFLOAT3(-1000.0f, 250.0f, 4000.0f), XMFLOAT3(50.0f, 300.0f, 10.0f), random);
+
+		// Flat meshes use the smallest extent on their flat axis rather than dividing by zero
+		TestPositionError(XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(30.0f, 0.0f, 30.0f), random);
+	}
+
+	void TestNormals()
+	{
+		std::vector<XMFLOAT3> normals =
+		{
+			XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f),
+			XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.57735f, -0.57735f, -0.57735f)
+		};
+		std::mt19937 random(2);
+		for (int i = 0; i < RANDOM_VERTEX_COUNT; i++)
+		{
+			normals.push_back(RandomUnitVector(random));
+		}
+
+		float fMaxError = 0.0f;
+		for (auto &normal : normals)
+		{
+			XMFLOAT2 encodedNormal = VertexQuantization::EncodeOctahedralNormal(normal);
+			CHECK(fabsf(encodedNormal.x) <= 1.0f && fabsf(encodedNormal.y) <= 1.0f);
+
+			// Through snorm16, as stored in the vertex buffer
+			XMSHORTN2 storedNormal;
+			XMStoreShortN2(&storedNormal, XMLoadFloat2(&encodedNormal));
+			XMStoreFloat2(&encodedNormal, XMLoadShortN2(&storedNormal));
+			XMFLOAT3 decodedNormal = VertexQuantization::DecodeOctahedralNormal(encodedNormal);
+			fMaxError = std::max({ fMaxError, fabsf(decodedNormal.x - normal.x), fabsf(decodedNormal.y - normal.y), fabsf(decodedNormal.z - normal.z) });
+		}
+		CHECK(fMaxError <= MAX_NORMAL_ERROR);
+
+		// A zero normal encodes to the centre of the octahedron instead of dividing by zero
+		XMFLOAT2 encodedZero = VertexQuantization::EncodeOctahedralNormal(XMFLOAT3(0.0f, 0.0f, 0.0f));
+		CHECK(encodedZero.x == 0.0f && encodedZero.y == 0.0f);
+	}
+
+	void TestTextureCoordinates()
+	{
+		std::mt19937 random(3);
+		std::vector<Vertex> vertices = MakeVertices(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), random);
+		QuantizationBounds bounds = VertexQuantization::ComputeBounds(BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+		std::vector<QuantizedVertex> quantizedVertices;
+		VertexQuantization::Encode(vertices, bounds, quantizedVertices);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			Vertex decodedVertex = VertexQuantization::Decode(quantizedVertices[i], bounds);
+			const XMFLOAT2 &textureCoordinates = vertices[i].textureCoordinates;
+			CHECK(fabsf(decodedVertex.textureCoordinates.x - textureCoordinates.x) <= fabsf(textureCoordinates.x) * MAX_TEXCOORD_RELATIVE_ERROR);
+			CHECK(fabsf(decodedVertex.textureCoordinates.y - textureCoordinates.y) <= fabsf(textureCoordinates.y) * MAX_TEXCOORD_RELATIVE_ERROR);
+		}
+	}
+
+	void TestValidation()
+	{
+		// A vertex at the centre of the bounds is stored exactly, so moving it one step is a full step of error, which is more than the encoding allows
+		std::vector<Vertex> vertices(1, Vertex(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(0.5f, 0.5f), XMFLOAT3(0.0f, 1.0f, 0.0f)));
+		QuantizationBounds bounds = VertexQuantization::ComputeBounds(BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(2.0f, 2.0f, 2.0f)));
+		std::vector<QuantizedVertex> quantizedVertices;
+		VertexQuantization::Encode(vertices, bounds, quantizedVertices);
+		CHECK(quantizedVertices[0].position.x == 0);
+		CHECK(VertexQuantization::ValidateEncoding(vertices, quantizedVertices, bounds));
+
+		quantizedVertices[0].position.x++;
+		CHECK(!VertexQuantization::ValidateEncoding(vertices, quantizedVertices, bounds));
+		quantizedVertices[0].position.x--;
+
+		quantizedVertices[0].normal.x += 100;
+		CHECK(!VertexQuantization::ValidateEncoding(vertices, quantizedVertices, bounds));
+	}
+}
+
+void UnitTests::TestVertexQuantization()
+{
+	TestPositions();
+	TestNormals();
+	TestTextureCoordinates();
+	TestValidation();
+}
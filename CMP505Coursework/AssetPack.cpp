@@ -0,0 +1,349 @@
+//
+// AssetPack.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// File Mapping (https://docs.microsoft.com/en-us/windows/win32/memory/file-mapping)
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include "AssetPack.h"
+#include "LzCodec.h"
+#include "SafeFileWriter.h"
+
+#pragma region AssetPack
+
+AssetPack *AssetPack::pMountedPack = nullptr;
+
+AssetPack::AssetPack()
+{
+	m_pHeader = nullptr;
+	m_pEntries = nullptr;
+}
+
+bool AssetPack::Open(const char *filePath, const std::string &strRootDirectory)
+{
+	Close();
+	if (!m_file.Open(filePath) || m_file.GetSize() < sizeof(AssetPackHeader))
+	{
+		Close();
+		return false;
+	}
+
+	m_pHeader = reinterpret_cast<const AssetPackHeader*>(m_file.GetData());
+	if (m_pHeader->magic != ASSET_PACK_MAGIC || m_pHeader->version != ASSET_PACK_VERSION ||
+		!IsSectionInFile(m_pHeader->entryTableOffset, uint64_t(m_pHeader->entryCount) * sizeof(AssetPackEntry)))
+	{
+		Close();
+		return false;
+	}
+
+	m_pEntries = reinterpret_cast<const AssetPackEntry*>(m_file.GetData() + m_pHeader->entryTableOffset);
+	for (uint32_t i = 0; i < m_pHeader->entryCount; i++)
+	{
+		const AssetPackEntry &entry = m_pEntries[i];
+		bool bIsCompressed = (entry.flags & ASSET_PACK_COMPRESSED) != 0;
+		if (!IsSectionInFile(entry.dataOffset, entry.storedSize) || (!bIsCompressed && entry.storedSize != entry.size) ||
+			memchr(entry.path, '\0', sizeof(entry.path)) == nullptr)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	m_strRootDirectory = NormalizePath(strRootDirectory);
+	if (!m_strRootDirectory.empty() && m_strRootDirectory.back() != '/')
+	{
+		m_strRootDirectory += '/';
+	}
+
+	return true;
+}
+
+void AssetPack::Close()
+{
+	m_file.Close();
+	m_pHeader = nullptr;
+	m_pEntries = nullptr;
+	m_decodedData.clear();
+	m_overriddenPaths.clear();
+}
+
+int AssetPack::GetEntryCount()
+{
+	return m_pHeader != nullptr ? static_cast<int>(m_pHeader->entryCount) : 0;
+}
+
+bool AssetPack::Contains(const std::string &strFilePath)
+{
+	return FindEntry(strFilePath) != nullptr;
+}
+
+bool AssetPack::Find(const std::string &strFilePath, const char *&pData, size_t &size)
+{
+	const AssetPackEntry *pEntry = FindEntry(strFilePath);
+	if (pEntry == nullptr)
+	{
+		return false;
+	}
+
+	const char *pStoredData = m_file.GetData() + pEntry->dataOffset;
+	if ((pEntry->flags & ASSET_PACK_COMPRESSED) == 0)
+	{
+		pData = pStoredData;
+		size = static_cast<size_t>(pEntry->size);
+		return true;
+	}
+
+	// Decoded while locked, so two threads never decode the same data (the compressed files are small text files)
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::unique_ptr<char[]> &decodedData = m_decodedData[pEntry->dataOffset];
+	if (decodedData == nullptr)
+	{
+		std::unique_ptr<char[]> data(new char[pEntry->size > 0 ? static_cast<size_t>(pEntry->size) : 1]);
+		if (!LzCodec::Decode(reinterpret_cast<const uint8_t*>(pStoredData), static_cast<size_t>(pEntry->storedSize), reinterpret_cast<uint8_t*>(data.get()),
+							 static_cast<size_t>(pEntry->size)))
+		{
+			m_decodedData.erase(pEntry->dataOffset);
+			return false;
+		}
+		decodedData = std::move(data);
+	}
+
+	pData = decodedData.get();
+	size = static_cast<size_t>(pEntry->size);
+
+	return true;
+}
+
+bool AssetPack::GetContentHash(const std::string &strFilePath, uint64_t &hash)
+{
+	const AssetPackEntry *pEntry = FindEntry(strFilePath);
+	if (pEntry == nullptr)
+	{
+		return false;
+	}
+
+	hash = pEntry->contentHash;
+
+	return true;
+}
+
+void AssetPack::Override(const std::string &strFilePath)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_overriddenPaths.insert(NormalizePath(strFilePath));
+}
+
+bool AssetPack::Mount(const char *filePath, const std::string &strRootDirectory)
+{
+	Unmount();
+
+	AssetPack *pPack = new AssetPack();
+	if (!pPack->Open(filePath, strRootDirectory))
+	{
+		delete pPack;
+		return false;
+	}
+	pMountedPack = pPack;
+
+	return true;
+}
+
+void AssetPack::Unmount()
+{
+	delete pMountedPack;
+	pMountedPack = nullptr;
+}
+
+AssetPack* AssetPack::GetMounted()
+{
+	return pMountedPack;
+}
+
+const AssetPackEntry* AssetPack::FindEntry(const std::string &strFilePath)
+{
+	std::string strPath = NormalizePath(strFilePath);
+	if (m_pHeader == nullptr || strPath.compare(0, m_strRootDirectory.size(), m_strRootDirectory) != 0)
+	{
+		return nullptr;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_overriddenPaths.find(strPath) != m_overriddenPaths.end())
+		{
+			return nullptr;
+		}
+	}
+
+	// Paths with the same hash are next to each other, so the path itself is compared from the first one on
+	strPath.erase(0, m_strRootDirectory.size());
+	uint64_t pathHash = HashAssetPackPath(strPath.data(), strPath.size());
+	const AssetPackEntry *pEnd = m_pEntries + m_pHeader->entryCount;
+	const AssetPackEntry *pEntry = std::lower_bound(m_pEntries, pEnd, pathHash, [](const AssetPackEntry &entry, uint64_t pathHash)
+	{
+		return entry.pathHash < pathHash;
+	});
+	for (; pEntry < pEnd && pEntry->pathHash == pathHash; pEntry++)
+	{
+		if (strPath == pEntry->path)
+		{
+			return pEntry;
+		}
+	}
+
+	return nullptr;
+}
+
+bool AssetPack::IsSectionInFile(uint64_t offset, uint64_t size)
+{
+	return offset <= m_file.GetSize() && size <= m_file.GetSize() - offset;
+}
+
+std::string AssetPack::NormalizePath(const std::string &strFilePath)
+{
+	// Assimp joins the directory and the file name with the OS separator, which can double it
+	std::string strPath;
+	strPath.reserve(strFilePath.size());
+	for (char c : strFilePath)
+	{
+		c = c == '\\' ? '/' : c;
+		if (c != '/' || strPath.empty() || strPath.back() != '/')
+		{
+			strPath += c;
+		}
+	}
+	while (strPath.compare(0, 2, "./") == 0)
+	{
+		strPath.erase(0, 2);
+	}
+	return strPath;
+}
+
+#pragma endregion
+
+#pragma region AssetPackWriter
+
+AssetPackWriter::AssetPackWriter()
+{
+	m_bCompress = false;
+}
+
+bool AssetPackWriter::AddFile(const std::string &strPackPath, const char *filePath)
+{
+	MappedFile file;
+	if (strPackPath.size() >= MAX_ASSET_PACK_PATH_LENGTH || !file.Open(filePath))
+	{
+		return false;
+	}
+
+	PackedFile packedFile;
+	packedFile.strPath = strPackPath;
+	packedFile.data.assign(file.GetData(), file.GetData() + file.GetSize());
+	m_files.push_back(std::move(packedFile));
+
+	return true;
+}
+
+void AssetPackWriter::SetCompression(bool bCompress)
+{
+	m_bCompress = bCompress;
+}
+
+bool AssetPackWriter::Write(const std::string &strFilePath, AssetPackStats &stats, bool &bIsUpToDate)
+{
+	auto align = [](uint64_t offset) { return (offset + ASSET_PACK_ALIGNMENT - 1) & ~uint64_t(ASSET_PACK_ALIGNMENT - 1); };
+
+	stats = {};
+	bIsUpToDate = false;
+	AssetPackHeader header = {};
+	header.magic = ASSET_PACK_MAGIC;
+	header.version = ASSET_PACK_VERSION;
+	header.entryCount = static_cast<uint32_t>(m_files.size());
+	header.entryTableOffset = sizeof(AssetPackHeader);
+	header.dataOffset = align(header.entryTableOffset + m_files.size() * sizeof(AssetPackEntry));
+
+	// The data is laid out in the order the files were added, so files that are read together stay together
+	std::vector<AssetPackEntry> entries(m_files.size());
+	std::vector<std::pair<uint64_t, std::vector<uint8_t>>> storedData;	// Each distinct content, by the offset it is stored at
+	std::unordered_map<uint64_t, size_t> firstFileOfContent;	// By content hash
+	uint64_t dataEnd = header.dataOffset;
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		const PackedFile &file = m_files[i];
+		AssetPackEntry &entry = entries[i];
+		entry.pathHash = HashAssetPackPath(file.strPath.data(), file.strPath.size());
+		entry.contentHash = HashCookedMeshData(file.data.data(), file.data.size());
+		entry.size = file.data.size();
+		memcpy(entry.path, file.strPath.data(), file.strPath.size());
+		stats.fileBytes += entry.size;
+
+		// Files with the same content share the data of the first one (compared in full, in case the hashes collide)
+		auto sameContent = firstFileOfContent.find(entry.contentHash);
+		if (sameContent != firstFileOfContent.end() && m_files[sameContent->second].data == file.data)
+		{
+			const AssetPackEntry &sharedEntry = entries[sameContent->second];
+			entry.dataOffset = sharedEntry.dataOffset;
+			entry.storedSize = sharedEntry.storedSize;
+			entry.flags = sharedEntry.flags;
+			stats.iSharedCount++;
+			continue;
+		}
+		firstFileOfContent.emplace(entry.contentHash, i);
+
+		std::vector<uint8_t> data(file.data.begin(), file.data.end());
+		if (m_bCompress)
+		{
+			std::vector<uint8_t> compressedData;
+			LzCodec::Encode(data.data(), data.size(), compressedData);
+			if (compressedData.size() <= data.size() - data.size() / 8)
+			{
+				data = std::move(compressedData);
+				entry.flags |= ASSET_PACK_COMPRESSED;
+				stats.iCompressedCount++;
+			}
+		}
+
+		entry.dataOffset = align(dataEnd);
+		entry.storedSize = data.size();
+		dataEnd = entry.dataOffset + entry.storedSize;
+		stats.storedBytes += entry.storedSize;
+		storedData.emplace_back(entry.dataOffset, std::move(data));
+	}
+	header.dataCount = static_cast<uint32_t>(storedData.size());
+	stats.iEntryCount = static_cast<int>(entries.size());
+
+	std::vector<char> fileData(static_cast<size_t>(dataEnd), 0);
+	for (auto &data : storedData)
+	{
+		if (!data.second.empty())
+		{
+			memcpy(&fileData[static_cast<size_t>(data.first)], data.second.data(), data.second.size());
+		}
+	}
+
+	std::stable_sort(entries.begin(), entries.end(), [](const AssetPackEntry &a, const AssetPackEntry &b) { return a.pathHash < b.pathHash; });
+	memcpy(&fileData[0], &header, sizeof(header));
+	if (!entries.empty())
+	{
+		memcpy(&fileData[static_cast<size_t>(header.entryTableOffset)], entries.data(), entries.size() * sizeof(AssetPackEntry));
+	}
+
+	{
+		MappedFile existingFile;
+		if (existingFile.Open(strFilePath.c_str()) && existingFile.GetSize() == fileData.size() &&
+			memcmp(existingFile.GetData(), fileData.data(), fileData.size()) == 0)
+		{
+			bIsUpToDate = true;
+			return true;
+		}
+	}
+
+	return SafeFileWriter::Write(strFilePath, fileData.data(), fileData.size());
+}
+
+#pragma endregion
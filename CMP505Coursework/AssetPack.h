@@ -0,0 +1,100 @@
+//
+// AssetPack.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// File Mapping (https://docs.microsoft.com/en-us/windows/win32/memory/file-mapping)
+//
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "AssetPackFormat.h"
+#include "MappedFile.h"
+
+// Memory-mapped asset pack, the files are views into the mapping (or into their decoded data if they are compressed)
+// Paths are looked up relative to the root directory the pack is opened with ("Resources/clock.obj" is "clock.obj" in a pack of "Resources/"),
+// and '\' and '/' are treated as the same separator
+// The mounted pack is read by MappedFile, so every file opened through it comes from the pack if the pack has it
+class AssetPack
+{
+public:
+	AssetPack();
+
+	// Fails if the file is missing, truncated or was written by another version of the format
+	bool Open(const char *filePath, const std::string &strRootDirectory);
+	void Close();
+	int GetEntryCount();
+	bool Contains(const std::string &strFilePath);
+	// The data stays valid until the pack is closed, compressed files are decoded the first time they are found
+	// Any thread can find any file
+	bool Find(const std::string &strFilePath, const char *&pData, size_t &size);
+	// Hash of the file as it was on disk (without decoding it)
+	bool GetContentHash(const std::string &strFilePath, uint64_t &hash);
+	// The file is read from disk from now on (for files changed after the pack was built)
+	void Override(const std::string &strFilePath);
+
+	// Mounted before the threads that read files start, and unmounted after they stop
+	static bool Mount(const char *filePath, const std::string &strRootDirectory);
+	static void Unmount();
+	// nullptr if no pack is mounted
+	static AssetPack* GetMounted();
+
+private:
+	MappedFile m_file;
+	std::string m_strRootDirectory;
+	const AssetPackHeader *m_pHeader;
+	const AssetPackEntry *m_pEntries;
+	std::map<uint64_t, std::unique_ptr<char[]>> m_decodedData;	// By data offset, so files with the same content are decoded once
+	std::set<std::string> m_overriddenPaths;
+	std::mutex m_mutex;
+
+	static AssetPack *pMountedPack;
+
+	// nullptr if the file is not in the pack (or is overridden)
+	const AssetPackEntry* FindEntry(const std::string &strFilePath);
+	bool IsSectionInFile(uint64_t offset, uint64_t size);
+	static std::string NormalizePath(const std::string &strFilePath);
+
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+};
+
+struct AssetPackStats
+{
+	int iEntryCount;
+	int iSharedCount;						// Entries that share the data of an earlier entry
+	int iCompressedCount;
+	uint64_t fileBytes;						// The files as they are on disk
+	uint64_t storedBytes;					// The data in the pack (shared data counted once, without the alignment)
+};
+
+// Collects files and writes them as a pack
+class AssetPackWriter
+{
+public:
+	AssetPackWriter();
+
+	// The path is stored as given (relative to the directory the pack is opened with), fails if the file cannot be read or the path is too long
+	bool AddFile(const std::string &strPackPath, const char *filePath);
+	// Compresses the files with LzCodec when it makes them at least an eighth smaller
+	void SetCompression(bool bCompress);
+	// Builds the whole pack in memory and writes it to a temporary file first, so a partially written pack is never mounted
+	// The file is left as it is if it already holds the same pack
+	bool Write(const std::string &strFilePath, AssetPackStats &stats, bool &bIsUpToDate);
+
+private:
+	struct PackedFile
+	{
+		std::string strPath;
+		std::vector<char> data;
+	};
+
+	std::vector<PackedFile> m_files;
+	bool m_bCompress;
+};
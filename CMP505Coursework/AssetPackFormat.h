@@ -0,0 +1,60 @@
+//
+// AssetPackFormat.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Fowler-Noll-Vo hash function (http://www.isthe.com/chongo/tech/comp/fnv/index.html)
+// File Mapping (https://docs.microsoft.com/en-us/windows/win32/memory/file-mapping)
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "CookedMeshFormat.h"
+
+// Single file holding the loose resource files, mapped once and read in place
+// Every structure is plain data with explicit sizes, like the cooked mesh format
+//
+// Layout:
+// AssetPackHeader
+// AssetPackEntry[entryCount] (sorted by path hash, so an entry is found with a binary search)
+// File data (each file starts on an ASSET_PACK_ALIGNMENT boundary, files with the same content share their data)
+//
+// A file can be compressed with LzCodec (see the entry flags), it is then decoded the first time it is read
+
+#define ASSET_PACK_MAGIC 0x4B434150			// "PACK"
+#define ASSET_PACK_VERSION 1				// Increase whenever the layout below or the codec changes
+#define ASSET_PACK_ALIGNMENT 4096			// Page size, so every file starts on a page of its own in the mapping
+#define MAX_ASSET_PACK_PATH_LENGTH 128
+#define ASSET_PACK_COMPRESSED 1				// Entry flags
+
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t dataCount;						// Distinct file contents (fewer than the entries if some are shared)
+	uint64_t entryTableOffset;				// Byte offsets from the start of the file
+	uint64_t dataOffset;
+};
+
+struct AssetPackEntry
+{
+	uint64_t pathHash;						// Of the path below
+	uint64_t contentHash;					// Of the file as it is on disk (the same as the source hash of a loose file)
+	uint64_t dataOffset;					// From the start of the pack
+	uint64_t storedSize;					// Size in the pack (smaller than the size if the file is compressed)
+	uint64_t size;
+	uint32_t flags;							// ASSET_PACK_COMPRESSED
+	uint32_t reserved;
+	char path[MAX_ASSET_PACK_PATH_LENGTH];	// Relative to the directory the pack was built from, with '/' separators and null-terminated
+};
+
+static_assert(sizeof(AssetPackHeader) % 8 == 0, "AssetPackHeader must keep the entry table aligned");
+static_assert(sizeof(AssetPackEntry) % 8 == 0, "AssetPackEntry must keep its 64-bit fields aligned");
+
+inline uint64_t HashAssetPackPath(const char *path, size_t length)
+{
+	return HashCookedMeshData(path, length);
+}
@@ -0,0 +1,40 @@
+//
+// AssetPackIOSystem.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Open Asset Import Library: IOSystem and MemoryIOStream (https://github.com/assimp/assimp)
+//
+
+#include <cstring>
+#include "AssetPackIOSystem.h"
+
+bool AssetPackIOSystem::Exists(const char *filePath) const
+{
+	AssetPack *pPack = AssetPack::GetMounted();
+	return (pPack != nullptr && pPack->Contains(filePath)) || DefaultIOSystem::Exists(filePath);
+}
+
+Assimp::IOStream* AssetPackIOSystem::Open(const char *filePath, const char *mode)
+{
+	AssetPack *pPack = AssetPack::GetMounted();
+	const char *pData = nullptr;
+	size_t size = 0;
+	if (IsReadMode(mode) && pPack != nullptr && pPack->Find(filePath, pData, size))
+	{
+		return OpenMemory(pData, size);
+	}
+
+	return DefaultIOSystem::Open(filePath, mode);
+}
+
+Assimp::IOStream* AssetPackIOSystem::OpenMemory(const char *pData, size_t size)
+{
+	return new Assimp::MemoryIOStream(reinterpret_cast<const uint8_t*>(pData), size, false);
+}
+
+bool AssetPackIOSystem::IsReadMode(const char *mode)
+{
+	// Files opened for writing are never in the pack (or the read queue)
+	return strpbrk(mode, "wa+") == nullptr;
+}
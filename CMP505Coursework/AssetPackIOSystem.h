@@ -0,0 +1,27 @@
+//
+// AssetPackIOSystem.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Open Asset Import Library: IOSystem and MemoryIOStream (https://github.com/assimp/assimp)
+//
+
+#pragma once
+
+#include <Assimp/DefaultIOSystem.h>
+#include <Assimp/MemoryIOWrapper.h>
+#include "AssetPack.h"
+
+// Gives Assimp the files in the mounted asset pack, other files are read from disk as usual
+class AssetPackIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+	bool Exists(const char *filePath) const override;
+	// The stream reads the pack's mapping without copying it (Assimp closes it with the default Close, which deletes it)
+	Assimp::IOStream* Open(const char *filePath, const char *mode = "rb") override;
+
+protected:
+	// Streams of data that outlives the importer
+	static Assimp::IOStream* OpenMemory(const char *pData, size_t size);
+	static bool IsReadMode(const char *mode);
+};
@@ -23,6 +23,7 @@ Bloom::Bloom(ID3D11Device *pDevice, ID3D11DeviceContext *pImmediateContext)
 	m_pSamplerState = nullptr;
 	m_pExtractRenderer = new OffScreenRenderer(pDevice, pImmediateContext);
 	m_pBlur = new Blur(pDevice, pImmediateContext);
+	m_pTextTexture = nullptr;
 	m_bShouldShowText = false;
 }
 
@@ -37,10 +38,12 @@ Bloom::~Bloom()
 	SAFE_RELEASE(m_pSamplerState)
 	SAFE_DELETE(m_pExtractRenderer)
 	SAFE_DELETE(m_pBlur)
+	SAFE_RELEASE(m_pTextTexture)
 }
 
 HRESULT Bloom::Initialize(int iWindowWidth, int iWindowHeight)
 {
+	ProfileZone profileZone("Bloom::Initialize");
 	HRESULT result = S_OK;
 
 	// Compile the vertex shader
@@ -202,10 +205,14 @@ HRESULT Bloom::Initialize(int iWindowWidth, int iWindowHeight)
 		return result;
 	}
 
-	// Create text texture
-	std::string strFilePath = "Resources/text.png";
-	std::wstring wstrFilePath(strFilePath.begin(), strFilePath.end());
-	result = CreateWICTextureFromFile(m_pDevice, wstrFilePath.c_str(), nullptr, &m_pTextTexture);
+	// Create text texture (read through MappedFile, so it comes from the mounted asset pack if it is packed)
+	MappedFile textFile;
+	if (!textFile.Open("Resources/text.png"))
+	{
+		Utils::ShowError("Failed to read text texture.", E_FAIL);
+		return E_FAIL;
+	}
+	result = CreateWICTextureFromMemory(m_pDevice, reinterpret_cast<const uint8_t*>(textFile.GetData()), textFile.GetSize(), nullptr, &m_pTextTexture);
 	if (FAILED(result))
 	{
 		Utils::ShowError("Failed to create text texture.", result);
@@ -215,6 +222,19 @@ HRESULT Bloom::Initialize(int iWindowWidth, int iWindowHeight)
 	return result;
 }
 
+bool Bloom::UsesFile(const std::string &strFilePath)
+{
+	for (auto filePath : { "Shaders/BloomVertexShader.hlsl", "Shaders/BloomExtractPixelShader.hlsl", "Shaders/BloomCombinePixelShader.hlsl", 
+						   "Shaders/BlurVertexShader.hlsl", "Shaders/BlurPixelShader.hlsl", "Resources/text.png" })
+	{
+		if (strFilePath == filePath)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 #pragma endregion
 
 #pragma region Getters
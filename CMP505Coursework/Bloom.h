@@ -10,6 +10,8 @@
 
 #include <DirectXTK/WICTextureLoader.h>
 #include "Blur.h"
+#include "MappedFile.h"
+#include "Profiler.h"
 
 struct BloomExtractBuffer // For pixel shader
 {
@@ -38,6 +40,8 @@ public:
 	void SetShouldShowText(bool bShouldShowText);
 
 	HRESULT Initialize(int iWindowWidth, int iWindowHeight);
+	// Whether the bloom (or its blur) is created from the file, so it has to be created again when the file changes
+	static bool UsesFile(const std::string &strFilePath);
 	bool RenderBloomExtractToTexture(PostProcessQuad *pQuad, ID3D11ShaderResourceView *pSceneTexture);
 	bool RenderHorizontalBlurToTexture(PostProcessQuad *pQuad, ID3D11ShaderResourceView *pInputTexture);
 	bool RenderVerticalBlurToTexture(PostProcessQuad *pQuad);
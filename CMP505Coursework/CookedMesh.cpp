@@ -0,0 +1,364 @@
+//
+// CookedMesh.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// File Mapping (https://docs.microsoft.com/en-us/windows/win32/memory/file-mapping)
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+//
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "AssetPack.h"
+#include "CookedMesh.h"
+#include "MeshCodec.h"
+#include "SafeFileWriter.h"
+
+#pragma region CookedMeshFile
+
+CookedMeshFile::CookedMeshFile()
+{
+	m_pHeader = nullptr;
+	m_pVertexData = nullptr;
+	m_pIndexData = nullptr;
+}
+
+bool CookedMeshFile::Open(const char *filePath, uint32_t vertexSize)
+{
+	Close();
+
+	if (!m_file.Open(filePath) || m_file.GetSize() < sizeof(CookedMeshHeader))
+	{
+		Close();
+		return false;
+	}
+
+	// The mapping is page aligned, so every aligned section can be used in place
+	const CookedMeshHeader *pHeader = reinterpret_cast<const CookedMeshHeader*>(m_file.GetData());
+	if (pHeader->magic != COOKED_MESH_MAGIC || pHeader->version != COOKED_MESH_VERSION || pHeader->vertexSize != vertexSize)
+	{
+		Close();
+		return false;
+	}
+
+	// Uncompressed sections have to hold all of their data, compressed ones are checked when they are decoded
+	bool bAreVerticesCompressed = (pHeader->flags & COOKED_MESH_COMPRESSED_VERTICES) != 0;
+	bool bAreIndicesCompressed = (pHeader->flags & COOKED_MESH_COMPRESSED_INDICES) != 0;
+	if (!IsSectionInFile(pHeader->submeshTableOffset, uint64_t(pHeader->submeshCount) * sizeof(CookedSubmesh)) ||
+		!IsSectionInFile(pHeader->meshletTableOffset, uint64_t(pHeader->meshletCount) * sizeof(CookedMeshlet)) ||
+		!IsSectionInFile(pHeader->vertexDataOffset, pHeader->vertexDataSize) ||
+		!IsSectionInFile(pHeader->indexDataOffset, pHeader->indexDataSize) ||
+		(!bAreVerticesCompressed && pHeader->vertexDataSize != uint64_t(pHeader->vertexCount) * pHeader->vertexSize) ||
+		(!bAreIndicesCompressed && pHeader->indexDataSize != uint64_t(pHeader->indexCount) * sizeof(uint32_t)))
+	{
+		Close();
+		return false;
+	}
+	m_pHeader = pHeader;
+
+	// Check the submesh ranges once so the accessors do not have to
+	for (uint32_t i = 0; i < pHeader->submeshCount; i++)
+	{
+		const CookedSubmesh *pSubmesh = GetSubmesh(i);
+		bool bIsValid = uint64_t(pSubmesh->vertexOffset) + pSubmesh->vertexCount <= pHeader->vertexCount &&
+						uint64_t(pSubmesh->indexOffset) + pSubmesh->indexCount <= pHeader->indexCount &&
+						uint64_t(pSubmesh->meshletOffset) + pSubmesh->meshletCount <= pHeader->meshletCount &&
+						uint64_t(pSubmesh->vertexDataOffset) + pSubmesh->vertexDataSize <= pHeader->vertexDataSize &&
+						uint64_t(pSubmesh->indexDataOffset) + pSubmesh->indexDataSize <= pHeader->indexDataSize &&
+						pSubmesh->lodCount > 0 && pSubmesh->lodCount <= MAX_COOKED_LOD_COUNT;
+		for (uint32_t j = 0; bIsValid && j < pSubmesh->lodCount; j++)
+		{
+			bIsValid = uint64_t(pSubmesh->lods[j].indexOffset) + pSubmesh->lods[j].indexCount <= pSubmesh->indexCount;
+		}
+		if (!bIsValid)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	if (!DecodeSections())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void CookedMeshFile::Close()
+{
+	m_file.Close();
+	m_pHeader = nullptr;
+	m_pVertexData = nullptr;
+	m_pIndexData = nullptr;
+	m_decodedVertexData.clear();
+	m_decodedVertexData.shrink_to_fit();
+	m_decodedIndexData.clear();
+	m_decodedIndexData.shrink_to_fit();
+}
+
+const CookedMeshHeader* CookedMeshFile::GetHeader()
+{
+	return m_pHeader;
+}
+
+const CookedSubmesh* CookedMeshFile::GetSubmesh(int iSubmeshIndex)
+{
+	return reinterpret_cast<const CookedSubmesh*>(m_file.GetData() + m_pHeader->submeshTableOffset) + iSubmeshIndex;
+}
+
+const void* CookedMeshFile::GetVertexData(const CookedSubmesh &submesh)
+{
+	return m_pVertexData + uint64_t(submesh.vertexOffset) * m_pHeader->vertexSize;
+}
+
+const uint32_t* CookedMeshFile::GetIndexData(const CookedSubmesh &submesh)
+{
+	return m_pIndexData + submesh.indexOffset;
+}
+
+const CookedMeshlet* CookedMeshFile::GetMeshlets(const CookedSubmesh &submesh)
+{
+	return reinterpret_cast<const CookedMeshlet*>(m_file.GetData() + m_pHeader->meshletTableOffset) + submesh.meshletOffset;
+}
+
+bool CookedMeshFile::IsSectionInFile(uint64_t offset, uint64_t size)
+{
+	return offset % COOKED_MESH_ALIGNMENT == 0 && offset <= m_file.GetSize() && size <= m_file.GetSize() - offset;
+}
+
+bool CookedMeshFile::DecodeSections()
+{
+	m_pVertexData = reinterpret_cast<const unsigned char*>(m_file.GetData() + m_pHeader->vertexDataOffset);
+	m_pIndexData = reinterpret_cast<const uint32_t*>(m_file.GetData() + m_pHeader->indexDataOffset);
+
+	// Each submesh is decoded to where it would be in an uncompressed file
+	if (m_pHeader->flags & COOKED_MESH_COMPRESSED_VERTICES)
+	{
+		m_decodedVertexData.resize(size_t(m_pHeader->vertexCount) * m_pHeader->vertexSize);
+		for (uint32_t i = 0; i < m_pHeader->submeshCount; i++)
+		{
+			const CookedSubmesh *pSubmesh = GetSubmesh(i);
+			if (!MeshCodec::DecodeVertices(m_pVertexData + pSubmesh->vertexDataOffset, pSubmesh->vertexDataSize,
+										   m_decodedVertexData.data() + size_t(pSubmesh->vertexOffset) * m_pHeader->vertexSize,
+										   pSubmesh->vertexCount, m_pHeader->vertexSize))
+			{
+				return false;
+			}
+		}
+		m_pVertexData = m_decodedVertexData.data();
+	}
+
+	if (m_pHeader->flags & COOKED_MESH_COMPRESSED_INDICES)
+	{
+		m_decodedIndexData.resize(m_pHeader->indexCount);
+		const unsigned char *pIndexData = reinterpret_cast<const unsigned char*>(m_file.GetData() + m_pHeader->indexDataOffset);
+		for (uint32_t i = 0; i < m_pHeader->submeshCount; i++)
+		{
+			const CookedSubmesh *pSubmesh = GetSubmesh(i);
+			if (!MeshCodec::DecodeIndices(pIndexData + pSubmesh->indexDataOffset, pSubmesh->indexDataSize,
+										  m_decodedIndexData.data() + pSubmesh->indexOffset, pSubmesh->indexCount, pSubmesh->vertexCount))
+			{
+				return false;
+			}
+		}
+		m_pIndexData = m_decodedIndexData.data();
+	}
+
+	return true;
+}
+
+#pragma endregion
+
+#pragma region CookedMeshWriter
+
+CookedMeshWriter::CookedMeshWriter(uint32_t vertexSize)
+{
+	m_uiVertexSize = vertexSize;
+	m_bCompressVertices = false;
+	m_bCompressIndices = false;
+}
+
+void CookedMeshWriter::AddSubmesh(CookedSubmesh submesh, const void *pVertices, uint32_t uiVertexCount, const uint32_t *pIndices, uint32_t uiIndexCount,
+								  const CookedMeshlet *pMeshlets, uint32_t uiMeshletCount)
+{
+	submesh.vertexOffset = static_cast<uint32_t>(m_vertexData.size() / m_uiVertexSize);
+	submesh.vertexCount = uiVertexCount;
+	submesh.indexOffset = static_cast<uint32_t>(m_indexData.size());
+	submesh.indexCount = uiIndexCount;
+	submesh.meshletOffset = static_cast<uint32_t>(m_meshlets.size());
+	submesh.meshletCount = uiMeshletCount;
+	submesh.texturePath[MAX_COOKED_TEXTURE_PATH_LENGTH - 1] = '\0';
+	m_submeshes.push_back(submesh);
+
+	const unsigned char *pVertexBytes = static_cast<const unsigned char*>(pVertices);
+	m_vertexData.insert(m_vertexData.end(), pVertexBytes, pVertexBytes + size_t(uiVertexCount) * m_uiVertexSize);
+	m_indexData.insert(m_indexData.end(), pIndices, pIndices + uiIndexCount);
+	if (pMeshlets != nullptr)
+	{
+		m_meshlets.insert(m_meshlets.end(), pMeshlets, pMeshlets + uiMeshletCount);
+	}
+}
+
+int CookedMeshWriter::GetSubmeshCount()
+{
+	return static_cast<int>(m_submeshes.size());
+}
+
+void CookedMeshWriter::SetCompression(bool bCompressVertices, bool bCompressIndices)
+{
+	m_bCompressVertices = bCompressVertices && m_uiVertexSize % 4 == 0 && m_uiVertexSize <= MESH_CODEC_MAX_VERTEX_SIZE;
+	m_bCompressIndices = bCompressIndices;
+}
+
+bool CookedMeshWriter::Write(const std::string &strFilePath, uint64_t sourceHash, uint64_t settingsHash)
+{
+	CookedMeshHeader header = {};
+	header.magic = COOKED_MESH_MAGIC;
+	header.version = COOKED_MESH_VERSION;
+	header.sourceHash = sourceHash;
+	header.settingsHash = settingsHash;
+	header.submeshCount = static_cast<uint32_t>(m_submeshes.size());
+	header.meshletCount = static_cast<uint32_t>(m_meshlets.size());
+	header.vertexSize = m_uiVertexSize;
+	header.vertexCount = static_cast<uint32_t>(m_vertexData.size() / m_uiVertexSize);
+	header.indexCount = static_cast<uint32_t>(m_indexData.size());
+	header.flags = (m_bCompressVertices ? COOKED_MESH_COMPRESSED_VERTICES : 0) | (m_bCompressIndices ? COOKED_MESH_COMPRESSED_INDICES : 0);
+
+	// The data sections as they are stored, with the byte range of each submesh
+	std::vector<CookedSubmesh> submeshes = m_submeshes;
+	std::vector<uint8_t> vertexSection;
+	std::vector<uint8_t> indexSection;
+	std::vector<uint8_t> encodedData;
+	for (auto &submesh : submeshes)
+	{
+		const unsigned char *pVertices = m_vertexData.data() + size_t(submesh.vertexOffset) * m_uiVertexSize;
+		submesh.vertexDataOffset = static_cast<uint32_t>(vertexSection.size());
+		if (m_bCompressVertices)
+		{
+			MeshCodec::EncodeVertices(pVertices, submesh.vertexCount, m_uiVertexSize, encodedData);
+			vertexSection.insert(vertexSection.end(), encodedData.begin(), encodedData.end());
+		}
+		else
+		{
+			vertexSection.insert(vertexSection.end(), pVertices, pVertices + size_t(submesh.vertexCount) * m_uiVertexSize);
+		}
+		submesh.vertexDataSize = static_cast<uint32_t>(vertexSection.size()) - submesh.vertexDataOffset;
+
+		const uint32_t *pIndices = m_indexData.data() + submesh.indexOffset;
+		submesh.indexDataOffset = static_cast<uint32_t>(indexSection.size());
+		if (m_bCompressIndices)
+		{
+			MeshCodec::EncodeIndices(pIndices, submesh.indexCount, encodedData);
+			indexSection.insert(indexSection.end(), encodedData.begin(), encodedData.end());
+		}
+		else
+		{
+			const uint8_t *pIndexBytes = reinterpret_cast<const uint8_t*>(pIndices);
+			indexSection.insert(indexSection.end(), pIndexBytes, pIndexBytes + size_t(submesh.indexCount) * sizeof(uint32_t));
+		}
+		submesh.indexDataSize = static_cast<uint32_t>(indexSection.size()) - submesh.indexDataOffset;
+	}
+	header.vertexDataSize = vertexSection.size();
+	header.indexDataSize = indexSection.size();
+
+	// Model space bounds: the corners of each submesh's box are moved by its transform (row vectors, like DirectXMath)
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (auto &submesh : m_submeshes)
+	{
+		for (int iCorner = 0; iCorner < 8; iCorner++)
+		{
+			float corner[3];
+			for (int i = 0; i < 3; i++)
+			{
+				corner[i] = submesh.boxCenter[i] + ((iCorner >> i) & 1 ? submesh.boxExtents[i] : -submesh.boxExtents[i]);
+			}
+			for (int i = 0; i < 3; i++)
+			{
+				float fValue = corner[0] * submesh.transform[i] + corner[1] * submesh.transform[4 + i] + corner[2] * submesh.transform[8 + i] + submesh.transform[12 + i];
+				minimum[i] = fValue < minimum[i] ? fValue : minimum[i];
+				maximum[i] = fValue > maximum[i] ? fValue : maximum[i];
+			}
+		}
+	}
+	if (!m_submeshes.empty())
+	{
+		float fRadiusSquared = 0.0f;
+		for (int i = 0; i < 3; i++)
+		{
+			header.boxCenter[i] = (minimum[i] + maximum[i]) * 0.5f;
+			header.boxExtents[i] = (maximum[i] - minimum[i]) * 0.5f;
+			header.sphereCenter[i] = header.boxCenter[i];
+			fRadiusSquared += header.boxExtents[i] * header.boxExtents[i];
+		}
+		header.sphereRadius = sqrtf(fRadiusSquared);
+	}
+
+	header.submeshTableOffset = Align(sizeof(CookedMeshHeader));
+	header.meshletTableOffset = Align(header.submeshTableOffset + m_submeshes.size() * sizeof(CookedSubmesh));
+	header.vertexDataOffset = Align(header.meshletTableOffset + m_meshlets.size() * sizeof(CookedMeshlet));
+	header.indexDataOffset = Align(header.vertexDataOffset + vertexSection.size());
+	uint64_t fileSize = header.indexDataOffset + indexSection.size();
+
+	// Assemble the file in memory so it is written with a single call
+	std::vector<char> fileData(static_cast<size_t>(fileSize), 0);
+	memcpy(&fileData[0], &header, sizeof(header));
+	if (!submeshes.empty())
+	{
+		memcpy(&fileData[static_cast<size_t>(header.submeshTableOffset)], submeshes.data(), submeshes.size() * sizeof(CookedSubmesh));
+	}
+	if (!m_meshlets.empty())
+	{
+		memcpy(&fileData[static_cast<size_t>(header.meshletTableOffset)], m_meshlets.data(), m_meshlets.size() * sizeof(CookedMeshlet));
+	}
+	if (!vertexSection.empty())
+	{
+		memcpy(&fileData[static_cast<size_t>(header.vertexDataOffset)], vertexSection.data(), vertexSection.size());
+	}
+	if (!indexSection.empty())
+	{
+		memcpy(&fileData[static_cast<size_t>(header.indexDataOffset)], indexSection.data(), indexSection.size());
+	}
+
+	return SafeFileWriter::Write(strFilePath, fileData.data(), fileData.size());
+}
+
+uint64_t CookedMeshWriter::HashFile(const char *filePath)
+{
+	// The pack stores the hash, so a compressed file is not decoded just to hash it
+	AssetPack *pPack = AssetPack::GetMounted();
+	uint64_t contentHash = 0;
+	if (pPack != nullptr && pPack->GetContentHash(filePath, contentHash))
+	{
+		return contentHash;
+	}
+
+	MappedFile file;
+	if (!file.Open(filePath))
+	{
+		return 0;
+	}
+	return HashCookedMeshData(file.GetData(), file.GetSize());
+}
+
+uint64_t CookedMeshWriter::Align(uint64_t offset)
+{
+	return (offset + COOKED_MESH_ALIGNMENT - 1) & ~uint64_t(COOKED_MESH_ALIGNMENT - 1);
+}
+
+#pragma endregion
+
+uint64_t CookedMeshWriter::HashDependencies(uint64_t sourceHash, const std::vector<std::string> &dependencyPaths)
+{
+	// The file hashes are mixed in rather than the contents, so files in the pack are not read either
+	for (auto &strDependencyPath : dependencyPaths)
+	{
+		uint64_t dependencyHash = HashFile(strDependencyPath.c_str());
+		sourceHash = HashCookedMeshData(&dependencyHash, sizeof(dependencyHash), sourceHash);
+	}
+	return sourceHash;
+}
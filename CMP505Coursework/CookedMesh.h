@@ -0,0 +1,74 @@
+//
+// CookedMesh.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// File Mapping (https://docs.microsoft.com/en-us/windows/win32/memory/file-mapping)
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CookedMeshFormat.h"
+#include "MappedFile.h"
+
+// Memory-mapped cooked mesh (the accessors point into the mapping, or into the decoded data if it is compressed,
+// so they are only valid while the file is open)
+class CookedMeshFile
+{
+public:
+	CookedMeshFile();
+
+	// Fails if the file is missing, truncated, cannot be decoded or was written by another version of the format
+	bool Open(const char *filePath, uint32_t vertexSize);
+	void Close();
+	const CookedMeshHeader* GetHeader();
+	const CookedSubmesh* GetSubmesh(int iSubmeshIndex);
+	const void* GetVertexData(const CookedSubmesh &submesh);
+	const uint32_t* GetIndexData(const CookedSubmesh &submesh);
+	const CookedMeshlet* GetMeshlets(const CookedSubmesh &submesh);
+
+private:
+	MappedFile m_file;
+	const CookedMeshHeader *m_pHeader;
+	const unsigned char *m_pVertexData;
+	const uint32_t *m_pIndexData;
+	std::vector<unsigned char> m_decodedVertexData;
+	std::vector<uint32_t> m_decodedIndexData;
+
+	bool IsSectionInFile(uint64_t offset, uint64_t size);
+	bool DecodeSections();
+};
+
+// Collects submeshes and writes them in the cooked format
+class CookedMeshWriter
+{
+public:
+	CookedMeshWriter(uint32_t vertexSize);
+
+	// The offsets of the submesh are filled in by the writer, the rest of it (LODs, bounds, material) is written as is
+	void AddSubmesh(CookedSubmesh submesh, const void *pVertices, uint32_t uiVertexCount, const uint32_t *pIndices, uint32_t uiIndexCount,
+					const CookedMeshlet *pMeshlets = nullptr, uint32_t uiMeshletCount = 0);
+	int GetSubmeshCount();
+	// Compresses the vertex and index data with MeshCodec when the file is written (the vertex size has to be a multiple of 4)
+	void SetCompression(bool bCompressVertices, bool bCompressIndices);
+	// Writes to a temporary file first so a partially written file is never loaded
+	bool Write(const std::string &strFilePath, uint64_t sourceHash, uint64_t settingsHash);
+
+	static uint64_t HashFile(const char *filePath);
+	// Mixes the hashes of the files the source refers to (OBJ material libraries) into the source hash,
+	// the same way in the game and the asset cooker, so editing a material makes the cooked mesh stale
+	static uint64_t HashDependencies(uint64_t sourceHash, const std::vector<std::string> &dependencyPaths);
+
+private:
+	uint32_t m_uiVertexSize;
+	bool m_bCompressVertices;
+	bool m_bCompressIndices;
+	std::vector<CookedSubmesh> m_submeshes;
+	std::vector<CookedMeshlet> m_meshlets;
+	std::vector<unsigned char> m_vertexData;
+	std::vector<uint32_t> m_indexData;
+
+	static uint64_t Align(uint64_t offset);
+};
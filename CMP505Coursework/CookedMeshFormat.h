@@ -0,0 +1,132 @@
+//
+// CookedMeshFormat.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Fowler-Noll-Vo hash function (http://www.isthe.com/chongo/tech/comp/fnv/index.html)
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Binary container for meshes that have already been imported, simplified and split into meshlets
+// The file is mapped into memory and used in place, so every structure is plain data with explicit sizes
+//
+// Layout (every section starts on a COOKED_MESH_ALIGNMENT boundary):
+// CookedMeshHeader
+// CookedSubmesh[submeshCount]
+// CookedMeshlet[meshletCount]
+// Vertex data (vertexSize bytes per vertex, the same layout as the vertex buffer)
+// Index data (32-bit indices, relative to the first vertex of their submesh)
+//
+// Either data section can be compressed with MeshCodec (see the header flags), each submesh on its own
+// Compressed sections are decoded when the file is opened, so the accessors work the same way for both
+
+#define COOKED_MESH_MAGIC 0x48534D43		// "CMSH"
+#define COOKED_MESH_VERSION 3				// Increase whenever the layout below or the cooking steps change
+#define COOKED_MESH_ALIGNMENT 16
+#define MAX_COOKED_LOD_COUNT 4				// The full detail mesh and three simplified LODs
+#define MAX_COOKED_TEXTURE_PATH_LENGTH 128
+#define COOKED_MESH_COMPRESSED_VERTICES 1	// Header flags
+#define COOKED_MESH_COMPRESSED_INDICES 2
+#define GEOMETRY_ONLY_SETTINGS_HASH 0		// Welded and optimized geometry without LODs or meshlets (written by the asset cooker)
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+struct CookedVertex							// Same layout as Vertex (position, texture coordinates and normal)
+{
+	float position[3];
+	float textureCoordinates[2];
+	float normal[3];
+};
+
+struct CookedMeshHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;					// Hash of the data the mesh was cooked from (a stale file is cooked again)
+	uint64_t settingsHash;					// Hash of the settings the mesh was cooked with (LODs and meshlets)
+	uint32_t submeshCount;
+	uint32_t meshletCount;
+	uint32_t vertexSize;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t flags;							// COOKED_MESH_COMPRESSED_VERTICES and COOKED_MESH_COMPRESSED_INDICES
+	float boxCenter[3];						// Bounds of all submeshes in model space
+	float boxExtents[3];
+	float sphereCenter[3];
+	float sphereRadius;
+	uint64_t submeshTableOffset;			// Byte offsets from the start of the file
+	uint64_t meshletTableOffset;
+	uint64_t vertexDataOffset;
+	uint64_t indexDataOffset;
+	uint64_t vertexDataSize;				// Size of the sections in the file (smaller than the data if they are compressed)
+	uint64_t indexDataSize;
+};
+
+struct CookedLod
+{
+	uint32_t indexOffset;					// Relative to the first index of the submesh
+	uint32_t indexCount;
+	float maxScreenCoverage;
+};
+
+struct CookedMeshlet
+{
+	uint32_t indexOffset;					// Relative to the first index of the submesh
+	uint32_t indexCount;
+	float sphereCenter[3];					// Object space
+	float sphereRadius;
+	float coneAxis[3];
+	float coneCutoff;
+};
+
+struct CookedSubmesh
+{
+	uint32_t vertexOffset;					// In vertices, from the start of the vertex data
+	uint32_t vertexCount;
+	uint32_t indexOffset;					// In indices, from the start of the index data
+	uint32_t indexCount;					// All LODs (the full detail LOD is first)
+	uint32_t meshletOffset;					// In meshlets, from the start of the meshlet table
+	uint32_t meshletCount;
+	uint32_t lodCount;
+	uint32_t vertexDataOffset;				// In bytes, from the start of the vertex data section (as stored, so compressed if the section is)
+	uint32_t vertexDataSize;
+	uint32_t indexDataOffset;				// In bytes, from the start of the index data section
+	uint32_t indexDataSize;
+	CookedLod lods[MAX_COOKED_LOD_COUNT];
+	float transform[16];					// Row major, applied before the world matrix
+	float boxCenter[3];						// Object space
+	float boxExtents[3];
+	float sphereCenter[3];
+	float sphereRadius;
+	float diffuseColor[4];					// Used when there is no texture path (alpha is 0 if the default texture is used)
+	char texturePath[MAX_COOKED_TEXTURE_PATH_LENGTH]; // Relative to the directory of the source file
+};
+
+static_assert(sizeof(CookedVertex) == 32, "CookedVertex must match the vertex buffer layout");
+static_assert(sizeof(CookedMeshHeader) % 8 == 0, "CookedMeshHeader must keep its 64-bit offsets aligned");
+
+// 64-bit FNV-1a, used for the source and settings hashes
+inline uint64_t HashCookedMeshData(const void *pData, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+	const unsigned char *pBytes = static_cast<const unsigned char*>(pData);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pBytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+// Models the game imports with StaticPropImportProfile (Assimp post-processing, then one batched mesh per material)
+// The profile is part of their source hash and the asset cooker cannot reproduce the import, so it leaves them for the game to cook
+inline bool IsStaticPropSource(const char *fileName)
+{
+	return strcmp(fileName, "crystal_post.obj") == 0 || strcmp(fileName, "crystal_fence.obj") == 0;
+}
@@ -0,0 +1,492 @@
+//
+// DdsFile.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// DDS (https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dx-graphics-dds-pguide)
+// DDS_HEADER_DXT10 (https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dds-header-dxt10)
+// DirectXTK DDSTextureLoader (https://github.com/microsoft/DirectXTK)
+//
+
+#include <cstring>
+#include "DdsFile.h"
+
+#define DDS_MAGIC 0x20534444				// "DDS "
+#define DDS_PAGE_SIZE 4096
+
+#define DDS_FOURCC(a, b, c, d) (static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24))
+
+// DDS_PIXELFORMAT flags
+#define DDS_ALPHA_PIXELS 0x1
+#define DDS_FOURCC_PIXELS 0x4
+#define DDS_RGB_PIXELS 0x40
+#define DDS_LUMINANCE_PIXELS 0x20000
+
+// DDS_HEADER caps2 flags
+#define DDS_CUBEMAP 0x200
+#define DDS_CUBEMAP_ALL_FACES 0xFE00
+#define DDS_VOLUME 0x200000
+
+// DDS_HEADER_DXT10 values
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_MISC_TEXTURECUBE 0x4
+
+// DXGI_FORMAT values (named differently from the DXGI enum, which is not available on every platform)
+#define DDS_FORMAT_R32G32B32A32_FLOAT 2
+#define DDS_FORMAT_R16G16B16A16_FLOAT 10
+#define DDS_FORMAT_R16G16B16A16_UNORM 11
+#define DDS_FORMAT_R8G8B8A8_UNORM 28
+#define DDS_FORMAT_R8G8B8A8_UNORM_SRGB 29
+#define DDS_FORMAT_R8_UNORM 61
+#define DDS_FORMAT_BC1_UNORM 71
+#define DDS_FORMAT_BC1_UNORM_SRGB 72
+#define DDS_FORMAT_BC2_UNORM 74
+#define DDS_FORMAT_BC2_UNORM_SRGB 75
+#define DDS_FORMAT_BC3_UNORM 77
+#define DDS_FORMAT_BC3_UNORM_SRGB 78
+#define DDS_FORMAT_BC4_UNORM 80
+#define DDS_FORMAT_BC4_SNORM 81
+#define DDS_FORMAT_BC5_UNORM 83
+#define DDS_FORMAT_BC5_SNORM 84
+#define DDS_FORMAT_B8G8R8A8_UNORM 87
+#define DDS_FORMAT_B8G8R8X8_UNORM 88
+#define DDS_FORMAT_B8G8R8A8_UNORM_SRGB 91
+#define DDS_FORMAT_BC6H_UF16 95
+#define DDS_FORMAT_BC6H_SF16 96
+#define DDS_FORMAT_BC7_UNORM 98
+#define DDS_FORMAT_BC7_UNORM_SRGB 99
+
+namespace
+{
+	struct DdsPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	uint32_t GetFormat(const DdsPixelFormat &pixelFormat)
+	{
+		if (pixelFormat.flags & DDS_FOURCC_PIXELS)
+		{
+			switch (pixelFormat.fourCC)
+			{
+			case DDS_FOURCC('D', 'X', 'T', '1'):
+				return DDS_FORMAT_BC1_UNORM;
+			case DDS_FOURCC('D', 'X', 'T', '2'):
+			case DDS_FOURCC('D', 'X', 'T', '3'):
+				return DDS_FORMAT_BC2_UNORM;
+			case DDS_FOURCC('D', 'X', 'T', '4'):
+			case DDS_FOURCC('D', 'X', 'T', '5'):
+				return DDS_FORMAT_BC3_UNORM;
+			case DDS_FOURCC('A', 'T', 'I', '1'):
+			case DDS_FOURCC('B', 'C', '4', 'U'):
+				return DDS_FORMAT_BC4_UNORM;
+			case DDS_FOURCC('B', 'C', '4', 'S'):
+				return DDS_FORMAT_BC4_SNORM;
+			case DDS_FOURCC('A', 'T', 'I', '2'):
+			case DDS_FOURCC('B', 'C', '5', 'U'):
+				return DDS_FORMAT_BC5_UNORM;
+			case DDS_FOURCC('B', 'C', '5', 'S'):
+				return DDS_FORMAT_BC5_SNORM;
+			case 36: // D3DFMT_A16B16G16R16
+				return DDS_FORMAT_R16G16B16A16_UNORM;
+			case 113: // D3DFMT_A16B16G16R16F
+				return DDS_FORMAT_R16G16B16A16_FLOAT;
+			case 116: // D3DFMT_A32B32G32R32F
+				return DDS_FORMAT_R32G32B32A32_FLOAT;
+			}
+			return 0;
+		}
+
+		if ((pixelFormat.flags & DDS_RGB_PIXELS) && pixelFormat.rgbBitCount == 32)
+		{
+			if (pixelFormat.rBitMask == 0x000000FF && pixelFormat.gBitMask == 0x0000FF00 && pixelFormat.bBitMask == 0x00FF0000)
+			{
+				return DDS_FORMAT_R8G8B8A8_UNORM;
+			}
+			if (pixelFormat.rBitMask == 0x00FF0000 && pixelFormat.gBitMask == 0x0000FF00 && pixelFormat.bBitMask == 0x000000FF)
+			{
+				return (pixelFormat.flags & DDS_ALPHA_PIXELS) && pixelFormat.aBitMask != 0 ? DDS_FORMAT_B8G8R8A8_UNORM : DDS_FORMAT_B8G8R8X8_UNORM;
+			}
+		}
+
+		if ((pixelFormat.flags & DDS_LUMINANCE_PIXELS) && pixelFormat.rgbBitCount == 8)
+		{
+			return DDS_FORMAT_R8_UNORM;
+		}
+
+		return 0;
+	}
+
+	// Bytes per 4x4 block, or 0 if the format is not block compressed
+	uint32_t GetBlockSize(uint32_t uiFormat)
+	{
+		switch (uiFormat)
+		{
+		case DDS_FORMAT_BC1_UNORM:
+		case DDS_FORMAT_BC1_UNORM_SRGB:
+		case DDS_FORMAT_BC4_UNORM:
+		case DDS_FORMAT_BC4_SNORM:
+			return 8;
+		case DDS_FORMAT_BC2_UNORM:
+		case DDS_FORMAT_BC2_UNORM_SRGB:
+		case DDS_FORMAT_BC3_UNORM:
+		case DDS_FORMAT_BC3_UNORM_SRGB:
+		case DDS_FORMAT_BC5_UNORM:
+		case DDS_FORMAT_BC5_SNORM:
+		case DDS_FORMAT_BC6H_UF16:
+		case DDS_FORMAT_BC6H_SF16:
+		case DDS_FORMAT_BC7_UNORM:
+		case DDS_FORMAT_BC7_UNORM_SRGB:
+			return 16;
+		}
+		return 0;
+	}
+
+	// Bits per pixel of the formats that are not block compressed, or 0 if the format is not supported
+	uint32_t GetBitsPerPixel(uint32_t uiFormat)
+	{
+		switch (uiFormat)
+		{
+		case DDS_FORMAT_R32G32B32A32_FLOAT:
+			return 128;
+		case DDS_FORMAT_R16G16B16A16_FLOAT:
+		case DDS_FORMAT_R16G16B16A16_UNORM:
+			return 64;
+		case DDS_FORMAT_R8G8B8A8_UNORM:
+		case DDS_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DDS_FORMAT_B8G8R8A8_UNORM:
+		case DDS_FORMAT_B8G8R8X8_UNORM:
+		case DDS_FORMAT_B8G8R8A8_UNORM_SRGB:
+			return 32;
+		case DDS_FORMAT_R8_UNORM:
+			return 8;
+		}
+		return 0;
+	}
+}
+
+DdsFile::DdsFile()
+{
+	m_pData = nullptr;
+	m_size = 0;
+	m_info = {};
+}
+
+bool DdsFile::Open(const char *filePath)
+{
+	if (!m_file.Open(filePath))
+	{
+		return false;
+	}
+
+	return Parse(reinterpret_cast<const uint8_t*>(m_file.GetData()), m_file.GetSize());
+}
+
+bool DdsFile::Parse(const uint8_t *pData, size_t size)
+{
+	m_pData = pData;
+	m_size = size;
+	m_info = {};
+	m_mips.clear();
+
+	// The headers are copied out, since the mapped data does not have to be aligned
+	uint32_t magic = 0;
+	DdsHeader header;
+	if (size < sizeof(magic) + sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&magic, pData, sizeof(magic));
+	memcpy(&header, pData + sizeof(magic), sizeof(header));
+	if (magic != DDS_MAGIC || header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat))
+	{
+		return false;
+	}
+	if (header.width == 0 || header.height == 0)
+	{
+		return false;
+	}
+	uint64_t offset = sizeof(magic) + sizeof(header);
+
+	m_info.uiWidth = header.width;
+	m_info.uiHeight = header.height;
+	m_info.uiMipCount = header.mipMapCount > 0 ? header.mipMapCount : 1;
+	m_info.uiArraySize = 1;
+	uint64_t arraySize = 1;
+	if ((header.pixelFormat.flags & DDS_FOURCC_PIXELS) && header.pixelFormat.fourCC == DDS_FOURCC('D', 'X', '1', '0'))
+	{
+		DdsHeaderDx10 headerDx10;
+		if (size < offset + sizeof(headerDx10))
+		{
+			return false;
+		}
+		memcpy(&headerDx10, pData + offset, sizeof(headerDx10));
+		offset += sizeof(headerDx10);
+
+		if (headerDx10.resourceDimension != DDS_DIMENSION_TEXTURE2D || headerDx10.arraySize == 0)
+		{
+			return false;
+		}
+		m_info.uiFormat = headerDx10.dxgiFormat;
+		m_info.bIsCubeMap = (headerDx10.miscFlag & DDS_MISC_TEXTURECUBE) != 0;
+		arraySize = uint64_t(headerDx10.arraySize) * (m_info.bIsCubeMap ? 6 : 1);
+	}
+	else
+	{
+		if (header.caps2 & DDS_VOLUME)
+		{
+			return false;
+		}
+		if (header.caps2 & DDS_CUBEMAP)
+		{
+			// Cube maps without every face cannot be created
+			if ((header.caps2 & DDS_CUBEMAP_ALL_FACES) != DDS_CUBEMAP_ALL_FACES)
+			{
+				return false;
+			}
+			m_info.bIsCubeMap = true;
+			arraySize = 6;
+		}
+		m_info.uiFormat = GetFormat(header.pixelFormat);
+	}
+
+	// The layout of an unsupported format is unknown, so its mips cannot be found
+	uint32_t uiBlockSize = GetBlockSize(m_info.uiFormat);
+	uint32_t uiBitsPerPixel = GetBitsPerPixel(m_info.uiFormat);
+	if ((uiBlockSize == 0 && uiBitsPerPixel == 0) || m_info.uiMipCount > MAX_DDS_MIP_COUNT)
+	{
+		m_info.uiFormat = 0;
+		return false;
+	}
+	m_info.bIsBlockCompressed = uiBlockSize > 0;
+
+	// Every array slice has its whole mip chain, largest mip first, so the chain is laid out once (relative to the start of its slice)
+	// Truncated files are rejected before anything is allocated, rather than uploading past the end of the data
+	// (a damaged header can claim billions of slices or mips far larger than the file)
+	uint64_t remainingSize = size - offset;
+	DdsMip sliceMips[MAX_DDS_MIP_COUNT];
+	uint64_t sliceSize = 0;
+	uint32_t uiWidth = m_info.uiWidth;
+	uint32_t uiHeight = m_info.uiHeight;
+	for (uint32_t i = 0; i < m_info.uiMipCount; i++)
+	{
+		uint64_t rowPitch = m_info.bIsBlockCompressed ? (uint64_t(uiWidth) + 3) / 4 * uiBlockSize : (uint64_t(uiWidth) * uiBitsPerPixel + 7) / 8;
+		uint64_t rowCount = m_info.bIsBlockCompressed ? (uint64_t(uiHeight) + 3) / 4 : uiHeight;
+		if (rowPitch > UINT32_MAX || rowPitch > remainingSize - sliceSize || rowCount > (remainingSize - sliceSize) / rowPitch)
+		{
+			return false;
+		}
+
+		DdsMip &mip = sliceMips[i];
+		mip.uiWidth = uiWidth;
+		mip.uiHeight = uiHeight;
+		mip.uiRowPitch = static_cast<uint32_t>(rowPitch);
+		mip.uiRowCount = static_cast<uint32_t>(rowCount);
+		mip.offset = sliceSize;
+		mip.size = rowPitch * rowCount;
+		sliceSize += mip.size;
+
+		uiWidth = uiWidth > 1 ? uiWidth / 2 : 1;
+		uiHeight = uiHeight > 1 ? uiHeight / 2 : 1;
+	}
+	if (arraySize > UINT32_MAX || arraySize > remainingSize / sliceSize)
+	{
+		return false;
+	}
+	m_info.uiArraySize = static_cast<uint32_t>(arraySize);
+
+	m_mips.reserve(static_cast<size_t>(arraySize) * m_info.uiMipCount);
+	for (uint32_t i = 0; i < m_info.uiArraySize; i++)
+	{
+		for (uint32_t j = 0; j < m_info.uiMipCount; j++)
+		{
+			DdsMip mip = sliceMips[j];
+			mip.offset += offset + i * sliceSize;
+			m_mips.push_back(mip);
+		}
+	}
+
+	return true;
+}
+
+const DdsTextureInfo& DdsFile::GetInfo()
+{
+	return m_info;
+}
+
+const DdsMip& DdsFile::GetMip(uint32_t uiArraySlice, uint32_t uiMip)
+{
+	return m_mips[uiArraySlice * m_info.uiMipCount + uiMip];
+}
+
+const uint8_t* DdsFile::GetMipData(uint32_t uiArraySlice, uint32_t uiMip)
+{
+	return m_pData + GetMip(uiArraySlice, uiMip).offset;
+}
+
+uint64_t DdsFile::GetMipRangeSize(uint32_t uiFirstMip, uint32_t uiMipCount)
+{
+	uint64_t size = 0;
+	for (uint32_t i = 0; i < m_info.uiArraySize; i++)
+	{
+		for (uint32_t j = uiFirstMip; j < uiFirstMip + uiMipCount && j < m_info.uiMipCount; j++)
+		{
+			size += GetMip(i, j).size;
+		}
+	}
+	return size;
+}
+
+const uint8_t* DdsFile::GetData()
+{
+	return m_pData;
+}
+
+size_t DdsFile::GetSize()
+{
+	return m_size;
+}
+
+uint64_t DdsFile::GetMipSize(uint32_t uiFormat, uint32_t uiWidth, uint32_t uiHeight)
+{
+	uint32_t uiBlockSize = GetBlockSize(uiFormat);
+	if (uiBlockSize > 0)
+	{
+		return static_cast<uint64_t>((uiWidth + 3) / 4) * uiBlockSize * ((uiHeight + 3) / 4);
+	}
+	return static_cast<uint64_t>((uiWidth * GetBitsPerPixel(uiFormat) + 7) / 8) * uiHeight;
+}
+
+void DdsFile::PrefetchMips(uint32_t uiFirstMip, uint32_t uiMipCount)
+{
+	volatile uint8_t sum = 0;
+	for (uint32_t i = 0; i < m_info.uiArraySize; i++)
+	{
+		for (uint32_t j = uiFirstMip; j < uiFirstMip + uiMipCount && j < m_info.uiMipCount; j++)
+		{
+			const DdsMip &mip = GetMip(i, j);
+			for (uint64_t k = 0; k < mip.size; k += DDS_PAGE_SIZE)
+			{
+				sum += m_pData[mip.offset + k];
+			}
+		}
+	}
+}
+
+#ifdef _WIN32
+HRESULT DdsFile::CreateTexture(ID3D11Device *pDevice, uint32_t uiFirstMip, uint32_t uiMipCount, ID3D11ShaderResourceView **ppTextureView)
+{
+	HRESULT result = S_OK;
+
+	if (m_mips.empty() || uiFirstMip >= m_info.uiMipCount)
+	{
+		return E_INVALIDARG;
+	}
+	uiMipCount = uiMipCount < m_info.uiMipCount - uiFirstMip ? uiMipCount : m_info.uiMipCount - uiFirstMip;
+
+	// The largest mip of a block compressed texture has to be a whole number of blocks
+	while (m_info.bIsBlockCompressed && uiFirstMip > 0 && (GetMip(0, uiFirstMip).uiWidth % 4 != 0 || GetMip(0, uiFirstMip).uiHeight % 4 != 0))
+	{
+		uiFirstMip--;
+		uiMipCount++;
+	}
+
+	// Create texture
+
+	D3D11_TEXTURE2D_DESC textureDesc;
+	ZeroMemory(&textureDesc, sizeof(textureDesc));
+	textureDesc.Width = GetMip(0, uiFirstMip).uiWidth;
+	textureDesc.Height = GetMip(0, uiFirstMip).uiHeight;
+	textureDesc.MipLevels = uiMipCount;
+	textureDesc.ArraySize = m_info.uiArraySize;
+	textureDesc.Format = static_cast<DXGI_FORMAT>(m_info.uiFormat);
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.MiscFlags = m_info.bIsCubeMap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+	// The mips are uploaded straight from the mapped file
+	std::vector<D3D11_SUBRESOURCE_DATA> subresources;
+	for (uint32_t i = 0; i < m_info.uiArraySize; i++)
+	{
+		for (uint32_t j = uiFirstMip; j < uiFirstMip + uiMipCount; j++)
+		{
+			const DdsMip &mip = GetMip(i, j);
+			D3D11_SUBRESOURCE_DATA subresource;
+			subresource.pSysMem = m_pData + mip.offset;
+			subresource.SysMemPitch = mip.uiRowPitch;
+			subresource.SysMemSlicePitch = static_cast<UINT>(mip.size);
+			subresources.push_back(subresource);
+		}
+	}
+
+	ID3D11Texture2D *pTexture = nullptr;
+	result = pDevice->CreateTexture2D(&textureDesc, subresources.data(), &pTexture);
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	// Create shader resource view
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+	ZeroMemory(&viewDesc, sizeof(viewDesc));
+	viewDesc.Format = textureDesc.Format;
+	if (m_info.bIsCubeMap)
+	{
+		viewDesc.ViewDimension = m_info.uiArraySize > 6 ? D3D11_SRV_DIMENSION_TEXTURECUBEARRAY : D3D11_SRV_DIMENSION_TEXTURECUBE;
+		viewDesc.TextureCubeArray.MipLevels = uiMipCount;
+		viewDesc.TextureCubeArray.NumCubes = m_info.uiArraySize / 6;
+	}
+	else if (m_info.uiArraySize > 1)
+	{
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		viewDesc.Texture2DArray.MipLevels = uiMipCount;
+		viewDesc.Texture2DArray.ArraySize = m_info.uiArraySize;
+	}
+	else
+	{
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		viewDesc.Texture2D.MipLevels = uiMipCount;
+	}
+
+	result = pDevice->CreateShaderResourceView(pTexture, &viewDesc, ppTextureView);
+	pTexture->Release();
+
+	return result;
+}
+#endif
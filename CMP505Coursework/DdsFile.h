@@ -0,0 +1,81 @@
+//
+// DdsFile.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// DDS (https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dx-graphics-dds-pguide)
+// DDS_HEADER_DXT10 (https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dds-header-dxt10)
+// DirectXTK DDSTextureLoader (https://github.com/microsoft/DirectXTK)
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <d3d11.h>
+#endif
+
+#define MAX_DDS_MIP_COUNT 16
+
+struct DdsMip
+{
+	uint32_t uiWidth;
+	uint32_t uiHeight;
+	uint32_t uiRowPitch;			// Bytes per row of pixels (or of 4x4 blocks)
+	uint32_t uiRowCount;
+	uint64_t offset;				// Byte offset from the start of the file
+	uint64_t size;
+};
+
+struct DdsTextureInfo
+{
+	uint32_t uiWidth;
+	uint32_t uiHeight;
+	uint32_t uiMipCount;
+	uint32_t uiArraySize;			// 6 per cube
+	uint32_t uiFormat;				// DXGI_FORMAT value (0 if the format is not supported)
+	bool bIsCubeMap;
+	bool bIsBlockCompressed;
+};
+
+// Memory-mapped DDS file, with the layout of every mip so a range of them can be uploaded (or streamed in later) without copying the file
+// Only 2D textures, texture arrays and cube maps are supported (not volume textures)
+class DdsFile
+{
+public:
+	DdsFile();
+
+	bool Open(const char *filePath);
+	// The data is not copied, so it has to outlive the file
+	bool Parse(const uint8_t *pData, size_t size);
+	const DdsTextureInfo& GetInfo();
+	const DdsMip& GetMip(uint32_t uiArraySlice, uint32_t uiMip);
+	const uint8_t* GetMipData(uint32_t uiArraySlice, uint32_t uiMip);
+	// Bytes of mips [uiFirstMip, uiFirstMip + uiMipCount) of every array slice
+	uint64_t GetMipRangeSize(uint32_t uiFirstMip, uint32_t uiMipCount);
+	const uint8_t* GetData();
+	size_t GetSize();
+	// Reads a byte of every page of the mip range, so the pages are already in memory when the range is uploaded
+	void PrefetchMips(uint32_t uiFirstMip, uint32_t uiMipCount);
+	// Bytes of a mip of the size in the format, or 0 if the format is not supported (also used for textures that are not loaded from DDS files)
+	static uint64_t GetMipSize(uint32_t uiFormat, uint32_t uiWidth, uint32_t uiHeight);
+
+#ifdef _WIN32
+	// Uploads mips [uiFirstMip, uiFirstMip + uiMipCount) of every array slice, the first of them becomes mip 0 of the texture
+	// (block compressed textures start at the last mip in the range whose size is still a multiple of 4 if the first one is not)
+	HRESULT CreateTexture(ID3D11Device *pDevice, uint32_t uiFirstMip, uint32_t uiMipCount, ID3D11ShaderResourceView **ppTextureView);
+#endif
+
+private:
+	MappedFile m_file;
+	const uint8_t *m_pData;
+	size_t m_size;
+	DdsTextureInfo m_info;
+	std::vector<DdsMip> m_mips;		// uiMipCount per array slice, in file order
+
+	DdsFile(const DdsFile&) = delete;
+	DdsFile& operator=(const DdsFile&) = delete;
+};
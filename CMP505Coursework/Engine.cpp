@@ -29,6 +29,8 @@ Engine::~Engine()
 
 bool Engine::Initialize(LPCTSTR applicationName, int iWindowWidth, int iWindowHeight)
 {
+	ProfileZone profileZone("Engine::Initialize");
+
 	if (!InitMainWindow(iWindowWidth, iWindowHeight))
 	{
 		return false;
@@ -0,0 +1,195 @@
+//
+// FileReadQueue.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Synchronous and Asynchronous I/O (https://docs.microsoft.com/en-us/windows/win32/fileio/synchronous-and-asynchronous-i-o)
+// aio(7) (https://man7.org/linux/man-pages/man7/aio.7.html)
+//
+
+#include "FileReadQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FileReadQueue::FileReadQueue()
+{
+	m_byteCount = 0;
+	m_dWaitMilliseconds = 0.0;
+}
+
+FileReadQueue::~FileReadQueue()
+{
+	// The reads write to the buffers until they finish
+	for (auto &read : m_reads)
+	{
+		std::lock_guard<std::mutex> lock(read.second->mutex);
+		Complete(*read.second);
+	}
+}
+
+bool FileReadQueue::Submit(const std::string &strFilePath)
+{
+	std::string strKey = NormalizePath(strFilePath);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_reads.find(strKey) != m_reads.end())
+	{
+		return true;
+	}
+
+	std::unique_ptr<FileRead> pRead(new FileRead());
+	pRead->size = 0;
+	pRead->bIsPending = false;
+	pRead->bIsSuccessful = false;
+
+#ifdef _WIN32
+	pRead->hFile = CreateFileA(strFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (pRead->hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(pRead->hFile, &fileSize) || fileSize.QuadPart > MAXDWORD)
+	{
+		CloseHandle(pRead->hFile);
+		return false;
+	}
+	pRead->size = static_cast<size_t>(fileSize.QuadPart);
+	pRead->data.reset(new char[pRead->size > 0 ? pRead->size : 1]);
+
+	// Cached files can be read before ReadFile returns, the result is collected the same way either way
+	pRead->overlapped = {};
+	pRead->overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+	if (pRead->overlapped.hEvent == nullptr ||
+		(!ReadFile(pRead->hFile, pRead->data.get(), static_cast<DWORD>(pRead->size), nullptr, &pRead->overlapped) && GetLastError() != ERROR_IO_PENDING))
+	{
+		if (pRead->overlapped.hEvent != nullptr)
+		{
+			CloseHandle(pRead->overlapped.hEvent);
+		}
+		CloseHandle(pRead->hFile);
+		return false;
+	}
+#else
+	pRead->iFileDescriptor = open(strFilePath.c_str(), O_RDONLY);
+	if (pRead->iFileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStatus;
+	if (fstat(pRead->iFileDescriptor, &fileStatus) != 0)
+	{
+		close(pRead->iFileDescriptor);
+		return false;
+	}
+	pRead->size = static_cast<size_t>(fileStatus.st_size);
+	pRead->data.reset(new char[pRead->size > 0 ? pRead->size : 1]);
+
+	// The file is read front to back
+	posix_fadvise(pRead->iFileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	memset(&pRead->controlBlock, 0, sizeof(pRead->controlBlock));
+	pRead->controlBlock.aio_fildes = pRead->iFileDescriptor;
+	pRead->controlBlock.aio_buf = pRead->data.get();
+	pRead->controlBlock.aio_nbytes = pRead->size;
+	pRead->controlBlock.aio_offset = 0;
+	if (aio_read(&pRead->controlBlock) != 0)
+	{
+		close(pRead->iFileDescriptor);
+		return false;
+	}
+#endif
+
+	pRead->bIsPending = true;
+	m_reads[strKey] = std::move(pRead);
+
+	return true;
+}
+
+bool FileReadQueue::Wait(const std::string &strFilePath, const char *&pData, size_t &size)
+{
+	FileRead *pRead = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto read = m_reads.find(NormalizePath(strFilePath));
+		if (read == m_reads.end())
+		{
+			return false;
+		}
+		pRead = read->second.get();
+	}
+
+	std::lock_guard<std::mutex> lock(pRead->mutex);
+	if (pRead->bIsPending)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+		Complete(*pRead);
+		double dMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		std::lock_guard<std::mutex> queueLock(m_mutex);
+		m_dWaitMilliseconds += dMilliseconds;
+		m_byteCount += pRead->bIsSuccessful ? pRead->size : 0;
+	}
+	if (!pRead->bIsSuccessful)
+	{
+		return false;
+	}
+
+	pData = pRead->data.get();
+	size = pRead->size;
+
+	return true;
+}
+
+void FileReadQueue::Complete(FileRead &read)
+{
+	if (!read.bIsPending)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	DWORD dwByteCount = 0;
+	read.bIsSuccessful = GetOverlappedResult(read.hFile, &read.overlapped, &dwByteCount, TRUE) && dwByteCount == read.size;
+	CloseHandle(read.overlapped.hEvent);
+	CloseHandle(read.hFile);
+#else
+	const struct aiocb *controlBlocks[] = { &read.controlBlock };
+	int iError = aio_error(&read.controlBlock);
+	while (iError == EINPROGRESS)
+	{
+		aio_suspend(controlBlocks, 1, nullptr);
+		iError = aio_error(&read.controlBlock);
+	}
+	read.bIsSuccessful = iError == 0 && aio_return(&read.controlBlock) == static_cast<ssize_t>(read.size);
+	close(read.iFileDescriptor);
+#endif
+
+	read.bIsPending = false;
+}
+
+std::string FileReadQueue::GetReport()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "File read queue: %d files, %.1f KB read, %.2f ms waiting for reads in flight\n", static_cast<int>(m_reads.size()),
+			 m_byteCount / 1024.0, m_dWaitMilliseconds);
+	return buffer;
+}
+
+std::string FileReadQueue::NormalizePath(const std::string &strFilePath)
+{
+	std::string strKey = strFilePath;
+	std::replace(strKey.begin(), strKey.end(), '\\', '/');
+	return strKey;
+}
@@ -0,0 +1,73 @@
+//
+// FileReadQueue.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Synchronous and Asynchronous I/O (https://docs.microsoft.com/en-us/windows/win32/fileio/synchronous-and-asynchronous-i-o)
+// aio(7) (https://man7.org/linux/man-pages/man7/aio.7.html)
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <aio.h>
+#endif
+
+// Reads whole files in the background, every file submitted is read at the same time
+// Files are submitted up front (before the threads that use them start) and waited for by whoever parses them, so the reads overlap
+// each other and the work done while they are in flight
+// Each file is read straight into a buffer of its size, which is kept until the queue is destroyed
+// Paths are compared with '\' and '/' treated as the same separator
+class FileReadQueue
+{
+public:
+	FileReadQueue();
+	// Waits for the reads still in flight
+	~FileReadQueue();
+
+	// Returns false if the file cannot be opened or the read cannot be started (files already submitted are not read again)
+	bool Submit(const std::string &strFilePath);
+	// Blocks until the file has been read, returns false if it was not submitted or could not be read
+	// Any thread can wait for any file (the data is not null-terminated)
+	bool Wait(const std::string &strFilePath, const char *&pData, size_t &size);
+	// Files read, bytes read and the time spent waiting for reads in flight
+	std::string GetReport();
+
+private:
+	struct FileRead
+	{
+		std::unique_ptr<char[]> data;
+		size_t size;
+		bool bIsPending;
+		bool bIsSuccessful;
+		std::mutex mutex;			// Held while the read is completed, so it is only completed once
+#ifdef _WIN32
+		HANDLE hFile;
+		OVERLAPPED overlapped;
+#else
+		int iFileDescriptor;
+		struct aiocb controlBlock;
+#endif
+	};
+
+	std::map<std::string, std::unique_ptr<FileRead>> m_reads;
+	std::mutex m_mutex;
+	uint64_t m_byteCount;
+	double m_dWaitMilliseconds;
+
+	static std::string NormalizePath(const std::string &strFilePath);
+	// Blocks until the read has finished and closes the file (call with the read's mutex held)
+	static void Complete(FileRead &read);
+
+	FileReadQueue(const FileReadQueue&) = delete;
+	FileReadQueue& operator=(const FileReadQueue&) = delete;
+};
@@ -0,0 +1,181 @@
+//
+// FileWatcher.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+
+#include "FileWatcher.h"
+
+FileWatcher::FileWatcher()
+{
+	m_hStopEvent = nullptr;
+}
+
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+bool FileWatcher::Start(const std::vector<std::string> &directories)
+{
+	Stop();
+
+	for (auto &strDirectory : directories)
+	{
+		WatchedDirectory *pDirectory = new WatchedDirectory();
+		pDirectory->strPath = strDirectory;
+		pDirectory->hDirectory = CreateFileA(strDirectory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+											 OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		pDirectory->overlapped = {};
+		pDirectory->overlapped.hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		m_directories.push_back(pDirectory);
+
+		if (pDirectory->hDirectory == INVALID_HANDLE_VALUE || pDirectory->overlapped.hEvent == nullptr || !WatchDirectory(pDirectory))
+		{
+			Stop();
+			return false;
+		}
+	}
+
+	m_hStopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	if (m_hStopEvent == nullptr)
+	{
+		Stop();
+		return false;
+	}
+	m_thread = std::thread(&FileWatcher::Run, this);
+
+	return true;
+}
+
+void FileWatcher::Stop()
+{
+	if (m_thread.joinable())
+	{
+		SetEvent(m_hStopEvent);
+		m_thread.join();
+	}
+	if (m_hStopEvent != nullptr)
+	{
+		CloseHandle(m_hStopEvent);
+		m_hStopEvent = nullptr;
+	}
+
+	for (auto pDirectory : m_directories)
+	{
+		if (pDirectory->hDirectory != INVALID_HANDLE_VALUE)
+		{
+			// The pending read writes into the buffer until it is cancelled
+			DWORD dwByteCount = 0;
+			if (CancelIoEx(pDirectory->hDirectory, &pDirectory->overlapped))
+			{
+				GetOverlappedResult(pDirectory->hDirectory, &pDirectory->overlapped, &dwByteCount, TRUE);
+			}
+			CloseHandle(pDirectory->hDirectory);
+		}
+		if (pDirectory->overlapped.hEvent != nullptr)
+		{
+			CloseHandle(pDirectory->overlapped.hEvent);
+		}
+		delete pDirectory;
+	}
+	m_directories.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_changedFiles.clear();
+}
+
+std::vector<std::string> FileWatcher::GetChangedFiles()
+{
+	std::vector<std::string> changedFiles;
+	auto currentTime = std::chrono::high_resolution_clock::now();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto entry = m_changedFiles.begin(); entry != m_changedFiles.end();)
+	{
+		if (std::chrono::duration<float, std::milli>(currentTime - entry->second).count() >= FILE_WATCHER_SETTLE_MILLISECONDS)
+		{
+			changedFiles.push_back(entry->first);
+			entry = m_changedFiles.erase(entry);
+		}
+		else
+		{
+			entry++;
+		}
+	}
+
+	return changedFiles;
+}
+
+bool FileWatcher::WatchDirectory(WatchedDirectory *pDirectory)
+{
+	// The read completes (and signals the directory's event) when a change is recorded
+	return ReadDirectoryChangesW(pDirectory->hDirectory,
+								 pDirectory->buffer,
+								 sizeof(pDirectory->buffer),
+								 FALSE,												// Not the subdirectories
+								 FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+								 nullptr,											// Bytes returned (only used by synchronous reads)
+								 &pDirectory->overlapped,
+								 nullptr) != FALSE;
+}
+
+void FileWatcher::ReadChanges(WatchedDirectory *pDirectory)
+{
+	DWORD dwByteCount = 0;
+	if (!GetOverlappedResult(pDirectory->hDirectory, &pDirectory->overlapped, &dwByteCount, FALSE) || dwByteCount == 0)
+	{
+		return; // The buffer overflowed
+	}
+
+	auto currentTime = std::chrono::high_resolution_clock::now();
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const BYTE *pRecord = reinterpret_cast<const BYTE*>(pDirectory->buffer);
+	while (true)
+	{
+		const FILE_NOTIFY_INFORMATION *pInformation = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(pRecord);
+
+		// Removed files and the old names of renamed files are not reported (saving through a temporary file ends with a rename to the real name)
+		if (pInformation->Action == FILE_ACTION_ADDED || pInformation->Action == FILE_ACTION_MODIFIED || pInformation->Action == FILE_ACTION_RENAMED_NEW_NAME)
+		{
+			int iNameLength = static_cast<int>(pInformation->FileNameLength / sizeof(WCHAR));
+			int iByteCount = WideCharToMultiByte(CP_UTF8, 0, pInformation->FileName, iNameLength, nullptr, 0, nullptr, nullptr);
+			std::string strFileName(iByteCount, '\0');
+			WideCharToMultiByte(CP_UTF8, 0, pInformation->FileName, iNameLength, &strFileName[0], iByteCount, nullptr, nullptr);
+
+			m_changedFiles[pDirectory->strPath + '/' + strFileName] = currentTime;
+		}
+
+		if (pInformation->NextEntryOffset == 0)
+		{
+			break;
+		}
+		pRecord += pInformation->NextEntryOffset;
+	}
+}
+
+void FileWatcher::Run()
+{
+	std::vector<HANDLE> events = { m_hStopEvent };
+	for (auto pDirectory : m_directories)
+	{
+		events.push_back(pDirectory->overlapped.hEvent);
+	}
+
+	while (true)
+	{
+		DWORD dwResult = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, INFINITE);
+		if (dwResult <= WAIT_OBJECT_0 || dwResult >= WAIT_OBJECT_0 + events.size())
+		{
+			break; // Stopped (or the wait failed)
+		}
+
+		WatchedDirectory *pDirectory = m_directories[dwResult - WAIT_OBJECT_0 - 1];
+		ReadChanges(pDirectory);
+		if (!WatchDirectory(pDirectory))
+		{
+			OutputDebugStringA(("Stopped watching " + pDirectory->strPath + "\n").c_str());
+			break;
+		}
+	}
+}
@@ -0,0 +1,60 @@
+//
+// FileWatcher.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// ReadDirectoryChangesW (https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-readdirectorychangesw)
+// Understanding ReadDirectoryChangesW (https://qualapps.blogspot.com/2010/05/understanding-readdirectorychangesw.html)
+//
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+#define FILE_WATCHER_SETTLE_MILLISECONDS 250	// Editors often write a file several times when saving it, so a change is only reported once the file is left alone
+#define FILE_WATCHER_BUFFER_SIZE 16384			// Bytes of change records per directory (the changes are lost if it overflows, until the file changes again)
+
+// Watches directories for files that are written, created or renamed, on a thread of its own
+class FileWatcher
+{
+public:
+	FileWatcher();
+	// Stops watching (and waits for the watcher thread)
+	~FileWatcher();
+
+	// Only the files directly in the directories are watched, not their subdirectories (so the cooked files are not)
+	// Fails if a directory cannot be opened
+	bool Start(const std::vector<std::string> &directories);
+	void Stop();
+	// Files that changed since the last call and have settled
+	// The paths start with the watched directory and use forward slashes ("Shaders/LightPixelShader.hlsl")
+	std::vector<std::string> GetChangedFiles();
+
+private:
+	struct WatchedDirectory
+	{
+		std::string strPath;
+		HANDLE hDirectory;
+		OVERLAPPED overlapped;
+		DWORD buffer[FILE_WATCHER_BUFFER_SIZE / sizeof(DWORD)];	// The change records are DWORD aligned
+	};
+
+	std::vector<WatchedDirectory*> m_directories;
+	std::thread m_thread;
+	HANDLE m_hStopEvent;
+	std::mutex m_mutex;
+	std::map<std::string, std::chrono::high_resolution_clock::time_point> m_changedFiles;	// Last change of each file that has not been reported
+
+	bool WatchDirectory(WatchedDirectory *pDirectory);
+	void ReadChanges(WatchedDirectory *pDirectory);
+	void Run();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+};
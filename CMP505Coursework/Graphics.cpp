@@ -30,6 +30,10 @@ Graphics::Graphics()
 	m_pOffScreenRenderer = nullptr;
 	m_pPostProcessQuad = nullptr;
 	m_pBloom = nullptr;
+	m_iWindowWidth = 0;
+	m_iWindowHeight = 0;
+	m_pFileWatcher = nullptr;
+	m_pShaderReloadGraph = nullptr;
 	m_fTotalTime = 0.0f;
 	m_fLeftAnimationRotation = 0.0f;
 	m_fRightAnimationRotation = 0.0f;
@@ -37,12 +41,16 @@ Graphics::Graphics()
 	m_bPlayLeftAnimation = false;
 	m_bPlayRightAnimation = false;
 	m_bPlayClockAnimation = false;
+	m_bWasResidencyKeyDown = false;
 	m_pLeftLeverBoxModel = nullptr;
 	m_pRightLeverBoxModel = nullptr;
 }
 
 Graphics::~Graphics()
 {
+	// Stopped first, since the reload tasks still use the shaders
+	SAFE_DELETE(m_pFileWatcher)
+	SAFE_DELETE(m_pShaderReloadGraph)
 	SAFE_RELEASE(m_pDevice)
 	SAFE_RELEASE(m_pImmediateContext)
 	SAFE_RELEASE(m_pSwapChain)
@@ -63,10 +71,15 @@ Graphics::~Graphics()
 	SAFE_DELETE(m_pBloom)
 	SAFE_DELETE(m_pLeftLeverBoxModel)
 	SAFE_DELETE(m_pRightLeverBoxModel)
+	AssetPack::Unmount();
 }
 
 bool Graphics::Initialize(int iWindowWidth, int iWindowHeight, HWND hWindow)
 {
+	ProfileZone profileZone("Graphics::Initialize");
+	m_iWindowWidth = iWindowWidth;
+	m_iWindowHeight = iWindowHeight;
+
 	// Create device, swap chain, render target view, and depth stencil view
 	// Create depth stencil states, rasterizer states, and blend states
 	// Setup the viewport
@@ -82,8 +95,24 @@ bool Graphics::Initialize(int iWindowWidth, int iWindowHeight, HWND hWindow)
 	m_pCamera = new Camera(position, fAspectRatio);
 
 	// Load models and textures
+#if USE_ASSET_PACK
+	// Mounted before anything reads a resource, and kept until everything that reads them is deleted
+	if (!AssetPack::Mount(ASSET_PACK_FILE_PATH, "Resources/"))
+	{
+		OutputDebugStringA("No asset pack at " ASSET_PACK_FILE_PATH ", the loose resource files are used\n");
+	}
+#endif
+#if LOADING_BENCHMARK
+	// Each load starts from scratch (only the first one may have to cook the meshes)
+	for (int iThreadCount = 1; iThreadCount <= TaskGraph::GetDefaultThreadCount(); iThreadCount++)
+	{
+		ResourceManager resourceManager(m_pDevice, m_pImmediateContext);
+		resourceManager.LoadResources(iThreadCount);
+	}
+#endif
+	// The level is drawn right away, with placeholders until the resources have streamed in
 	m_pResourceManager = new ResourceManager(m_pDevice, m_pImmediateContext);
-	if (!m_pResourceManager->LoadResources())
+	if (!m_pResourceManager->StartStreaming())
 	{
 		return false;
 	}
@@ -122,11 +151,22 @@ bool Graphics::Initialize(int iWindowWidth, int iWindowHeight, HWND hWindow)
 		return false;
 	}
 
+#if HOT_RELOAD
+	// The directories are watched on a thread of their own, the level runs without hot reload if they cannot be
+	m_pFileWatcher = new FileWatcher();
+	if (!m_pFileWatcher->Start({ "Resources", "Shaders" }))
+	{
+		OutputDebugStringA("Failed to watch the resource and shader directories.\n");
+		SAFE_DELETE(m_pFileWatcher)
+	}
+#endif
+
 	return true;
 }
 
 HRESULT Graphics::InitDirect3D(int iWindowWidth, int iWindowHeight, HWND hWindow)
 {
+	ProfileZone profileZone("Graphics::InitDirect3D");
 	HRESULT result = S_OK;
 
 	// Create device and swap chain
@@ -348,28 +388,22 @@ HRESULT Graphics::InitDirect3D(int iWindowWidth, int iWindowHeight, HWND hWindow
 
 bool Graphics::InitCollision()
 {
-	XMFLOAT3 boxExtents = XMFLOAT3(4.0f, 4.0f, 4.0f);
-
-	// Setup the collision boxes
-	m_leftLeverCollisionBox.Center = LEFT_LEVER_POSITION;
-	m_leftLeverCollisionBox.Extents = boxExtents;
-	m_rightLeverCollisionBox.Center = RIGHT_LEVER_POSITION;
-	m_rightLeverCollisionBox.Extents = boxExtents;
+	ProfileZone profileZone("Graphics::InitCollision");
 
 	// Initialize box models
-	XMMATRIX boxScalingMatrix = XMMatrixScaling(boxExtents.x, boxExtents.y, boxExtents.z);
 	m_pLeftLeverBoxModel = new ColorModel();
 	if (!m_pLeftLeverBoxModel->InitializeBuffers(m_pDevice))
 	{
 		return false;
 	}
-	m_pLeftLeverBoxModel->SetWorldMatrix(boxScalingMatrix * XMMatrixTranslation(LEFT_LEVER_POSITION.x, LEFT_LEVER_POSITION.y, LEFT_LEVER_POSITION.z));
 	m_pRightLeverBoxModel = new ColorModel();
 	if (!m_pRightLeverBoxModel->InitializeBuffers(m_pDevice))
 	{
 		return false;
 	}
-	m_pRightLeverBoxModel->SetWorldMatrix(boxScalingMatrix * XMMatrixTranslation(RIGHT_LEVER_POSITION.x, RIGHT_LEVER_POSITION.y, RIGHT_LEVER_POSITION.z));
+
+	// Setup the collision boxes
+	PlaceLeverCollisionBoxes();
 
 	// Setup the camera collision sphere
 	m_cameraCollisionSphere.sphere.Radius = 4.0f;
@@ -380,6 +414,109 @@ bool Graphics::InitCollision()
 	return true;
 }
 
+void Graphics::PlaceLeverCollisionBoxes()
+{
+	XMFLOAT3 boxExtents = XMFLOAT3(4.0f, 4.0f, 4.0f);
+	XMFLOAT3 leftLeverPosition = m_pResourceManager->GetModelPosition(ModelResource::LeverModel1);
+	XMFLOAT3 rightLeverPosition = m_pResourceManager->GetModelPosition(ModelResource::LeverModel2);
+
+	m_leftLeverCollisionBox.Center = leftLeverPosition;
+	m_leftLeverCollisionBox.Extents = boxExtents;
+	m_rightLeverCollisionBox.Center = rightLeverPosition;
+	m_rightLeverCollisionBox.Extents = boxExtents;
+
+	XMMATRIX boxScalingMatrix = XMMatrixScaling(boxExtents.x, boxExtents.y, boxExtents.z);
+	m_pLeftLeverBoxModel->SetWorldMatrix(boxScalingMatrix * XMMatrixTranslation(leftLeverPosition.x, leftLeverPosition.y, leftLeverPosition.z));
+	m_pRightLeverBoxModel->SetWorldMatrix(boxScalingMatrix * XMMatrixTranslation(rightLeverPosition.x, rightLeverPosition.y, rightLeverPosition.z));
+}
+
+void Graphics::UpdateHotReload()
+{
+	// Resource files are reloaded by the resource manager, shader files (and the bloom's text texture) here
+	if (m_pFileWatcher != nullptr)
+	{
+		for (auto &strFilePath : m_pFileWatcher->GetChangedFiles())
+		{
+			if (strFilePath.compare(0, 10, "Resources/") == 0)
+			{
+				// The packed copy is out of date, so the file is read from disk from now on (by the bloom too)
+				if (AssetPack::GetMounted() != nullptr)
+				{
+					AssetPack::GetMounted()->Override(strFilePath);
+				}
+				m_pResourceManager->ReloadFile(strFilePath);
+			}
+			if (strFilePath.compare(0, 8, "Shaders/") == 0 || Bloom::UsesFile(strFilePath))
+			{
+				m_pendingShaderReloadFiles.insert(strFilePath);
+			}
+		}
+	}
+
+	if (m_pResourceManager->UpdateReloading(STREAMING_BUDGET_MILLISECONDS))
+	{
+		PlaceLeverCollisionBoxes();
+	}
+
+	if (m_pShaderReloadGraph != nullptr)
+	{
+		if (!m_pShaderReloadGraph->Update(STREAMING_BUDGET_MILLISECONDS))
+		{
+			return;
+		}
+
+		if (m_pShaderReloadGraph->HasFailed())
+		{
+			OutputDebugStringA("Failed to reload shaders (the ones that failed are kept as they were).\n");
+		}
+#ifdef _DEBUG
+		OutputDebugStringA(m_pShaderReloadGraph->GetReport().c_str());
+#endif
+		SAFE_DELETE(m_pShaderReloadGraph)
+	}
+
+	if (m_pendingShaderReloadFiles.empty())
+	{
+		return;
+	}
+
+	// Shaders are compiled on worker threads and swapped in between frames (like the bloom, which is created again with its shaders)
+	TaskGraph *pShaderReloadGraph = new TaskGraph();
+	bool bIsUsed = m_pShaderManager->AddReloadTasks(*pShaderReloadGraph, m_pendingShaderReloadFiles);
+	bool bIsBloomChanged = false;
+	for (auto &strFilePath : m_pendingShaderReloadFiles)
+	{
+		bIsBloomChanged |= Bloom::UsesFile(strFilePath);
+	}
+	m_pendingShaderReloadFiles.clear();
+
+	if (bIsBloomChanged)
+	{
+		std::shared_ptr<std::unique_ptr<Bloom>> pNewBloom = std::make_shared<std::unique_ptr<Bloom>>();
+		int iCreateBloom = pShaderReloadGraph->AddTask("Create bloom", WorkerThread, {}, [this, pNewBloom]
+		{
+			pNewBloom->reset(new Bloom(m_pDevice, m_pImmediateContext));
+			return SUCCEEDED((*pNewBloom)->Initialize(m_iWindowWidth, m_iWindowHeight));
+		});
+
+		pShaderReloadGraph->AddTask("Swap bloom", DeviceThread, { iCreateBloom }, [this, pNewBloom]
+		{
+			SAFE_DELETE(m_pBloom)
+			m_pBloom = pNewBloom->release();
+			return true;
+		});
+		bIsUsed = true;
+	}
+
+	if (!bIsUsed)
+	{
+		delete pShaderReloadGraph;
+		return;
+	}
+	m_pShaderReloadGraph = pShaderReloadGraph;
+	m_pShaderReloadGraph->Start(2);
+}
+
 #pragma endregion
 
 #pragma region Input Handling
@@ -450,6 +587,14 @@ void Graphics::HandleKeyboardInput(float fDeltaTime)
 			m_pResourceManager->SetShouldRotateRightLever(true);
 		}
 	}
+
+	// Print the memory used by the resources to the debugger
+	bool bIsResidencyKeyDown = (GetAsyncKeyState('M') & 0x8000) != 0;
+	if (bIsResidencyKeyDown && !m_bWasResidencyKeyDown)
+	{
+		OutputDebugStringA(m_pResourceManager->GetResidencySnapshot().c_str());
+	}
+	m_bWasResidencyKeyDown = bIsResidencyKeyDown;
 }
 
 void Graphics::OnMouseDown(int x, int y, HWND hWindow)
@@ -489,6 +634,28 @@ bool Graphics::Render(const float fDeltaTime)
 {
 	m_fTotalTime += fDeltaTime;
 
+	// Create the resources that have finished loading in the background
+	if (!m_pResourceManager->UpdateStreaming(STREAMING_BUDGET_MILLISECONDS))
+	{
+		return false;
+	}
+
+#if HOT_RELOAD
+	// Swap in the resources and shaders that have been reloaded since their files changed
+	UpdateHotReload();
+#endif
+
+	// The startup profile covers everything up to the last resource being streamed in
+	if (Profiler::IsCapturing() && !m_pResourceManager->IsStreaming())
+	{
+		Profiler::StopCapture();
+		if (!Profiler::WriteChromeTrace(STARTUP_TRACE_FILE_PATH))
+		{
+			OutputDebugStringA("Failed to write startup trace.\n");
+		}
+		OutputDebugStringA(Profiler::GetSummary().c_str());
+	}
+
 	HandleKeyboardInput(fDeltaTime);
 	m_pCamera->Update();
 
@@ -511,13 +678,16 @@ bool Graphics::Render(const float fDeltaTime)
 
 	// Render models
 
-	// Set the vertex and index buffers and the primitive topology
-	m_pResourceManager->RenderModel(TxtModelResource::GroundModel);
-	// Set the vertex input layout, constant buffers, texture, sampler state, and shaders
-	// Draw
-	if (!m_pShaderManager->RenderModel(m_pResourceManager->GetModel(TxtModelResource::GroundModel), m_pCamera))
+	if (m_pResourceManager->IsModelReady(TxtModelResource::GroundModel))
 	{
-		return false;
+		// Set the vertex and index buffers and the primitive topology
+		m_pResourceManager->RenderModel(TxtModelResource::GroundModel);
+		// Set the vertex input layout, constant buffers, texture, sampler state, and shaders
+		// Draw
+		if (!m_pShaderManager->RenderModel(m_pResourceManager->GetModel(TxtModelResource::GroundModel), m_pCamera))
+		{
+			return false;
+		}
 	}
 
 	if (!m_pResourceManager->RenderModel(ModelResource::CrystalPostModel, m_pCamera, m_pShaderManager->GetLightShader()))
@@ -602,15 +772,18 @@ bool Graphics::Render(const float fDeltaTime)
 	// Turn off back face culling
 	m_pImmediateContext->RSSetState(m_pRasterizerStateNoCulling);
 
-	// Translate the sky dome to be centered around the camera position
-	XMMATRIX skyTranslationMatrix = XMMatrixTranslation(m_pCamera->GetPosition().x, m_pCamera->GetPosition().y, m_pCamera->GetPosition().z);
-	m_pResourceManager->GetSkyDome()->SetWorldMatrix(skyTranslationMatrix);
-
-	// Render sky dome
-	m_pResourceManager->RenderModel(TxtModelResource::SkyDomeModel);
-	if (!m_pShaderManager->RenderSkyDome(m_pResourceManager->GetSkyDome(), m_pCamera, m_fTotalTime))
+	if (m_pResourceManager->IsModelReady(TxtModelResource::SkyDomeModel))
 	{
-		return false;
+		// Translate the sky dome to be centered around the camera position
+		XMMATRIX skyTranslationMatrix = XMMatrixTranslation(m_pCamera->GetPosition().x, m_pCamera->GetPosition().y, m_pCamera->GetPosition().z);
+		m_pResourceManager->GetSkyDome()->SetWorldMatrix(skyTranslationMatrix);
+
+		// Render sky dome
+		m_pResourceManager->RenderModel(TxtModelResource::SkyDomeModel);
+		if (!m_pShaderManager->RenderSkyDome(m_pResourceManager->GetSkyDome(), m_pCamera, m_fTotalTime))
+		{
+			return false;
+		}
 	}
 
 	// Set the depth test comparison back to default
@@ -12,11 +12,14 @@
 #include <dxgi.h>
 #include <d3d11.h>
 #include <DirectXCollision.h>
+#include <set>
 #include "Camera.h"
 #include "ResourceManager.h"
 #include "ShaderManager.h"
 #include "Bloom.h"
 #include "ColorModel.h"
+#include "FileWatcher.h"
+#include "Profiler.h"
 #include "Utils.h"
 
 // Link necessary libraries
@@ -24,6 +27,10 @@
 #pragma comment(lib, "d3d11.lib")
 
 #define ROTATION_INCREMENT (2 * XM_PI / 60) * (fDeltaTime / 1000) * 4;
+#define STARTUP_TRACE_FILE_PATH "startup_trace.json"	// Written when the startup profile ends (run with -profile-startup)
+#define HOT_RELOAD true									// Reload the resources and shaders whose files change while the level runs
+#define USE_ASSET_PACK true								// Read the resources from the asset pack the asset cooker builds (the loose files if there is none)
+#define ASSET_PACK_FILE_PATH "Resources/assets.pack"
 
 struct CollisionSphere
 {
@@ -66,6 +73,11 @@ private:
 	OffScreenRenderer *m_pOffScreenRenderer;
 	PostProcessQuad *m_pPostProcessQuad;
 	Bloom *m_pBloom;
+	int m_iWindowWidth;
+	int m_iWindowHeight;
+	FileWatcher *m_pFileWatcher;
+	TaskGraph *m_pShaderReloadGraph;
+	std::set<std::string> m_pendingShaderReloadFiles;
 	float m_fTotalTime;
 	float m_fLeftAnimationRotation;
 	float m_fRightAnimationRotation;
@@ -73,6 +85,7 @@ private:
 	bool m_bPlayLeftAnimation;
 	bool m_bPlayRightAnimation;
 	bool m_bPlayClockAnimation;
+	bool m_bWasResidencyKeyDown;		// The residency snapshot is printed once per key press
 	BoundingBox m_leftLeverCollisionBox; // Axis-aligned box
 	BoundingBox m_rightLeverCollisionBox;
 	ColorModel *m_pLeftLeverBoxModel;
@@ -81,6 +94,9 @@ private:
 
 	HRESULT InitDirect3D(int iWindowWidth, int iWindowHeight, HWND hWindow);
 	bool InitCollision();
+	// The collision boxes follow the levers, which the level may move when it is reloaded
+	void PlaceLeverCollisionBoxes();
+	void UpdateHotReload();
 	void HandleKeyboardInput(float fDeltaTime);
 	void SetRenderTarget();
 	void UnbindPixelShaderResources();
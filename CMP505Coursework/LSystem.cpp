@@ -2,584 +2,772 @@
 // LSystem.cpp
 // Copyright  2019 Diel Barnes. All rights reserved.
 //
+// Reference:
+// The Algorithmic Beauty of Plants, parametric L-systems (http://algorithmicbotany.org/papers/abop/abop.pdf)
+//
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <set>
+#include <sstream>
 #include "LSystem.h"
+#include "MappedFile.h"
+#include "NumberParser.h"
+
+#pragma region Expression
+
+float Expression::Evaluate(const std::vector<float> &parameters) const
+{
+	std::vector<float> stack(steps.size());
+	int iTop = 0;
+	for (const Step &step : steps)
+	{
+		switch (step.operation)
+		{
+		case PushNumber:
+			stack[iTop++] = step.fValue;
+			continue;
+		case PushParameter:
+			stack[iTop++] = parameters[static_cast<size_t>(step.fValue)];
+			continue;
+		case Negate:
+			stack[iTop - 1] = -stack[iTop - 1];
+			continue;
+		case Round:
+			stack[iTop - 1] = roundf(stack[iTop - 1]);
+			continue;
+		default:
+			break;
+		}
+
+		// Binary operations pop the right operand, and replace the left one with the result
+		float fRight = stack[--iTop];
+		float &fLeft = stack[iTop - 1];
+		switch (step.operation)
+		{
+		case Add:			fLeft = fLeft + fRight; break;
+		case Subtract:		fLeft = fLeft - fRight; break;
+		case Multiply:		fLeft = fLeft * fRight; break;
+		case Divide:		fLeft = fLeft / fRight; break;
+		case Less:			fLeft = fLeft < fRight ? 1.0f : 0.0f; break;
+		case LessEqual:		fLeft = fLeft <= fRight ? 1.0f : 0.0f; break;
+		case Greater:		fLeft = fLeft > fRight ? 1.0f : 0.0f; break;
+		case GreaterEqual:	fLeft = fLeft >= fRight ? 1.0f : 0.0f; break;
+		case Equal:			fLeft = fLeft == fRight ? 1.0f : 0.0f; break;
+		case NotEqual:		fLeft = fLeft != fRight ? 1.0f : 0.0f; break;
+		case And:			fLeft = fLeft != 0.0f && fRight != 0.0f ? 1.0f : 0.0f; break;
+		case Max:			fLeft = fLeft > fRight ? fLeft : fRight; break;
+		case Min:			fLeft = fLeft < fRight ? fLeft : fRight; break;
+		default:			break;
+		}
+	}
+
+	return iTop > 0 ? stack[iTop - 1] : 0.0f;
+}
+
+#pragma endregion
+
+#pragma region Loading
 
 LSystem::LSystem()
 {
-	AddRules();
 }
 
 LSystem::~LSystem()
 {
 }
 
-void LSystem::AddRules()
+bool LSystem::Load(const char *filePath, const std::vector<std::string> &variableNames, std::string &strError)
 {
-	// Condition functions
-
-	ConditionFunction BoxCountGreaterThanOne = [this](std::vector<float> args) -> bool
-	{
-		return args[0] > 1;
-	};
-
-	ConditionFunction BoxCountEqualToOne = [this](std::vector<float> args) -> bool
+	// Read through MappedFile, so the rules in the mounted asset pack are read from the pack
+	MappedFile file;
+	if (!file.Open(filePath))
 	{
-		return args[0] == 1;
-	};
+		strError = std::string(filePath) + ": cannot open the file";
+		return false;
+	}
+	std::istringstream stream(std::string(file.GetData(), file.GetSize()));
 
-	ConditionFunction BoxCountEqualToZero = [this](std::vector<float> args) -> bool
+	std::map<char, std::vector<Rule>> rules;
+	std::vector<Axiom> axioms;
+	Rule *pLastRule = nullptr;
+	std::string strLine;
+	for (int iLine = 1; std::getline(stream, strLine); iLine++)
 	{
-		return args[0] == 0 && args[1] > MIN_RADIUS_TO_SPAWN;
-	};
-
-	// Cylinder rules
-
-	//   C(r, b, i, w, h)       :  b > 1               ->  C(r, b-1, i, w, h) /(360/b*i) B(w, h)
-	//                          :  b == 1              ->  C(r, 0, i, w, h) ^(r + (h/2) - 0.2) B(w, h)
+		if (!ParseLine(strLine, variableNames, rules, axioms, pLastRule, strError))
+		{
+			strError = std::string(filePath) + "(" + std::to_string(iLine) + "): " + strError;
+			return false;
+		}
+	}
 
-	SuccessorFunction CylinderRule1Successor = [this](Module cylinder) -> Word
+	// Rules can use symbols whose rules come later in the file, so the modules are checked once every rule is known
+	for (auto &symbolRules : rules)
 	{
-		float fCylinderRadius = cylinder.parameters[CylinderParameters::CylinderRadius];
-		float fBoxCount = cylinder.parameters[CylinderParameters::CylinderBoxCount];
-		float fBoxIterator = cylinder.parameters[CylinderParameters::CylinderBoxIterator];
-		float fBoxWidth = cylinder.parameters[CylinderParameters::CylinderBoxWidth];
-		float fBoxHeight = cylinder.parameters[CylinderParameters::CylinderBoxHeight];
-
-		Module nextCylinder(CYLINDER_SYMBOL, { fCylinderRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-		Module rotate(ROTATE_CW_SYMBOL, { 2 * XM_PI / fBoxCount * (fBoxIterator + 1) });
-		Module box(BOX_SYMBOL, { fBoxWidth, fBoxHeight });
-
-		return { nextCylinder, rotate, box };
-	};
-
-	SuccessorFunction CylinderRule2Successor = [this](Module cylinder) -> Word
+		int iParameterCount = GetModuleParameterCount(symbolRules.first);
+		for (Rule &rule : symbolRules.second)
+		{
+			if (iParameterCount >= 0 && static_cast<int>(rule.parameterNames.size()) != iParameterCount)
+			{
+				strError = std::string(filePath) + ": the rules of '" + symbolRules.first + "' need " + std::to_string(iParameterCount) + " parameters";
+				return false;
+			}
+			for (WordTemplate &successor : rule.successors)
+			{
+				if (!CheckParameterCounts(rules, successor, strError))
+				{
+					strError = std::string(filePath) + ": " + strError;
+					return false;
+				}
+			}
+		}
+	}
+	for (Axiom &axiom : axioms)
 	{
-		float fCylinderRadius = cylinder.parameters[CylinderParameters::CylinderRadius];
-		float fBoxCount = cylinder.parameters[CylinderParameters::CylinderBoxCount];
-		float fBoxIterator = cylinder.parameters[CylinderParameters::CylinderBoxIterator];
-		float fBoxWidth = cylinder.parameters[CylinderParameters::CylinderBoxWidth];
-		float fBoxHeight = cylinder.parameters[CylinderParameters::CylinderBoxHeight];
-
-		Module nextCylinder(CYLINDER_SYMBOL, { fCylinderRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-		Module translate(TRANSLATE_UP_SYMBOL, { fCylinderRadius + (fBoxHeight / 2) - 0.2f });
-		Module box(BOX_SYMBOL, { fBoxWidth, fBoxHeight });
-
-		return { nextCylinder, translate, box };
-	};
-
-	Rule cylinderRule1(BoxCountGreaterThanOne, { CylinderRule1Successor });
-	Rule cylinderRule2(BoxCountEqualToOne, { CylinderRule2Successor });
+		if (!CheckParameterCounts(rules, axiom.word, strError))
+		{
+			strError = std::string(filePath) + ": " + strError;
+			return false;
+		}
+	}
 
-	std::vector<Rule> cylinderRules;
-	cylinderRules.push_back(cylinderRule1);
-	cylinderRules.push_back(cylinderRule2);
+	m_rules.swap(rules);
+	m_axioms.swap(axioms);
 
-	m_rules[CYLINDER_SYMBOL] = cylinderRules;
+	return true;
+}
 
-	// Tube rules
+int LSystem::GetAxiomCount()
+{
+	return static_cast<int>(m_axioms.size());
+}
 
-	//   T(r1, r2, b, i, w, h)  :  b > 1               ->  T(r1, r2, b-1, i, w, h) /(360/b*i) B(w, h)
-	//                          :  b == 1              ->  T(r1, r2, 0, i, w, h) ^(r + (h/2) - 0.2) B(w, h)
-	//                          :  b == 0, r1 >= 1.25  ->  T(r1, r2, 0, i, w, h)
+bool LSystem::ParseLine(const std::string &strLine, const std::vector<std::string> &variableNames, std::map<char, std::vector<Rule>> &rules, std::vector<Axiom> &axioms, Rule *&pLastRule, std::string &strError)
+{
+	std::string strText = strLine.substr(0, strLine.find('#'));
+	const char *pCurrent = strText.data();
+	const char *pEnd = pCurrent + strText.size();
 
-	SuccessorFunction TubeRule1Successor = [this](Module tube) -> Word
+	// The source of a rule is compared on reload, so spaces and comments are not part of it
+	std::string strSource;
+	for (char c : strText)
 	{
-		float fTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		Module nextTube(TUBE_SYMBOL, { fTubeInnerRadius, fTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-		Module rotate(ROTATE_CW_SYMBOL, { 2 * XM_PI / fBoxCount * (fBoxIterator + 1) });
-		Module box(BOX_SYMBOL, { fBoxWidth, fBoxHeight });
-
-		return { nextTube, rotate, box };
-	};
-
-	SuccessorFunction TubeRule2Successor = [this](Module tube) -> Word
+		if (!isspace(static_cast<unsigned char>(c)))
+		{
+			strSource += c;
+		}
+	}
+	if (strSource.empty())
 	{
-		float fTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		Module nextTube(TUBE_SYMBOL, { fTubeInnerRadius, fTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-		Module translate(TRANSLATE_UP_SYMBOL, { fTubeOuterRadius + (fBoxHeight / 2) - 0.2f });
-		Module box(BOX_SYMBOL, { fBoxWidth, fBoxHeight });
-
-		return { nextTube, translate, box };
-	};
+		return true;
+	}
 
-	SuccessorFunction TubeRule3Successor1 = [this](Module tube) -> Word
+	pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+	Rule *pRule = nullptr;
+	std::string strDirective;
+	if (*pCurrent == '|')
 	{
-		float fTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		Module nextTube(TUBE_SYMBOL, { fTubeInnerRadius, fTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-
-		return { nextTube };
-	};
-
-	//                                                 ->  C(r2/3, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  C(r2/4, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  C(r2/3, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  C(r2/4, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-
-	SuccessorFunction TubeRule3Successor2 = [this](Module tube) -> Word
+		if (pLastRule == nullptr)
+		{
+			strError = "expected a rule before the successor";
+			return false;
+		}
+		pRule = pLastRule;
+		pRule->strSource += '\n' + strSource;
+		pCurrent++;
+	}
+	else if (!ParseName(pCurrent, pEnd, strDirective) || (strDirective != "rule" && strDirective != "axiom"))
 	{
-		float fTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		float fCylinderRadius = fTubeOuterRadius / 3;
-		float fSpokeCount = max(roundf(fBoxCount / 2), MIN_SPOKE_COUNT);
-
-		Module cylinder(CYLINDER_SYMBOL, { fCylinderRadius, fSpokeCount, 0, fBoxWidth/2, fTubeInnerRadius - fCylinderRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fTubeInnerRadius, fTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-
-		return { cylinder, origin, nextTube };
-	};
-
-	SuccessorFunction TubeRule3Successor3 = [this](Module tube) -> Word
+		strError = "unknown directive '" + (strDirective.empty() ? strSource.substr(0, 1) : strDirective) + "'";
+		return false;
+	}
+	else if (strDirective == "axiom")
 	{
-		float fTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		float fCylinderRadius = fTubeOuterRadius / 4;
-		float fSpokeCount = max(roundf(fBoxCount / 2), MIN_SPOKE_COUNT);
-
-		Module cylinder(CYLINDER_SYMBOL, { fCylinderRadius, fSpokeCount, 0, fBoxWidth / 2, fTubeInnerRadius - fCylinderRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fTubeInnerRadius, fTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-
-		return { cylinder, origin, nextTube };
-	};
-
-	SuccessorFunction TubeRule3Successor4 = [this](Module tube) -> Word
+		Axiom axiom;
+		axiom.strSource = strSource;
+		if (!ParseWord(pCurrent, pEnd, variableNames, axiom.word, strError))
+		{
+			return false;
+		}
+		if (pCurrent != pEnd)
+		{
+			strError = "an axiom has a single successor";
+			return false;
+		}
+		axioms.push_back(axiom);
+		pLastRule = nullptr;
+		return true;
+	}
+	else
 	{
-		float fTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		float fCylinderRadius = fTubeOuterRadius / 3;
-		float fSpokeCount = max(roundf(fBoxCount / 4), MIN_SPOKE_COUNT);
-
-		Module cylinder(CYLINDER_SYMBOL, { fCylinderRadius, fSpokeCount, 0, fBoxWidth / 2, fTubeInnerRadius - fCylinderRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fTubeInnerRadius, fTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
+		// Predecessor and condition
+		Rule rule;
+		rule.strSource = strSource;
+		rule.bHasCondition = false;
+		pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+		if (pCurrent == pEnd || !IsSymbol(*pCurrent))
+		{
+			strError = "expected rule <symbol>(<parameters>) [: <condition>] -> <successor>";
+			return false;
+		}
+		char symbol = *pCurrent++;
+		if (pCurrent != pEnd && *pCurrent == '(')
+		{
+			do
+			{
+				pCurrent++;
+				std::string strName;
+				if (!ParseName(pCurrent, pEnd, strName))
+				{
+					strError = "expected a parameter name";
+					return false;
+				}
+				rule.parameterNames.push_back(strName);
+				pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+			} while (pCurrent != pEnd && *pCurrent == ',');
+			if (pCurrent == pEnd || *pCurrent != ')')
+			{
+				strError = "expected ) after the parameters";
+				return false;
+			}
+			pCurrent++;
+		}
+		pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+		if (pCurrent != pEnd && *pCurrent == ':')
+		{
+			pCurrent++;
+			rule.bHasCondition = true;
+			if (!ParseExpression(pCurrent, pEnd, rule.parameterNames, rule.condition, strError))
+			{
+				return false;
+			}
+			pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+		}
+		if (pEnd - pCurrent < 2 || pCurrent[0] != '-' || pCurrent[1] != '>')
+		{
+			strError = "expected -> before the successor";
+			return false;
+		}
+		pCurrent += 2;
 
-		return { cylinder, origin, nextTube };
-	};
+		std::vector<Rule> &symbolRules = rules[symbol];
+		if (!symbolRules.empty() && symbolRules[0].parameterNames.size() != rule.parameterNames.size())
+		{
+			strError = std::string("the rules of '") + symbol + "' have different numbers of parameters";
+			return false;
+		}
+		symbolRules.push_back(rule);
+		pRule = pLastRule = &symbolRules.back();
+	}
 
-	SuccessorFunction TubeRule3Successor5 = [this](Module tube) -> Word
+	// Successors (after the arrow or the bar, and after each bar that follows them)
+	while (true)
 	{
-		float fTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		float fCylinderRadius = fTubeOuterRadius / 4;
-		float fSpokeCount = max(roundf(fBoxCount / 4), MIN_SPOKE_COUNT);
-
-		Module cylinder(CYLINDER_SYMBOL, { fCylinderRadius, fSpokeCount, 0, fBoxWidth / 2, fTubeInnerRadius - fCylinderRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fTubeInnerRadius, fTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-
-		return { cylinder, origin, nextTube };
-	};
-
-	//                                                 ->  T(r2/3*0.5, r2/3, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  T(r2/3*0.667, r2/3, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  T(r2/3*0.334, r2/3, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
+		WordTemplate successor;
+		if (!ParseWord(pCurrent, pEnd, pRule->parameterNames, successor, strError))
+		{
+			return false;
+		}
+		pRule->successors.push_back(successor);
+		if (pCurrent == pEnd)
+		{
+			return true;
+		}
+		pCurrent++;
+	}
+}
 
-	SuccessorFunction TubeRule3Successor6 = [this](Module tube) -> Word
+bool LSystem::ParseWord(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, WordTemplate &word, std::string &strError)
+{
+	// Modules up to the end of the line, or up to the bar before the next successor
+	while ((pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd)) != pEnd && *pCurrent != '|')
 	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 3;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.5f;
-		float fSpokeCount = max(roundf(fBoxCount / 2), MIN_SPOKE_COUNT);
+		if (!IsSymbol(*pCurrent))
+		{
+			strError = std::string("expected a module instead of '") + *pCurrent + "'";
+			return false;
+		}
 
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
+		ModuleTemplate module;
+		module.symbol = *pCurrent++;
+		if (pCurrent != pEnd && *pCurrent == '(')
+		{
+			do
+			{
+				pCurrent++;
+				Expression parameter;
+				if (!ParseExpression(pCurrent, pEnd, names, parameter, strError))
+				{
+					return false;
+				}
+				module.parameters.push_back(parameter);
+				pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+			} while (pCurrent != pEnd && *pCurrent == ',');
+			if (pCurrent == pEnd || *pCurrent != ')')
+			{
+				strError = std::string("expected ) after the parameters of '") + module.symbol + "'";
+				return false;
+			}
+			pCurrent++;
+		}
+		word.push_back(module);
+	}
 
-		return { smallTube, origin, nextTube };
-	};
+	return true;
+}
 
-	SuccessorFunction TubeRule3Successor7 = [this](Module tube) -> Word
+bool LSystem::ParseExpression(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError)
+{
+	if (!ParseComparison(pCurrent, pEnd, names, expression, strError))
 	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 3;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.667f;
-		float fSpokeCount = max(roundf(fBoxCount / 2), MIN_SPOKE_COUNT);
+		return false;
+	}
+	while (pEnd - (pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd)) >= 2 && pCurrent[0] == '&' && pCurrent[1] == '&')
+	{
+		pCurrent += 2;
+		if (!ParseComparison(pCurrent, pEnd, names, expression, strError))
+		{
+			return false;
+		}
+		expression.steps.push_back({ Expression::And, 0.0f });
+	}
 
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
+	return true;
+}
 
-		return { smallTube, origin, nextTube };
-	};
+bool LSystem::ParseComparison(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError)
+{
+	if (!ParseSum(pCurrent, pEnd, names, expression, strError))
+	{
+		return false;
+	}
 
-	SuccessorFunction TubeRule3Successor8 = [this](Module tube) -> Word
+	pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+	Expression::Operation operation;
+	char next = pEnd - pCurrent >= 2 ? pCurrent[1] : '\0';
+	if (pCurrent == pEnd)
 	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
+		return true;
+	}
+	else if (*pCurrent == '<')
+	{
+		operation = next == '=' ? Expression::LessEqual : Expression::Less;
+	}
+	else if (*pCurrent == '>')
+	{
+		operation = next == '=' ? Expression::GreaterEqual : Expression::Greater;
+	}
+	else if (*pCurrent == '=' && next == '=')
+	{
+		operation = Expression::Equal;
+	}
+	else if (*pCurrent == '!' && next == '=')
+	{
+		operation = Expression::NotEqual;
+	}
+	else
+	{
+		return true;
+	}
+	pCurrent += next == '=' ? 2 : 1;
 
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 3;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.334f;
-		float fSpokeCount = max(roundf(fBoxCount / 2), MIN_SPOKE_COUNT);
+	if (!ParseSum(pCurrent, pEnd, names, expression, strError))
+	{
+		return false;
+	}
+	expression.steps.push_back({ operation, 0.0f });
 
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
+	return true;
+}
 
-		return { smallTube, origin, nextTube };
-	};
+bool LSystem::ParseSum(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError)
+{
+	if (!ParseProduct(pCurrent, pEnd, names, expression, strError))
+	{
+		return false;
+	}
+	// The minus of the arrow after a condition is not a subtraction
+	while ((pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd)) != pEnd && (*pCurrent == '+' || *pCurrent == '-') &&
+		   !(pEnd - pCurrent >= 2 && pCurrent[0] == '-' && pCurrent[1] == '>'))
+	{
+		Expression::Operation operation = *pCurrent++ == '+' ? Expression::Add : Expression::Subtract;
+		if (!ParseProduct(pCurrent, pEnd, names, expression, strError))
+		{
+			return false;
+		}
+		expression.steps.push_back({ operation, 0.0f });
+	}
 
-	//                                                 ->  T(r2/4*0.5, r2/4, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  T(r2/4*0.667, r2/4, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  T(r2/4*0.334, r2/4, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
+	return true;
+}
 
-	SuccessorFunction TubeRule3Successor9 = [this](Module tube) -> Word
+bool LSystem::ParseProduct(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError)
+{
+	if (!ParseFactor(pCurrent, pEnd, names, expression, strError))
+	{
+		return false;
+	}
+	while ((pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd)) != pEnd && (*pCurrent == '*' || *pCurrent == '/'))
 	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
+		Expression::Operation operation = *pCurrent++ == '*' ? Expression::Multiply : Expression::Divide;
+		if (!ParseFactor(pCurrent, pEnd, names, expression, strError))
+		{
+			return false;
+		}
+		expression.steps.push_back({ operation, 0.0f });
+	}
 
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 4;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.5f;
-		float fSpokeCount = max(roundf(fBoxCount / 2), MIN_SPOKE_COUNT);
+	return true;
+}
 
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
+bool LSystem::ParseFactor(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError)
+{
+	pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+	if (pCurrent == pEnd)
+	{
+		strError = "expected an expression";
+		return false;
+	}
 
-		return { smallTube, origin, nextTube };
-	};
+	if (*pCurrent == '-')
+	{
+		pCurrent++;
+		if (!ParseFactor(pCurrent, pEnd, names, expression, strError))
+		{
+			return false;
+		}
+		expression.steps.push_back({ Expression::Negate, 0.0f });
+		return true;
+	}
 
-	SuccessorFunction TubeRule3Successor10 = [this](Module tube) -> Word
+	if (*pCurrent == '(')
 	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
+		pCurrent++;
+		if (!ParseExpression(pCurrent, pEnd, names, expression, strError))
+		{
+			return false;
+		}
+		pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+		if (pCurrent == pEnd || *pCurrent != ')')
+		{
+			strError = "expected ) after the expression";
+			return false;
+		}
+		pCurrent++;
+		return true;
+	}
 
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 4;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.667f;
-		float fSpokeCount = max(roundf(fBoxCount / 2), MIN_SPOKE_COUNT);
+	if (isdigit(static_cast<unsigned char>(*pCurrent)) || *pCurrent == '.')
+	{
+		float fValue = 0.0f;
+		pCurrent = NumberParser::ParseFloat(pCurrent, pEnd, fValue);
+		if (pCurrent == nullptr)
+		{
+			strError = "expected a number";
+			return false;
+		}
+		expression.steps.push_back({ Expression::PushNumber, fValue });
+		return true;
+	}
 
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
+	std::string strName;
+	if (!ParseName(pCurrent, pEnd, strName))
+	{
+		strError = std::string("expected an expression instead of '") + *pCurrent + "'";
+		return false;
+	}
 
-		return { smallTube, origin, nextTube };
-	};
-
-	SuccessorFunction TubeRule3Successor11 = [this](Module tube) -> Word
+	// Functions
+	if (pCurrent != pEnd && *pCurrent == '(')
 	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
+		Expression::Operation operation;
+		int iArgumentCount = 2;
+		if (strName == "round")
+		{
+			operation = Expression::Round;
+			iArgumentCount = 1;
+		}
+		else if (strName == "max")
+		{
+			operation = Expression::Max;
+		}
+		else if (strName == "min")
+		{
+			operation = Expression::Min;
+		}
+		else
+		{
+			strError = "unknown function '" + strName + "'";
+			return false;
+		}
 
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 4;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.334f;
-		float fSpokeCount = max(roundf(fBoxCount / 2), MIN_SPOKE_COUNT);
+		for (int i = 0; i < iArgumentCount; i++)
+		{
+			pCurrent++;
+			if (!ParseExpression(pCurrent, pEnd, names, expression, strError))
+			{
+				return false;
+			}
+			pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+			if (pCurrent == pEnd || *pCurrent != (i + 1 < iArgumentCount ? ',' : ')'))
+			{
+				strError = strName + " takes " + std::to_string(iArgumentCount) + (iArgumentCount > 1 ? " arguments" : " argument");
+				return false;
+			}
+		}
+		pCurrent++;
+		expression.steps.push_back({ operation, 0.0f });
+		return true;
+	}
 
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
+	// Parameters (or variables in an axiom), then constants
+	auto name = std::find(names.begin(), names.end(), strName);
+	if (name != names.end())
+	{
+		expression.steps.push_back({ Expression::PushParameter, static_cast<float>(name - names.begin()) });
+		return true;
+	}
+	if (strName == "pi")
+	{
+		expression.steps.push_back({ Expression::PushNumber, XM_PI });
+		return true;
+	}
 
-		return { smallTube, origin, nextTube };
-	};
-
-	//                                                 ->  T(r2/3*0.5, r2/3, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  T(r2/3*0.667, r2/3, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  T(r2/3*0.334, r2/3, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
+	strError = "unknown name '" + strName + "'";
+	return false;
+}
 
-	SuccessorFunction TubeRule3Successor12 = [this](Module tube) -> Word
+bool LSystem::ParseName(const char *&pCurrent, const char *pEnd, std::string &strName)
+{
+	pCurrent = NumberParser::SkipWhitespace(pCurrent, pEnd);
+	const char *pStart = pCurrent;
+	while (pCurrent != pEnd && (isalpha(static_cast<unsigned char>(*pCurrent)) || *pCurrent == '_' ||
+								(pCurrent != pStart && isdigit(static_cast<unsigned char>(*pCurrent)))))
 	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
+		pCurrent++;
+	}
+	strName.assign(pStart, pCurrent);
 
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 3;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.5f;
-		float fSpokeCount = max(roundf(fBoxCount / 4), MIN_SPOKE_COUNT);
+	return !strName.empty();
+}
 
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
+bool LSystem::CheckParameterCounts(const std::map<char, std::vector<Rule>> &rules, const WordTemplate &word, std::string &strError)
+{
+	for (const ModuleTemplate &module : word)
+	{
+		int iParameterCount = static_cast<int>(module.parameters.size());
+		auto symbolRules = rules.find(module.symbol);
+		if (symbolRules != rules.end())
+		{
+			// Rewritten with the rules, and drawn with the same parameters if no rule applies
+			if (iParameterCount != static_cast<int>(symbolRules->second[0].parameterNames.size()))
+			{
+				strError = std::string("'") + module.symbol + "' has " + std::to_string(iParameterCount) + " parameters, its rules have " +
+						   std::to_string(symbolRules->second[0].parameterNames.size());
+				return false;
+			}
+		}
+		else if (GetModuleParameterCount(module.symbol) < 0)
+		{
+			strError = std::string("'") + module.symbol + "' is neither a module nor the symbol of a rule";
+			return false;
+		}
+		else if (iParameterCount != GetModuleParameterCount(module.symbol))
+		{
+			strError = std::string("'") + module.symbol + "' has " + std::to_string(iParameterCount) + " parameters, it needs " +
+					   std::to_string(GetModuleParameterCount(module.symbol));
+			return false;
+		}
+	}
 
-		return { smallTube, origin, nextTube };
-	};
+	return true;
+}
 
-	SuccessorFunction TubeRule3Successor13 = [this](Module tube) -> Word
+int LSystem::GetModuleParameterCount(char symbol)
+{
+	switch (symbol)
 	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
-
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 3;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.667f;
-		float fSpokeCount = max(roundf(fBoxCount / 4), MIN_SPOKE_COUNT);
-
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-
-		return { smallTube, origin, nextTube };
-	};
-
-	SuccessorFunction TubeRule3Successor14 = [this](Module tube) -> Word
-	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
+	case CYLINDER_SYMBOL:
+		return CylinderParameters::CylinderBoxHeight + 1;
+	case TUBE_SYMBOL:
+		return TubeParameters::TubeBoxHeight + 1;
+	case BOX_SYMBOL:
+		return BoxParameters::BoxHeight + 1;
+	case TRANSLATE_UP_SYMBOL:
+	case ROTATE_CW_SYMBOL:
+		return 1;
+	case ORIGIN_SYMBOL:
+		return 0;
+	}
 
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 3;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.334f;
-		float fSpokeCount = max(roundf(fBoxCount / 4), MIN_SPOKE_COUNT);
+	return -1;
+}
 
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-
-		return { smallTube, origin, nextTube };
-	};
-
-	//                                                 ->  T(r2/4*0.5, r2/4, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  T(r2/4*0.667, r2/4, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-	//                                                 ->  T(r2/4*0.334, r2/4, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
+bool LSystem::IsSymbol(char c)
+{
+	return isgraph(static_cast<unsigned char>(c)) && c != '(' && c != ')' && c != ',' && c != '|' && c != '#';
+}
 
-	SuccessorFunction TubeRule3Successor15 = [this](Module tube) -> Word
-	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
+#pragma endregion
 
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 4;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.5f;
-		float fSpokeCount = max(roundf(fBoxCount / 4), MIN_SPOKE_COUNT);
-
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-
-		return { smallTube, origin, nextTube };
-	};
+#pragma region Generation
 
-	SuccessorFunction TubeRule3Successor16 = [this](Module tube) -> Word
-	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
+bool LSystem::HasSameDerivation(LSystem &otherLSystem, int iAxiomIndex)
+{
+	if (iAxiomIndex >= otherLSystem.GetAxiomCount() || m_axioms[iAxiomIndex].strSource != otherLSystem.m_axioms[iAxiomIndex].strSource)
+	{
+		return false;
+	}
 
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 4;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.667f;
-		float fSpokeCount = max(roundf(fBoxCount / 4), MIN_SPOKE_COUNT);
-
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-
-		return { smallTube, origin, nextTube };
-	};
-
-	SuccessorFunction TubeRule3Successor17 = [this](Module tube) -> Word
-	{
-		float fNextTubeInnerRadius = tube.parameters[TubeParameters::TubeInnerRadius];
-		float fNextTubeOuterRadius = tube.parameters[TubeParameters::TubeOuterRadius];
-		float fBoxCount = tube.parameters[TubeParameters::TubeBoxCount];
-		float fBoxIterator = tube.parameters[TubeParameters::TubeBoxIterator];
-		float fBoxWidth = tube.parameters[TubeParameters::TubeBoxWidth];
-		float fBoxHeight = tube.parameters[TubeParameters::TubeBoxHeight];
+	// Every symbol the axiom can be rewritten to, and the rules of each one
+	std::set<char> visitedSymbols;
+	std::vector<char> pendingSymbols;
+	for (const ModuleTemplate &module : m_axioms[iAxiomIndex].word)
+	{
+		pendingSymbols.push_back(module.symbol);
+	}
+	while (!pendingSymbols.empty())
+	{
+		char symbol = pendingSymbols.back();
+		pendingSymbols.pop_back();
+		if (!visitedSymbols.insert(symbol).second)
+		{
+			continue;
+		}
 
-		float fSmallTubeOuterRadius = fNextTubeOuterRadius / 4;
-		float fSmallTubeInnerRadius = fSmallTubeOuterRadius * 0.334f;
-		float fSpokeCount = max(roundf(fBoxCount / 4), MIN_SPOKE_COUNT);
+		auto rules = m_rules.find(symbol);
+		auto otherRules = otherLSystem.m_rules.find(symbol);
+		bool bHasRules = rules != m_rules.end();
+		if (bHasRules != (otherRules != otherLSystem.m_rules.end()))
+		{
+			return false;
+		}
+		if (!bHasRules)
+		{
+			continue;
+		}
+		if (rules->second.size() != otherRules->second.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < rules->second.size(); i++)
+		{
+			if (rules->second[i].strSource != otherRules->second[i].strSource)
+			{
+				return false;
+			}
+			for (const WordTemplate &successor : rules->second[i].successors)
+			{
+				for (const ModuleTemplate &module : successor)
+				{
+					pendingSymbols.push_back(module.symbol);
+				}
+			}
+		}
+	}
 
-		Module smallTube(TUBE_SYMBOL, { fSmallTubeInnerRadius, fSmallTubeOuterRadius, fSpokeCount, 0, fBoxWidth / 2, fNextTubeInnerRadius - fSmallTubeOuterRadius + 0.5f });
-		Module origin(ORIGIN_SYMBOL, {});
-		Module nextTube(TUBE_SYMBOL, { fNextTubeInnerRadius, fNextTubeOuterRadius, fBoxCount, fBoxIterator + 1, fBoxWidth, fBoxHeight });
-
-		return { smallTube, origin, nextTube };
-	};
-
-	Rule tubeRule1(BoxCountGreaterThanOne, { TubeRule1Successor });
-	Rule tubeRule2(BoxCountEqualToOne, { TubeRule2Successor });
-	Rule tubeRule3(BoxCountEqualToZero, { TubeRule3Successor1, TubeRule3Successor2, TubeRule3Successor3, TubeRule3Successor4,
-										  TubeRule3Successor5, TubeRule3Successor6, TubeRule3Successor7, TubeRule3Successor8,
-										  TubeRule3Successor9 , TubeRule3Successor10 , TubeRule3Successor11,
-										  TubeRule3Successor12 , TubeRule3Successor13 , TubeRule3Successor14,
-										  TubeRule3Successor15 , TubeRule3Successor16 , TubeRule3Successor17 });
+	return true;
+}
 
-	std::vector<Rule> tubeRules;
-	tubeRules.push_back(tubeRule1);
-	tubeRules.push_back(tubeRule2);
-	tubeRules.push_back(tubeRule3);
+Word LSystem::Instantiate(const WordTemplate &word, const std::vector<float> &parameters)
+{
+	Word instance;
+	instance.reserve(word.size());
+	for (const ModuleTemplate &module : word)
+	{
+		std::vector<float> values;
+		values.reserve(module.parameters.size());
+		for (const Expression &parameter : module.parameters)
+		{
+			values.push_back(parameter.Evaluate(parameters));
+		}
+		instance.push_back(Module(module.symbol, values));
+	}
 
-	m_rules[TUBE_SYMBOL] = tubeRules;
+	return instance;
 }
 
-Word LSystem::ApplyRules(Word currentWord)
+bool LSystem::ApplyRule(const Module &module, Word &nextWord)
 {
-	Word nextWord;
-
-	bool bHasNonTerminalModule = false;
+	auto rules = m_rules.find(module.symbol);
+	if (rules == m_rules.end())
+	{
+		return false;
+	}
 
-	for (Module module : currentWord)
+	for (const Rule &rule : rules->second)
 	{
-		Word word = ApplyRule(module);
-		int size = static_cast<int>(word.size());
-		if (size == 0)
+		if (rule.bHasCondition && rule.condition.Evaluate(module.parameters) == 0.0f)
 		{
-			nextWord.push_back(module);
+			continue;
 		}
-		else 
+
+		int size = static_cast<int>(rule.successors.size());
+		int index = 0;
+		if (size > 1)
 		{
-			bHasNonTerminalModule = true;
-			nextWord.insert(nextWord.end(), word.begin(), word.end());
+			Utils utils;
+			index = utils.GetRandomInt(0, size - 1);
 		}
+		Word successor = Instantiate(rule.successors[index], module.parameters);
+		nextWord.insert(nextWord.end(), successor.begin(), successor.end());
+		return true;
 	}
 
-	if (bHasNonTerminalModule)
-	{
-		nextWord = ApplyRules(nextWord);
-	}
-
-	return nextWord;
+	return false;
 }
 
-Word LSystem::ApplyRule(Module module)
+bool LSystem::GenerateModel(int iAxiomIndex, const std::vector<float> &variables, Model *pModel)
 {
-	Word nextWord;
-
-	std::vector<Rule> rules = m_rules[module.symbol];
-	std::vector<SuccessorFunction> successorFunctions;
-
-	for (Rule rule : rules)
+	// Every module is rewritten in parallel, until no rule applies to any of them
+	Word word = Instantiate(m_axioms[iAxiomIndex].word, variables);
+	for (int iStep = 0; ; iStep++)
 	{
-		float fCurrentBoxCount = 0.0f;
-		float fRadius = 0.0f;
-
-		if (module.symbol == CYLINDER_SYMBOL)
+		if (iStep == MAX_DERIVATION_STEPS || word.size() > MAX_WORD_LENGTH)
 		{
-			fCurrentBoxCount = module.parameters[CylinderParameters::CylinderBoxCount] - module.parameters[CylinderParameters::CylinderBoxIterator];
+			return false;
 		}
-		else if (module.symbol = TUBE_SYMBOL)
+
+		Word nextWord;
+		bool bHasNonTerminalModule = false;
+		for (const Module &module : word)
 		{
-			fCurrentBoxCount = module.parameters[TubeParameters::TubeBoxCount] - module.parameters[TubeParameters::TubeBoxIterator];
-			fRadius = module.parameters[TubeParameters::TubeInnerRadius];
+			if (ApplyRule(module, nextWord))
+			{
+				bHasNonTerminalModule = true;
+			}
+			else
+			{
+				nextWord.push_back(module);
+			}
 		}
-
-		bool condition = rule.conditionFunction({ fCurrentBoxCount, fRadius });
-		if (condition)
+		if (!bHasNonTerminalModule)
 		{
-			successorFunctions = rule.successorFunctions;
 			break;
 		}
+		word.swap(nextWord);
 	}
-	
-	int size = static_cast<int>(successorFunctions.size());
-	if (size == 1)
-	{
-		SuccessorFunction successorFunction = successorFunctions[0];
-		nextWord = successorFunction(module);
-	}
-	else if (size > 1)
-	{
-		Utils utils;
-		int index = utils.GetRandomInt(0, size - 1);
-		SuccessorFunction successorFunction = successorFunctions[index];
-		nextWord = successorFunction(module);
-	}
-
-	return nextWord;
-}
 
-void LSystem::GenerateModel(Word axiom, Model *pModel)
-{
 	XMMATRIX translationMatrix = XMMatrixIdentity();
 	XMMATRIX rotationMatrix = XMMatrixIdentity();
 
-	Word word = ApplyRules(axiom);
 	for (Module module : word)
 	{
 		switch (module.symbol)
 		{
 		case CYLINDER_SYMBOL:
-			pModel->AddCylinderMesh(module.parameters[CylinderParameters::CylinderRadius], 
+			pModel->AddCylinderMesh(module.parameters[CylinderParameters::CylinderRadius],
 									COGWHEEL_THICKNESS, SUBDIVISION_COUNT, COGWHEEL_ROTATION_MATRIX);
 			break;
 		case TUBE_SYMBOL:
-			pModel->AddTubeMesh(module.parameters[TubeParameters::TubeInnerRadius], 
-								module.parameters[TubeParameters::TubeOuterRadius], 
+			pModel->AddTubeMesh(module.parameters[TubeParameters::TubeInnerRadius],
+								module.parameters[TubeParameters::TubeOuterRadius],
 								COGWHEEL_THICKNESS, SUBDIVISION_COUNT, COGWHEEL_ROTATION_MATRIX);
 			break;
 		case BOX_SYMBOL:
-			pModel->AddBoxMesh(XMFLOAT3(module.parameters[BoxParameters::BoxWidth], 
-										module.parameters[BoxParameters::BoxHeight], 
+			pModel->AddBoxMesh(XMFLOAT3(module.parameters[BoxParameters::BoxWidth],
+										module.parameters[BoxParameters::BoxHeight],
 										COGWHEEL_THICKNESS * 0.99),
 							   translationMatrix * rotationMatrix);
 			break;
@@ -595,4 +783,8 @@ void LSystem::GenerateModel(Word axiom, Model *pModel)
 			break;
 		}
 	}
+
+	return true;
 }
+
+#pragma endregion
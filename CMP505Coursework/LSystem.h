@@ -2,56 +2,36 @@
 // LSystem.h
 // Copyright  2019 Diel Barnes. All rights reserved.
 //
-
-// Constants
-//   Cogwheel thickness     : 0.5f
-//   Number of subdivisions : 24
-//   Min inner radius       : 0.5f
-//   Min tube thickness     : 0.25f
-//   Min distance between tube and inner cylinder/tube : 0.5f
-//   Min radius to spawn inner cylinder/tube : 0.5f + 0.25f + 0.5f = 1.25f
-
-// Modules
-//   C(r, b, w, h)      : Add cylinder mesh (parameters: radius, number of boxes, box width, box height)
-//   T(r1, r2, b, w, h) : Add tube mesh (parameters: inner radius, outer radius, number of boxes, box width, box height)
-//   B(w, h)            : Add box mesh (parameters: width, height)
-//   ^(d)               : Translate up (parameter: distance)
-//   /(a)               : Rotate clockwise (parameter: angle)
-//   o                  : Go back to origin
-
-// Rules
-//   C(r, b, i, w, h)       :  b > 1               ->  C(r, b-1, i, w, h) /(360/b*i) B(w, h)
-//                          :  b == 1              ->  C(r, 0, i, w, h) ^(r + (h/2) - 0.2) B(w, h)
-//
-//   T(r1, r2, b, i, w, h)  :  b > 1               ->  T(r1, r2, b-1, i, w, h) /(360/b*i) B(w, h)
-//                          :  b == 1              ->  T(r1, r2, 0, i, w, h) ^(r + (h/2) - 0.2) B(w, h)
-//                          :  b == 0, r1 >= 1.25  ->  T(r1, r2, 0, i, w, h)
-//                                                 ->  C(r2/3, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  C(r2/4, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  C(r2/3, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  C(r2/4, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//
-//                                                 ->  T(r2/3*0.5, r2/3, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  T(r2/3*0.667, r2/3, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  T(r2/3*0.334, r2/3, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
+// Reference:
+// The Algorithmic Beauty of Plants, parametric L-systems (http://algorithmicbotany.org/papers/abop/abop.pdf)
 //
-//                                                 ->  T(r2/4*0.5, r2/4, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  T(r2/4*0.667, r2/4, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  T(r2/4*0.334, r2/4, round(b/2), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
+
+// Parametric L-system of the cogwheels, whose rules and axioms are read from a text file (so they can be edited while the game runs)
 //
-//                                                 ->  T(r2/3*0.5, r2/3, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  T(r2/3*0.667, r2/3, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  T(r2/3*0.334, r2/3, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
+// Rule files have one directive per line (# starts a comment):
+// rule <symbol>(<parameters>) [: <condition>] -> <successor>
+//		Rewrites the module, a successor is a list of modules whose parameters are expressions of the predecessor's parameters
+//		The rules of a symbol are tried in order, and the first one whose condition holds is applied
+// | <successor>
+//		Another successor of the rule above (one of them is picked at random, with equal probability)
+// axiom <successor>
+//		The word a model is derived from (the n-th axiom of the file is model n), its parameters can use the variables the game passes in
+// Expressions have numbers, parameters, + - * /, parentheses, round(x), max(x, y), min(x, y) and pi,
+// and conditions compare them with < <= > >= == != and join the comparisons with &&
 //
-//                                                 ->  T(r2/4*0.5, r2/4, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  T(r2/4*0.667, r2/4, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
-//                                                 ->  T(r2/4*0.334, r2/4, round(b/4), i, w/2, r1 - r) o T(r1, r2, 0, w, h)
+// Modules (the ones the model is built from, the word is rewritten until no rule applies):
+//   C(r, b, i, w, h)      : Add cylinder mesh (parameters: radius, number of boxes, boxes added, box width, box height)
+//   T(r1, r2, b, i, w, h) : Add tube mesh (parameters: inner radius, outer radius, number of boxes, boxes added, box width, box height)
+//   B(w, h)               : Add box mesh (parameters: width, height)
+//   ^(d)                  : Translate up (parameter: distance)
+//   /(a)                  : Rotate clockwise (parameter: angle in radians)
+//   o                     : Go back to origin
 
 #pragma once
 
-#include <functional>
 #include <vector>
 #include <map>
+#include <string>
 #include "Model.h"
 #include "Utils.h"
 
@@ -64,9 +44,9 @@
 
 #define COGWHEEL_THICKNESS 0.5f
 #define SUBDIVISION_COUNT 24
-#define MIN_RADIUS_TO_SPAWN 1.5f
-#define MIN_SPOKE_COUNT 3.0f
 #define COGWHEEL_ROTATION_MATRIX XMMatrixRotationRollPitchYaw(XM_PI * 0.5f, XM_PI * 0.0f, XM_PI * 0.0f)
+#define MAX_DERIVATION_STEPS 256		// A rule file whose words are still rewritten after this many steps never stops
+#define MAX_WORD_LENGTH 65536
 
 enum CylinderParameters : int
 {
@@ -109,21 +89,62 @@ struct Module
 
 using Word = std::vector<Module>;
 
-using ConditionFunction = std::function<bool(std::vector<float>)>;
-using SuccessorFunction = std::function<Word(Module)>;
+// Expression compiled to the operations of a stack machine (in reverse Polish notation)
+struct Expression
+{
+	enum Operation : int
+	{
+		PushNumber = 0,
+		PushParameter,
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Negate,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		Equal,
+		NotEqual,
+		And,
+		Round,
+		Max,
+		Min
+	};
+
+	struct Step
+	{
+		Operation operation;
+		float fValue;		// The number, or the index of the parameter
+	};
 
-struct Rule
+	std::vector<Step> steps;
+
+	float Evaluate(const std::vector<float> &parameters) const;
+};
+
+struct ModuleTemplate
 {
-	ConditionFunction conditionFunction;
-	std::vector<SuccessorFunction> successorFunctions; // Equal probability
+	char symbol;
+	std::vector<Expression> parameters;
+};
 
-	Rule() {}
+using WordTemplate = std::vector<ModuleTemplate>;
 
-	Rule(ConditionFunction condFunc, std::vector<SuccessorFunction> successorFuncs)
-	{
-		conditionFunction = condFunc;
-		successorFunctions = successorFuncs;
-	}
+struct Rule
+{
+	std::vector<std::string> parameterNames;
+	bool bHasCondition;
+	Expression condition;
+	std::vector<WordTemplate> successors; // Equal probability
+	std::string strSource;				  // The rule's lines without their spaces and comments (a rule whose text is the same is the same rule)
+};
+
+struct Axiom
+{
+	WordTemplate word;
+	std::string strSource;
 };
 
 class LSystem
@@ -132,12 +153,32 @@ public:
 	LSystem();
 	~LSystem();
 
-	void GenerateModel(Word axiom, Model *pModel);
+	// The variables are the names the axioms can use, in the order their values are passed to GenerateModel
+	// The error is the file name, the line and what is wrong with it (the rules are left as they were if the file cannot be loaded)
+	bool Load(const char *filePath, const std::vector<std::string> &variableNames, std::string &strError);
+	int GetAxiomCount();
+	// Fails if the word is still being rewritten after MAX_DERIVATION_STEPS steps (or grows past MAX_WORD_LENGTH modules)
+	bool GenerateModel(int iAxiomIndex, const std::vector<float> &variables, Model *pModel);
+	// Whether both systems derive the axiom's model the same way (the same axiom, and the same rules for every symbol it can be rewritten to)
+	bool HasSameDerivation(LSystem &otherLSystem, int iAxiomIndex);
 
 private:
 	std::map<char, std::vector<Rule>> m_rules;
-
-	void AddRules();
-	Word ApplyRules(Word word);
-	Word ApplyRule(Module module);
+	std::vector<Axiom> m_axioms;
+
+	static bool ParseLine(const std::string &strLine, const std::vector<std::string> &variableNames, std::map<char, std::vector<Rule>> &rules, std::vector<Axiom> &axioms, Rule *&pLastRule, std::string &strError);
+	static bool ParseWord(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, WordTemplate &word, std::string &strError);
+	static bool ParseExpression(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError);
+	static bool ParseComparison(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError);
+	static bool ParseSum(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError);
+	static bool ParseProduct(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError);
+	static bool ParseFactor(const char *&pCurrent, const char *pEnd, const std::vector<std::string> &names, Expression &expression, std::string &strError);
+	static bool ParseName(const char *&pCurrent, const char *pEnd, std::string &strName);
+	static bool CheckParameterCounts(const std::map<char, std::vector<Rule>> &rules, const WordTemplate &word, std::string &strError);
+	// The number of parameters the model is built with (-1 for symbols that are only rewritten)
+	static int GetModuleParameterCount(char symbol);
+	static bool IsSymbol(char c);
+	Word Instantiate(const WordTemplate &word, const std::vector<float> &parameters);
+	// Returns false if no rule applies to the module
+	bool ApplyRule(const Module &module, Word &nextWord);
 };
@@ -0,0 +1,448 @@
+//
+// LevelLayout.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// XMMatrixRotationRollPitchYaw (https://docs.microsoft.com/en-us/windows/win32/api/directxmath/nf-directxmath-xmmatrixrotationrollpitchyaw)
+// Z-order curve (https://en.wikipedia.org/wiki/Z-order_curve)
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include "LevelLayout.h"
+#include "MappedFile.h"
+#include "SafeFileWriter.h"
+
+#define DEGREES_TO_RADIANS 0.0174532925f
+#define MORTON_BITS_PER_AXIS 10
+
+namespace
+{
+	bool ParseFloat(const std::string &strToken, float &fValue)
+	{
+		char *pEnd = nullptr;
+		fValue = strtof(strToken.c_str(), &pEnd);
+		return !strToken.empty() && *pEnd == '\0' && std::isfinite(fValue);
+	}
+
+	bool ParseInt(const std::string &strToken, int &iValue)
+	{
+		char *pEnd = nullptr;
+		long value = strtol(strToken.c_str(), &pEnd, 10);
+		iValue = static_cast<int>(value);
+		return !strToken.empty() && *pEnd == '\0' && value >= INT32_MIN && value <= INT32_MAX;
+	}
+
+	bool ParseFloats(const std::vector<std::string> &tokens, size_t firstToken, int iCount, float *values)
+	{
+		for (int i = 0; i < iCount; i++)
+		{
+			if (firstToken + i >= tokens.size() || !ParseFloat(tokens[firstToken + i], values[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Spreads the low 10 bits of the value out to every third bit
+	uint32_t SpreadBits(uint32_t value)
+	{
+		value &= 0x3FF;
+		value = (value | (value << 16)) & 0x030000FF;
+		value = (value | (value << 8)) & 0x0300F00F;
+		value = (value | (value << 4)) & 0x030C30C3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	}
+}
+
+#pragma region LevelLayoutFile
+
+LevelLayoutFile::LevelLayoutFile()
+{
+	m_pHeader = nullptr;
+}
+
+bool LevelLayoutFile::Open(const char *filePath, uint64_t sourceHash)
+{
+	Close();
+
+	std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+	if (file.fail())
+	{
+		return false;
+	}
+	std::streamoff size = file.tellg();
+	if (size < static_cast<std::streamoff>(sizeof(LevelTableHeader)))
+	{
+		return false;
+	}
+	m_data.resize(static_cast<size_t>(size));
+	file.seekg(0);
+	if (!file.read(m_data.data(), m_data.size()))
+	{
+		Close();
+		return false;
+	}
+
+	const LevelTableHeader *pHeader = reinterpret_cast<const LevelTableHeader*>(m_data.data());
+	if (pHeader->magic != LEVEL_TABLE_MAGIC || pHeader->version != LEVEL_TABLE_VERSION || pHeader->sourceHash != sourceHash ||
+		pHeader->groupTableOffset > m_data.size() || uint64_t(pHeader->groupCount) * sizeof(LevelModelGroup) > m_data.size() - pHeader->groupTableOffset ||
+		pHeader->instanceTableOffset > m_data.size() || uint64_t(pHeader->instanceCount) * sizeof(LevelInstance) > m_data.size() - pHeader->instanceTableOffset ||
+		pHeader->groupTableOffset % LEVEL_TABLE_ALIGNMENT != 0 || pHeader->instanceTableOffset % LEVEL_TABLE_ALIGNMENT != 0)
+	{
+		Close();
+		return false;
+	}
+	m_pHeader = pHeader;
+
+	// Check the groups once so the accessors do not have to
+	for (int i = 0; i < GetGroupCount(); i++)
+	{
+		const LevelModelGroup *pGroup = GetGroup(i);
+		if (uint64_t(pGroup->instanceOffset) + pGroup->instanceCount > pHeader->instanceCount ||
+			memchr(pGroup->modelName, '\0', MAX_LEVEL_MODEL_NAME_LENGTH) == nullptr)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void LevelLayoutFile::Close()
+{
+	m_data.clear();
+	m_data.shrink_to_fit();
+	m_pHeader = nullptr;
+}
+
+int LevelLayoutFile::GetGroupCount()
+{
+	return m_pHeader != nullptr ? static_cast<int>(m_pHeader->groupCount) : 0;
+}
+
+const LevelModelGroup* LevelLayoutFile::GetGroup(int iGroupIndex)
+{
+	return reinterpret_cast<const LevelModelGroup*>(m_data.data() + m_pHeader->groupTableOffset) + iGroupIndex;
+}
+
+const LevelInstance* LevelLayoutFile::GetInstances(const char *modelName, int &iInstanceCount)
+{
+	iInstanceCount = 0;
+	for (int i = 0; i < GetGroupCount(); i++)
+	{
+		const LevelModelGroup *pGroup = GetGroup(i);
+		if (strcmp(pGroup->modelName, modelName) == 0)
+		{
+			iInstanceCount = static_cast<int>(pGroup->instanceCount);
+			return reinterpret_cast<const LevelInstance*>(m_data.data() + m_pHeader->instanceTableOffset) + pGroup->instanceOffset;
+		}
+	}
+	return nullptr;
+}
+
+bool LevelLayoutFile::HasSameInstances(LevelLayoutFile &otherLayout, const char *modelName)
+{
+	int iInstanceCount = 0;
+	int iOtherInstanceCount = 0;
+	const LevelInstance *pInstances = GetInstances(modelName, iInstanceCount);
+	const LevelInstance *pOtherInstances = otherLayout.GetInstances(modelName, iOtherInstanceCount);
+	return iInstanceCount == iOtherInstanceCount && (iInstanceCount == 0 || memcmp(pInstances, pOtherInstances, sizeof(LevelInstance) * iInstanceCount) == 0);
+}
+
+int LevelLayoutFile::GetInstanceCount()
+{
+	return m_pHeader != nullptr ? static_cast<int>(m_pHeader->instanceCount) : 0;
+}
+
+#pragma endregion
+
+#pragma region LevelLayoutCompiler
+
+bool LevelLayoutCompiler::Compile(const char *sourceFilePath, const std::string &strTableFilePath, uint64_t sourceHash, std::string &strError)
+{
+	// Read through MappedFile, so a level in the mounted asset pack is compiled from the pack
+	MappedFile sourceFile;
+	if (!sourceFile.Open(sourceFilePath))
+	{
+		strError = std::string(sourceFilePath) + ": cannot open the file";
+		return false;
+	}
+	std::istringstream file(std::string(sourceFile.GetData(), sourceFile.GetSize()));
+
+	float origin[3] = { 0.0f, 0.0f, 0.0f };
+	std::vector<Placement> placements;
+	std::string strLine;
+	for (int iLine = 1; std::getline(file, strLine); iLine++)
+	{
+		if (!ParseLine(strLine, origin, placements, strError))
+		{
+			strError = std::string(sourceFilePath) + "(" + std::to_string(iLine) + "): " + strError;
+			return false;
+		}
+	}
+
+	SortPlacements(placements);
+	if (!Write(strTableFilePath, sourceHash, placements))
+	{
+		strError = strTableFilePath + ": cannot write the file";
+		return false;
+	}
+
+	return true;
+}
+
+bool LevelLayoutCompiler::ParseLine(const std::string &strLine, float origin[3], std::vector<Placement> &placements, std::string &strError)
+{
+	std::vector<std::string> tokens;
+	std::stringstream stream(strLine.substr(0, strLine.find('#')));
+	std::string strToken;
+	while (stream >> strToken)
+	{
+		tokens.push_back(strToken);
+	}
+	if (tokens.empty())
+	{
+		return true;
+	}
+
+	if (tokens[0] == "origin")
+	{
+		if (tokens.size() != 4 || !ParseFloats(tokens, 1, 3, origin))
+		{
+			strError = "expected origin <x> <y> <z>";
+			return false;
+		}
+		return true;
+	}
+
+	if (tokens[0] != "place" && tokens[0] != "run")
+	{
+		strError = "unknown directive '" + tokens[0] + "'";
+		return false;
+	}
+
+	float position[3];
+	if (tokens.size() < 5 || tokens[1].size() >= MAX_LEVEL_MODEL_NAME_LENGTH || !ParseFloats(tokens, 2, 3, position))
+	{
+		strError = "expected " + tokens[0] + " <model> <x> <y> <z> (model names are shorter than " + std::to_string(MAX_LEVEL_MODEL_NAME_LENGTH) + " characters)";
+		return false;
+	}
+
+	float step[3] = { 0.0f, 0.0f, 0.0f };
+	int iCount = 1;
+	size_t firstOption = 5;
+	if (tokens[0] == "run")
+	{
+		if (tokens.size() < 11 || tokens[5] != "step" || !ParseFloats(tokens, 6, 3, step) || tokens[9] != "count" || !ParseInt(tokens[10], iCount) || iCount < 1)
+		{
+			strError = "expected run <model> <x> <y> <z> step <x> <y> <z> count <n> (n is at least 1)";
+			return false;
+		}
+		firstOption = 11;
+	}
+
+	float rotation[3] = { 0.0f, 0.0f, 0.0f };
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+	int32_t tiles[2] = { 1, 1 };
+	if (!ParseOptions(tokens, firstOption, rotation, scale, tiles, strError))
+	{
+		return false;
+	}
+
+	for (int i = 0; i < iCount; i++)
+	{
+		Placement placement;
+		placement.strModelName = tokens[1];
+		float instancePosition[3];
+		for (int j = 0; j < 3; j++)
+		{
+			instancePosition[j] = origin[j] + position[j] + step[j] * i;
+		}
+		ComputeWorldMatrix(instancePosition, rotation, scale, placement.instance.worldMatrix);
+		placement.instance.textureTileCount[0] = tiles[0];
+		placement.instance.textureTileCount[1] = tiles[1];
+		placement.uiSortKey = 0;
+		placements.push_back(placement);
+	}
+
+	return true;
+}
+
+bool LevelLayoutCompiler::ParseOptions(const std::vector<std::string> &tokens, size_t firstToken, float rotation[3], float scale[3], int32_t tiles[2], std::string &strError)
+{
+	size_t i = firstToken;
+	while (i < tokens.size())
+	{
+		if (tokens[i] == "rotate")
+		{
+			if (!ParseFloats(tokens, i + 1, 3, rotation))
+			{
+				strError = "expected rotate <pitch> <yaw> <roll>";
+				return false;
+			}
+			for (int j = 0; j < 3; j++)
+			{
+				rotation[j] *= DEGREES_TO_RADIANS;
+			}
+			i += 4;
+		}
+		else if (tokens[i] == "scale")
+		{
+			// A uniform scale, unless it is followed by two more numbers
+			if (ParseFloats(tokens, i + 1, 3, scale))
+			{
+				i += 4;
+			}
+			else if (ParseFloats(tokens, i + 1, 1, scale))
+			{
+				scale[1] = scale[0];
+				scale[2] = scale[0];
+				i += 2;
+			}
+			else
+			{
+				strError = "expected scale <s> or scale <x> <y> <z>";
+				return false;
+			}
+		}
+		else if (tokens[i] == "tiles")
+		{
+			int u = 0;
+			int v = 0;
+			if (i + 2 >= tokens.size() || !ParseInt(tokens[i + 1], u) || !ParseInt(tokens[i + 2], v) || u < 1 || v < 1)
+			{
+				strError = "expected tiles <u> <v> (at least 1 each)";
+				return false;
+			}
+			tiles[0] = u;
+			tiles[1] = v;
+			i += 3;
+		}
+		else
+		{
+			strError = "unknown option '" + tokens[i] + "'";
+			return false;
+		}
+	}
+	return true;
+}
+
+void LevelLayoutCompiler::ComputeWorldMatrix(const float position[3], const float rotation[3], const float scale[3], float worldMatrix[4][3])
+{
+	// Scaling * XMMatrixRotationRollPitchYaw(pitch, yaw, roll) * Translation, for row vectors
+	float fSinPitch = sinf(rotation[0]);
+	float fCosPitch = cosf(rotation[0]);
+	float fSinYaw = sinf(rotation[1]);
+	float fCosYaw = cosf(rotation[1]);
+	float fSinRoll = sinf(rotation[2]);
+	float fCosRoll = cosf(rotation[2]);
+	float rotationMatrix[3][3] =
+	{
+		{ fCosRoll * fCosYaw + fSinRoll * fSinPitch * fSinYaw, fSinRoll * fCosPitch, fSinRoll * fSinPitch * fCosYaw - fCosRoll * fSinYaw },
+		{ fCosRoll * fSinPitch * fSinYaw - fSinRoll * fCosYaw, fCosRoll * fCosPitch, fSinRoll * fSinYaw + fCosRoll * fSinPitch * fCosYaw },
+		{ fCosPitch * fSinYaw, -fSinPitch, fCosPitch * fCosYaw }
+	};
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			worldMatrix[i][j] = scale[i] * rotationMatrix[i][j];
+		}
+		worldMatrix[3][i] = position[i];
+	}
+}
+
+void LevelLayoutCompiler::SortPlacements(std::vector<Placement> &placements)
+{
+	// Positions are quantized within the bounds of their model's instances, and interleaved into a Z-order curve key
+	std::map<std::string, std::pair<std::vector<float>, std::vector<float>>> bounds;
+	for (auto &placement : placements)
+	{
+		auto result = bounds.insert({ placement.strModelName, { std::vector<float>(3, FLT_MAX), std::vector<float>(3, -FLT_MAX) } });
+		std::vector<float> &minimum = result.first->second.first;
+		std::vector<float> &maximum = result.first->second.second;
+		for (int i = 0; i < 3; i++)
+		{
+			minimum[i] = std::min(minimum[i], placement.instance.worldMatrix[3][i]);
+			maximum[i] = std::max(maximum[i], placement.instance.worldMatrix[3][i]);
+		}
+	}
+
+	float fMaxCell = static_cast<float>((1 << MORTON_BITS_PER_AXIS) - 1);
+	for (auto &placement : placements)
+	{
+		const auto &modelBounds = bounds[placement.strModelName];
+		placement.uiSortKey = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			float fSize = modelBounds.second[i] - modelBounds.first[i];
+			float fCell = fSize > 0.0f ? (placement.instance.worldMatrix[3][i] - modelBounds.first[i]) / fSize * fMaxCell : 0.0f;
+			placement.uiSortKey |= SpreadBits(static_cast<uint32_t>(fCell + 0.5f)) << i;
+		}
+	}
+
+	// Stable, so instances at the same place keep the order they were written in
+	std::stable_sort(placements.begin(), placements.end(), [](const Placement &a, const Placement &b)
+	{
+		int iComparison = a.strModelName.compare(b.strModelName);
+		return iComparison != 0 ? iComparison < 0 : a.uiSortKey < b.uiSortKey;
+	});
+}
+
+bool LevelLayoutCompiler::Write(const std::string &strTableFilePath, uint64_t sourceHash, const std::vector<Placement> &placements)
+{
+	std::vector<LevelModelGroup> groups;
+	std::vector<LevelInstance> instances;
+	for (auto &placement : placements)
+	{
+		if (groups.empty() || placement.strModelName != groups.back().modelName)
+		{
+			LevelModelGroup group = {};
+			strcpy(group.modelName, placement.strModelName.c_str());
+			group.instanceOffset = static_cast<uint32_t>(instances.size());
+			groups.push_back(group);
+		}
+		groups.back().instanceCount++;
+		instances.push_back(placement.instance);
+	}
+
+	LevelTableHeader header = {};
+	header.magic = LEVEL_TABLE_MAGIC;
+	header.version = LEVEL_TABLE_VERSION;
+	header.sourceHash = sourceHash;
+	header.groupCount = static_cast<uint32_t>(groups.size());
+	header.instanceCount = static_cast<uint32_t>(instances.size());
+	header.groupTableOffset = Align(sizeof(LevelTableHeader));
+	header.instanceTableOffset = Align(header.groupTableOffset + groups.size() * sizeof(LevelModelGroup));
+	uint64_t fileSize = header.instanceTableOffset + instances.size() * sizeof(LevelInstance);
+
+	std::vector<char> fileData(static_cast<size_t>(fileSize), 0);
+	memcpy(&fileData[0], &header, sizeof(header));
+	if (!groups.empty())
+	{
+		memcpy(&fileData[static_cast<size_t>(header.groupTableOffset)], groups.data(), groups.size() * sizeof(LevelModelGroup));
+		memcpy(&fileData[static_cast<size_t>(header.instanceTableOffset)], instances.data(), instances.size() * sizeof(LevelInstance));
+	}
+
+	// A partially written table is never loaded
+	return SafeFileWriter::Write(strTableFilePath, fileData.data(), fileData.size());
+}
+
+uint64_t LevelLayoutCompiler::Align(uint64_t offset)
+{
+	return (offset + LEVEL_TABLE_ALIGNMENT - 1) & ~uint64_t(LEVEL_TABLE_ALIGNMENT - 1);
+}
+
+#pragma endregion
@@ -0,0 +1,112 @@
+//
+// LevelLayout.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// XMMatrixRotationRollPitchYaw (https://docs.microsoft.com/en-us/windows/win32/api/directxmath/nf-directxmath-xmmatrixrotationrollpitchyaw)
+// Z-order curve (https://en.wikipedia.org/wiki/Z-order_curve)
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Where the models of a level are placed, written as text and compiled into a binary instance table
+// The table holds the instances of each model together, in the order of the Z-order curve through their positions
+// (instances that are close to each other in the level are close to each other in the table)
+//
+// Level files have one placement per line (# starts a comment), distances in world units and angles in degrees:
+// origin <x> <y> <z>
+//		Added to the positions of the placements that follow, so a room or a bridge can be laid out around its own centre
+// place <model> <x> <y> <z> [options]
+//		One instance of the model
+// run <model> <x> <y> <z> step <x> <y> <z> count <n> [options]
+//		A row of n instances (fence runs), each one step further than the previous one
+// Options: rotate <pitch> <yaw> <roll>, scale <s> or scale <x> <y> <z>, tiles <u> <v> (texture tiles of the ground)
+// Instances are scaled, then rotated like XMMatrixRotationRollPitchYaw (roll, then pitch, then yaw), then moved to their position
+//
+// Table layout (every section starts on a LEVEL_TABLE_ALIGNMENT boundary):
+// LevelTableHeader
+// LevelModelGroup[groupCount] (sorted by model name)
+// LevelInstance[instanceCount]
+
+#define LEVEL_TABLE_MAGIC 0x4C564C43		// "CLVL"
+#define LEVEL_TABLE_VERSION 1				// Increase whenever the layout below or the compiler changes
+#define LEVEL_TABLE_ALIGNMENT 16
+#define LEVEL_TABLE_EXTENSION ".instances"	// Added to the name of the level file, in the cooked directory
+#define MAX_LEVEL_MODEL_NAME_LENGTH 32
+
+struct LevelTableHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;					// Hash of the level file the table was compiled from (a stale table is compiled again)
+	uint32_t groupCount;
+	uint32_t instanceCount;
+	uint64_t groupTableOffset;				// Byte offsets from the start of the file
+	uint64_t instanceTableOffset;
+};
+
+struct LevelModelGroup
+{
+	char modelName[MAX_LEVEL_MODEL_NAME_LENGTH];
+	uint32_t instanceOffset;				// In instances, from the start of the instance table
+	uint32_t instanceCount;
+};
+
+struct LevelInstance
+{
+	float worldMatrix[4][3];				// Row major, like DirectXMath (the fourth column of an affine matrix is always (0, 0, 0, 1))
+	int32_t textureTileCount[2];
+};
+
+static_assert(sizeof(LevelTableHeader) % 8 == 0, "LevelTableHeader must keep its 64-bit offsets aligned");
+static_assert(sizeof(LevelInstance) == 56, "LevelInstance must stay packed");
+
+// Compiled level (the whole table is read with a single read, and used in place)
+class LevelLayoutFile
+{
+public:
+	LevelLayoutFile();
+
+	// Fails if the file is missing or truncated, or was compiled from another version of the source or by another version of the compiler
+	bool Open(const char *filePath, uint64_t sourceHash);
+	void Close();
+	int GetGroupCount();
+	const LevelModelGroup* GetGroup(int iGroupIndex);
+	// Returns nullptr (and a count of 0) if the level does not place the model
+	const LevelInstance* GetInstances(const char *modelName, int &iInstanceCount);
+	int GetInstanceCount();
+	// Whether both levels place the model in the same places, in the same order (so its instance buffers can be kept)
+	bool HasSameInstances(LevelLayoutFile &otherLayout, const char *modelName);
+
+private:
+	std::vector<char> m_data;
+	const LevelTableHeader *m_pHeader;
+};
+
+// Parses level files and writes their instance tables
+class LevelLayoutCompiler
+{
+public:
+	// The error is the file name, the line and what is wrong with it
+	static bool Compile(const char *sourceFilePath, const std::string &strTableFilePath, uint64_t sourceHash, std::string &strError);
+
+private:
+	struct Placement
+	{
+		std::string strModelName;
+		LevelInstance instance;
+		uint32_t uiSortKey;
+	};
+
+	static bool ParseLine(const std::string &strLine, float origin[3], std::vector<Placement> &placements, std::string &strError);
+	static bool ParseOptions(const std::vector<std::string> &tokens, size_t firstToken, float rotation[3], float scale[3], int32_t tiles[2], std::string &strError);
+	static void ComputeWorldMatrix(const float position[3], const float rotation[3], const float scale[3], float worldMatrix[4][3]);
+	static void SortPlacements(std::vector<Placement> &placements);
+	static bool Write(const std::string &strTableFilePath, uint64_t sourceHash, const std::vector<Placement> &placements);
+	static uint64_t Align(uint64_t offset);
+};
@@ -15,7 +15,14 @@ LightShader::LightShader(ID3D11Device *pDevice, ID3D11DeviceContext *pImmediateC
 {
 	m_pInstanceVertexShader = nullptr;
 	m_pInstanceVertexInputLayout = nullptr;
+	m_pQuantizedVertexShader = nullptr;
+	m_pQuantizedVertexInputLayout = nullptr;
+	m_pPackedInstanceVertexShader = nullptr;
+	m_pPackedInstanceVertexInputLayout = nullptr;
+	m_pQuantizedPackedInstanceVertexShader = nullptr;
+	m_pQuantizedPackedInstanceVertexInputLayout = nullptr;
 	m_pLightVSBuffer = nullptr;
+	m_pQuantizationVSBuffer = nullptr;
 	m_pLightPSBuffer = nullptr;
 	m_pSamplerState = nullptr;
 }
@@ -24,7 +31,14 @@ LightShader::~LightShader()
 {
 	SAFE_RELEASE(m_pInstanceVertexShader)
 	SAFE_RELEASE(m_pInstanceVertexInputLayout)
+	SAFE_RELEASE(m_pQuantizedVertexShader)
+	SAFE_RELEASE(m_pQuantizedVertexInputLayout)
+	SAFE_RELEASE(m_pPackedInstanceVertexShader)
+	SAFE_RELEASE(m_pPackedInstanceVertexInputLayout)
+	SAFE_RELEASE(m_pQuantizedPackedInstanceVertexShader)
+	SAFE_RELEASE(m_pQuantizedPackedInstanceVertexInputLayout)
 	SAFE_RELEASE(m_pLightVSBuffer)
+	SAFE_RELEASE(m_pQuantizationVSBuffer)
 	SAFE_RELEASE(m_pLightPSBuffer)
 	SAFE_RELEASE(m_pSamplerState)
 }
@@ -59,29 +73,34 @@ HRESULT LightShader::Initialize()
 		return result;
 	}
 
-	// Compile the instance vertex shader
-	ID3DBlob *pCompiledInstanceVertexShader;
-	result = CompileShaderFromFile(L"Shaders/LightInstanceVertexShader.hlsl", "VS", "vs_5_0", &pCompiledInstanceVertexShader);
-	if (FAILED(result))
-	{
-		Utils::ShowError("Failed to compile instance vertex shader.", result);
-		return result;
-	}
+	// Compile and create the instance vertex shader and its input layout
 
-	const void *ppCompiledInstanceVertexShader = pCompiledInstanceVertexShader->GetBufferPointer();
-	SIZE_T compiledInstanceVertexShaderSize = pCompiledInstanceVertexShader->GetBufferSize();
+	D3D11_INPUT_ELEMENT_DESC instanceVertexInputDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,	D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLDMATRIX", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDMATRIX", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDMATRIX", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDMATRIX", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "TEX_TILE", 0, DXGI_FORMAT_R32G32_UINT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "LIGHT_DIR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
 
-	// Create the instance vertex shader
-	result = m_pDevice->CreateVertexShader(ppCompiledInstanceVertexShader, compiledInstanceVertexShaderSize, nullptr, &m_pInstanceVertexShader);
+	result = CreateVertexShader(L"Shaders/LightInstanceVertexShader.hlsl", nullptr, instanceVertexInputDesc, ARRAYSIZE(instanceVertexInputDesc),
+								&m_pInstanceVertexShader, &m_pInstanceVertexInputLayout);
 	if (FAILED(result))
 	{
-		Utils::ShowError("Failed to create instance vertex shader.", result);
 		return result;
 	}
 
-	// Create the instance vertex input layout
+	// Compile and create the packed instance vertex shader and its input layout (see PackedInstance)
+	// The texture tile count and the light direction are the same for every instance of a mesh and are read from the per-draw constant buffers
 
-	D3D11_INPUT_ELEMENT_DESC instanceVertexInputDesc[] =
+	D3D_SHADER_MACRO packedInstanceDefines[] = { { "PACKED_INSTANCE", "1" }, { nullptr, nullptr } };
+
+	D3D11_INPUT_ELEMENT_DESC packedInstanceVertexInputDesc[] =
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,	D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
@@ -89,21 +108,46 @@ HRESULT LightShader::Initialize()
 		{ "WORLDMATRIX", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 		{ "WORLDMATRIX", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 		{ "WORLDMATRIX", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "WORLDMATRIX", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "TEX_TILE", 0, DXGI_FORMAT_R32G32_UINT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "LIGHT_DIR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 	};
 
-	uiElementCount = ARRAYSIZE(instanceVertexInputDesc);
+	result = CreateVertexShader(L"Shaders/LightInstanceVertexShader.hlsl", packedInstanceDefines, packedInstanceVertexInputDesc, ARRAYSIZE(packedInstanceVertexInputDesc),
+								&m_pPackedInstanceVertexShader, &m_pPackedInstanceVertexInputLayout);
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	// Compile and create the quantized vertex shaders and their input layouts (see QuantizedVertex)
+
+	D3D_SHADER_MACRO quantizedVertexDefines[] = { { "QUANTIZED_VERTEX", "1" }, { nullptr, nullptr } };
+
+	D3D11_INPUT_ELEMENT_DESC quantizedVertexInputDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },				// Normalized to [-1, 1] within the mesh bounds
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },	// Octahedral-encoded
+	};
 
-	result = m_pDevice->CreateInputLayout(instanceVertexInputDesc, uiElementCount, ppCompiledInstanceVertexShader, compiledInstanceVertexShaderSize, &m_pInstanceVertexInputLayout);
+	result = CreateVertexShader(L"Shaders/LightVertexShader.hlsl", quantizedVertexDefines, quantizedVertexInputDesc, ARRAYSIZE(quantizedVertexInputDesc),
+								&m_pQuantizedVertexShader, &m_pQuantizedVertexInputLayout);
 	if (FAILED(result))
 	{
-		Utils::ShowError("Failed to create instance vertex input layout.", result);
 		return result;
 	}
 
-	SAFE_RELEASE(pCompiledInstanceVertexShader)
+	// The per-vertex elements are replaced and the per-instance elements are kept
+	D3D_SHADER_MACRO quantizedPackedInstanceDefines[] = { { "QUANTIZED_VERTEX", "1" }, { "PACKED_INSTANCE", "1" }, { nullptr, nullptr } };
+
+	D3D11_INPUT_ELEMENT_DESC quantizedPackedInstanceVertexInputDesc[ARRAYSIZE(packedInstanceVertexInputDesc)];
+	memcpy(quantizedPackedInstanceVertexInputDesc, packedInstanceVertexInputDesc, sizeof(packedInstanceVertexInputDesc));
+	memcpy(quantizedPackedInstanceVertexInputDesc, quantizedVertexInputDesc, sizeof(quantizedVertexInputDesc));
+
+	result = CreateVertexShader(L"Shaders/LightInstanceVertexShader.hlsl", quantizedPackedInstanceDefines, quantizedPackedInstanceVertexInputDesc, ARRAYSIZE(quantizedPackedInstanceVertexInputDesc),
+								&m_pQuantizedPackedInstanceVertexShader, &m_pQuantizedPackedInstanceVertexInputLayout);
+	if (FAILED(result))
+	{
+		return result;
+	}
 
 	// Create the light vertex shader constant buffer
 	// ByteWidth always needs to be a multiple of 16 if using D3D11_BIND_CONSTANT_BUFFER or CreateBuffer will fail
@@ -119,6 +163,15 @@ HRESULT LightShader::Initialize()
 		return result;
 	}
 
+	// Create the quantization vertex shader constant buffer
+	bufferDesc.ByteWidth = sizeof(QuantizationVSBuffer);
+	result = m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_pQuantizationVSBuffer);
+	if (FAILED(result))
+	{
+		Utils::ShowError("Failed to create quantization vertex shader buffer.", result);
+		return result;
+	}
+
 	// Create the light pixel shader constant buffer
 	bufferDesc.ByteWidth = sizeof(LightPSBuffer);
 	result = m_pDevice->CreateBuffer(&bufferDesc, nullptr, &m_pLightPSBuffer);
@@ -153,25 +206,111 @@ HRESULT LightShader::Initialize()
 	return result;
 }
 
+HRESULT LightShader::CreateVertexShader(LPCWSTR filename, const D3D_SHADER_MACRO *defines, D3D11_INPUT_ELEMENT_DESC vertexInputDesc[], UINT uiElementCount,
+										ID3D11VertexShader **ppVertexShader, ID3D11InputLayout **ppVertexInputLayout)
+{
+	HRESULT result = S_OK;
+	AddSourceFile(filename);
+
+	// Compile the vertex shader
+	ID3DBlob *pCompiledVertexShader;
+	result = CompileShaderFromFile(filename, "VS", "vs_5_0", &pCompiledVertexShader, defines);
+	if (FAILED(result))
+	{
+		Utils::ShowError("Failed to compile light vertex shader variant.", result);
+		return result;
+	}
+
+	const void *ppCompiledVertexShader = pCompiledVertexShader->GetBufferPointer();
+	SIZE_T compiledVertexShaderSize = pCompiledVertexShader->GetBufferSize();
+
+	// Create the vertex shader
+	result = m_pDevice->CreateVertexShader(ppCompiledVertexShader, compiledVertexShaderSize, nullptr, ppVertexShader);
+	if (FAILED(result))
+	{
+		Utils::ShowError("Failed to create light vertex shader variant.", result);
+		return result;
+	}
+
+	// Create the vertex input layout
+	result = m_pDevice->CreateInputLayout(vertexInputDesc, uiElementCount, ppCompiledVertexShader, compiledVertexShaderSize, ppVertexInputLayout);
+	if (FAILED(result))
+	{
+		Utils::ShowError("Failed to create light vertex input layout variant.", result);
+		return result;
+	}
+
+	SAFE_RELEASE(pCompiledVertexShader)
+
+	return result;
+}
+
 #pragma endregion
 
 #pragma region Render
 
-bool LightShader::PreRender(int iInstanceCount, XMINT2 textureTileCount, XMFLOAT4 ambientColor,
-							XMFLOAT4 diffuseColor, XMFLOAT4 specularColor, float specularPower,
-							XMFLOAT3 lightDirection, XMFLOAT3 pointLightColor, float pointLightStrength,
-						    XMFLOAT3 pointLightPosition, Camera *pCamera)
+void LightShader::SetVertexShader(int iInstanceCount, VertexFormat vertexFormat, bool bPackedInstances)
 {
-	// Set the vertex input layout
-	if (iInstanceCount == 1)
+	// Set the vertex input layout and the vertex shader to the device
+	// (quantized vertices are only used by meshes, whose instances are always packed)
+	if (vertexFormat == QuantizedVertexFormat)
+	{
+		m_pImmediateContext->IASetInputLayout(iInstanceCount == 1 ? m_pQuantizedVertexInputLayout : m_pQuantizedPackedInstanceVertexInputLayout);
+		m_pImmediateContext->VSSetShader(iInstanceCount == 1 ? m_pQuantizedVertexShader : m_pQuantizedPackedInstanceVertexShader, nullptr, 0);
+	}
+	else if (iInstanceCount == 1)
 	{
 		m_pImmediateContext->IASetInputLayout(m_pVertexInputLayout);
+		m_pImmediateContext->VSSetShader(m_pVertexShader,
+										 nullptr,			// Array of class instance interfaces used by the vertex shader
+										 0);				// Number of class instance interfaces
+	}
+	else if (bPackedInstances)
+	{
+		m_pImmediateContext->IASetInputLayout(m_pPackedInstanceVertexInputLayout);
+		m_pImmediateContext->VSSetShader(m_pPackedInstanceVertexShader, nullptr, 0);
 	}
 	else
 	{
 		m_pImmediateContext->IASetInputLayout(m_pInstanceVertexInputLayout);
+		m_pImmediateContext->VSSetShader(m_pInstanceVertexShader, nullptr, 0);
+	}
+}
+
+bool LightShader::SetQuantizationBuffer(QuantizationBounds bounds)
+{
+	// Lock the quantization vertex shader buffer so it can be written to
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT result = m_pImmediateContext->Map(m_pQuantizationVSBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	if (FAILED(result))
+	{
+		Utils::ShowError("Failed to map the quantization vertex shader buffer.", result);
+		return false;
 	}
 
+	// Copy the mesh bounds into the quantization vertex shader buffer
+	QuantizationVSBuffer *pQuantizationVSBufferData = (QuantizationVSBuffer*)mappedResource.pData;
+	pQuantizationVSBufferData->positionCenter = XMFLOAT4(bounds.center.x, bounds.center.y, bounds.center.z, 0.0f);
+	pQuantizationVSBufferData->positionExtents = XMFLOAT4(bounds.extents.x, bounds.extents.y, bounds.extents.z, 0.0f);
+
+	// Unlock the quantization vertex shader buffer
+	m_pImmediateContext->Unmap(m_pQuantizationVSBuffer, 0);
+
+	// Set the constant buffer to be used by the vertex shader
+	m_pImmediateContext->VSSetConstantBuffers(2, 1, &m_pQuantizationVSBuffer);
+
+	return true;
+}
+
+
+bool LightShader::PreRender(int iInstanceCount, XMINT2 textureTileCount, XMFLOAT4 ambientColor,
+							XMFLOAT4 diffuseColor, XMFLOAT4 specularColor, float specularPower,
+							XMFLOAT3 lightDirection, XMFLOAT3 pointLightColor, float pointLightStrength,
+						    XMFLOAT3 pointLightPosition, Camera *pCamera, bool bPackedInstances)
+{
+	// Set the vertex input layout and the vertex shader (meshes with quantized vertices switch to their own variant)
+	SetVertexShader(iInstanceCount, FullPrecisionVertexFormat, bPackedInstances);
+
 	// Update the light vertex shader constant buffer
 
 	// Lock the light vertex shader buffer so it can be written to
@@ -198,18 +337,6 @@ bool LightShader::PreRender(int iInstanceCount, XMINT2 textureTileCount, XMFLOAT
 	// Set the constant buffers to be used by the vertex shader
 	m_pImmediateContext->VSSetConstantBuffers(1, 1, &m_pLightVSBuffer);
 
-	// Set the vertex shader to the device
-	if (iInstanceCount == 1)
-	{
-		m_pImmediateContext->VSSetShader(m_pVertexShader,
-										 nullptr,			// Array of class instance interfaces used by the vertex shader
-										 0);				// Number of class instance interfaces
-	}
-	else
-	{
-		m_pImmediateContext->VSSetShader(m_pInstanceVertexShader, nullptr, 0);
-	}
-
 	// Update the light pixel shader constant buffer
 
 	// Lock the light pixel shader buffer so it can be written to
@@ -232,7 +359,7 @@ bool LightShader::PreRender(int iInstanceCount, XMINT2 textureTileCount, XMFLOAT
 	pLightPSBufferData->pointLightColor = pointLightColor;
 	pLightPSBufferData->pointLightStrength = pointLightStrength;
 	pLightPSBufferData->pointLightPosition = pointLightPosition;
-	pLightPSBufferData->instanceCount = iInstanceCount;
+	pLightPSBufferData->instanceCount = bPackedInstances ? 1 : iInstanceCount; // Packed instances use the light direction of the draw
 
 	// Unlock the light pixel shader buffer
 	m_pImmediateContext->Unmap(m_pLightPSBuffer, 0);
@@ -257,7 +384,7 @@ bool LightShader::Render(TxtModel *pModel, Camera *pCamera)
 	if (!PreRender(pModel->GetInstanceCount(), pModel->GetTextureTileCount(), pModel->GetAmbientColor(),
 				   pModel->GetDiffuseColor(), pModel->GetSpecularColor(), pModel->GetSpecularPower(),
 				   pModel->GetLightDirection(), pModel->GetPointLightColor(), pModel->GetPointLightStrength(), 
-				   pModel->GetPointLightPosition(), pCamera))
+				   pModel->GetPointLightPosition(), pCamera, false))
 	{
 		return false;
 	}
@@ -265,7 +392,7 @@ bool LightShader::Render(TxtModel *pModel, Camera *pCamera)
 	std::vector<ID3D11ShaderResourceView*> textures;
 	textures.push_back(pModel->GetTexture());
 
-	Render(pModel->GetInstanceCount(), pModel->GetWorldMatrix(), textures, pModel->GetIndexCount(), pCamera);
+	Render(pModel->GetInstanceCount(), pModel->GetWorldMatrix(), textures, { { 0, pModel->GetIndexCount() } }, pCamera);
 
 	return true;
 }
@@ -274,16 +401,23 @@ bool LightShader::PreRender(Model *pModel, Camera *pCamera)
 {
 	return PreRender(pModel->GetInstanceCount(), XMINT2(1, 1), pModel->GetAmbientColor(), pModel->GetDiffuseColor(), pModel->GetSpecularColor(),
 					 pModel->GetSpecularPower(), pModel->GetLightDirection(), pModel->GetPointLightColor(), pModel->GetPointLightStrength(),
-					 pModel->GetPointLightPosition(), pCamera);
+					 pModel->GetPointLightPosition(), pCamera, true);
 }
 
 void LightShader::Render(Mesh *pMesh, Camera *pCamera)
 {
-	Render(pMesh->GetInstanceCount(), pMesh->GetWorldMatrix(), pMesh->GetTextures(), pMesh->GetIndexCount(), pCamera);
+	// Meshes of the same model can have different vertex formats
+	SetVertexShader(pMesh->GetInstanceCount(), pMesh->GetVertexFormat(), true);
+	if (pMesh->GetVertexFormat() == QuantizedVertexFormat)
+	{
+		SetQuantizationBuffer(pMesh->GetQuantizationBounds());
+	}
+
+	Render(pMesh->GetInstanceCount(), pMesh->GetWorldMatrix(), pMesh->GetTextures(), pMesh->GetDrawRanges(), pCamera);
 }
 
 void LightShader::Render(int iInstanceCount, XMMATRIX worldMatrix, std::vector<ID3D11ShaderResourceView*> textures, 
-						 int iIndexCount, Camera *pCamera)
+						 std::vector<IndexRange> drawRanges, Camera *pCamera)
 {
 	// Update and set the matrix constant buffer to be used by the vertex shader
 	Shader::SetMatrixBuffer(worldMatrix, pCamera->GetViewMatrix(), pCamera->GetProjectionMatrix());
@@ -291,16 +425,19 @@ void LightShader::Render(int iInstanceCount, XMMATRIX worldMatrix, std::vector<I
 	// Set the texture to be used by the pixel shader
 	m_pImmediateContext->PSSetShaderResources(0, 1, &textures[0]);
 
-	// Render triangles
-	if (iInstanceCount == 1)
-	{
-		m_pImmediateContext->DrawIndexed(iIndexCount,
-										 0,				// Location of the first index read by the GPU from the index buffer
-										 0);			// Value added to each index before reading a vertex from the vertex buffer
-	}
-	else
+	// Render triangles (one draw for each visible range of the index buffer)
+	for (auto &drawRange : drawRanges)
 	{
-		m_pImmediateContext->DrawIndexedInstanced(iIndexCount, iInstanceCount, 0, 0, 0);
+		if (iInstanceCount == 1)
+		{
+			m_pImmediateContext->DrawIndexed(drawRange.iIndexCount,
+											 drawRange.iStartIndex,	// Location of the first index read by the GPU from the index buffer
+											 0);						// Value added to each index before reading a vertex from the vertex buffer
+		}
+		else
+		{
+			m_pImmediateContext->DrawIndexedInstanced(drawRange.iIndexCount, iInstanceCount, drawRange.iStartIndex, 0, 0);
+		}
 	}
 }
 
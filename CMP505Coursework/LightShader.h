@@ -35,6 +35,12 @@ struct LightPSBuffer // For pixel shader
 	UINT instanceCount;
 };
 
+struct QuantizationVSBuffer // For vertex shader (quantized vertices only)
+{
+	XMFLOAT4 positionCenter;
+	XMFLOAT4 positionExtents;
+};
+
 class LightShader : public Shader
 {
 public:
@@ -49,14 +55,25 @@ public:
 private:
 	ID3D11VertexShader *m_pInstanceVertexShader;
 	ID3D11InputLayout *m_pInstanceVertexInputLayout;
+	ID3D11VertexShader *m_pQuantizedVertexShader;
+	ID3D11InputLayout *m_pQuantizedVertexInputLayout;
+	ID3D11VertexShader *m_pPackedInstanceVertexShader;
+	ID3D11InputLayout *m_pPackedInstanceVertexInputLayout;
+	ID3D11VertexShader *m_pQuantizedPackedInstanceVertexShader;
+	ID3D11InputLayout *m_pQuantizedPackedInstanceVertexInputLayout;
 	ID3D11Buffer *m_pLightVSBuffer;
+	ID3D11Buffer *m_pQuantizationVSBuffer;
 	ID3D11Buffer *m_pLightPSBuffer;
 	ID3D11SamplerState *m_pSamplerState;
 
 	bool PreRender(int iInstanceCount, XMINT2 textureTileCount, XMFLOAT4 ambientColor,
 				   XMFLOAT4 diffuseColor, XMFLOAT4 specularColor, float specularPower,
 				   XMFLOAT3 lightDirection, XMFLOAT3 pointLightColor, float pointLightStrength, 
-				   XMFLOAT3 pointLightPosition, Camera *pCamera);
+				   XMFLOAT3 pointLightPosition, Camera *pCamera, bool bPackedInstances);
+	HRESULT CreateVertexShader(LPCWSTR filename, const D3D_SHADER_MACRO *defines, D3D11_INPUT_ELEMENT_DESC vertexInputDesc[], UINT uiElementCount,
+							   ID3D11VertexShader **ppVertexShader, ID3D11InputLayout **ppVertexInputLayout);
+	void SetVertexShader(int iInstanceCount, VertexFormat vertexFormat, bool bPackedInstances);
+	bool SetQuantizationBuffer(QuantizationBounds bounds);
 	void Render(int iInstanceCount, XMMATRIX worldMatrix, std::vector<ID3D11ShaderResourceView*> textures, 
-				int iIndexCount, Camera *pCamera);
+				std::vector<IndexRange> drawRanges, Camera *pCamera);
 };
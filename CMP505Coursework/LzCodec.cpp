@@ -0,0 +1,147 @@
+//
+// LzCodec.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// LZ4 Block Format Description (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md)
+//
+
+#include <cstring>
+#include "LzCodec.h"
+
+void LzCodec::Encode(const uint8_t *pData, size_t size, std::vector<uint8_t> &output)
+{
+	output.clear();
+	output.reserve(size + size / 255 + 16);
+
+	// Last position (plus one, so 0 is empty) of each hashed 4 byte sequence, only the latest one is tried
+	std::vector<size_t> positions(size_t(1) << LZ_CODEC_HASH_BITS, 0);
+	size_t literalStart = 0;
+	size_t i = 0;
+	while (i + LZ_CODEC_MIN_MATCH <= size)
+	{
+		uint32_t uiSequence;
+		memcpy(&uiSequence, pData + i, sizeof(uiSequence));
+		uint32_t uiHash = (uiSequence * 2654435761u) >> (32 - LZ_CODEC_HASH_BITS);
+		size_t candidate = positions[uiHash];
+		positions[uiHash] = i + 1;
+		if (candidate == 0 || i - (candidate - 1) > LZ_CODEC_MAX_OFFSET || memcmp(pData + candidate - 1, pData + i, LZ_CODEC_MIN_MATCH) != 0)
+		{
+			i++;
+			continue;
+		}
+
+		// Matches can overlap the bytes they produce (a short run repeated)
+		size_t matchStart = candidate - 1;
+		size_t matchLength = LZ_CODEC_MIN_MATCH;
+		while (i + matchLength < size && pData[matchStart + matchLength] == pData[i + matchLength])
+		{
+			matchLength++;
+		}
+		WriteSequence(pData + literalStart, i - literalStart, i - matchStart, matchLength, output);
+		i += matchLength;
+		literalStart = i;
+	}
+
+	WriteSequence(pData + literalStart, size - literalStart, 0, 0, output);
+}
+
+bool LzCodec::Decode(const uint8_t *pData, size_t size, uint8_t *pOutput, size_t outputSize)
+{
+	const uint8_t *pEnd = pData + size;
+	size_t outputPosition = 0;
+	while (pData < pEnd)
+	{
+		uint8_t token = *pData++;
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !ReadLength(pData, pEnd, literalCount))
+		{
+			return false;
+		}
+		if (literalCount > static_cast<size_t>(pEnd - pData) || literalCount > outputSize - outputPosition)
+		{
+			return false;
+		}
+		memcpy(pOutput + outputPosition, pData, literalCount);
+		pData += literalCount;
+		outputPosition += literalCount;
+
+		if (pData == pEnd)
+		{
+			break;
+		}
+
+		if (pEnd - pData < 2)
+		{
+			return false;
+		}
+		size_t matchOffset = pData[0] | (pData[1] << 8);
+		pData += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(pData, pEnd, matchLength))
+		{
+			return false;
+		}
+		matchLength += LZ_CODEC_MIN_MATCH;
+		if (matchOffset == 0 || matchOffset > outputPosition || matchLength > outputSize - outputPosition)
+		{
+			return false;
+		}
+
+		// Byte by byte, since the match can overlap what it writes
+		const uint8_t *pMatch = pOutput + outputPosition - matchOffset;
+		for (size_t i = 0; i < matchLength; i++)
+		{
+			pOutput[outputPosition + i] = pMatch[i];
+		}
+		outputPosition += matchLength;
+	}
+
+	return outputPosition == outputSize;
+}
+
+void LzCodec::WriteSequence(const uint8_t *pLiterals, size_t literalCount, size_t matchOffset, size_t matchLength, std::vector<uint8_t> &output)
+{
+	size_t matchCode = matchLength > 0 ? matchLength - LZ_CODEC_MIN_MATCH : 0;
+	output.push_back(static_cast<uint8_t>(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+	if (literalCount >= 15)
+	{
+		WriteLength(literalCount - 15, output);
+	}
+	output.insert(output.end(), pLiterals, pLiterals + literalCount);
+
+	if (matchLength == 0)
+	{
+		return;
+	}
+	output.push_back(static_cast<uint8_t>(matchOffset & 0xFF));
+	output.push_back(static_cast<uint8_t>(matchOffset >> 8));
+	if (matchCode >= 15)
+	{
+		WriteLength(matchCode - 15, output);
+	}
+}
+
+void LzCodec::WriteLength(size_t length, std::vector<uint8_t> &output)
+{
+	for (; length >= 255; length -= 255)
+	{
+		output.push_back(255);
+	}
+	output.push_back(static_cast<uint8_t>(length));
+}
+
+bool LzCodec::ReadLength(const uint8_t *&pData, const uint8_t *pEnd, size_t &length)
+{
+	uint8_t byte = 255;
+	while (byte == 255)
+	{
+		if (pData == pEnd)
+		{
+			return false;
+		}
+		byte = *pData++;
+		length += byte;
+	}
+	return true;
+}
@@ -0,0 +1,34 @@
+//
+// LzCodec.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// LZ4 Block Format Description (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md)
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define LZ_CODEC_MIN_MATCH 4
+#define LZ_CODEC_MAX_OFFSET 65535
+#define LZ_CODEC_HASH_BITS 16
+
+// General purpose byte compressor in the style of LZ4, for files that have no codec of their own (text, uncompressed images)
+// Each sequence is a token (literal and match length nibbles), the literals, and a match copied from up to 64 KB back
+// The last sequence only has literals
+class LzCodec
+{
+public:
+	static void Encode(const uint8_t *pData, size_t size, std::vector<uint8_t> &output);
+	// Fails if the data is not a valid stream or does not decode to exactly outputSize bytes
+	static bool Decode(const uint8_t *pData, size_t size, uint8_t *pOutput, size_t outputSize);
+
+private:
+	static void WriteSequence(const uint8_t *pLiterals, size_t literalCount, size_t matchOffset, size_t matchLength, std::vector<uint8_t> &output);
+	// Lengths of 15 or more continue in bytes of 255 until a smaller byte
+	static void WriteLength(size_t length, std::vector<uint8_t> &output);
+	static bool ReadLength(const uint8_t *&pData, const uint8_t *pEnd, size_t &length);
+};
@@ -4,7 +4,9 @@
 //
 
 #include <windows.h>
+#include <cstring>
 #include "Engine.h"
+#include "Profiler.h"
 #include "Utils.h"
 
 // Entry point
@@ -13,6 +15,13 @@ int WINAPI WinMain(HINSTANCE hInstance,
 				   PSTR pCmdLine,				// Address of command line string for the application
 				   int iCmdShow)				// Controls how the window is to be shown
 {
+	// Time the startup phases and the resource loads, see Graphics::Render for the output
+	if (pCmdLine != nullptr && strstr(pCmdLine, "-profile-startup") != nullptr)
+	{
+		Profiler::StartCapture();
+		Profiler::SetThreadName("Main thread");
+	}
+
 	Engine *pEngine = new Engine(hInstance);
 	if (pEngine->Initialize("Procedural Game Prototype", 1024, 768))
 	{
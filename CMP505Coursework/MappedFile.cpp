@@ -0,0 +1,166 @@
+//
+// MappedFile.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// File Mapping (https://docs.microsoft.com/en-us/windows/win32/memory/file-mapping)
+// mmap(2) (https://man7.org/linux/man-pages/man2/mmap.2.html)
+//
+
+#include "MappedFile.h"
+#include "AssetPack.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+#ifdef _WIN32
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hFileMapping = nullptr;
+#else
+	m_iFileDescriptor = -1;
+#endif
+	m_pData = nullptr;
+	m_size = 0;
+	m_bIsPackView = false;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const char *filePath)
+{
+	Close();
+
+	AssetPack *pPack = AssetPack::GetMounted();
+	if (pPack != nullptr && pPack->Find(filePath, m_pData, m_size))
+	{
+		m_bIsPackView = true;
+		return true;
+	}
+
+#ifdef _WIN32
+	m_hFile = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_hFile, &fileSize))
+	{
+		Close();
+		return false;
+	}
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+
+	// Empty files cannot be mapped
+	if (m_size == 0)
+	{
+		return true;
+	}
+
+	m_hFileMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_hFileMapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const char*>(MapViewOfFile(m_hFileMapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	m_iFileDescriptor = open(filePath, O_RDONLY);
+	if (m_iFileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStatus;
+	if (fstat(m_iFileDescriptor, &fileStatus) != 0)
+	{
+		Close();
+		return false;
+	}
+	m_size = static_cast<size_t>(fileStatus.st_size);
+
+	// Empty files cannot be mapped
+	if (m_size == 0)
+	{
+		return true;
+	}
+
+	void *pData = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_iFileDescriptor, 0);
+	m_pData = pData == MAP_FAILED ? nullptr : static_cast<const char*>(pData);
+	if (m_pData != nullptr)
+	{
+		// The file is read front to back
+		madvise(pData, m_size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (m_pData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_bIsPackView)
+	{
+		// The pack owns the mapping
+		m_pData = nullptr;
+		m_size = 0;
+		m_bIsPackView = false;
+		return;
+	}
+
+#ifdef _WIN32
+	if (m_pData != nullptr)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+	if (m_hFileMapping != nullptr)
+	{
+		CloseHandle(m_hFileMapping);
+		m_hFileMapping = nullptr;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_pData != nullptr)
+	{
+		munmap(const_cast<char*>(m_pData), m_size);
+	}
+	if (m_iFileDescriptor >= 0)
+	{
+		close(m_iFileDescriptor);
+		m_iFileDescriptor = -1;
+	}
+#endif
+	m_pData = nullptr;
+	m_size = 0;
+}
+
+const char* MappedFile::GetData()
+{
+	return m_pData;
+}
+
+size_t MappedFile::GetSize()
+{
+	return m_size;
+}
@@ -0,0 +1,44 @@
+//
+// MappedFile.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// File Mapping (https://docs.microsoft.com/en-us/windows/win32/memory/file-mapping)
+// mmap(2) (https://man7.org/linux/man-pages/man2/mmap.2.html)
+//
+
+#pragma once
+
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Read-only view of a whole file (the data is not null-terminated)
+// Files in the mounted asset pack are views of the pack's mapping, so they stay valid until the pack is unmounted
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char *filePath);
+	void Close();
+	const char* GetData();
+	size_t GetSize();
+
+private:
+#ifdef _WIN32
+	HANDLE m_hFile;
+	HANDLE m_hFileMapping;
+#else
+	int m_iFileDescriptor;
+#endif
+	const char *m_pData;
+	size_t m_size;
+	bool m_bIsPackView;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+};
@@ -10,17 +10,21 @@
 
 #pragma region Init
 
-Mesh::Mesh(std::vector<ID3D11ShaderResourceView*> &textures, XMMATRIX transformMatrix)
+Mesh::Mesh(std::vector<ID3D11ShaderResourceView*> &textures, XMMATRIX transformMatrix, VertexFormat vertexFormat)
 {
 	m_textures = textures;
 	m_pVertexBuffer = nullptr;
 	m_pIndexBuffer = nullptr;
 	m_iIndexCount = 0;
+	m_iCurrentLod = 0;
+	m_bMeshletsEnabled = false;
 	m_pInstanceBuffer = nullptr;
-	m_pInstances = nullptr;
+	m_bIsInstanceBufferDirty = false;
 	m_iInstanceCount = 0;
 	m_worldMatrix = XMMatrixIdentity();
 	m_transformMatrix = transformMatrix;
+	m_vertexFormat = vertexFormat;
+	m_quantizationBounds = {};
 }
 
 Mesh::~Mesh()
@@ -32,72 +36,307 @@ Mesh::~Mesh()
 	SAFE_RELEASE(m_pVertexBuffer);
 	SAFE_RELEASE(m_pIndexBuffer);
 	SAFE_RELEASE(m_pInstanceBuffer);
-	SAFE_DELETE(m_pInstances);
 }
 
 bool Mesh::InitializeBuffers(ID3D11Device *pDevice, std::vector<Vertex> &vertices, std::vector<DWORD> &indices, 
+							 int iInstanceCount, Instance *instances, std::vector<DWORD> *pIndexBufferData)
+{
+	// The full detail mesh is always the first LOD, the simplified LODs follow it in the same index buffer
+	std::vector<MeshLod> lods = { { 0, (int)indices.size(), FLT_MAX } };
+	std::vector<DWORD> lodIndices = indices;
+
+	// Split the full detail mesh into meshlets (this reorders its triangles so each meshlet is a contiguous index range)
+	m_meshlets.clear();
+	if (m_bMeshletsEnabled && indices.size() > MAX_MESHLET_TRIANGLES * 3)
+	{
+		m_meshlets = MeshletBuilder::Build(vertices, lodIndices);
+	}
+
+	for (size_t i = 0; i < m_lodIndices.size(); i++)
+	{
+		lods.push_back({ (int)lodIndices.size(), m_lods[i].iIndexCount, m_lods[i].fMaxScreenCoverage });
+		lodIndices.insert(lodIndices.end(), m_lodIndices[i].begin(), m_lodIndices[i].end());
+	}
+	m_lods = lods;
+	m_lodIndices.clear();
+
+	m_iCurrentLod = 0;
+	m_iIndexCount = lodIndices.size();
+	m_drawRanges = { { 0, (int)indices.size() } };
+
+	// Compute the object space bounding box and bounding sphere
+	ComputeBounds(vertices);
+
+	if (!CreateBuffers(pDevice, vertices.data(), vertices.size(), lodIndices.data(), iInstanceCount, instances))
+	{
+		return false;
+	}
+
+	if (pIndexBufferData != nullptr)
+	{
+		*pIndexBufferData = lodIndices;
+	}
+
+	return true;
+}
+
+bool Mesh::InitializeBuffers(ID3D11Device *pDevice, CookedMeshFile &cookedMeshFile, const CookedSubmesh &submesh, 
 							 int iInstanceCount, Instance *instances)
 {
-	int iVertexCount = vertices.size();
-	m_iIndexCount = indices.size();
+	static_assert(sizeof(DWORD) == sizeof(uint32_t), "Cooked indices are used as the index buffer data");
+
+	m_lods.clear();
+	for (uint32_t i = 0; i < submesh.lodCount; i++)
+	{
+		m_lods.push_back({ (int)submesh.lods[i].indexOffset, (int)submesh.lods[i].indexCount, submesh.lods[i].maxScreenCoverage });
+	}
+	m_lods[0].fMaxScreenCoverage = FLT_MAX;
+	m_lodIndices.clear();
+
+	// The cooked indices are already in meshlet order
+	m_meshlets.clear();
+	if (m_bMeshletsEnabled)
+	{
+		const CookedMeshlet *cookedMeshlets = cookedMeshFile.GetMeshlets(submesh);
+		for (uint32_t i = 0; i < submesh.meshletCount; i++)
+		{
+			const CookedMeshlet &cookedMeshlet = cookedMeshlets[i];
+			Meshlet meshlet;
+			meshlet.iStartIndex = cookedMeshlet.indexOffset;
+			meshlet.iIndexCount = cookedMeshlet.indexCount;
+			meshlet.boundingSphere = BoundingSphere(XMFLOAT3(cookedMeshlet.sphereCenter), cookedMeshlet.sphereRadius);
+			meshlet.coneAxis = XMFLOAT3(cookedMeshlet.coneAxis);
+			meshlet.fConeCutoff = cookedMeshlet.coneCutoff;
+			m_meshlets.push_back(meshlet);
+		}
+	}
+
+	m_iCurrentLod = 0;
+	m_iIndexCount = submesh.indexCount;
+	m_drawRanges = { { 0, m_lods[0].iIndexCount } };
+
+	m_boundingBox = BoundingBox(XMFLOAT3(submesh.boxCenter), XMFLOAT3(submesh.boxExtents));
+	m_boundingSphere = BoundingSphere(XMFLOAT3(submesh.sphereCenter), submesh.sphereRadius);
 
+	// The buffers are created from the mapped file without copying the vertices or indices
+	return CreateBuffers(pDevice, static_cast<const Vertex*>(cookedMeshFile.GetVertexData(submesh)), submesh.vertexCount, 
+						 reinterpret_cast<const DWORD*>(cookedMeshFile.GetIndexData(submesh)), iInstanceCount, instances);
+}
+
+void Mesh::GetCookedSubmesh(CookedSubmesh &submesh, std::vector<CookedMeshlet> &meshlets)
+{
+	submesh.lodCount = min((int)m_lods.size(), MAX_COOKED_LOD_COUNT);
+	for (uint32_t i = 0; i < submesh.lodCount; i++)
+	{
+		submesh.lods[i] = { (uint32_t)m_lods[i].iStartIndex, (uint32_t)m_lods[i].iIndexCount, m_lods[i].fMaxScreenCoverage };
+	}
+
+	XMFLOAT4X4 transform;
+	XMStoreFloat4x4(&transform, m_transformMatrix);
+	memcpy(submesh.transform, &transform, sizeof(submesh.transform));
+
+	memcpy(submesh.boxCenter, &m_boundingBox.Center, sizeof(submesh.boxCenter));
+	memcpy(submesh.boxExtents, &m_boundingBox.Extents, sizeof(submesh.boxExtents));
+	memcpy(submesh.sphereCenter, &m_boundingSphere.Center, sizeof(submesh.sphereCenter));
+	submesh.sphereRadius = m_boundingSphere.Radius;
+
+	meshlets.clear();
+	for (auto &meshlet : m_meshlets)
+	{
+		CookedMeshlet cookedMeshlet;
+		cookedMeshlet.indexOffset = meshlet.iStartIndex;
+		cookedMeshlet.indexCount = meshlet.iIndexCount;
+		memcpy(cookedMeshlet.sphereCenter, &meshlet.boundingSphere.Center, sizeof(cookedMeshlet.sphereCenter));
+		cookedMeshlet.sphereRadius = meshlet.boundingSphere.Radius;
+		memcpy(cookedMeshlet.coneAxis, &meshlet.coneAxis, sizeof(cookedMeshlet.coneAxis));
+		cookedMeshlet.coneCutoff = meshlet.fConeCutoff;
+		meshlets.push_back(cookedMeshlet);
+	}
+}
+
+bool Mesh::CreateBuffers(ID3D11Device *pDevice, const Vertex *vertices, int iVertexCount, const DWORD *indices, 
+						 int iInstanceCount, Instance *instances)
+{
 	// Create the vertex buffer
+	if (!CreateVertexBuffer(pDevice, vertices, iVertexCount))
+	{
+		return false;
+	}
 
 	D3D11_BUFFER_DESC bufferDesc = {};
-	bufferDesc.ByteWidth = sizeof(Vertex) * iVertexCount;
 	bufferDesc.Usage = D3D11_USAGE_DEFAULT;							// Require read and write access by the GPU
-	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;				// Bind the buffer as a vertex buffer to the input assembler stage
 	bufferDesc.CPUAccessFlags = 0;									// No CPU access is necessary
 
 	D3D11_SUBRESOURCE_DATA subresourceData = {}; // Data that will be copied to the buffer during creation
-	subresourceData.pSysMem = vertices.data();
-
-	HRESULT result = pDevice->CreateBuffer(&bufferDesc, &subresourceData, &m_pVertexBuffer);
-	if (FAILED(result))
-	{
-		Utils::ShowError("Failed to create mesh vertex buffer.", result);
-		return false;
-	}
 
 	// Create the index buffer
 
 	bufferDesc.ByteWidth = sizeof(DWORD) * m_iIndexCount;
 	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;					// Bind the buffer as an index buffer to the input assembler stage
 
-	subresourceData.pSysMem = indices.data();
+	subresourceData.pSysMem = indices;
 
-	result = pDevice->CreateBuffer(&bufferDesc, &subresourceData, &m_pIndexBuffer);
+	HRESULT result = E_FAIL;
+	TaskGraph::RunOnDeviceThread([&] { result = pDevice->CreateBuffer(&bufferDesc, &subresourceData, &m_pIndexBuffer); });
 	if (FAILED(result))
 	{
 		Utils::ShowError("Failed to create mesh index buffer.", result);
 		return false;
 	}
 
+	return CreateInstanceBuffer(pDevice, iInstanceCount, instances);
+}
+
+bool Mesh::InitializeSharedBuffers(ID3D11Device *pDevice, Mesh *pSourceMesh, int iInstanceCount, Instance *instances)
+{
+	if (pSourceMesh->m_pVertexBuffer == nullptr || pSourceMesh->m_pIndexBuffer == nullptr)
+	{
+		return false;
+	}
+
+	// Both meshes hold a reference to the vertex and index buffers, which are released when the last of them is deleted
+	m_pVertexBuffer = pSourceMesh->m_pVertexBuffer;
+	m_pVertexBuffer->AddRef();
+	m_pIndexBuffer = pSourceMesh->m_pIndexBuffer;
+	m_pIndexBuffer->AddRef();
+	m_iIndexCount = pSourceMesh->m_iIndexCount;
+	m_lods = pSourceMesh->m_lods;
+	m_iCurrentLod = 0;
+	m_meshlets = m_bMeshletsEnabled ? pSourceMesh->m_meshlets : std::vector<Meshlet>();
+	m_drawRanges = { { GetStartIndex(), GetIndexCount() } };
+	m_boundingBox = pSourceMesh->m_boundingBox;
+	m_boundingSphere = pSourceMesh->m_boundingSphere;
+	m_quantizationBounds = pSourceMesh->m_quantizationBounds;
+
+	// The world matrices are per mesh, so each mesh has its own instance buffer
+	return CreateInstanceBuffer(pDevice, iInstanceCount, instances);
+}
+
+bool Mesh::CreateInstanceBuffer(ID3D11Device *pDevice, int iInstanceCount, Instance *instances)
+{
 	m_iInstanceCount = iInstanceCount;
 
 	if (iInstanceCount > 1)
 	{
-		m_pInstances = instances;
+		// Pack the instances (the texture tile count and the light direction are set per draw)
+		// The instances are copied so the caller's array can be shared by every mesh of a model
+		m_instances.resize(iInstanceCount);
+		for (int i = 0; i < iInstanceCount; i++)
+		{
+			SetInstanceWorldMatrix(i, m_transformMatrix * instances[i].worldMatrix);
+		}
+		m_bIsInstanceBufferDirty = false;
 
 		// Create the instance buffer
 
-		bufferDesc.ByteWidth = sizeof(Instance) * iInstanceCount;
+		D3D11_BUFFER_DESC bufferDesc = {};
+		bufferDesc.ByteWidth = sizeof(PackedInstance) * iInstanceCount;
 		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
 		bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
-		for (int i = 0; i < iInstanceCount; i++)
-		{
-			instances[i].worldMatrix = m_transformMatrix * instances[i].worldMatrix;
-		}
-		subresourceData.pSysMem = instances;
+		D3D11_SUBRESOURCE_DATA subresourceData = {};
+		subresourceData.pSysMem = m_instances.data();
 
-		result = pDevice->CreateBuffer(&bufferDesc, &subresourceData, &m_pInstanceBuffer);
+		HRESULT result = E_FAIL;
+		TaskGraph::RunOnDeviceThread([&] { result = pDevice->CreateBuffer(&bufferDesc, &subresourceData, &m_pInstanceBuffer); });
 		if (FAILED(result))
 		{
 			Utils::ShowError("Failed to create mesh instance buffer.", result);
 			return false;
 		}
+
+		UpdateInstanceBounds();
+	}
+
+	return true;
+}
+
+void Mesh::ComputeBounds(std::vector<Vertex> &vertices)
+{
+	if (vertices.empty())
+	{
+		m_boundingBox = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f));
+		m_boundingSphere = BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+		return;
+	}
+
+	// Both reduce the positions with vectorized min/max operations (positions are strided by the vertex size)
+	BoundingBox::CreateFromPoints(m_boundingBox, vertices.size(), &vertices[0].position, sizeof(Vertex));
+	BoundingSphere::CreateFromPoints(m_boundingSphere, vertices.size(), &vertices[0].position, sizeof(Vertex));
+}
+
+void Mesh::UpdateInstanceBounds()
+{
+	m_instanceBoundingBoxes.resize(m_iInstanceCount);
+	m_instanceBoundingSpheres.resize(m_iInstanceCount);
+
+	for (int i = 0; i < m_iInstanceCount; i++)
+	{
+		XMMATRIX worldMatrix = GetInstanceWorldMatrix(i);
+		m_boundingBox.Transform(m_instanceBoundingBoxes[i], worldMatrix);
+		m_boundingSphere.Transform(m_instanceBoundingSpheres[i], worldMatrix);
+	}
+}
+
+void Mesh::SetInstanceWorldMatrix(int iInstanceIndex, XMMATRIX transposedWorldMatrix)
+{
+	// Instance matrices are stored transposed for the instance vertex shader, so the columns of the world matrix are the first three rows
+	XMFLOAT4X4 matrix;
+	XMStoreFloat4x4(&matrix, transposedWorldMatrix);
+	for (int i = 0; i < 3; i++)
+	{
+		m_instances[iInstanceIndex].worldMatrixColumns[i] = XMFLOAT4(matrix.m[i]);
+	}
+}
+
+XMMATRIX Mesh::GetInstanceWorldMatrix(int iInstanceIndex)
+{
+	const XMFLOAT4 *columns = m_instances[iInstanceIndex].worldMatrixColumns;
+	return XMMatrixTranspose(XMMATRIX(XMLoadFloat4(&columns[0]), XMLoadFloat4(&columns[1]), XMLoadFloat4(&columns[2]), g_XMIdentityR3));
+}
+
+bool Mesh::CreateVertexBuffer(ID3D11Device *pDevice, const Vertex *vertices, int iVertexCount)
+{
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;							// Require read and write access by the GPU
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;				// Bind the buffer as a vertex buffer to the input assembler stage
+	bufferDesc.CPUAccessFlags = 0;									// No CPU access is necessary
+
+	D3D11_SUBRESOURCE_DATA subresourceData = {}; // Data that will be copied to the buffer during creation
+
+	std::vector<QuantizedVertex> quantizedVertices;
+	if (m_vertexFormat == QuantizedVertexFormat)
+	{
+		// Positions are stored relative to the mesh bounds, which the vertex shader uses to decode them
+		// Encoding is the only step that needs the vertices in a vector, the full precision path uses them in place
+		std::vector<Vertex> sourceVertices(vertices, vertices + iVertexCount);
+		m_quantizationBounds = VertexQuantization::ComputeBounds(m_boundingBox);
+		VertexQuantization::Encode(sourceVertices, m_quantizationBounds, quantizedVertices);
+
+#ifdef _DEBUG
+		if (!VertexQuantization::ValidateEncoding(sourceVertices, quantizedVertices, m_quantizationBounds))
+		{
+			OutputDebugStringA("Quantized mesh vertices exceed the expected encoding error.\n");
+		}
+#endif
+
+		bufferDesc.ByteWidth = sizeof(QuantizedVertex) * quantizedVertices.size();
+		subresourceData.pSysMem = quantizedVertices.data();
+	}
+	else
+	{
+		bufferDesc.ByteWidth = sizeof(Vertex) * iVertexCount;
+		subresourceData.pSysMem = vertices;
+	}
+
+	// Meshes are built on the loading threads, only the buffer creation runs on the device thread
+	HRESULT result = E_FAIL;
+	TaskGraph::RunOnDeviceThread([&] { result = pDevice->CreateBuffer(&bufferDesc, &subresourceData, &m_pVertexBuffer); });
+	if (FAILED(result))
+	{
+		Utils::ShowError("Failed to create mesh vertex buffer.", result);
+		return false;
 	}
 
 	return true;
@@ -109,6 +348,18 @@ bool Mesh::InitializeBuffers(ID3D11Device *pDevice, std::vector<Vertex> &vertice
 
 void Mesh::SetTextures(std::vector<ID3D11ShaderResourceView*> textures)
 {
+	// The mesh holds a reference to each of its textures
+	for (auto &texture : textures)
+	{
+		if (texture != nullptr)
+		{
+			texture->AddRef();
+		}
+	}
+	for (auto &texture : m_textures)
+	{
+		SAFE_RELEASE(texture);
+	}
 	m_textures = textures;
 }
 
@@ -119,7 +370,86 @@ std::vector<ID3D11ShaderResourceView*> Mesh::GetTextures()
 
 int Mesh::GetIndexCount()
 {
-	return m_iIndexCount;
+	return m_lods.empty() ? m_iIndexCount : m_lods[m_iCurrentLod].iIndexCount;
+}
+
+int Mesh::GetStartIndex()
+{
+	return m_lods.empty() ? 0 : m_lods[m_iCurrentLod].iStartIndex;
+}
+
+void Mesh::SetLods(std::vector<std::vector<DWORD>> lodIndices, std::vector<float> maxScreenCoverages)
+{
+	// Must be called before the buffers are initialized
+	m_lodIndices = lodIndices;
+	m_lods.clear();
+	for (size_t i = 0; i < lodIndices.size(); i++)
+	{
+		m_lods.push_back({ 0, (int)lodIndices[i].size(), maxScreenCoverages[i] });
+	}
+}
+
+int Mesh::GetLodCount()
+{
+	return m_lods.size();
+}
+
+int Mesh::GetCurrentLod()
+{
+	return m_iCurrentLod;
+}
+
+void Mesh::SetMeshletsEnabled(bool bEnabled)
+{
+	// Must be called before the buffers are initialized
+	m_bMeshletsEnabled = bEnabled;
+}
+
+int Mesh::GetMeshletCount()
+{
+	return m_meshlets.size();
+}
+
+UINT Mesh::GetGeometryByteSize()
+{
+	D3D11_BUFFER_DESC vertexBufferDesc = {};
+	D3D11_BUFFER_DESC indexBufferDesc = {};
+	if (m_pVertexBuffer != nullptr)
+	{
+		m_pVertexBuffer->GetDesc(&vertexBufferDesc);
+	}
+	if (m_pIndexBuffer != nullptr)
+	{
+		m_pIndexBuffer->GetDesc(&indexBufferDesc);
+	}
+	return vertexBufferDesc.ByteWidth + indexBufferDesc.ByteWidth;
+}
+
+void Mesh::ReleaseCpuInstances()
+{
+	if (m_meshlets.empty() && !m_bIsInstanceBufferDirty)
+	{
+		m_instances.clear();
+		m_instances.shrink_to_fit();
+	}
+}
+
+void Mesh::TrackResidency(ResidencyTracker &tracker, const std::string &strAssetName)
+{
+	tracker.AddCpuBytes(strAssetName, IndexResidency, sizeof(Meshlet) * m_meshlets.size());
+	tracker.AddCpuBytes(strAssetName, InstanceResidency, sizeof(PackedInstance) * m_instances.size());
+	tracker.AddBuffer(strAssetName, VertexResidency, m_pVertexBuffer);
+	tracker.AddBuffer(strAssetName, IndexResidency, m_pIndexBuffer);
+	tracker.AddBuffer(strAssetName, InstanceResidency, m_pInstanceBuffer);
+	for (auto pTexture : m_textures)
+	{
+		tracker.AddTexture(strAssetName, pTexture);
+	}
+}
+
+std::vector<IndexRange> Mesh::GetDrawRanges()
+{
+	return m_drawRanges;
 }
 
 int Mesh::GetInstanceCount()
@@ -130,29 +460,181 @@ int Mesh::GetInstanceCount()
 void Mesh::SetWorldMatrix(XMMATRIX worldMatrix)
 {
 	m_worldMatrix = worldMatrix;
-	if (m_pInstances != nullptr)
+	if (m_pInstanceBuffer != nullptr)
 	{
+		// Every instance moves to the same place, so released instances are packed again
+		m_instances.resize(m_iInstanceCount);
 		for (int i = 0; i < m_iInstanceCount; i++)
 		{
-			m_pInstances[i].worldMatrix = m_transformMatrix * worldMatrix;
+			SetInstanceWorldMatrix(i, m_transformMatrix * worldMatrix);
 		}
+		m_bIsInstanceBufferDirty = true;
+		UpdateInstanceBounds();
 	}
 }
 
+XMMATRIX Mesh::GetTransformMatrix()
+{
+	return m_transformMatrix;
+}
+
 XMMATRIX Mesh::GetWorldMatrix()
 {
 	return m_transformMatrix * m_worldMatrix;
 }
 
+BoundingBox Mesh::GetBoundingBox()
+{
+	return m_boundingBox;
+}
+
+BoundingSphere Mesh::GetBoundingSphere()
+{
+	return m_boundingSphere;
+}
+
+BoundingBox Mesh::GetWorldBoundingBox()
+{
+	BoundingBox worldBoundingBox;
+	m_boundingBox.Transform(worldBoundingBox, GetWorldMatrix());
+	return worldBoundingBox;
+}
+
+BoundingSphere Mesh::GetWorldBoundingSphere()
+{
+	BoundingSphere worldBoundingSphere;
+	m_boundingSphere.Transform(worldBoundingSphere, GetWorldMatrix());
+	return worldBoundingSphere;
+}
+
+BoundingBox Mesh::GetInstanceBoundingBox(int iInstanceIndex)
+{
+	if (m_instanceBoundingBoxes.empty())
+	{
+		return GetWorldBoundingBox();
+	}
+	return m_instanceBoundingBoxes[iInstanceIndex];
+}
+
+BoundingSphere Mesh::GetInstanceBoundingSphere(int iInstanceIndex)
+{
+	if (m_instanceBoundingSpheres.empty())
+	{
+		return GetWorldBoundingSphere();
+	}
+	return m_instanceBoundingSpheres[iInstanceIndex];
+}
+
+VertexFormat Mesh::GetVertexFormat()
+{
+	return m_vertexFormat;
+}
+
+QuantizationBounds Mesh::GetQuantizationBounds()
+{
+	return m_quantizationBounds;
+}
+
 #pragma endregion
 
 #pragma region Render
 
+void Mesh::SelectLod(Camera *pCamera)
+{
+	if (m_lods.size() <= 1)
+	{
+		m_drawRanges = { { GetStartIndex(), GetIndexCount() } };
+		return;
+	}
+
+	// Screen coverage is the projected diameter of the bounding sphere as a fraction of the screen height
+	// (the largest instance decides the LOD of every instance since they are drawn together)
+	XMFLOAT3 cameraPosition = pCamera->GetPosition();
+	XMVECTOR vCameraPosition = XMLoadFloat3(&cameraPosition);
+	XMFLOAT4X4 projectionMatrix;
+	XMStoreFloat4x4(&projectionMatrix, pCamera->GetProjectionMatrix());
+
+	float fScreenCoverage = 0.0f;
+	int iSphereCount = max(m_iInstanceCount, 1);
+	for (int i = 0; i < iSphereCount; i++)
+	{
+		BoundingSphere boundingSphere = GetInstanceBoundingSphere(i);
+		float fDistance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&boundingSphere.Center) - vCameraPosition));
+		if (fDistance <= boundingSphere.Radius)
+		{
+			fScreenCoverage = FLT_MAX;
+			break;
+		}
+		fScreenCoverage = max(fScreenCoverage, boundingSphere.Radius * projectionMatrix._22 / fDistance);
+	}
+
+	// Use the least detailed LOD that is allowed at this coverage
+	m_iCurrentLod = 0;
+	for (int i = m_lods.size() - 1; i > 0; i--)
+	{
+		if (fScreenCoverage <= m_lods[i].fMaxScreenCoverage)
+		{
+			m_iCurrentLod = i;
+			break;
+		}
+	}
+
+	m_drawRanges = { { GetStartIndex(), GetIndexCount() } };
+}
+
+void Mesh::CullMeshlets(Camera *pCamera)
+{
+	// Simplified LODs are not partitioned and are drawn whole
+	if (m_meshlets.empty() || m_iCurrentLod != 0)
+	{
+		m_drawRanges = { { GetStartIndex(), GetIndexCount() } };
+		return;
+	}
+
+	BoundingFrustum frustum(pCamera->GetProjectionMatrix());
+	frustum.Transform(frustum, XMMatrixInverse(nullptr, pCamera->GetViewMatrix()));
+	XMFLOAT3 cameraPosition = pCamera->GetPosition();
+	XMVECTOR vCameraPosition = XMLoadFloat3(&cameraPosition);
+
+	m_drawRanges.clear();
+	for (auto &meshlet : m_meshlets)
+	{
+		// Instances share the index buffer, so a meshlet is drawn if any instance can see it
+		bool bIsVisible = false;
+		if (m_instances.empty())
+		{
+			bIsVisible = MeshletBuilder::IsVisible(meshlet, GetWorldMatrix(), frustum, vCameraPosition);
+		}
+		else
+		{
+			for (int i = 0; i < m_iInstanceCount && !bIsVisible; i++)
+			{
+				bIsVisible = MeshletBuilder::IsVisible(meshlet, GetInstanceWorldMatrix(i), frustum, vCameraPosition);
+			}
+		}
+
+		if (!bIsVisible)
+		{
+			continue;
+		}
+
+		// Merge adjacent visible meshlets into one draw
+		if (!m_drawRanges.empty() && m_drawRanges.back().iStartIndex + m_drawRanges.back().iIndexCount == meshlet.iStartIndex)
+		{
+			m_drawRanges.back().iIndexCount += meshlet.iIndexCount;
+		}
+		else
+		{
+			m_drawRanges.push_back({ meshlet.iStartIndex, meshlet.iIndexCount });
+		}
+	}
+}
+
 void Mesh::Render(ID3D11DeviceContext *pImmediateContext)
 {
-	if (m_pInstances != nullptr)
+	if (m_bIsInstanceBufferDirty)
 	{
-		// Update the instance buffer
+		// Update the instance buffer (only after the instances have moved)
 
 		// Lock the instance buffer so it can be written to
 		D3D11_MAPPED_SUBRESOURCE mappedResource;
@@ -163,17 +645,21 @@ void Mesh::Render(ID3D11DeviceContext *pImmediateContext)
 		}
 
 		// Copy the instances into the instance buffer
-		memcpy(mappedResource.pData, m_pInstances, sizeof(Instance) * m_iInstanceCount);
+		memcpy(mappedResource.pData, m_instances.data(), sizeof(PackedInstance) * m_iInstanceCount);
 
 		// Unlock the instance buffer
 		pImmediateContext->Unmap(m_pInstanceBuffer, 0);
+
+		m_bIsInstanceBufferDirty = false;
 	}
 
 	// Set the vertex and index buffers to active in the input assembler so they can be rendered (put them on the graphics pipeline)
 
+	UINT uiVertexStride = m_vertexFormat == QuantizedVertexFormat ? sizeof(QuantizedVertex) : sizeof(Vertex);
+
 	if (m_iInstanceCount == 1)
 	{
-		UINT uiStrides = sizeof(Vertex);
+		UINT uiStrides = uiVertexStride;
 		UINT uiOffsets = 0;
 
 		pImmediateContext->IASetVertexBuffers(0,				// First input slot for binding
@@ -185,8 +671,8 @@ void Mesh::Render(ID3D11DeviceContext *pImmediateContext)
 	else
 	{
 		UINT strides[2];
-		strides[0] = sizeof(Vertex);
-		strides[1] = sizeof(Instance);
+		strides[0] = uiVertexStride;
+		strides[1] = sizeof(PackedInstance);
 
 		UINT offsets[2];
 		offsets[0] = 0;
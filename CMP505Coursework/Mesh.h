@@ -11,26 +11,75 @@
 #include <vector>
 #include <d3d11.h>
 #include <directxmath.h>
+#include <DirectXCollision.h>
 #include "TxtModel.h"
+#include "VertexQuantization.h"
+#include "MeshletBuilder.h"
+#include "CookedMesh.h"
+#include "TaskGraph.h"
+#include "Camera.h"
 #include "Utils.h"
 
 using namespace DirectX;
 
+struct MeshLod
+{
+	int iStartIndex;					// Offset of the LOD in the shared index buffer
+	int iIndexCount;
+	float fMaxScreenCoverage;			// Largest projected diameter (fraction of the screen height) the LOD is used for
+};
+
+struct IndexRange
+{
+	int iStartIndex;
+	int iIndexCount;
+};
+
 class Mesh
 {
 public:
-	Mesh(std::vector<ID3D11ShaderResourceView*> &textures, XMMATRIX transformMatrix);
+	Mesh(std::vector<ID3D11ShaderResourceView*> &textures, XMMATRIX transformMatrix, VertexFormat vertexFormat = FullPrecisionVertexFormat);
 	~Mesh();
 
 	void SetTextures(std::vector<ID3D11ShaderResourceView*> textures);
 	std::vector<ID3D11ShaderResourceView*> GetTextures();
 	int GetIndexCount();
+	int GetStartIndex();
+	void SetLods(std::vector<std::vector<DWORD>> lodIndices, std::vector<float> maxScreenCoverages);
+	int GetLodCount();
+	int GetCurrentLod();
+	void SetMeshletsEnabled(bool bEnabled);
+	int GetMeshletCount();
+	std::vector<IndexRange> GetDrawRanges();
 	int GetInstanceCount();
 	void SetWorldMatrix(XMMATRIX worldMatrix);
+	XMMATRIX GetTransformMatrix();
 	XMMATRIX GetWorldMatrix();
+	BoundingBox GetBoundingBox();
+	BoundingSphere GetBoundingSphere();
+	BoundingBox GetWorldBoundingBox();
+	BoundingSphere GetWorldBoundingSphere();
+	BoundingBox GetInstanceBoundingBox(int iInstanceIndex);
+	BoundingSphere GetInstanceBoundingSphere(int iInstanceIndex);
+	VertexFormat GetVertexFormat();
+	QuantizationBounds GetQuantizationBounds();
 
+	// pIndexBufferData receives the indices of every LOD as they are stored in the index buffer (used for cooking)
 	bool InitializeBuffers(ID3D11Device *pDevice, std::vector<Vertex> &vertices, std::vector<DWORD> &indices, 
+						   int iInstanceCount, Instance *instances = nullptr, std::vector<DWORD> *pIndexBufferData = nullptr);
+	// Creates the buffers straight from a mapped cooked mesh (the LODs, meshlets and bounds are read from the file)
+	bool InitializeBuffers(ID3D11Device *pDevice, CookedMeshFile &cookedMeshFile, const CookedSubmesh &submesh, 
 						   int iInstanceCount, Instance *instances = nullptr);
+	void GetCookedSubmesh(CookedSubmesh &submesh, std::vector<CookedMeshlet> &meshlets);
+	// Shares the vertex and index buffers (and the LODs, meshlets and bounds) of a mesh loaded from the same file
+	bool InitializeSharedBuffers(ID3D11Device *pDevice, Mesh *pSourceMesh, int iInstanceCount, Instance *instances = nullptr);
+	UINT GetGeometryByteSize();
+	// Frees the CPU copy of the instances unless the meshlet culling reads them (moving the mesh packs them again)
+	void ReleaseCpuInstances();
+	// The meshlets are counted as index memory, since they partition the index buffer
+	void TrackResidency(ResidencyTracker &tracker, const std::string &strAssetName);
+	void SelectLod(Camera *pCamera);
+	void CullMeshlets(Camera *pCamera);
 	void Render(ID3D11DeviceContext *pImmediateContext);
 
 private:
@@ -38,9 +87,31 @@ private:
 	ID3D11Buffer *m_pVertexBuffer;
 	ID3D11Buffer *m_pIndexBuffer;
 	int m_iIndexCount;
+	std::vector<std::vector<DWORD>> m_lodIndices;		// Only kept until the index buffer is created
+	std::vector<MeshLod> m_lods;						// Ordered from the most to the least detailed
+	int m_iCurrentLod;
+	bool m_bMeshletsEnabled;
+	std::vector<Meshlet> m_meshlets;					// Partition the full detail LOD
+	std::vector<IndexRange> m_drawRanges;				// Visible part of the current LOD
 	ID3D11Buffer *m_pInstanceBuffer;
-	Instance *m_pInstances;
+	std::vector<PackedInstance> m_instances;			// Empty for a single instance, or once released
+	bool m_bIsInstanceBufferDirty;
 	int m_iInstanceCount;
 	XMMATRIX m_worldMatrix;
 	XMMATRIX m_transformMatrix;
+	BoundingBox m_boundingBox;							// Object space
+	BoundingSphere m_boundingSphere;
+	std::vector<BoundingBox> m_instanceBoundingBoxes;	// World space
+	std::vector<BoundingSphere> m_instanceBoundingSpheres;
+	VertexFormat m_vertexFormat;
+	QuantizationBounds m_quantizationBounds;
+
+	void ComputeBounds(std::vector<Vertex> &vertices);
+	void SetInstanceWorldMatrix(int iInstanceIndex, XMMATRIX transposedWorldMatrix);
+	XMMATRIX GetInstanceWorldMatrix(int iInstanceIndex);
+	void UpdateInstanceBounds();
+	bool CreateBuffers(ID3D11Device *pDevice, const Vertex *vertices, int iVertexCount, const DWORD *indices, 
+					   int iInstanceCount, Instance *instances);
+	bool CreateVertexBuffer(ID3D11Device *pDevice, const Vertex *vertices, int iVertexCount);
+	bool CreateInstanceBuffer(ID3D11Device *pDevice, int iInstanceCount, Instance *instances);
 };
@@ -0,0 +1,714 @@
+//
+// MeshCodec.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+// Compressing Index and Vertex Buffers (https://zeux.io/2017/08/08/quantization-with-meshoptimizer/)
+//
+
+#include <cstring>
+#include "MeshCodec.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+#define EDGE_FIFO_SIZE 16
+#define VERTEX_FIFO_SIZE 16
+#define MAX_FIFO_DISTANCE 14				// Edge distances 0-14 fit the code's high nibble (15 is a triangle without a shared edge)
+#define VERTEX_GROUP_SIZE 16
+#define MAX_VERTEX_BLOCK_BYTES 8192			// The decoder keeps a block of byte deltas on the stack
+
+namespace
+{
+	// Index codec
+
+	// Vertex references: 0 is the next new vertex, 1-14 a recent vertex, 15 (or more in the data stream) a delta from the last vertex
+	enum VertexReference : uint32_t
+	{
+		NextVertexReference = 0,
+		ExplicitVertexReference = 15
+	};
+
+	struct IndexCodecState
+	{
+		uint32_t edgeFifo[EDGE_FIFO_SIZE][2];
+		uint32_t vertexFifo[VERTEX_FIFO_SIZE];
+		uint32_t uiEdgeOffset;
+		uint32_t uiVertexOffset;
+		uint32_t uiNextVertex;
+		uint32_t uiLastVertex;
+
+		IndexCodecState()
+		{
+			memset(edgeFifo, 0xFF, sizeof(edgeFifo));
+			memset(vertexFifo, 0xFF, sizeof(vertexFifo));
+			uiEdgeOffset = 0;
+			uiVertexOffset = 0;
+			uiNextVertex = 0;
+			uiLastVertex = 0;
+		}
+
+		void PushEdge(uint32_t a, uint32_t b)
+		{
+			edgeFifo[uiEdgeOffset % EDGE_FIFO_SIZE][0] = a;
+			edgeFifo[uiEdgeOffset % EDGE_FIFO_SIZE][1] = b;
+			uiEdgeOffset++;
+		}
+
+		void PushVertex(uint32_t v)
+		{
+			vertexFifo[uiVertexOffset % VERTEX_FIFO_SIZE] = v;
+			uiVertexOffset++;
+		}
+
+		const uint32_t* GetEdge(uint32_t uiDistance)
+		{
+			return edgeFifo[(uiEdgeOffset - 1 - uiDistance) % EDGE_FIFO_SIZE];
+		}
+
+		uint32_t GetVertex(uint32_t uiDistance)
+		{
+			return vertexFifo[(uiVertexOffset - 1 - uiDistance) % VERTEX_FIFO_SIZE];
+		}
+
+		// Neighbouring triangles wind the edge they share in opposite directions, so an edge is found in the FIFO reversed
+		int FindEdge(uint32_t a, uint32_t b)
+		{
+			for (uint32_t i = 0; i <= MAX_FIFO_DISTANCE; i++)
+			{
+				const uint32_t *edge = GetEdge(i);
+				if (edge[0] == a && edge[1] == b)
+				{
+					return i;
+				}
+			}
+			return -1;
+		}
+
+		// Returns the reference, and the delta to write for an explicit reference
+		uint32_t EncodeVertex(uint32_t v, int32_t &delta)
+		{
+			uint32_t reference = ExplicitVertexReference;
+			if (v == uiNextVertex)
+			{
+				reference = NextVertexReference;
+				uiNextVertex++;
+				PushVertex(v);
+			}
+			else
+			{
+				for (uint32_t i = 0; i < MAX_FIFO_DISTANCE; i++)
+				{
+					if (GetVertex(i) == v)
+					{
+						reference = 1 + i;
+						break;
+					}
+				}
+				if (reference == ExplicitVertexReference)
+				{
+					delta = static_cast<int32_t>(v - uiLastVertex);
+					PushVertex(v);
+				}
+			}
+			uiLastVertex = v;
+			return reference;
+		}
+
+		uint32_t DecodeVertex(uint32_t reference, int32_t delta)
+		{
+			uint32_t v;
+			if (reference == NextVertexReference)
+			{
+				v = uiNextVertex++;
+				PushVertex(v);
+			}
+			else if (reference < ExplicitVertexReference)
+			{
+				v = GetVertex(reference - 1);
+			}
+			else
+			{
+				v = uiLastVertex + static_cast<uint32_t>(delta);
+				PushVertex(v);
+			}
+			uiLastVertex = v;
+			return v;
+		}
+	};
+
+	void WriteVarint(std::vector<uint8_t> &output, uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			output.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		output.push_back(static_cast<uint8_t>(value));
+	}
+
+	bool ReadVarint(const uint8_t *&pData, const uint8_t *pEnd, uint32_t &value)
+	{
+		value = 0;
+		for (int iShift = 0; iShift < 35; iShift += 7)
+		{
+			if (pData == pEnd)
+			{
+				return false;
+			}
+			uint8_t byte = *pData++;
+			value |= static_cast<uint32_t>(byte & 0x7F) << iShift;
+			if (byte < 0x80)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uint32_t EncodeZigzag(int32_t value)
+	{
+		return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+	}
+
+	int32_t DecodeZigzag(uint32_t value)
+	{
+		return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+	}
+
+	// A vertex in the data stream: the reference, or 15 plus the zigzag delta for an explicit vertex
+	void WriteVertexReference(std::vector<uint8_t> &data, uint32_t reference, int32_t delta)
+	{
+		WriteVarint(data, reference == ExplicitVertexReference ? ExplicitVertexReference + EncodeZigzag(delta) : reference);
+	}
+
+	bool ReadVertexReference(const uint8_t *&pData, const uint8_t *pEnd, uint32_t &reference, int32_t &delta)
+	{
+		uint32_t value;
+		if (!ReadVarint(pData, pEnd, value))
+		{
+			return false;
+		}
+		reference = value < ExplicitVertexReference ? value : ExplicitVertexReference;
+		delta = value < ExplicitVertexReference ? 0 : DecodeZigzag(value - ExplicitVertexReference);
+		return true;
+	}
+
+	// Vertex codec
+
+	enum GroupMode : uint8_t
+	{
+		ZeroGroupMode = 0,					// All 16 deltas are 0
+		TwoBitGroupMode,					// 4 bytes, and a byte for each delta of 3 or more
+		FourBitGroupMode,					// 8 bytes, and a byte for each delta of 15 or more
+		ByteGroupMode						// 16 bytes
+	};
+
+	size_t GetVertexBlockSize(size_t vertexSize)
+	{
+		size_t blockSize = (MAX_VERTEX_BLOCK_BYTES / vertexSize) & ~size_t(VERTEX_GROUP_SIZE - 1);
+		return blockSize < 256 ? blockSize : 256;
+	}
+
+	// Small deltas in either direction become small values (0, -1, 1, -2... become 0, 1, 2, 3...)
+	uint8_t EncodeByteZigzag(uint8_t delta)
+	{
+		return static_cast<uint8_t>((delta & 0x80) ? ~(delta << 1) : (delta << 1));
+	}
+
+#ifdef MESH_CODEC_SSE2
+	// Undoes the zigzag of 16 deltas of one byte of the vertex and sums them onto the previous value (broadcast to every byte)
+	// The sum is a prefix sum in the register: the register is added to itself shifted by 1, 2, 4 and 8 bytes
+	__m128i DecodeLane(const uint8_t *pDeltas, __m128i &previous)
+	{
+		const __m128i one = _mm_set1_epi8(1);
+		const __m128i lowBits = _mm_set1_epi8(0x7F);
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pDeltas));
+		values = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(values, 1), lowBits), _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(values, one)));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 1));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 2));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 4));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 8));
+		values = _mm_add_epi8(values, previous);
+
+		// The last byte is the previous value of the next group
+		previous = _mm_unpackhi_epi8(values, values);
+		previous = _mm_unpackhi_epi16(previous, previous);
+		previous = _mm_shuffle_epi32(previous, 0xFF);
+		return values;
+	}
+
+	// Turns 16 registers of one byte of 16 vertices into 16 registers of 16 bytes of one vertex
+	// (interleaving the first and second half of the registers 4 times transposes the bytes)
+	void Transpose16x16(__m128i rows[16])
+	{
+		for (int iRound = 0; iRound < 4; iRound++)
+		{
+			__m128i interleaved[16];
+			for (int i = 0; i < 8; i++)
+			{
+				interleaved[i * 2] = _mm_unpacklo_epi8(rows[i], rows[i + 8]);
+				interleaved[i * 2 + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 8]);
+			}
+			for (int i = 0; i < 16; i++)
+			{
+				rows[i] = interleaved[i];
+			}
+		}
+	}
+#else
+	uint8_t DecodeByteZigzag(uint8_t value)
+	{
+		return static_cast<uint8_t>((value >> 1) ^ -(value & 1));
+	}
+#endif
+
+	void EncodeGroup(const uint8_t deltas[VERTEX_GROUP_SIZE], std::vector<uint8_t> &output, uint8_t &mode)
+	{
+		int iTwoBitEscapes = 0;
+		int iFourBitEscapes = 0;
+		bool bIsZero = true;
+		for (int i = 0; i < VERTEX_GROUP_SIZE; i++)
+		{
+			bIsZero = bIsZero && deltas[i] == 0;
+			iTwoBitEscapes += deltas[i] >= 3 ? 1 : 0;
+			iFourBitEscapes += deltas[i] >= 15 ? 1 : 0;
+		}
+
+		int iTwoBitSize = 4 + iTwoBitEscapes;
+		int iFourBitSize = 8 + iFourBitEscapes;
+		if (bIsZero)
+		{
+			mode = ZeroGroupMode;
+		}
+		else if (iTwoBitSize <= iFourBitSize && iTwoBitSize < VERTEX_GROUP_SIZE)
+		{
+			mode = TwoBitGroupMode;
+			for (int i = 0; i < VERTEX_GROUP_SIZE; i += 4)
+			{
+				uint8_t packed = 0;
+				for (int j = 0; j < 4; j++)
+				{
+					packed |= static_cast<uint8_t>((deltas[i + j] < 3 ? deltas[i + j] : 3) << (j * 2));
+				}
+				output.push_back(packed);
+			}
+			for (int i = 0; i < VERTEX_GROUP_SIZE; i++)
+			{
+				if (deltas[i] >= 3)
+				{
+					output.push_back(deltas[i]);
+				}
+			}
+		}
+		else if (iFourBitSize < VERTEX_GROUP_SIZE)
+		{
+			mode = FourBitGroupMode;
+			for (int i = 0; i < VERTEX_GROUP_SIZE; i += 2)
+			{
+				uint8_t low = deltas[i] < 15 ? deltas[i] : 15;
+				uint8_t high = deltas[i + 1] < 15 ? deltas[i + 1] : 15;
+				output.push_back(static_cast<uint8_t>(low | (high << 4)));
+			}
+			for (int i = 0; i < VERTEX_GROUP_SIZE; i++)
+			{
+				if (deltas[i] >= 15)
+				{
+					output.push_back(deltas[i]);
+				}
+			}
+		}
+		else
+		{
+			mode = ByteGroupMode;
+			output.insert(output.end(), deltas, deltas + VERTEX_GROUP_SIZE);
+		}
+	}
+
+	// The mask must not be 0
+	int GetLowestBitIndex(int iMask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, static_cast<unsigned long>(iMask));
+		return static_cast<int>(index);
+#else
+		return __builtin_ctz(static_cast<unsigned int>(iMask));
+#endif
+	}
+
+	// Unpacks a group's deltas (still zigzag encoded), returns nullptr if the data ends early
+	const uint8_t* DecodeGroup(const uint8_t *pData, const uint8_t *pEnd, uint8_t mode, uint8_t deltas[VERTEX_GROUP_SIZE])
+	{
+		static const size_t packedSizes[] = { 0, 4, 8, 16 };
+		if (static_cast<size_t>(pEnd - pData) < packedSizes[mode])
+		{
+			return nullptr;
+		}
+
+		uint8_t escape = mode == TwoBitGroupMode ? 3 : 15;
+		int iEscapeMask = 0;
+#ifdef MESH_CODEC_SSE2
+		__m128i values;
+		if (mode == ZeroGroupMode)
+		{
+			values = _mm_setzero_si128();
+		}
+		else if (mode == TwoBitGroupMode)
+		{
+			int packed;
+			memcpy(&packed, pData, sizeof(packed));
+			__m128i bytes = _mm_cvtsi32_si128(packed);
+			__m128i mask = _mm_set1_epi8(3);
+			__m128i bits0 = _mm_and_si128(bytes, mask);
+			__m128i bits2 = _mm_and_si128(_mm_srli_epi16(bytes, 2), mask);
+			__m128i bits4 = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+			__m128i bits6 = _mm_and_si128(_mm_srli_epi16(bytes, 6), mask);
+			values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bits0, bits2), _mm_unpacklo_epi8(bits4, bits6));
+		}
+		else if (mode == FourBitGroupMode)
+		{
+			__m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pData));
+			__m128i mask = _mm_set1_epi8(15);
+			values = _mm_unpacklo_epi8(_mm_and_si128(bytes, mask), _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+		}
+		else
+		{
+			values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(deltas), values);
+		if (mode == TwoBitGroupMode || mode == FourBitGroupMode)
+		{
+			iEscapeMask = _mm_movemask_epi8(_mm_cmpeq_epi8(values, _mm_set1_epi8(static_cast<char>(escape))));
+		}
+#else
+		for (int i = 0; i < VERTEX_GROUP_SIZE; i++)
+		{
+			switch (mode)
+			{
+			case ZeroGroupMode:
+				deltas[i] = 0;
+				break;
+			case TwoBitGroupMode:
+				deltas[i] = (pData[i / 4] >> ((i % 4) * 2)) & 3;
+				break;
+			case FourBitGroupMode:
+				deltas[i] = (pData[i / 2] >> ((i % 2) * 4)) & 15;
+				break;
+			default:
+				deltas[i] = pData[i];
+			}
+			iEscapeMask |= (mode == TwoBitGroupMode || mode == FourBitGroupMode) && deltas[i] == escape ? 1 << i : 0;
+		}
+#endif
+		pData += packedSizes[mode];
+
+		// Escaped deltas follow the packed ones, in order (only the escaped positions are visited, clearing the lowest bit each time)
+		for (; iEscapeMask != 0; iEscapeMask &= iEscapeMask - 1)
+		{
+			if (pData == pEnd)
+			{
+				return nullptr;
+			}
+			deltas[GetLowestBitIndex(iEscapeMask)] = *pData++;
+		}
+
+		return pData;
+	}
+}
+
+#pragma region Indices
+
+void MeshCodec::EncodeIndices(const uint32_t *pIndices, size_t indexCount, std::vector<uint8_t> &output)
+{
+	// Header, then a code byte per triangle, then the data the codes refer to (varints)
+	size_t triangleCount = indexCount / 3;
+	output.assign(1 + triangleCount, 0);
+	output[0] = MESH_CODEC_INDEX_HEADER;
+
+	IndexCodecState state;
+	std::vector<uint8_t> data;
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		uint32_t a = pIndices[i * 3];
+		uint32_t b = pIndices[i * 3 + 1];
+		uint32_t c = pIndices[i * 3 + 2];
+
+		// Rotate the triangle so the edge shared with the most recent triangle comes first
+		int iEdgeDistance = -1;
+		uint32_t triangle[3] = { a, b, c };
+		uint32_t rotations[3][3] = { { a, b, c }, { b, c, a }, { c, a, b } };
+		for (auto &rotation : rotations)
+		{
+			int iDistance = state.FindEdge(rotation[0], rotation[1]);
+			if (iDistance >= 0 && (iEdgeDistance < 0 || iDistance < iEdgeDistance))
+			{
+				iEdgeDistance = iDistance;
+				memcpy(triangle, rotation, sizeof(triangle));
+			}
+		}
+
+		int32_t delta = 0;
+		if (iEdgeDistance >= 0)
+		{
+			uint32_t reference = state.EncodeVertex(triangle[2], delta);
+			output[1 + i] = static_cast<uint8_t>((iEdgeDistance << 4) | reference);
+			if (reference == ExplicitVertexReference)
+			{
+				WriteVarint(data, EncodeZigzag(delta));
+			}
+			state.PushEdge(triangle[2], triangle[1]);
+			state.PushEdge(triangle[0], triangle[2]);
+		}
+		else
+		{
+			output[1 + i] = 0xF0;
+			for (int j = 0; j < 3; j++)
+			{
+				uint32_t reference = state.EncodeVertex(triangle[j], delta);
+				WriteVertexReference(data, reference, delta);
+			}
+			state.PushEdge(b, a);
+			state.PushEdge(c, b);
+			state.PushEdge(a, c);
+		}
+	}
+
+	output.insert(output.end(), data.begin(), data.end());
+}
+
+bool MeshCodec::DecodeIndices(const uint8_t *pData, size_t size, uint32_t *pIndices, size_t indexCount, uint32_t uiVertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (indexCount % 3 != 0 || size < 1 + triangleCount || pData[0] != MESH_CODEC_INDEX_HEADER)
+	{
+		return false;
+	}
+
+	const uint8_t *pCodes = pData + 1;
+	const uint8_t *pStream = pCodes + triangleCount;
+	const uint8_t *pEnd = pData + size;
+	IndexCodecState state;
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		uint8_t code = pCodes[i];
+		uint32_t *triangle = pIndices + i * 3;
+		int32_t delta = 0;
+		if ((code >> 4) <= MAX_FIFO_DISTANCE)
+		{
+			const uint32_t *edge = state.GetEdge(code >> 4);
+			uint32_t reference = code & 15;
+			if (reference == ExplicitVertexReference)
+			{
+				uint32_t value;
+				if (!ReadVarint(pStream, pEnd, value))
+				{
+					return false;
+				}
+				delta = DecodeZigzag(value);
+			}
+			triangle[0] = edge[0];
+			triangle[1] = edge[1];
+			triangle[2] = state.DecodeVertex(reference, delta);
+			state.PushEdge(triangle[2], triangle[1]);
+			state.PushEdge(triangle[0], triangle[2]);
+		}
+		else
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				uint32_t reference;
+				if (!ReadVertexReference(pStream, pEnd, reference, delta))
+				{
+					return false;
+				}
+				triangle[j] = state.DecodeVertex(reference, delta);
+			}
+			state.PushEdge(triangle[1], triangle[0]);
+			state.PushEdge(triangle[2], triangle[1]);
+			state.PushEdge(triangle[0], triangle[2]);
+		}
+
+		// Also catches edges and vertices read from FIFO entries that were never filled
+		if (triangle[0] >= uiVertexCount || triangle[1] >= uiVertexCount || triangle[2] >= uiVertexCount)
+		{
+			return false;
+		}
+	}
+
+	return pStream == pEnd;
+}
+
+#pragma endregion
+
+#pragma region Vertices
+
+void MeshCodec::EncodeVertices(const void *pVertices, size_t vertexCount, size_t vertexSize, std::vector<uint8_t> &output)
+{
+	const uint8_t *pBytes = static_cast<const uint8_t*>(pVertices);
+	output.assign(1, MESH_CODEC_VERTEX_HEADER);
+
+	// Blocks of vertices, each byte of the vertex separately: 2 bits of mode per group of 16 vertices, then the groups
+	size_t blockSize = GetVertexBlockSize(vertexSize);
+	std::vector<uint8_t> previous(vertexSize, 0);
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += blockSize)
+	{
+		size_t blockVertexCount = vertexCount - blockStart < blockSize ? vertexCount - blockStart : blockSize;
+		size_t groupCount = (blockVertexCount + VERTEX_GROUP_SIZE - 1) / VERTEX_GROUP_SIZE;
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			size_t modeOffset = output.size();
+			output.resize(output.size() + (groupCount + 3) / 4, 0);
+			for (size_t g = 0; g < groupCount; g++)
+			{
+				uint8_t deltas[VERTEX_GROUP_SIZE] = {};
+				for (size_t i = 0; i < VERTEX_GROUP_SIZE && g * VERTEX_GROUP_SIZE + i < blockVertexCount; i++)
+				{
+					uint8_t value = pBytes[(blockStart + g * VERTEX_GROUP_SIZE + i) * vertexSize + k];
+					deltas[i] = EncodeByteZigzag(static_cast<uint8_t>(value - previous[k]));
+					previous[k] = value;
+				}
+
+				uint8_t mode;
+				EncodeGroup(deltas, output, mode);
+				output[modeOffset + g / 4] |= static_cast<uint8_t>(mode << ((g % 4) * 2));
+			}
+		}
+	}
+}
+
+bool MeshCodec::DecodeVertices(const uint8_t *pData, size_t size, void *pVertices, size_t vertexCount, size_t vertexSize)
+{
+	if (size < 1 || pData[0] != MESH_CODEC_VERTEX_HEADER || vertexSize % 4 != 0 || vertexSize == 0 || vertexSize > MESH_CODEC_MAX_VERTEX_SIZE)
+	{
+		return false;
+	}
+
+	uint8_t *pBytes = static_cast<uint8_t*>(pVertices);
+	const uint8_t *pEnd = pData + size;
+	pData++;
+
+	// The deltas of a block are unpacked byte by byte of the vertex, then summed and transposed back into vertices
+	uint8_t blockDeltas[MAX_VERTEX_BLOCK_BYTES];
+#ifdef MESH_CODEC_SSE2
+	__m128i previous[MESH_CODEC_MAX_VERTEX_SIZE];		// Each byte of the vertex broadcast to a register
+	for (auto &value : previous)
+	{
+		value = _mm_setzero_si128();
+	}
+#else
+	uint8_t previous[MESH_CODEC_MAX_VERTEX_SIZE] = {};
+#endif
+	size_t blockSize = GetVertexBlockSize(vertexSize);
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += blockSize)
+	{
+		size_t blockVertexCount = vertexCount - blockStart < blockSize ? vertexCount - blockStart : blockSize;
+		size_t groupCount = (blockVertexCount + VERTEX_GROUP_SIZE - 1) / VERTEX_GROUP_SIZE;
+		size_t laneSize = groupCount * VERTEX_GROUP_SIZE;
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			const uint8_t *pModes = pData;
+			pData += (groupCount + 3) / 4;
+			if (pData > pEnd)
+			{
+				return false;
+			}
+			for (size_t g = 0; g < groupCount; g++)
+			{
+				uint8_t mode = (pModes[g / 4] >> ((g % 4) * 2)) & 3;
+				pData = DecodeGroup(pData, pEnd, mode, blockDeltas + k * laneSize + g * VERTEX_GROUP_SIZE);
+				if (pData == nullptr)
+				{
+					return false;
+				}
+			}
+		}
+
+		uint8_t *pBlock = pBytes + blockStart * vertexSize;
+#ifdef MESH_CODEC_SSE2
+		// One group of 16 vertices at a time, so the vertices are written in order
+		for (size_t g = 0; g < groupCount; g++)
+		{
+			uint8_t *pGroup = pBlock + g * VERTEX_GROUP_SIZE * vertexSize;
+			const uint8_t *pGroupDeltas = blockDeltas + g * VERTEX_GROUP_SIZE;
+			size_t groupVertexCount = blockVertexCount - g * VERTEX_GROUP_SIZE;
+			groupVertexCount = groupVertexCount < VERTEX_GROUP_SIZE ? groupVertexCount : VERTEX_GROUP_SIZE;
+
+			// 16 bytes of the vertex at a time, each vertex is written with one store
+			size_t k = 0;
+			for (; k + 16 <= vertexSize; k += 16)
+			{
+				__m128i rows[16];
+				for (int j = 0; j < 16; j++)
+				{
+					rows[j] = DecodeLane(pGroupDeltas + (k + j) * laneSize, previous[k + j]);
+				}
+				Transpose16x16(rows);
+				for (size_t i = 0; i < groupVertexCount; i++)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pGroup + i * vertexSize + k), rows[i]);
+				}
+			}
+
+			// The remaining 4, 8 or 12 bytes 4 at a time: interleaving 4 registers gives 4 vertices per register
+			for (; k < vertexSize; k += 4)
+			{
+				__m128i lanes[4];
+				for (int j = 0; j < 4; j++)
+				{
+					lanes[j] = DecodeLane(pGroupDeltas + (k + j) * laneSize, previous[k + j]);
+				}
+				__m128i pairs01Low = _mm_unpacklo_epi8(lanes[0], lanes[1]);
+				__m128i pairs01High = _mm_unpackhi_epi8(lanes[0], lanes[1]);
+				__m128i pairs23Low = _mm_unpacklo_epi8(lanes[2], lanes[3]);
+				__m128i pairs23High = _mm_unpackhi_epi8(lanes[2], lanes[3]);
+				__m128i vertices[4] =
+				{
+					_mm_unpacklo_epi16(pairs01Low, pairs23Low),
+					_mm_unpackhi_epi16(pairs01Low, pairs23Low),
+					_mm_unpacklo_epi16(pairs01High, pairs23High),
+					_mm_unpackhi_epi16(pairs01High, pairs23High)
+				};
+				for (size_t i = 0; i < groupVertexCount; i++)
+				{
+					// Stores the lowest vertex of the register, then moves the next one down
+					int value = _mm_cvtsi128_si32(vertices[i / 4]);
+					vertices[i / 4] = _mm_srli_si128(vertices[i / 4], 4);
+					memcpy(pGroup + i * vertexSize + k, &value, sizeof(value));
+				}
+			}
+		}
+#else
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			uint8_t value = previous[k];
+			for (size_t i = 0; i < blockVertexCount; i++)
+			{
+				value = static_cast<uint8_t>(value + DecodeByteZigzag(blockDeltas[k * laneSize + i]));
+				pBlock[i * vertexSize + k] = value;
+			}
+			previous[k] = value;
+		}
+#endif
+	}
+
+	return pData == pEnd;
+}
+
+bool MeshCodec::IsVertexDecoderVectorized()
+{
+#ifdef MESH_CODEC_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+#pragma endregion
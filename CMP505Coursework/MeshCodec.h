@@ -0,0 +1,38 @@
+//
+// MeshCodec.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+// Compressing Index and Vertex Buffers (https://zeux.io/2017/08/08/quantization-with-meshoptimizer/)
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define MESH_CODEC_INDEX_HEADER 0xE1
+#define MESH_CODEC_VERTEX_HEADER 0xA1
+#define MESH_CODEC_MAX_VERTEX_SIZE 256
+
+// Lossless codecs for the cooked index and vertex streams, in the style of meshoptimizer's
+// The output is meant to be compressed again (or not) by a general purpose compressor, the codecs remove the redundancy it cannot see
+class MeshCodec
+{
+public:
+	// Triangle lists: each triangle is one code byte when it shares an edge with a recent triangle and uses a new or recent vertex
+	// Triangles keep their order and winding, but may be rotated (their first vertex can change)
+	static void EncodeIndices(const uint32_t *pIndices, size_t indexCount, std::vector<uint8_t> &output);
+	// Fails if the data is not a valid stream or an index is not below the vertex count
+	static bool DecodeIndices(const uint8_t *pData, size_t size, uint32_t *pIndices, size_t indexCount, uint32_t uiVertexCount);
+
+	// Any vertex layout (the size has to be a multiple of 4, up to MESH_CODEC_MAX_VERTEX_SIZE bytes)
+	// Each byte of the vertex is delta coded against the previous vertex and bit packed in groups of 16 vertices
+	// (vertices should be in fetch order, so consecutive vertices are close to each other)
+	static void EncodeVertices(const void *pVertices, size_t vertexCount, size_t vertexSize, std::vector<uint8_t> &output);
+	static bool DecodeVertices(const uint8_t *pData, size_t size, void *pVertices, size_t vertexCount, size_t vertexSize);
+	// True if the vertex decoder uses SSE2 on this build
+	static bool IsVertexDecoderVectorized();
+};
@@ -0,0 +1,372 @@
+//
+// MeshSimplifier.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Surface Simplification Using Quadric Error Metrics (https://www.cs.cmu.edu/~./garland/Papers/quadrics.pdf)
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+//
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <unordered_map>
+#include "MeshSimplifier.h"
+
+#define MIN_FLIP_COSINE 0.25f	// Reject collapses that rotate an adjacent triangle by more than ~75 degrees
+
+namespace
+{
+	struct Quadric
+	{
+		// Symmetric 4x4 matrix of the plane equation ax + by + cz + d = 0
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+		void AddPlane(double a, double b, double c, double d, double fWeight)
+		{
+			a2 += a * a * fWeight; ab += a * b * fWeight; ac += a * c * fWeight; ad += a * d * fWeight;
+			b2 += b * b * fWeight; bc += b * c * fWeight; bd += b * d * fWeight;
+			c2 += c * c * fWeight; cd += c * d * fWeight;
+			d2 += d * d * fWeight;
+		}
+
+		void Add(const Quadric &quadric)
+		{
+			a2 += quadric.a2; ab += quadric.ab; ac += quadric.ac; ad += quadric.ad;
+			b2 += quadric.b2; bc += quadric.bc; bd += quadric.bd;
+			c2 += quadric.c2; cd += quadric.cd;
+			d2 += quadric.d2;
+		}
+
+		double Evaluate(const XMFLOAT3 &p) const
+		{
+			// v^T Q v where v = (x, y, z, 1)
+			double x = p.x, y = p.y, z = p.z;
+			return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				 + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				 + c2 * z * z + 2 * cd * z
+				 + d2;
+		}
+	};
+
+	struct Collapse
+	{
+		DWORD from;
+		DWORD to;
+		double cost;
+	};
+
+	struct VertexHash
+	{
+		const std::vector<Vertex> *pVertices;
+
+		size_t operator()(DWORD index) const
+		{
+			const Vertex &vertex = (*pVertices)[index];
+			const unsigned int *pWords = reinterpret_cast<const unsigned int*>(&vertex);
+			size_t hash = 2166136261u;
+			for (size_t i = 0; i < sizeof(Vertex) / sizeof(unsigned int); i++)
+			{
+				hash = (hash ^ pWords[i]) * 16777619u;
+			}
+			return hash;
+		}
+	};
+
+	struct VertexEqual
+	{
+		const std::vector<Vertex> *pVertices;
+
+		bool operator()(DWORD a, DWORD b) const
+		{
+			return memcmp(&(*pVertices)[a], &(*pVertices)[b], sizeof(Vertex)) == 0;
+		}
+	};
+
+	struct PositionHash
+	{
+		const std::vector<Vertex> *pVertices;
+
+		size_t operator()(DWORD index) const
+		{
+			const XMFLOAT3 &position = (*pVertices)[index].position;
+			const unsigned int *pWords = reinterpret_cast<const unsigned int*>(&position);
+			return ((pWords[0] * 73856093u) ^ (pWords[1] * 19349663u) ^ (pWords[2] * 83492791u));
+		}
+	};
+
+	struct PositionEqual
+	{
+		const std::vector<Vertex> *pVertices;
+
+		bool operator()(DWORD a, DWORD b) const
+		{
+			return memcmp(&(*pVertices)[a].position, &(*pVertices)[b].position, sizeof(XMFLOAT3)) == 0;
+		}
+	};
+
+	XMVECTOR GetTriangleNormal(const XMFLOAT3 &p0, const XMFLOAT3 &p1, const XMFLOAT3 &p2)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&p0);
+		return XMVector3Cross(XMLoadFloat3(&p1) - v0, XMLoadFloat3(&p2) - v0);
+	}
+}
+
+std::vector<DWORD> MeshSimplifier::Simplify(const std::vector<Vertex> &vertices, const std::vector<DWORD> &indices, size_t targetIndexCount)
+{
+	size_t vertexCount = vertices.size();
+
+	// Weld vertices with identical attributes (imported meshes are not indexed) and group vertices by position
+	// Vertices that share a position but differ in texture coordinates or normals lie on a seam
+
+	std::unordered_map<DWORD, DWORD, VertexHash, VertexEqual> vertexMap(vertexCount, VertexHash{ &vertices }, VertexEqual{ &vertices });
+	std::unordered_map<DWORD, DWORD, PositionHash, PositionEqual> positionMap(vertexCount, PositionHash{ &vertices }, PositionEqual{ &vertices });
+	std::vector<DWORD> weldRemap(vertexCount);
+	std::vector<DWORD> positionRemap(vertexCount);
+	std::vector<int> positionVertexCount(vertexCount, 0);
+
+	for (DWORD i = 0; i < vertexCount; i++)
+	{
+		weldRemap[i] = vertexMap.emplace(i, i).first->second;
+		positionRemap[i] = positionMap.emplace(i, i).first->second;
+		if (weldRemap[i] == i)
+		{
+			positionVertexCount[positionRemap[i]]++;
+		}
+	}
+
+	std::vector<DWORD> result(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		result[i] = weldRemap[indices[i]];
+	}
+
+	// Lock seam vertices and border vertices so UV and normal seams and open edges are preserved
+
+	std::vector<bool> isLocked(vertexCount, false);
+	for (DWORD i = 0; i < vertexCount; i++)
+	{
+		isLocked[i] = positionVertexCount[positionRemap[i]] > 1;
+	}
+
+	std::unordered_map<unsigned long long, int> directedEdges;
+	directedEdges.reserve(result.size());
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			unsigned long long a = positionRemap[result[i + j]];
+			unsigned long long b = positionRemap[result[i + (j + 1) % 3]];
+			directedEdges[(a << 32) | b]++;
+		}
+	}
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			unsigned long long a = positionRemap[result[i + j]];
+			unsigned long long b = positionRemap[result[i + (j + 1) % 3]];
+			if (directedEdges.find((b << 32) | a) == directedEdges.end())
+			{
+				isLocked[result[i + j]] = true;
+				isLocked[result[i + (j + 1) % 3]] = true;
+			}
+		}
+	}
+
+	// Accumulate the area-weighted plane quadrics of the triangles around each position
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const XMFLOAT3 &p0 = vertices[result[i]].position;
+		XMVECTOR vNormal = GetTriangleNormal(p0, vertices[result[i + 1]].position, vertices[result[i + 2]].position);
+		float fDoubleArea = XMVectorGetX(XMVector3Length(vNormal));
+		if (fDoubleArea == 0.0f)
+		{
+			continue;
+		}
+
+		XMFLOAT3 normal;
+		XMStoreFloat3(&normal, vNormal / fDoubleArea);
+		double d = -(normal.x * p0.x + normal.y * p0.y + normal.z * p0.z);
+
+		for (int j = 0; j < 3; j++)
+		{
+			quadrics[positionRemap[result[i + j]]].AddPlane(normal.x, normal.y, normal.z, d, fDoubleArea * 0.5f);
+		}
+	}
+
+	// Collapse the cheapest edges in passes until the target is reached
+
+	std::vector<DWORD> collapseRemap(vertexCount);
+	std::vector<bool> isTouched(vertexCount);
+	std::vector<Collapse> collapses;
+	std::vector<DWORD> triangleOffsets(vertexCount + 1);
+	std::vector<DWORD> vertexTriangles;
+
+	while (result.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		// Gather collapse candidates (a half-edge collapse moves "from" onto "to" and keeps the attributes of "to")
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				DWORD a = result[i + j];
+				DWORD b = result[i + (j + 1) % 3];
+
+				for (int k = 0; k < 2; k++)
+				{
+					DWORD from = k == 0 ? a : b;
+					DWORD to = k == 0 ? b : a;
+					if (isLocked[from])
+					{
+						continue;
+					}
+
+					Quadric quadric = quadrics[positionRemap[from]];
+					quadric.Add(quadrics[positionRemap[to]]);
+					collapses.push_back({ from, to, quadric.Evaluate(vertices[to].position) });
+				}
+			}
+		}
+
+		if (collapses.empty())
+		{
+			break;
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+		// Build the vertex to triangle adjacency
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (DWORD index : result)
+		{
+			triangleOffsets[index + 1]++;
+		}
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			triangleOffsets[i + 1] += triangleOffsets[i];
+		}
+		vertexTriangles.resize(result.size());
+		std::vector<DWORD> fillOffsets(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			vertexTriangles[fillOffsets[result[i]]++] = static_cast<DWORD>(i / 3);
+		}
+
+		for (DWORD i = 0; i < vertexCount; i++)
+		{
+			collapseRemap[i] = i;
+		}
+		std::fill(isTouched.begin(), isTouched.end(), false);
+
+		// Each interior collapse removes two triangles
+		size_t maxCollapseCount = (triangleCount - targetIndexCount / 3 + 1) / 2;
+		size_t collapseCount = 0;
+
+		for (const Collapse &collapse : collapses)
+		{
+			if (collapseCount >= maxCollapseCount)
+			{
+				break;
+			}
+			if (isTouched[collapse.from] || isTouched[collapse.to])
+			{
+				continue;
+			}
+
+			// Reject the collapse if it would flip any triangle around the removed vertex
+			bool bIsValid = true;
+			for (DWORD t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && bIsValid; t++)
+			{
+				const DWORD *triangle = &result[vertexTriangles[t] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					continue; // Becomes degenerate and is removed
+				}
+
+				XMFLOAT3 positions[3];
+				for (int j = 0; j < 3; j++)
+				{
+					positions[j] = vertices[triangle[j]].position;
+				}
+				XMVECTOR vOldNormal = GetTriangleNormal(positions[0], positions[1], positions[2]);
+				for (int j = 0; j < 3; j++)
+				{
+					if (triangle[j] == collapse.from)
+					{
+						positions[j] = vertices[collapse.to].position;
+					}
+				}
+				XMVECTOR vNewNormal = GetTriangleNormal(positions[0], positions[1], positions[2]);
+
+				float fDot = XMVectorGetX(XMVector3Dot(vOldNormal, vNewNormal));
+				float fLengths = XMVectorGetX(XMVector3Length(vOldNormal) * XMVector3Length(vNewNormal));
+				bIsValid = fDot > MIN_FLIP_COSINE * fLengths;
+			}
+			if (!bIsValid)
+			{
+				continue;
+			}
+
+			collapseRemap[collapse.from] = collapse.to;
+			quadrics[positionRemap[collapse.to]].Add(quadrics[positionRemap[collapse.from]]);
+			collapseCount++;
+
+			// Vertices around the collapse are not collapsed again in this pass so the adjacency stays valid
+			for (DWORD t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++)
+			{
+				const DWORD *triangle = &result[vertexTriangles[t] * 3];
+				isTouched[triangle[0]] = isTouched[triangle[1]] = isTouched[triangle[2]] = true;
+			}
+		}
+
+		if (collapseCount == 0)
+		{
+			break;
+		}
+
+		// Apply the collapses and remove triangles that became degenerate
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			DWORD a = collapseRemap[result[i]];
+			DWORD b = collapseRemap[result[i + 1]];
+			DWORD c = collapseRemap[result[i + 2]];
+			if (positionRemap[a] == positionRemap[b] || positionRemap[b] == positionRemap[c] || positionRemap[a] == positionRemap[c])
+			{
+				continue;
+			}
+			result[writeIndex++] = a;
+			result[writeIndex++] = b;
+			result[writeIndex++] = c;
+		}
+		result.resize(writeIndex);
+	}
+
+	return result;
+}
+
+std::vector<std::vector<DWORD>> MeshSimplifier::GenerateLods(const std::vector<Vertex> &vertices, const std::vector<DWORD> &indices, const std::vector<float> &triangleRatios)
+{
+	std::vector<std::future<std::vector<DWORD>>> tasks;
+	for (float fRatio : triangleRatios)
+	{
+		size_t targetIndexCount = static_cast<size_t>(indices.size() / 3 * fRatio) * 3;
+		tasks.push_back(std::async(std::launch::async, [&vertices, &indices, targetIndexCount]()
+		{
+			return Simplify(vertices, indices, targetIndexCount);
+		}));
+	}
+
+	std::vector<std::vector<DWORD>> lods;
+	for (auto &task : tasks)
+	{
+		lods.push_back(task.get());
+	}
+	return lods;
+}
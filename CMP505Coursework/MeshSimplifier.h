@@ -0,0 +1,27 @@
+//
+// MeshSimplifier.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Surface Simplification Using Quadric Error Metrics (https://www.cs.cmu.edu/~./garland/Papers/quadrics.pdf)
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+//
+
+#pragma once
+
+#include <vector>
+#include <directxmath.h>
+#include "TxtModel.h"
+
+using namespace DirectX;
+
+class MeshSimplifier
+{
+public:
+	// Collapses edges until the index count is at most the target (or no more edges can be collapsed)
+	// The vertex buffer is not modified so the result can share it with the original indices
+	static std::vector<DWORD> Simplify(const std::vector<Vertex> &vertices, const std::vector<DWORD> &indices, size_t targetIndexCount);
+
+	// Simplifies a mesh to each triangle ratio (0 to 1) on its own thread
+	static std::vector<std::vector<DWORD>> GenerateLods(const std::vector<Vertex> &vertices, const std::vector<DWORD> &indices, const std::vector<float> &triangleRatios);
+};
@@ -0,0 +1,225 @@
+//
+// MeshletBuilder.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+// Optimizing the Graphics Pipeline with Compute (https://frostbite-wp-prd.s3.amazonaws.com/wp-content/uploads/2016/03/29204330/GDC_2016_Compute.pdf)
+//
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include "MeshletBuilder.h"
+
+namespace
+{
+	struct PositionHash
+	{
+		size_t operator()(const XMFLOAT3 &position) const
+		{
+			unsigned int words[3];
+			memcpy(words, &position, sizeof(words));
+			return ((words[0] * 73856093u) ^ (words[1] * 19349663u) ^ (words[2] * 83492791u));
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const XMFLOAT3 &a, const XMFLOAT3 &b) const
+		{
+			return memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+		}
+	};
+}
+
+std::vector<Meshlet> MeshletBuilder::Build(const std::vector<Vertex> &vertices, std::vector<DWORD> &indices)
+{
+	size_t triangleCount = indices.size() / 3;
+
+	// Triangles are connected through shared positions since imported vertices are not always welded
+	std::unordered_map<XMFLOAT3, DWORD, PositionHash, PositionEqual> positionMap(vertices.size());
+	std::vector<DWORD> positionIds(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		positionIds[i] = positionMap.emplace(vertices[i].position, static_cast<DWORD>(positionMap.size())).first->second;
+	}
+
+	// Build the position to triangle adjacency
+	std::vector<DWORD> triangleOffsets(positionMap.size() + 1, 0);
+	for (DWORD index : indices)
+	{
+		triangleOffsets[positionIds[index] + 1]++;
+	}
+	for (size_t i = 0; i < positionMap.size(); i++)
+	{
+		triangleOffsets[i + 1] += triangleOffsets[i];
+	}
+	std::vector<DWORD> positionTriangles(indices.size());
+	std::vector<DWORD> fillOffsets(triangleOffsets.begin(), triangleOffsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		positionTriangles[fillOffsets[positionIds[indices[i]]]++] = static_cast<DWORD>(i / 3);
+	}
+
+	std::vector<Meshlet> meshlets;
+	std::vector<DWORD> meshletIndices;
+	meshletIndices.reserve(indices.size());
+	std::vector<bool> isTriangleUsed(triangleCount, false);
+
+	std::vector<DWORD> meshletVertices;
+	std::vector<DWORD> frontier;
+	size_t nextSeed = 0;
+
+	while (true)
+	{
+		// Seed each meshlet with the first unused triangle in index order
+		while (nextSeed < triangleCount && isTriangleUsed[nextSeed])
+		{
+			nextSeed++;
+		}
+		if (nextSeed == triangleCount)
+		{
+			break;
+		}
+
+		Meshlet meshlet = {};
+		meshlet.iStartIndex = static_cast<int>(meshletIndices.size());
+		meshletVertices.clear();
+		frontier.clear();
+		frontier.push_back(static_cast<DWORD>(nextSeed));
+
+		// Grow the meshlet breadth first across neighbouring triangles until a limit is reached
+		for (size_t f = 0; f < frontier.size() && meshlet.iIndexCount < MAX_MESHLET_TRIANGLES * 3; f++)
+		{
+			DWORD triangle = frontier[f];
+			if (isTriangleUsed[triangle])
+			{
+				continue;
+			}
+
+			int iNewVertexCount = 0;
+			for (int j = 0; j < 3; j++)
+			{
+				DWORD index = indices[triangle * 3 + j];
+				if (std::find(meshletVertices.begin(), meshletVertices.end(), index) == meshletVertices.end())
+				{
+					iNewVertexCount++;
+				}
+			}
+			if (meshletVertices.size() + iNewVertexCount > MAX_MESHLET_VERTICES)
+			{
+				continue;
+			}
+
+			isTriangleUsed[triangle] = true;
+			for (int j = 0; j < 3; j++)
+			{
+				DWORD index = indices[triangle * 3 + j];
+				if (std::find(meshletVertices.begin(), meshletVertices.end(), index) == meshletVertices.end())
+				{
+					meshletVertices.push_back(index);
+				}
+				meshletIndices.push_back(index);
+
+				DWORD positionId = positionIds[index];
+				for (DWORD t = triangleOffsets[positionId]; t < triangleOffsets[positionId + 1]; t++)
+				{
+					if (!isTriangleUsed[positionTriangles[t]])
+					{
+						frontier.push_back(positionTriangles[t]);
+					}
+				}
+			}
+			meshlet.iIndexCount += 3;
+		}
+
+		meshlets.push_back(meshlet);
+	}
+
+	indices = meshletIndices;
+
+	for (auto &meshlet : meshlets)
+	{
+		ComputeBounds(vertices, indices, meshlet);
+	}
+
+	return meshlets;
+}
+
+void MeshletBuilder::ComputeBounds(const std::vector<Vertex> &vertices, const std::vector<DWORD> &indices, Meshlet &meshlet)
+{
+	std::vector<XMFLOAT3> positions;
+	XMVECTOR vNormalSum = XMVectorZero();
+	std::vector<XMFLOAT3> normals;
+
+	for (int i = meshlet.iStartIndex; i < meshlet.iStartIndex + meshlet.iIndexCount; i += 3)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&vertices[indices[i]].position);
+		XMVECTOR v1 = XMLoadFloat3(&vertices[indices[i + 1]].position);
+		XMVECTOR v2 = XMLoadFloat3(&vertices[indices[i + 2]].position);
+		for (int j = 0; j < 3; j++)
+		{
+			positions.push_back(vertices[indices[i + j]].position);
+		}
+
+		// Clockwise triangles are front facing, which makes this normal point towards the viewer
+		XMVECTOR vNormal = XMVector3Cross(v1 - v0, v2 - v0);
+		if (XMVectorGetX(XMVector3LengthSq(vNormal)) > 0.0f)
+		{
+			vNormal = XMVector3Normalize(vNormal);
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, vNormal);
+			normals.push_back(normal);
+			vNormalSum += vNormal;
+		}
+	}
+
+	BoundingSphere::CreateFromPoints(meshlet.boundingSphere, positions.size(), positions.data(), sizeof(XMFLOAT3));
+
+	// The cone contains every triangle normal; if they span a hemisphere or more the meshlet is never back facing
+	meshlet.fConeCutoff = 1.0f;
+	meshlet.coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	if (normals.empty() || XMVectorGetX(XMVector3LengthSq(vNormalSum)) == 0.0f)
+	{
+		return;
+	}
+
+	XMVECTOR vAxis = XMVector3Normalize(vNormalSum);
+	float fMinDot = 1.0f;
+	for (auto &normal : normals)
+	{
+		fMinDot = min(fMinDot, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normal), vAxis)));
+	}
+	if (fMinDot <= 0.0f)
+	{
+		return;
+	}
+
+	XMStoreFloat3(&meshlet.coneAxis, vAxis);
+	meshlet.fConeCutoff = sqrtf(1.0f - fMinDot * fMinDot);
+}
+
+bool MeshletBuilder::IsVisible(const Meshlet &meshlet, XMMATRIX worldMatrix, const BoundingFrustum &frustum, FXMVECTOR vCameraPosition)
+{
+	BoundingSphere boundingSphere;
+	meshlet.boundingSphere.Transform(boundingSphere, worldMatrix);
+	if (!frustum.Intersects(boundingSphere))
+	{
+		return false;
+	}
+
+	if (meshlet.fConeCutoff >= 1.0f)
+	{
+		return true;
+	}
+
+	// Every triangle faces away from the camera if the view direction to the sphere is inside the cone
+	// (the cone is assumed to be unaffected by the world matrix's scale, which holds for uniform scaling)
+	XMVECTOR vAxis = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&meshlet.coneAxis), worldMatrix));
+	XMVECTOR vToCenter = XMLoadFloat3(&boundingSphere.Center) - vCameraPosition;
+	float fDot = XMVectorGetX(XMVector3Dot(vToCenter, vAxis));
+	float fDistance = XMVectorGetX(XMVector3Length(vToCenter));
+
+	return fDot < meshlet.fConeCutoff * fDistance + boundingSphere.Radius;
+}
@@ -0,0 +1,41 @@
+//
+// MeshletBuilder.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// meshoptimizer (https://github.com/zeux/meshoptimizer)
+// Optimizing the Graphics Pipeline with Compute (https://frostbite-wp-prd.s3.amazonaws.com/wp-content/uploads/2016/03/29204330/GDC_2016_Compute.pdf)
+//
+
+#pragma once
+
+#include <vector>
+#include <directxmath.h>
+#include <DirectXCollision.h>
+#include "TxtModel.h"
+
+using namespace DirectX;
+
+#define MAX_MESHLET_VERTICES 64
+#define MAX_MESHLET_TRIANGLES 124
+
+struct Meshlet
+{
+	int iStartIndex;					// Offset of the meshlet's triangles in the reordered indices
+	int iIndexCount;
+	BoundingSphere boundingSphere;		// Object space
+	XMFLOAT3 coneAxis;					// Average facing direction of the triangles
+	float fConeCutoff;					// Sine of the cone's half angle (1 if the triangles face too many directions to be culled)
+};
+
+class MeshletBuilder
+{
+public:
+	// Groups neighbouring triangles into meshlets and reorders the indices so each meshlet's triangles are contiguous
+	static std::vector<Meshlet> Build(const std::vector<Vertex> &vertices, std::vector<DWORD> &indices);
+	// A meshlet is culled if it is outside the frustum or all of its triangles face away from the camera (all in world space)
+	static bool IsVisible(const Meshlet &meshlet, XMMATRIX worldMatrix, const BoundingFrustum &frustum, FXMVECTOR vCameraPosition);
+
+private:
+	static void ComputeBounds(const std::vector<Vertex> &vertices, const std::vector<DWORD> &indices, Meshlet &meshlet);
+};
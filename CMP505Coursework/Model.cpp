@@ -6,16 +6,27 @@
 // C++ DirectX 11 Engine Tutorial 58 - Light Attenuation (https://youtu.be/RzsPqrmDzQg)
 //
 
+#include <algorithm>
 #include "Model.h"
 
+#define MIN_LOD_TRIANGLE_COUNT 256	// Smaller meshes are cheap enough to always render at full detail
+#define IMPORT_CACHE_SIZE 32		// Vertex cache size the import stats are simulated with (same as the asset cooker's)
+
 #pragma region Init
 
-Model::Model(ID3D11Device *pDevice, ID3D11DeviceContext *pImmediateContext, ID3D11ShaderResourceView *pDefaultTexture)
+Model::Model(ID3D11Device *pDevice, ID3D11DeviceContext *pImmediateContext, ID3D11ShaderResourceView *pDefaultTexture, TextureCache *pTextureCache)
 {
 	m_pDevice = pDevice;
 	m_pImmediateContext = pImmediateContext;
 	m_pDefaultTexture = pDefaultTexture;
+	m_pTextureCache = pTextureCache;
 	m_iInstanceCount = 1;
+	m_vertexFormat = FullPrecisionVertexFormat;
+	m_importProfile = FastImportProfile;
+	m_lodSettings = { { 0.5f, 0.25f }, { 0.25f, 0.1f }, { 0.1f, 0.04f } };
+	m_bMeshletsEnabled = false;
+	m_bStaticBatchingEnabled = false;
+	m_pReadQueue = nullptr;
 	m_worldMatrix = XMMatrixIdentity();
 	m_ambientColor = COLOR_XMF4(51.0f, 51.0f, 51.0f, 1.0f); // Ambient should not be too bright otherwise the scene will appear overexposed and washed-out
 	m_diffuseColor = COLOR_XMF4(180.0f, 100.0f, 255.0f, 1.0f);
@@ -32,51 +43,314 @@ Model::Model(ID3D11Device *pDevice, ID3D11DeviceContext *pImmediateContext, ID3D
 	//m_pointLightColor = XMFLOAT3(0.0f / 255.0f, 255.0f / 255.0f, 0.0f / 255.0f);
 	m_fPointLightStrength = 0.5f;
 	m_pointLightPosition = XMFLOAT3(0.0f, 3.0f, 0.0f);
+	m_pCookedMeshWriter = nullptr;
+	m_bIsCookable = true;
 }
 
 Model::~Model()
 {
+	SAFE_DELETE(m_pCookedMeshWriter);
+	for (auto &mesh : m_meshes)
+	{
+		SAFE_DELETE(mesh);
+	}
 }
 
 bool Model::Initialize(std::string strFilePath, int iInstanceCount, Instance *instances)
 {
+	ProfileZone profileZone("Load model ", strFilePath.c_str());
 	m_strDirectory = Utils::GetDirectoryFromPath(strFilePath);
 
-	Assimp::Importer importer;
-	const aiScene *pScene = importer.ReadFile(strFilePath, aiProcess_Triangulate | aiProcess_ConvertToLeftHanded);
-	if (pScene == nullptr)
+	// Use the cooked mesh unless the source file or its material libraries have changed since it was cooked
+	// (the textures they reference are loaded from their own files either way)
+	std::string strCookedFilePath = GetCookedFilePath(strFilePath.substr(strFilePath.find_last_of("/\\") + 1));
+	// The profiles import different geometry from the same file, so the profile is part of the source hash
+	// (except for the fast profile, which is how the asset cooker imports files)
+	const char *pSourceData = nullptr;
+	size_t sourceSize = 0;
+	uint64_t sourceHash = m_pReadQueue != nullptr && m_pReadQueue->Wait(strFilePath, pSourceData, sourceSize) ? HashCookedMeshData(pSourceData, sourceSize) :
+						  CookedMeshWriter::HashFile(strFilePath.c_str());
+	if (Utils::GetFileExtension(strFilePath) == "obj")
+	{
+		// The cooked submeshes store their materials, so the libraries are hashed like the asset cooker's dependencies
+		std::vector<std::string> materialLibraries;
+		ObjModelParser::FindMaterialLibraries(strFilePath.c_str(), materialLibraries);
+		sourceHash = CookedMeshWriter::HashDependencies(sourceHash, materialLibraries);
+	}
+	if (m_importProfile != FastImportProfile)
+	{
+		sourceHash = HashCookedMeshData(&m_importProfile, sizeof(m_importProfile), sourceHash);
+	}
+	if (m_bStaticBatchingEnabled)
+	{
+		// Batching changes the meshes as well
+		sourceHash = HashCookedMeshData(&m_bStaticBatchingEnabled, sizeof(m_bStaticBatchingEnabled), sourceHash);
+		sourceHash = HashCookedMeshData(m_animatedMeshIndices.data(), m_animatedMeshIndices.size() * sizeof(int), sourceHash);
+	}
+	if (LoadCookedMesh(strCookedFilePath, sourceHash, iInstanceCount, instances))
+	{
+		return true;
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	std::vector<ImportedMesh> importedMeshes;
+	if (m_importProfile == FastImportProfile && Utils::GetFileExtension(strFilePath) == "obj")
+	{
+		std::vector<ObjSubmesh> objSubmeshes;
+		if (!ObjModelParser::Parse(strFilePath.c_str(), objSubmeshes))
+		{
+			return false;
+		}
+
+#ifdef _DEBUG
+		ImportStats stats = GetImportStats(objSubmeshes);
+		stats.fMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		OutputDebugStringA(GetImportReport(strFilePath, m_importProfile, stats).c_str());
+
+		// Check the parser against the Assimp import it replaces
+		ObjModelValidator::Validate(strFilePath.c_str());
+#endif
+
+		for (auto &objSubmesh : objSubmeshes)
+		{
+			importedMeshes.push_back(ProcessObjSubmesh(objSubmesh));
+		}
+	}
+	else
+	{
+		Assimp::Importer importer;
+		importer.SetIOHandler(m_pReadQueue != nullptr ? new ReadQueueIOSystem(m_pReadQueue) : new AssetPackIOSystem());
+		const aiScene *pScene = importer.ReadFile(strFilePath, GetImportFlags(m_importProfile));
+		if (pScene == nullptr)
+		{
+			return false;
+		}
+
+#ifdef _DEBUG
+		ImportStats stats = GetImportStats(pScene);
+		stats.fMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		OutputDebugStringA(GetImportReport(strFilePath, m_importProfile, stats).c_str());
+#endif
+
+		ProcessNode(pScene->mRootNode, pScene, XMMatrixIdentity(), importedMeshes);
+	}
+
+	if (m_bStaticBatchingEnabled)
+	{
+		BatchMeshes(importedMeshes);
+	}
+
+	BeginCooking();
+	for (auto &importedMesh : importedMeshes)
+	{
+		Mesh *pMesh = new Mesh(importedMesh.textures, importedMesh.transformMatrix, m_vertexFormat);
+		pMesh->SetMeshletsEnabled(m_bMeshletsEnabled);
+		GenerateLods(pMesh, importedMesh.vertices, importedMesh.indices);
+		if (!InitializeMesh(pMesh, importedMesh.vertices, importedMesh.indices, iInstanceCount, instances, importedMesh.cookedMaterial))
+		{
+			MessageBox(0, "Failed to initialize mesh vertex and index buffers.", "", 0);
+		}
+		m_meshes.push_back(pMesh);
+	}
+	EndCooking(strCookedFilePath, sourceHash); // The model is still usable if it cannot be cooked
+
+	m_iInstanceCount = iInstanceCount;
+
+	return true;
+}
+
+bool Model::InitializeShared(Model *pSourceModel, int iInstanceCount, Instance *instances)
+{
+	m_strDirectory = pSourceModel->m_strDirectory;
+
+	for (auto pSourceMesh : pSourceModel->m_meshes)
+	{
+		// Each mesh releases its textures when it is deleted, so the shared ones need a reference of their own
+		std::vector<ID3D11ShaderResourceView*> textures = pSourceMesh->GetTextures();
+		for (auto texture : textures)
+		{
+			if (texture != nullptr)
+			{
+				texture->AddRef();
+			}
+		}
+
+		Mesh *pMesh = new Mesh(textures, pSourceMesh->GetTransformMatrix(), m_vertexFormat);
+		pMesh->SetMeshletsEnabled(m_bMeshletsEnabled);
+		if (!pMesh->InitializeSharedBuffers(m_pDevice, pSourceMesh, iInstanceCount, instances))
+		{
+			delete pMesh; // Releases the texture references taken above, the meshes already shared are deleted with the model
+			return false;
+		}
+		m_meshes.push_back(pMesh);
+	}
+
+	m_iInstanceCount = iInstanceCount;
+
+	return true;
+}
+
+bool Model::InitializeProxy(std::string strFilePath, int iInstanceCount, Instance *instances)
+{
+	CookedMeshFile cookedMeshFile;
+	if (!cookedMeshFile.Open(GetCookedFilePath(strFilePath.substr(strFilePath.find_last_of("/\\") + 1)).c_str(), sizeof(Vertex)))
 	{
 		return false;
 	}
 
-	ProcessNode(pScene->mRootNode, pScene, XMMatrixIdentity(), iInstanceCount, instances);
+	const CookedMeshHeader *pHeader = cookedMeshFile.GetHeader();
+	XMFLOAT3 size(pHeader->boxExtents[0] * 2.0f, pHeader->boxExtents[1] * 2.0f, pHeader->boxExtents[2] * 2.0f);
+	AddBoxMesh(size, XMMatrixTranslation(pHeader->boxCenter[0], pHeader->boxCenter[1], pHeader->boxCenter[2]), iInstanceCount, instances);
 
 	m_iInstanceCount = iInstanceCount;
 
 	return true;
 }
 
-void Model::ProcessNode(aiNode *pNode, const aiScene *pScene, XMMATRIX parentTransformMatrix, int iInstanceCount, Instance *instances)
+bool Model::LoadCookedMesh(std::string strCookedFilePath, uint64_t sourceHash, int iInstanceCount, Instance *instances)
+{
+	CookedMeshFile cookedMeshFile;
+	if (!cookedMeshFile.Open(strCookedFilePath.c_str(), sizeof(Vertex)))
+	{
+		return false;
+	}
+
+	const CookedMeshHeader *pHeader = cookedMeshFile.GetHeader();
+	if (pHeader->sourceHash != sourceHash)
+	{
+		return false;
+	}
+
+	// The import is skipped either way, but the LODs and meshlets have to be rebuilt if the settings differ
+	bool bIsBuilt = pHeader->settingsHash == GetCookSettingsHash();
+	if (!bIsBuilt)
+	{
+		BeginCooking();
+	}
+
+	for (uint32_t i = 0; i < pHeader->submeshCount; i++)
+	{
+		const CookedSubmesh &submesh = *cookedMeshFile.GetSubmesh(i);
+
+		std::vector<ID3D11ShaderResourceView*> textures = { LoadCookedMaterialTexture(submesh) };
+
+		Mesh *pMesh = new Mesh(textures, XMMATRIX(submesh.transform), m_vertexFormat);
+		pMesh->SetMeshletsEnabled(m_bMeshletsEnabled);
+		bool bResult = false;
+		if (bIsBuilt)
+		{
+			bResult = pMesh->InitializeBuffers(m_pDevice, cookedMeshFile, submesh, iInstanceCount, instances);
+		}
+		else
+		{
+			// Rebuild from the full detail LOD
+			const Vertex *pVertices = static_cast<const Vertex*>(cookedMeshFile.GetVertexData(submesh));
+			const uint32_t *pIndices = cookedMeshFile.GetIndexData(submesh) + submesh.lods[0].indexOffset;
+			std::vector<Vertex> vertices(pVertices, pVertices + submesh.vertexCount);
+			std::vector<DWORD> indices(pIndices, pIndices + submesh.lods[0].indexCount);
+			GenerateLods(pMesh, vertices, indices);
+			bResult = InitializeMesh(pMesh, vertices, indices, iInstanceCount, instances, submesh);
+		}
+		if (!bResult)
+		{
+			MessageBox(0, "Failed to initialize cooked mesh vertex and index buffers.", "", 0);
+		}
+		m_meshes.push_back(pMesh);
+	}
+
+	if (!bIsBuilt)
+	{
+		// The file is still mapped until it is closed, so it cannot be replaced before then
+		cookedMeshFile.Close();
+		EndCooking(strCookedFilePath, sourceHash);
+	}
+
+	m_iInstanceCount = iInstanceCount;
+
+	return true;
+}
+
+void Model::BeginCooking()
+{
+	SAFE_DELETE(m_pCookedMeshWriter);
+	m_pCookedMeshWriter = new CookedMeshWriter(sizeof(Vertex));
+	m_pCookedMeshWriter->SetCompression(COOKED_MESH_COMPRESSION, COOKED_MESH_COMPRESSION);
+	m_bIsCookable = true;
+}
+
+bool Model::EndCooking(std::string strCookedFilePath, uint64_t sourceHash)
+{
+	bool bResult = m_pCookedMeshWriter != nullptr && m_bIsCookable && 
+				   m_pCookedMeshWriter->Write(strCookedFilePath, sourceHash, GetCookSettingsHash());
+	SAFE_DELETE(m_pCookedMeshWriter);
+	return bResult;
+}
+
+std::string Model::GetCookedFilePath(std::string strName)
+{
+	return COOKED_MESH_DIRECTORY + strName + ".mesh";
+}
+
+std::string Model::CompareImportProfiles(std::string strFilePath)
+{
+	std::string strReport;
+	for (int i = 0; i < ImportProfileCount; i++)
+	{
+		ImportProfile importProfile = static_cast<ImportProfile>(i);
+		auto startTime = std::chrono::high_resolution_clock::now();
+		ImportStats stats = {};
+		if (importProfile == FastImportProfile && Utils::GetFileExtension(strFilePath) == "obj")
+		{
+			std::vector<ObjSubmesh> objSubmeshes;
+			if (!ObjModelParser::Parse(strFilePath.c_str(), objSubmeshes))
+			{
+				return strReport + strFilePath + ": failed to import\n";
+			}
+			stats = GetImportStats(objSubmeshes);
+		}
+		else
+		{
+			Assimp::Importer importer;
+			importer.SetIOHandler(new AssetPackIOSystem());
+			const aiScene *pScene = importer.ReadFile(strFilePath, GetImportFlags(importProfile));
+			if (pScene == nullptr)
+			{
+				return strReport + strFilePath + ": failed to import\n";
+			}
+			stats = GetImportStats(pScene);
+		}
+
+		// The time includes simulating the vertex cache, which is the same work for every profile
+		stats.fMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		strReport += GetImportReport(strFilePath, importProfile, stats);
+	}
+
+	return strReport;
+}
+
+void Model::ProcessNode(aiNode *pNode, const aiScene *pScene, XMMATRIX parentTransformMatrix, std::vector<ImportedMesh> &importedMeshes)
 {
 	XMMATRIX nodeTransformMatrix = XMMatrixTranspose(XMMATRIX(&pNode->mTransformation.a1)) * parentTransformMatrix;
 
 	for (UINT i = 0; i < pNode->mNumMeshes; i++)
 	{
 		aiMesh *pAiMesh = pScene->mMeshes[pNode->mMeshes[i]];
-		Mesh *pMesh = ProcessMesh(pAiMesh, pScene, nodeTransformMatrix, iInstanceCount, instances);
-		m_meshes.push_back(pMesh);
+		importedMeshes.push_back(ProcessMesh(pAiMesh, pScene, nodeTransformMatrix));
 	}
 
 	for (UINT i = 0; i < pNode->mNumChildren; i++)
 	{
-		ProcessNode(pNode->mChildren[i], pScene, nodeTransformMatrix, iInstanceCount, instances);
+		ProcessNode(pNode->mChildren[i], pScene, nodeTransformMatrix, importedMeshes);
 	}
 }
 
-Mesh* Model::ProcessMesh(aiMesh *pAiMesh, const aiScene *pScene, XMMATRIX transformMatrix, int iInstanceCount, Instance *instances)
+Model::ImportedMesh Model::ProcessMesh(aiMesh *pAiMesh, const aiScene *pScene, XMMATRIX transformMatrix)
 {
+	ImportedMesh importedMesh;
+	importedMesh.transformMatrix = transformMatrix;
+
 	// Get vertices
-	std::vector<Vertex> vertices;
+	std::vector<Vertex> &vertices = importedMesh.vertices;
 	for (UINT i = 0; i < pAiMesh->mNumVertices; i++)
 	{
 		Vertex vertex;
@@ -99,7 +373,7 @@ Mesh* Model::ProcessMesh(aiMesh *pAiMesh, const aiScene *pScene, XMMATRIX transf
 	}
 
 	// Get indices
-	std::vector<DWORD> indices;
+	std::vector<DWORD> &indices = importedMesh.indices;
 	for (UINT i = 0; i < pAiMesh->mNumFaces; i++)
 	{
 		aiFace face = pAiMesh->mFaces[i];
@@ -112,19 +386,274 @@ Mesh* Model::ProcessMesh(aiMesh *pAiMesh, const aiScene *pScene, XMMATRIX transf
 
 	// Get textures
 	aiMaterial *pMaterial = pScene->mMaterials[pAiMesh->mMaterialIndex];
-	std::vector<ID3D11ShaderResourceView*> textures = LoadMaterialTextures(pMaterial, aiTextureType::aiTextureType_DIFFUSE, pScene);
-	
-	// Create mesh
-	Mesh *pMesh = new Mesh(textures, transformMatrix);
-	if (!pMesh->InitializeBuffers(m_pDevice, vertices, indices, iInstanceCount, instances))
+	importedMesh.cookedMaterial = {};
+	importedMesh.textures = LoadMaterialTextures(pMaterial, aiTextureType::aiTextureType_DIFFUSE, pScene, importedMesh.cookedMaterial);
+
+	return importedMesh;
+}
+
+Model::ImportedMesh Model::ProcessObjSubmesh(ObjSubmesh &objSubmesh)
+{
+	ImportedMesh importedMesh;
+
+	// The parser's vertices have the same layout as Vertex
+	static_assert(sizeof(CookedVertex) == sizeof(Vertex), "CookedVertex must match Vertex");
+	importedMesh.vertices.resize(objSubmesh.vertices.size());
+	memcpy(importedMesh.vertices.data(), objSubmesh.vertices.data(), sizeof(Vertex) * objSubmesh.vertices.size());
+	importedMesh.indices.assign(objSubmesh.indices.begin(), objSubmesh.indices.end());
+
+	// OBJ files have no node hierarchy, so the meshes are not transformed
+	importedMesh.transformMatrix = XMMatrixIdentity();
+
+	// Same material as LoadMaterialTextures records for the Assimp import of the file
+	importedMesh.cookedMaterial = {};
+	if (!objSubmesh.strTexturePath.empty() && objSubmesh.strTexturePath.size() < MAX_COOKED_TEXTURE_PATH_LENGTH)
+	{
+		strcpy_s(importedMesh.cookedMaterial.texturePath, objSubmesh.strTexturePath.c_str());
+	}
+	else if (objSubmesh.diffuseColor[3] > 0.0f)
 	{
-		MessageBox(0, "Failed to initialize mesh vertex and index buffers.", "", 0);
+		memcpy(importedMesh.cookedMaterial.diffuseColor, objSubmesh.diffuseColor, sizeof(importedMesh.cookedMaterial.diffuseColor));
 	}
+	importedMesh.textures = { LoadCookedMaterialTexture(importedMesh.cookedMaterial) };
 
-	return pMesh;
+	return importedMesh;
 }
 
-std::vector<ID3D11ShaderResourceView*> Model::LoadMaterialTextures(aiMaterial *pMaterial, aiTextureType textureType, const aiScene *pScene)
+void Model::BatchMeshes(std::vector<ImportedMesh> &importedMeshes)
+{
+	// Animated meshes are kept as they are and come first, so their indices stay the same if they were the first meshes imported
+	std::vector<ImportedMesh> batchedMeshes;
+	std::vector<ImportedMesh*> staticMeshes;
+	for (size_t i = 0; i < importedMeshes.size(); i++)
+	{
+		bool bIsAnimated = std::find(m_animatedMeshIndices.begin(), m_animatedMeshIndices.end(), static_cast<int>(i)) != m_animatedMeshIndices.end();
+		if (bIsAnimated)
+		{
+			batchedMeshes.push_back(std::move(importedMeshes[i]));
+		}
+		else
+		{
+			staticMeshes.push_back(&importedMeshes[i]);
+		}
+	}
+
+	// Static meshes with the same material are pre-transformed and concatenated, in the order the first of them was imported
+	// Only materials that the cooked material fully describes can be compared (embedded textures are loaded separately for each mesh)
+	std::vector<size_t> comparableBatchIndices;
+	for (auto pImportedMesh : staticMeshes)
+	{
+		const CookedSubmesh &material = pImportedMesh->cookedMaterial;
+		bool bIsComparable = pImportedMesh->textures.size() == 1 &&
+							 (material.texturePath[0] != '\0' || material.diffuseColor[3] > 0.0f || pImportedMesh->textures[0] == m_pDefaultTexture);
+
+		ImportedMesh *pBatch = nullptr;
+		if (bIsComparable)
+		{
+			for (auto batchIndex : comparableBatchIndices)
+			{
+				const CookedSubmesh &batchMaterial = batchedMeshes[batchIndex].cookedMaterial;
+				if (strcmp(batchMaterial.texturePath, material.texturePath) == 0 &&
+					memcmp(batchMaterial.diffuseColor, material.diffuseColor, sizeof(material.diffuseColor)) == 0)
+				{
+					pBatch = &batchedMeshes[batchIndex];
+					break;
+				}
+			}
+		}
+
+		if (pBatch == nullptr)
+		{
+			if (bIsComparable)
+			{
+				comparableBatchIndices.push_back(batchedMeshes.size());
+			}
+			batchedMeshes.emplace_back();
+			pBatch = &batchedMeshes.back();
+			pBatch->textures.swap(pImportedMesh->textures);
+			pBatch->cookedMaterial = material;
+			pBatch->transformMatrix = XMMatrixIdentity();
+		}
+		else
+		{
+			// The batch already holds a reference to the same material
+			for (auto texture : pImportedMesh->textures)
+			{
+				SAFE_RELEASE(texture);
+			}
+		}
+
+		// Normals are transformed by the inverse transpose, so non-uniform scaling keeps them perpendicular
+		XMMATRIX transformMatrix = pImportedMesh->transformMatrix;
+		XMMATRIX normalMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, transformMatrix));
+		DWORD uiFirstVertex = static_cast<DWORD>(pBatch->vertices.size());
+		for (auto vertex : pImportedMesh->vertices)
+		{
+			XMStoreFloat3(&vertex.position, XMVector3TransformCoord(XMLoadFloat3(&vertex.position), transformMatrix));
+			XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.normal), normalMatrix)));
+			pBatch->vertices.push_back(vertex);
+		}
+		for (auto index : pImportedMesh->indices)
+		{
+			pBatch->indices.push_back(uiFirstVertex + index);
+		}
+	}
+
+	importedMeshes.swap(batchedMeshes);
+}
+
+void Model::GenerateLods(Mesh *pMesh, std::vector<Vertex> &vertices, std::vector<DWORD> &indices)
+{
+	if (m_lodSettings.empty() || indices.size() / 3 < MIN_LOD_TRIANGLE_COUNT)
+	{
+		return;
+	}
+
+	std::vector<float> triangleRatios;
+	for (auto &lodSetting : m_lodSettings)
+	{
+		triangleRatios.push_back(lodSetting.fTriangleRatio);
+	}
+
+	// Each LOD is simplified from the full detail mesh on its own thread
+	std::vector<std::vector<DWORD>> lodIndices = MeshSimplifier::GenerateLods(vertices, indices, triangleRatios);
+
+	// Skip LODs that could not be simplified further than the previous one (e.g. when most vertices lie on seams)
+	std::vector<std::vector<DWORD>> usedLodIndices;
+	std::vector<float> maxScreenCoverages;
+	size_t previousIndexCount = indices.size();
+	for (size_t i = 0; i < lodIndices.size(); i++)
+	{
+		if (lodIndices[i].empty() || lodIndices[i].size() >= previousIndexCount)
+		{
+			continue;
+		}
+		previousIndexCount = lodIndices[i].size();
+		usedLodIndices.push_back(lodIndices[i]);
+		maxScreenCoverages.push_back(m_lodSettings[i].fMaxScreenCoverage);
+	}
+
+	pMesh->SetLods(usedLodIndices, maxScreenCoverages);
+}
+
+bool Model::InitializeMesh(Mesh *pMesh, std::vector<Vertex> &vertices, std::vector<DWORD> &indices, int iInstanceCount, Instance *instances, 
+						   const CookedSubmesh &cookedMaterial)
+{
+	if (m_pCookedMeshWriter == nullptr)
+	{
+		return pMesh->InitializeBuffers(m_pDevice, vertices, indices, iInstanceCount, instances);
+	}
+
+	// The cooked mesh stores the indices as they end up in the index buffer (meshlet order, followed by the LODs)
+	std::vector<DWORD> indexBufferData;
+	if (!pMesh->InitializeBuffers(m_pDevice, vertices, indices, iInstanceCount, instances, &indexBufferData))
+	{
+		return false;
+	}
+
+	CookedSubmesh submesh = cookedMaterial;
+	std::vector<CookedMeshlet> meshlets;
+	pMesh->GetCookedSubmesh(submesh, meshlets);
+	m_pCookedMeshWriter->AddSubmesh(submesh, vertices.data(), vertices.size(), reinterpret_cast<const uint32_t*>(indexBufferData.data()), 
+									indexBufferData.size(), meshlets.data(), meshlets.size());
+
+	return true;
+}
+
+unsigned int Model::GetImportFlags(ImportProfile importProfile)
+{
+	unsigned int uiFlags = aiProcess_Triangulate | aiProcess_ConvertToLeftHanded;
+	if (importProfile != FastImportProfile)
+	{
+		uiFlags |= aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality | aiProcess_RemoveRedundantMaterials;
+	}
+	if (importProfile == MergedImportProfile)
+	{
+		uiFlags |= aiProcess_OptimizeMeshes | aiProcess_OptimizeGraph;
+	}
+	if (importProfile == StaticPropImportProfile)
+	{
+		// Pre-transforming already collapses the node graph (Assimp does not allow it together with aiProcess_OptimizeGraph)
+		uiFlags |= aiProcess_OptimizeMeshes | aiProcess_PreTransformVertices;
+	}
+
+	return uiFlags;
+}
+
+ImportStats Model::GetImportStats(const aiScene *pScene)
+{
+	ImportStats stats = {};
+	std::vector<DWORD> indices;
+	for (UINT i = 0; i < pScene->mNumMeshes; i++)
+	{
+		const aiMesh *pAiMesh = pScene->mMeshes[i];
+		indices.clear();
+		for (UINT j = 0; j < pAiMesh->mNumFaces; j++)
+		{
+			indices.insert(indices.end(), pAiMesh->mFaces[j].mIndices, pAiMesh->mFaces[j].mIndices + pAiMesh->mFaces[j].mNumIndices);
+		}
+
+		stats.uiMeshCount++;
+		stats.uiVertexCount += pAiMesh->mNumVertices;
+		stats.uiIndexCount += static_cast<UINT>(indices.size());
+		stats.uiCacheMissCount += CountCacheMisses(indices, pAiMesh->mNumVertices);
+	}
+
+	return stats;
+}
+
+ImportStats Model::GetImportStats(std::vector<ObjSubmesh> &objSubmeshes)
+{
+	ImportStats stats = {};
+	for (auto &objSubmesh : objSubmeshes)
+	{
+		stats.uiMeshCount++;
+		stats.uiVertexCount += static_cast<UINT>(objSubmesh.vertices.size());
+		stats.uiIndexCount += static_cast<UINT>(objSubmesh.indices.size());
+		std::vector<DWORD> indices(objSubmesh.indices.begin(), objSubmesh.indices.end());
+		stats.uiCacheMissCount += CountCacheMisses(indices, static_cast<UINT>(objSubmesh.vertices.size()));
+	}
+
+	return stats;
+}
+
+UINT Model::CountCacheMisses(const std::vector<DWORD> &indices, UINT uiVertexCount)
+{
+	// FIFO cache: each vertex remembers when it entered the cache, so a lookup is a subtraction
+	std::vector<UINT> cacheEntryTimes(uiVertexCount, 0);
+	UINT uiTime = IMPORT_CACHE_SIZE + 1;
+	UINT uiMissCount = 0;
+	for (auto index : indices)
+	{
+		if (uiTime - cacheEntryTimes[index] > IMPORT_CACHE_SIZE)
+		{
+			cacheEntryTimes[index] = uiTime++;
+			uiMissCount++;
+		}
+	}
+
+	return uiMissCount;
+}
+
+std::string Model::GetImportReport(std::string strFilePath, ImportProfile importProfile, ImportStats stats)
+{
+	const char *profileNames[] = { "fast", "optimized", "merged", "static prop" };
+
+	// ACMR: average cache misses per triangle (0.5 is ideal for regular grids, 3 means no reuse at all)
+	float fAcmr = stats.uiIndexCount > 0 ? stats.uiCacheMissCount * 3.0f / stats.uiIndexCount : 0.0f;
+	return strFilePath + " (" + profileNames[importProfile] + " profile): " + std::to_string(stats.uiMeshCount) + " meshes, " +
+		   std::to_string(stats.uiVertexCount) + " vertices, " + std::to_string(stats.uiIndexCount) + " indices, ACMR " + 
+		   std::to_string(fAcmr) + ", imported in " + std::to_string(stats.fMilliseconds) + " ms\n";
+}
+
+uint64_t Model::GetCookSettingsHash()
+{
+	uint64_t hash = HashCookedMeshData(m_lodSettings.data(), m_lodSettings.size() * sizeof(LodSetting));
+	return HashCookedMeshData(&m_bMeshletsEnabled, sizeof(m_bMeshletsEnabled), hash);
+}
+
+std::vector<ID3D11ShaderResourceView*> Model::LoadMaterialTextures(aiMaterial *pMaterial, aiTextureType textureType, const aiScene *pScene, 
+																	CookedSubmesh &cookedMaterial)
 {
 	std::vector<ID3D11ShaderResourceView*> textures;
 
@@ -135,14 +664,17 @@ std::vector<ID3D11ShaderResourceView*> Model::LoadMaterialTextures(aiMaterial *p
 		pMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, aiColor);
 		if (aiColor.IsBlack())
 		{
-			textures.push_back(m_pDefaultTexture);
+			textures.push_back(GetDefaultTexture());
 		}
 		else
 		{
 			unsigned char color[] = { aiColor.r * 255, aiColor.g * 255, aiColor.b * 255, 255 };
-			ID3D11ShaderResourceView *pTexture;
-			Create1x1ColorTexture(m_pDevice, color, &pTexture);
-			textures.push_back(pTexture);
+			textures.push_back(LoadColorTexture(color));
+
+			cookedMaterial.diffuseColor[0] = aiColor.r;
+			cookedMaterial.diffuseColor[1] = aiColor.g;
+			cookedMaterial.diffuseColor[2] = aiColor.b;
+			cookedMaterial.diffuseColor[3] = 1.0f;
 		}
 	}
 	else
@@ -155,44 +687,45 @@ std::vector<ID3D11ShaderResourceView*> Model::LoadMaterialTextures(aiMaterial *p
 
 			if (strPath[0] == '*') // Check if the path is an index number
 			{
+				m_bIsCookable = false;
 				if (pScene->mTextures[0]->mHeight == 0 && path.length >= 2)
 				{
 					// Compressed indexed embedded texture
 					int index = atoi(&strPath[1]);
-					ID3D11ShaderResourceView *pTexture = nullptr;
-					LoadEmbeddedTexture(reinterpret_cast<uint8_t*>(pScene->mTextures[index]->pcData), pScene->mTextures[index]->mWidth, pTexture);
-					textures.push_back(pTexture);
+					textures.push_back(LoadEmbeddedTexture(reinterpret_cast<uint8_t*>(pScene->mTextures[index]->pcData), pScene->mTextures[index]->mWidth));
 				}
 				else
 				{
 					// Non-compressed indexed embedded texture (not supported)
-					textures.push_back(m_pDefaultTexture);
+					textures.push_back(GetDefaultTexture());
 				}
 			}
 			else {
 				const aiTexture *pAiTexture = pScene->GetEmbeddedTexture(strPath.c_str());
 				if (pAiTexture != nullptr) // Check if the path is a texture's name
 				{
+					m_bIsCookable = false;
 					if (pAiTexture->mHeight == 0)
 					{
 						// Compressed non-indexed embedded texture
-						ID3D11ShaderResourceView *pTexture = nullptr;
-						LoadEmbeddedTexture(reinterpret_cast<uint8_t*>(pAiTexture->pcData), pAiTexture->mWidth, pTexture);
-						textures.push_back(pTexture);
+						textures.push_back(LoadEmbeddedTexture(reinterpret_cast<uint8_t*>(pAiTexture->pcData), pAiTexture->mWidth));
 					}
 					else
 					{
 						// Non-compressed non-indexed embedded texture (not supported)
-						textures.push_back(m_pDefaultTexture);
+						textures.push_back(GetDefaultTexture());
 					}
 				}
 				else if(strPath.find('.') != std::string::npos) // Check for the period before the file extension
 				{
 					// Disk texture
-					std::string strFilePath = m_strDirectory + '/' + strPath;
-					ID3D11ShaderResourceView *pTexture = nullptr;
-					LoadDiskTexture(strFilePath, &pTexture);
-					textures.push_back(pTexture);
+					textures.push_back(LoadDiskTexture(m_strDirectory + '/' + strPath));
+
+					// Only the first texture is used when rendering
+					if (textures.size() == 1 && strPath.size() < MAX_COOKED_TEXTURE_PATH_LENGTH)
+					{
+						strcpy_s(cookedMaterial.texturePath, strPath.c_str());
+					}
 				}
 			}
 		}
@@ -201,31 +734,47 @@ std::vector<ID3D11ShaderResourceView*> Model::LoadMaterialTextures(aiMaterial *p
 	return textures;
 }
 
-void Model::LoadEmbeddedTexture(const uint8_t *pData, size_t size, ID3D11ShaderResourceView *pTexture)
+// The textures are shared through the cache, so meshes using the same file or colour (even from other models) use the same texture
+
+ID3D11ShaderResourceView* Model::LoadEmbeddedTexture(const uint8_t *pData, size_t size)
 {
-	HRESULT result = CreateWICTextureFromMemory(m_pDevice, pData, size, nullptr, &pTexture);
-	if (FAILED(result))
-	{
-		pTexture = m_pDefaultTexture;
-	}
+	ID3D11ShaderResourceView *pTexture = m_pTextureCache->GetMemoryTexture(pData, size);
+	return pTexture != nullptr ? pTexture : GetDefaultTexture();
 }
 
-void Model::LoadDiskTexture(std::string strFilePath, ID3D11ShaderResourceView **pTexture)
+ID3D11ShaderResourceView* Model::LoadDiskTexture(std::string strFilePath)
 {
-	std::wstring wstrFilePath(strFilePath.begin(), strFilePath.end());
+	ID3D11ShaderResourceView *pTexture = m_pTextureCache->GetFileTexture(strFilePath);
+	return pTexture != nullptr ? pTexture : GetDefaultTexture();
+}
 
-	HRESULT result = S_OK;
-	if (Utils::GetFileExtension(strFilePath) == "dds")
+ID3D11ShaderResourceView* Model::LoadColorTexture(unsigned char color[4])
+{
+	ID3D11ShaderResourceView *pTexture = m_pTextureCache->GetColorTexture(color);
+	return pTexture != nullptr ? pTexture : GetDefaultTexture();
+}
+
+ID3D11ShaderResourceView* Model::LoadCookedMaterialTexture(const CookedSubmesh &cookedMaterial)
+{
+	// Recreate the material the same way LoadMaterialTextures does
+	if (cookedMaterial.texturePath[0] != '\0')
 	{
-		result = CreateDDSTextureFromFile(m_pDevice, wstrFilePath.c_str(), nullptr, pTexture);
-	}
-	else {
-		result = CreateWICTextureFromFile(m_pDevice, wstrFilePath.c_str(), nullptr, pTexture);
+		return LoadDiskTexture(m_strDirectory + '/' + cookedMaterial.texturePath);
 	}
-	if (FAILED(result))
+	else if (cookedMaterial.diffuseColor[3] > 0.0f)
 	{
-		pTexture = &m_pDefaultTexture;
+		unsigned char color[] = { cookedMaterial.diffuseColor[0] * 255, cookedMaterial.diffuseColor[1] * 255, cookedMaterial.diffuseColor[2] * 255, 255 };
+		return LoadColorTexture(color);
 	}
+
+	return GetDefaultTexture();
+}
+
+ID3D11ShaderResourceView* Model::GetDefaultTexture()
+{
+	// Meshes release their textures when they are deleted, so each mesh using the default texture needs its own reference
+	m_pDefaultTexture->AddRef();
+	return m_pDefaultTexture;
 }
 
 HRESULT Model::Create1x1ColorTexture(ID3D11Device *pDevice, unsigned char color[4], ID3D11ShaderResourceView **pTexture)
@@ -239,7 +788,7 @@ HRESULT Model::Create1x1ColorTexture(ID3D11Device *pDevice, unsigned char color[
 	subresourceData.SysMemPitch = sizeof(color);
 
 	ID3D11Texture2D *p2DTexture;
-	result = pDevice->CreateTexture2D(&textureDesc, &subresourceData, &p2DTexture);
+	TaskGraph::RunOnDeviceThread([&] { result = pDevice->CreateTexture2D(&textureDesc, &subresourceData, &p2DTexture); });
 	if (FAILED(result))
 	{
 		Utils::ShowError("Failed to initialize texture from color data.", result);
@@ -250,12 +799,31 @@ HRESULT Model::Create1x1ColorTexture(ID3D11Device *pDevice, unsigned char color[
 
 	CD3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc(D3D11_SRV_DIMENSION_TEXTURE2D, textureDesc.Format);
 
-	result = pDevice->CreateShaderResourceView(pResource, &shaderResourceViewDesc, pTexture);
+	TaskGraph::RunOnDeviceThread([&] { result = pDevice->CreateShaderResourceView(pResource, &shaderResourceViewDesc, pTexture); });
+	SAFE_RELEASE(p2DTexture); // The view holds a reference to the texture
 	if (FAILED(result))
 	{
 		Utils::ShowError("Failed to create shader resource view from texture generated from color data.", result);
 		return result;
 	}
+
+	return result;
+}
+
+void Model::ReleaseCpuGeometry()
+{
+	for (auto mesh : m_meshes)
+	{
+		mesh->ReleaseCpuInstances();
+	}
+}
+
+void Model::TrackResidency(ResidencyTracker &tracker, const std::string &strAssetName)
+{
+	for (auto mesh : m_meshes)
+	{
+		mesh->TrackResidency(tracker, strAssetName);
+	}
 }
 
 #pragma endregion
@@ -402,9 +970,10 @@ void Model::AddTubeMesh(float fInnerRadius, float fOuterRadius, float fHeight, U
 	}
 
 	// Create mesh
-	std::vector<ID3D11ShaderResourceView*> textures = { m_pDefaultTexture };
-	Mesh *pMesh = new Mesh(textures, transformMatrix);
-	if (!pMesh->InitializeBuffers(m_pDevice, vertices, indices, 1))
+	std::vector<ID3D11ShaderResourceView*> textures = { GetDefaultTexture() };
+	Mesh *pMesh = new Mesh(textures, transformMatrix, m_vertexFormat);
+	pMesh->SetMeshletsEnabled(m_bMeshletsEnabled);
+	if (!InitializeMesh(pMesh, vertices, indices, 1, nullptr, {}))
 	{
 		MessageBox(0, "Failed to initialize tube vertex and index buffers.", "", 0);
 	}
@@ -438,9 +1007,10 @@ void Model::AddCylinderMesh(float fRadius, float fHeight, UINT uiSubdivisions, X
 	}
 
 	// Create mesh
-	std::vector<ID3D11ShaderResourceView*> textures = { m_pDefaultTexture };
-	Mesh *pMesh = new Mesh(textures, transformMatrix);
-	if (!pMesh->InitializeBuffers(m_pDevice, vertices, indices, 1))
+	std::vector<ID3D11ShaderResourceView*> textures = { GetDefaultTexture() };
+	Mesh *pMesh = new Mesh(textures, transformMatrix, m_vertexFormat);
+	pMesh->SetMeshletsEnabled(m_bMeshletsEnabled);
+	if (!InitializeMesh(pMesh, vertices, indices, 1, nullptr, {}))
 	{
 		MessageBox(0, "Failed to initialize cylinder vertex and index buffers.", "", 0);
 	}
@@ -448,7 +1018,7 @@ void Model::AddCylinderMesh(float fRadius, float fHeight, UINT uiSubdivisions, X
 	m_meshes.push_back(pMesh);
 }
 
-void Model::AddBoxMesh(XMFLOAT3 size, XMMATRIX transformMatrix)
+void Model::AddBoxMesh(XMFLOAT3 size, XMMATRIX transformMatrix, int iInstanceCount, Instance *instances)
 {
 	std::vector<DirectX::VertexPositionNormalTexture> gpVertices;
 	std::vector<uint16_t> gpIndices;
@@ -474,9 +1044,10 @@ void Model::AddBoxMesh(XMFLOAT3 size, XMMATRIX transformMatrix)
 	}
 
 	// Create mesh
-	std::vector<ID3D11ShaderResourceView*> textures = { m_pDefaultTexture };
-	Mesh *pMesh = new Mesh(textures, transformMatrix);
-	if (!pMesh->InitializeBuffers(m_pDevice, vertices, indices, 1))
+	std::vector<ID3D11ShaderResourceView*> textures = { GetDefaultTexture() };
+	Mesh *pMesh = new Mesh(textures, transformMatrix, m_vertexFormat);
+	pMesh->SetMeshletsEnabled(m_bMeshletsEnabled);
+	if (!InitializeMesh(pMesh, vertices, indices, iInstanceCount, instances, {}))
 	{
 		MessageBox(0, "Failed to initialize cube vertex and index buffers.", "", 0);
 	}
@@ -506,6 +1077,40 @@ int Model::GetInstanceCount()
 	return m_iInstanceCount;
 }
 
+void Model::SetImportProfile(ImportProfile importProfile)
+{
+	m_importProfile = importProfile;
+}
+
+void Model::SetVertexFormat(VertexFormat vertexFormat)
+{
+	// Applies to meshes created afterwards
+	m_vertexFormat = vertexFormat;
+}
+
+void Model::SetLodSettings(std::vector<LodSetting> lodSettings)
+{
+	// Applies to models initialized afterwards (ordered from the most to the least detailed)
+	m_lodSettings = lodSettings;
+}
+
+void Model::SetMeshletsEnabled(bool bEnabled)
+{
+	// Applies to meshes created afterwards
+	m_bMeshletsEnabled = bEnabled;
+}
+
+void Model::SetStaticBatchingEnabled(bool bEnabled, std::vector<int> animatedMeshIndices)
+{
+	m_bStaticBatchingEnabled = bEnabled;
+	m_animatedMeshIndices = animatedMeshIndices;
+}
+
+void Model::SetReadQueue(FileReadQueue *pReadQueue)
+{
+	m_pReadQueue = pReadQueue;
+}
+
 void Model::SetWorldMatrix(XMMATRIX worldMatrix)
 {
 	m_worldMatrix = worldMatrix;
@@ -525,6 +1130,51 @@ XMMATRIX Model::GetWorldMatrix()
 	return m_worldMatrix;
 }
 
+BoundingBox Model::GetBoundingBox()
+{
+	// World space bounds enclosing every mesh (and every instance of each mesh)
+	BoundingBox boundingBox;
+	bool bIsEmpty = true;
+	for (auto mesh : m_meshes)
+	{
+		for (int i = 0; i < mesh->GetInstanceCount(); i++)
+		{
+			if (bIsEmpty)
+			{
+				boundingBox = mesh->GetInstanceBoundingBox(i);
+				bIsEmpty = false;
+			}
+			else
+			{
+				BoundingBox::CreateMerged(boundingBox, boundingBox, mesh->GetInstanceBoundingBox(i));
+			}
+		}
+	}
+	return boundingBox;
+}
+
+BoundingSphere Model::GetBoundingSphere()
+{
+	BoundingSphere boundingSphere;
+	bool bIsEmpty = true;
+	for (auto mesh : m_meshes)
+	{
+		for (int i = 0; i < mesh->GetInstanceCount(); i++)
+		{
+			if (bIsEmpty)
+			{
+				boundingSphere = mesh->GetInstanceBoundingSphere(i);
+				bIsEmpty = false;
+			}
+			else
+			{
+				BoundingSphere::CreateMerged(boundingSphere, boundingSphere, mesh->GetInstanceBoundingSphere(i));
+			}
+		}
+	}
+	return boundingSphere;
+}
+
 XMFLOAT4 Model::GetAmbientColor()
 {
 	return m_ambientColor;
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <directxmath.h>
 #include <DirectXTK/GeometricPrimitive.h>
 #include <DirectXTK/DDSTextureLoader.h>
@@ -16,22 +17,68 @@
 #include <Assimp/postprocess.h>
 #include <Assimp/scene.h>
 #include "Mesh.h"
+#include "MeshSimplifier.h"
+#include "CookedMesh.h"
+#include "ObjModelValidator.h"
+#include "ReadQueueIOSystem.h"
+#include "TextureCache.h"
+#include "Profiler.h"
 #include "Utils.h"
 
 using namespace DirectX;
 
+#define COOKED_MESH_DIRECTORY "Resources/Cooked/"
+#define COOKED_MESH_COMPRESSION true	// Compress the vertices and indices of cooked meshes (smaller files, decoded when they are opened)
+
+enum ImportProfile : int
+{
+	FastImportProfile = 0,		// Triangulated and converted to left-handed coordinates only (OBJ files are loaded with ObjModelParser, which also welds)
+	OptimizedImportProfile,		// Also welded and reordered for the vertex cache, the meshes are kept as they are (so they can be transformed by index)
+	MergedImportProfile,		// Also merges meshes and collapses the node graph where the transforms allow it (the mesh order changes)
+	StaticPropImportProfile,	// Also bakes the node transforms into the vertices, leaving one mesh per material (for models without moving parts)
+	ImportProfileCount
+};
+
+struct ImportStats
+{
+	UINT uiMeshCount;
+	UINT uiVertexCount;
+	UINT uiIndexCount;
+	UINT uiCacheMissCount;				// Simulated post-transform vertex cache misses when drawing every mesh once
+	float fMilliseconds;
+};
+
+struct LodSetting
+{
+	float fTriangleRatio;				// Fraction of the full detail triangle count (0 to 1)
+	float fMaxScreenCoverage;			// Largest projected diameter (fraction of the screen height) the LOD is used for
+};
+
 class Model
 {
 public:
-	Model(ID3D11Device *pDevice, ID3D11DeviceContext *pImmediateContext, ID3D11ShaderResourceView *pDefaultTexture);
+	Model(ID3D11Device *pDevice, ID3D11DeviceContext *pImmediateContext, ID3D11ShaderResourceView *pDefaultTexture, TextureCache *pTextureCache);
 	~Model();
 
 	void SetTextures(std::vector<ID3D11ShaderResourceView*> textures);
 	std::vector<Mesh*> GetMeshes();
 	int GetInstanceCount();
+	void SetVertexFormat(VertexFormat vertexFormat);
+	// Only used when the model is imported, cooked meshes are reimported if they were imported with another profile
+	void SetImportProfile(ImportProfile importProfile);
+	void SetLodSettings(std::vector<LodSetting> lodSettings);
+	void SetMeshletsEnabled(bool bEnabled);
+	// Meshes that share a material are pre-transformed and merged into one mesh when the model is imported
+	// Animated meshes (by import index) are kept separate and come first, in import order, followed by one mesh per material
+	void SetStaticBatchingEnabled(bool bEnabled, std::vector<int> animatedMeshIndices = {});
+	// The model file (and the files Assimp imports with it) are taken from the queue if they were submitted to it, rather than read again
+	// The queue has to outlive the call to Initialize
+	void SetReadQueue(FileReadQueue *pReadQueue);
 	void SetWorldMatrix(XMMATRIX worldMatrix);
 	void SetWorldMatrixOfMesh(XMMATRIX worldMatrix, int iMeshIndex);
 	XMMATRIX GetWorldMatrix();
+	BoundingBox GetBoundingBox();
+	BoundingSphere GetBoundingSphere();
 	XMFLOAT4 GetAmbientColor();
 	XMFLOAT4 GetDiffuseColor();
 	void SetSpecularColor(XMFLOAT4 color);
@@ -47,21 +94,59 @@ public:
 	void SetPointLightPosition(XMFLOAT3 position);
 	XMFLOAT3 GetPointLightPosition();
 
+	// OBJ files are loaded with ObjModelParser, other formats with Assimp
 	bool Initialize(std::string strFilePath, int iInstanceCount, Instance *instances = nullptr);
+	// Uses the vertex and index buffers of a model loaded from the same file (it must have the same vertex format and meshlet setting)
+	// The meshes get their own instances, textures and transforms, so the models can be placed and textured independently
+	// Returns false if the source model has no buffers to share or an instance buffer cannot be created
+	bool InitializeShared(Model *pSourceModel, int iInstanceCount, Instance *instances = nullptr);
+	// Placeholder box with the bounds of the model's cooked mesh, drawn while the model itself is loading
+	// Fails if the file has never been cooked (the bounds of an outdated cooked mesh are still used)
+	bool InitializeProxy(std::string strFilePath, int iInstanceCount, Instance *instances = nullptr);
+	// Fails if the cooked mesh is missing or was cooked from other source data
+	// Meshes cooked with other settings (or by the asset cooker) have their LODs and meshlets rebuilt and are cooked again
+	bool LoadCookedMesh(std::string strCookedFilePath, uint64_t sourceHash, int iInstanceCount, Instance *instances = nullptr);
+	// Meshes created between these calls are written to a cooked mesh
+	void BeginCooking();
+	bool EndCooking(std::string strCookedFilePath, uint64_t sourceHash);
+	static std::string GetCookedFilePath(std::string strName);
+	// Imports the file with every profile (without creating any meshes) and reports the stats of each
+	static std::string CompareImportProfiles(std::string strFilePath);
 	static HRESULT Create1x1ColorTexture(ID3D11Device *pDevice, unsigned char color[4], ID3D11ShaderResourceView **pTexture);
+	// The vertices and indices are never kept after the buffers are created, so only the instances of the meshes are freed
+	void ReleaseCpuGeometry();
+	void TrackResidency(ResidencyTracker &tracker, const std::string &strAssetName);
 
 	void GenerateCogwheel(); // Test function
 	void AddTubeMesh(float fInnerRadius, float fOuterRadius, float fHeight, UINT uiSubdivisions, XMMATRIX transformMatrix);
 	void AddCylinderMesh(float fRadius, float fHeight, UINT uiSubdivisions, XMMATRIX transformMatrix);
-	void AddBoxMesh(XMFLOAT3 size, XMMATRIX transformMatrix);
+	void AddBoxMesh(XMFLOAT3 size, XMMATRIX transformMatrix, int iInstanceCount = 1, Instance *instances = nullptr);
 
 private:
+	// Imported geometry and material of a mesh, before its buffers are created
+	struct ImportedMesh
+	{
+		std::vector<Vertex> vertices;
+		std::vector<DWORD> indices;
+		XMMATRIX transformMatrix;
+		std::vector<ID3D11ShaderResourceView*> textures;	// The mesh takes over these references
+		CookedSubmesh cookedMaterial;
+	};
+
 	ID3D11Device *m_pDevice;
 	ID3D11DeviceContext *m_pImmediateContext;
 	ID3D11ShaderResourceView *m_pDefaultTexture;
+	TextureCache *m_pTextureCache;
 	std::string m_strDirectory;
 	std::vector<Mesh*> m_meshes;
 	int m_iInstanceCount;
+	VertexFormat m_vertexFormat;
+	ImportProfile m_importProfile;
+	std::vector<LodSetting> m_lodSettings;
+	bool m_bMeshletsEnabled;
+	bool m_bStaticBatchingEnabled;
+	std::vector<int> m_animatedMeshIndices;
+	FileReadQueue *m_pReadQueue;
 	XMMATRIX m_worldMatrix;
 	XMFLOAT4 m_ambientColor;
 	XMFLOAT4 m_diffuseColor;
@@ -71,10 +156,28 @@ private:
 	XMFLOAT3 m_pointLightColor;
 	float m_fPointLightStrength;
 	XMFLOAT3 m_pointLightPosition;
+	CookedMeshWriter *m_pCookedMeshWriter;
+	bool m_bIsCookable;									// Embedded textures cannot be cooked
 
-	void ProcessNode(aiNode *pNode, const aiScene *pScene, XMMATRIX parentTransformMatrix, int iInstanceCount, Instance *instances = nullptr);
-	Mesh* ProcessMesh(aiMesh *pAiMesh, const aiScene *pScene, XMMATRIX transformMatrix, int iInstanceCount, Instance *instances = nullptr);
-	std::vector<ID3D11ShaderResourceView*> LoadMaterialTextures(aiMaterial *pMaterial, aiTextureType textureType, const aiScene *pScene);
-	void LoadEmbeddedTexture(const uint8_t *pData, size_t size, ID3D11ShaderResourceView *pTexture);
-	void LoadDiskTexture(std::string strFilePath, ID3D11ShaderResourceView **pTexture);
+	void ProcessNode(aiNode *pNode, const aiScene *pScene, XMMATRIX parentTransformMatrix, std::vector<ImportedMesh> &importedMeshes);
+	ImportedMesh ProcessMesh(aiMesh *pAiMesh, const aiScene *pScene, XMMATRIX transformMatrix);
+	ImportedMesh ProcessObjSubmesh(ObjSubmesh &objSubmesh);
+	void BatchMeshes(std::vector<ImportedMesh> &importedMeshes);
+	void GenerateLods(Mesh *pMesh, std::vector<Vertex> &vertices, std::vector<DWORD> &indices);
+	bool InitializeMesh(Mesh *pMesh, std::vector<Vertex> &vertices, std::vector<DWORD> &indices, int iInstanceCount, Instance *instances, 
+						const CookedSubmesh &cookedMaterial);
+	uint64_t GetCookSettingsHash();
+	static unsigned int GetImportFlags(ImportProfile importProfile);
+	static ImportStats GetImportStats(const aiScene *pScene);
+	static ImportStats GetImportStats(std::vector<ObjSubmesh> &objSubmeshes);
+	static UINT CountCacheMisses(const std::vector<DWORD> &indices, UINT uiVertexCount);
+	static std::string GetImportReport(std::string strFilePath, ImportProfile importProfile, ImportStats stats);
+	std::vector<ID3D11ShaderResourceView*> LoadMaterialTextures(aiMaterial *pMaterial, aiTextureType textureType, const aiScene *pScene, 
+																CookedSubmesh &cookedMaterial);
+	ID3D11ShaderResourceView* LoadEmbeddedTexture(const uint8_t *pData, size_t size);
+	ID3D11ShaderResourceView* LoadDiskTexture(std::string strFilePath);
+	ID3D11ShaderResourceView* LoadColorTexture(unsigned char color[4]);
+	// The texture of a material without embedded textures, as recorded in a cooked submesh
+	ID3D11ShaderResourceView* LoadCookedMaterialTexture(const CookedSubmesh &cookedMaterial);
+	ID3D11ShaderResourceView* GetDefaultTexture();
 };
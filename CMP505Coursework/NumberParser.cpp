@@ -0,0 +1,81 @@
+//
+// NumberParser.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// std::from_chars (https://en.cppreference.com/w/cpp/utility/from_chars)
+//
+
+#include <cstdlib>
+#include "NumberParser.h"
+
+#if (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+#define MAX_NUMBER_LENGTH 63 // Only used by the fallback float conversion
+
+const char* NumberParser::SkipWhitespace(const char *pCurrent, const char *pEnd)
+{
+	// Spaces, tabs, carriage returns and line feeds are all at or below ' '
+	while (pCurrent < pEnd && static_cast<unsigned char>(*pCurrent) <= ' ')
+	{
+		pCurrent++;
+	}
+	return pCurrent;
+}
+
+const char* NumberParser::ParseInt(const char *pCurrent, const char *pEnd, int &iValue)
+{
+	pCurrent = SkipWhitespace(pCurrent, pEnd);
+
+#if defined(__cpp_lib_to_chars)
+	std::from_chars_result result = std::from_chars(pCurrent, pEnd, iValue);
+	return result.ec == std::errc() ? result.ptr : nullptr;
+#else
+	bool bIsNegative = pCurrent < pEnd && *pCurrent == '-';
+	if (bIsNegative)
+	{
+		pCurrent++;
+	}
+
+	const char *pStart = pCurrent;
+	iValue = 0;
+	while (pCurrent < pEnd && static_cast<unsigned int>(*pCurrent - '0') < 10)
+	{
+		iValue = iValue * 10 + (*pCurrent - '0');
+		pCurrent++;
+	}
+	if (bIsNegative)
+	{
+		iValue = -iValue;
+	}
+	return pCurrent == pStart ? nullptr : pCurrent;
+#endif
+}
+
+const char* NumberParser::ParseFloat(const char *pCurrent, const char *pEnd, float &fValue)
+{
+	pCurrent = SkipWhitespace(pCurrent, pEnd);
+
+#if defined(__cpp_lib_to_chars)
+	// Locale independent and correctly rounded, like the stream extraction it replaces
+	std::from_chars_result result = std::from_chars(pCurrent, pEnd, fValue);
+	return result.ec == std::errc() ? result.ptr : nullptr;
+#else
+	// Floating point from_chars is not available in older standard libraries
+	// strtof needs a null-terminated string and the mapped file is not, so the token is copied first
+	char buffer[MAX_NUMBER_LENGTH + 1];
+	size_t length = 0;
+	while (pCurrent + length < pEnd && length < MAX_NUMBER_LENGTH && static_cast<unsigned char>(pCurrent[length]) > ' ')
+	{
+		buffer[length] = pCurrent[length];
+		length++;
+	}
+	buffer[length] = '\0';
+
+	char *pTokenEnd = nullptr;
+	fValue = strtof(buffer, &pTokenEnd);
+	return pTokenEnd == buffer ? nullptr : pCurrent + (pTokenEnd - buffer);
+#endif
+}
@@ -0,0 +1,20 @@
+//
+// NumberParser.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// std::from_chars (https://en.cppreference.com/w/cpp/utility/from_chars)
+//
+
+#pragma once
+
+// Number parsing on a mapped file (not null-terminated), shared by the text model and OBJ parsers
+// Does not depend on Direct3D, so the asset cooker parses OBJ files with the same code as the game
+class NumberParser
+{
+public:
+	static const char* SkipWhitespace(const char *pCurrent, const char *pEnd);
+	// Return the position after the number or nullptr if there is no number
+	static const char* ParseInt(const char *pCurrent, const char *pEnd, int &iValue);
+	static const char* ParseFloat(const char *pCurrent, const char *pEnd, float &fValue);
+};
@@ -0,0 +1,811 @@
+//
+// ObjModelParser.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Wavefront .obj file (http://paulbourke.net/dataformats/obj/)
+// MTL material format (http://paulbourke.net/dataformats/mtl/)
+// Open Asset Import Library: ObjFileParser, TriangulateProcess and ConvertToLHProcess (https://github.com/assimp/assimp)
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "ObjModelParser.h"
+
+#define MIN_CHUNK_SIZE 65536			// Smaller files are not worth splitting across threads
+#define DEFAULT_DIFFUSE_COLOR 0.6f		// Assimp's diffuse color for missing materials and materials without Kd
+#define PI 3.141592654f
+
+namespace
+{
+	// The parser is also built into the asset cooker, which does not have DirectXMath
+	struct Float2
+	{
+		float x;
+		float y;
+	};
+
+	struct Float3
+	{
+		float x;
+		float y;
+		float z;
+	};
+
+	Float3 Subtract(const Float3 &a, const Float3 &b)
+	{
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+
+	float Dot(const Float3 &a, const Float3 &b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	Float3 Cross(const Float3 &a, const Float3 &b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	// Zero length vectors stay zero, like XMVector3Normalize
+	Float3 Normalize(const Float3 &vector)
+	{
+		float fLength = sqrtf(Dot(vector, vector));
+		if (fLength == 0.0f)
+		{
+			return { 0.0f, 0.0f, 0.0f };
+		}
+		return { vector.x / fLength, vector.y / fLength, vector.z / fLength };
+	}
+
+	// Indices are resolved to absolute (0 based) indices while parsing, -1 if the corner does not have the element
+	struct ObjCorner
+	{
+		int iPosition;
+		int iTextureCoordinates;
+		int iNormal;
+
+		bool operator==(const ObjCorner &other) const
+		{
+			return iPosition == other.iPosition && iTextureCoordinates == other.iTextureCoordinates && iNormal == other.iNormal;
+		}
+	};
+
+	struct ObjCornerHasher
+	{
+		size_t operator()(const ObjCorner &corner) const
+		{
+			return static_cast<size_t>(corner.iPosition) * 73856093u ^ static_cast<size_t>(corner.iTextureCoordinates) * 19349663u ^
+				   static_cast<size_t>(corner.iNormal) * 83492791u;
+		}
+	};
+
+	struct ObjFace
+	{
+		int iFirstCorner;
+		int iCornerCount;
+	};
+
+	enum ObjStatementType
+	{
+		GroupStatement,			// g and o
+		MaterialStatement		// usemtl
+	};
+
+	struct ObjStatement
+	{
+		ObjStatementType type;
+		int iFaceIndex;			// Number of faces in the chunk before the statement
+		std::string strName;
+	};
+
+	// Line-aligned part of the file, parsed on its own thread
+	struct ObjChunk
+	{
+		const char *pBegin;
+		const char *pEnd;
+		int iPositionCount;
+		int iTextureCoordinateCount;
+		int iNormalCount;
+		int iPositionOffset;			// Elements in the chunks before this one
+		int iTextureCoordinateOffset;
+		int iNormalOffset;
+		std::vector<ObjCorner> corners;
+		std::vector<ObjFace> faces;
+		std::vector<ObjStatement> statements;
+		std::vector<std::string> materialLibraries;
+		bool bIsValid;
+	};
+
+	struct ObjElements
+	{
+		std::vector<Float3> positions;
+		std::vector<Float2> textureCoordinates;
+		std::vector<Float3> normals;
+	};
+
+	struct ObjFaceReference
+	{
+		int iChunkIndex;
+		int iFaceIndex;
+	};
+
+	struct ObjMaterial
+	{
+		float diffuseColor[3];
+		std::string strTexturePath;
+	};
+
+	// Calls the function with every index from 0 to iCount - 1, on up to one thread per core
+	template<typename Function>
+	void RunInParallel(int iCount, const Function &function)
+	{
+		int iThreadCount = static_cast<int>(std::thread::hardware_concurrency());
+		iThreadCount = iThreadCount < iCount ? iThreadCount : iCount;
+
+		std::atomic<int> nextIndex(0);
+		auto work = [&]
+		{
+			for (int i = nextIndex++; i < iCount; i = nextIndex++)
+			{
+				function(i);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (int i = 1; i < iThreadCount; i++)
+		{
+			threads.emplace_back(work);
+		}
+		work();
+		for (auto &thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	const char* FindLineEnd(const char *pCurrent, const char *pEnd)
+	{
+		const char *pLineEnd = static_cast<const char*>(memchr(pCurrent, '\n', pEnd - pCurrent));
+		return pLineEnd == nullptr ? pEnd : pLineEnd;
+	}
+
+	const char* SkipSpaces(const char *pCurrent, const char *pLineEnd)
+	{
+		while (pCurrent < pLineEnd && (*pCurrent == ' ' || *pCurrent == '\t'))
+		{
+			pCurrent++;
+		}
+		return pCurrent;
+	}
+
+	// The keyword has to be followed by whitespace or the end of the line
+	template<size_t N>
+	bool IsKeyword(const char *pCurrent, const char *pLineEnd, const char (&keyword)[N])
+	{
+		const size_t length = N - 1;
+		return static_cast<size_t>(pLineEnd - pCurrent) >= length && memcmp(pCurrent, keyword, length) == 0 &&
+			   (pCurrent + length == pLineEnd || static_cast<unsigned char>(pCurrent[length]) <= ' ');
+	}
+
+	// Names (groups, materials and files) are the rest of the line without the surrounding whitespace
+	std::string GetRestOfLine(const char *pCurrent, const char *pLineEnd)
+	{
+		pCurrent = SkipSpaces(pCurrent, pLineEnd);
+		while (pLineEnd > pCurrent && static_cast<unsigned char>(pLineEnd[-1]) <= ' ')
+		{
+			pLineEnd--;
+		}
+		return std::string(pCurrent, pLineEnd);
+	}
+
+	// Material libraries are relative to the directory of the OBJ file
+	std::string GetMaterialLibraryPath(const char *filePath, const std::string &strMaterialLibrary)
+	{
+		const char *pSeparator = strrchr(filePath, '/');
+		const char *pBackslash = strrchr(filePath, '\\');
+		pSeparator = pBackslash > pSeparator ? pBackslash : pSeparator;
+		if (pSeparator == nullptr)
+		{
+			return strMaterialLibrary;
+		}
+		return std::string(filePath, pSeparator) + '/' + strMaterialLibrary;
+	}
+
+	// OBJ indices start at 1, and negative indices count back from the last element defined so far
+	int ResolveIndex(int iIndex, int iDefinedCount)
+	{
+		if (iIndex > 0)
+		{
+			return iIndex - 1;
+		}
+		return iIndex < 0 ? iDefinedCount + iIndex : -1;
+	}
+
+	void CountElements(ObjChunk &chunk)
+	{
+		for (const char *pLine = chunk.pBegin; pLine < chunk.pEnd; )
+		{
+			const char *pLineEnd = FindLineEnd(pLine, chunk.pEnd);
+			const char *pCurrent = SkipSpaces(pLine, pLineEnd);
+			if (pCurrent < pLineEnd && *pCurrent == 'v')
+			{
+				if (IsKeyword(pCurrent, pLineEnd, "v"))
+				{
+					chunk.iPositionCount++;
+				}
+				else if (IsKeyword(pCurrent, pLineEnd, "vt"))
+				{
+					chunk.iTextureCoordinateCount++;
+				}
+				else if (IsKeyword(pCurrent, pLineEnd, "vn"))
+				{
+					chunk.iNormalCount++;
+				}
+			}
+			pLine = pLineEnd < chunk.pEnd ? pLineEnd + 1 : chunk.pEnd;
+		}
+	}
+
+	const char* ParseFloats(const char *pCurrent, const char *pLineEnd, float *pValues, int iCount)
+	{
+		for (int i = 0; i < iCount && pCurrent != nullptr; i++)
+		{
+			pCurrent = NumberParser::ParseFloat(pCurrent, pLineEnd, pValues[i]);
+		}
+		return pCurrent;
+	}
+
+	// Each chunk writes its elements at its own offsets, so the chunks can be parsed at the same time
+	void ParseChunk(ObjChunk &chunk, ObjElements &elements)
+	{
+		int iPositionCount = chunk.iPositionOffset;
+		int iTextureCoordinateCount = chunk.iTextureCoordinateOffset;
+		int iNormalCount = chunk.iNormalOffset;
+
+		for (const char *pLine = chunk.pBegin; pLine < chunk.pEnd; )
+		{
+			const char *pLineEnd = FindLineEnd(pLine, chunk.pEnd);
+			const char *pCurrent = SkipSpaces(pLine, pLineEnd);
+			pLine = pLineEnd < chunk.pEnd ? pLineEnd + 1 : chunk.pEnd;
+			if (pCurrent == pLineEnd)
+			{
+				continue;
+			}
+
+			if (IsKeyword(pCurrent, pLineEnd, "v"))
+			{
+				pCurrent = ParseFloats(pCurrent + 1, pLineEnd, &elements.positions[iPositionCount++].x, 3);
+			}
+			else if (IsKeyword(pCurrent, pLineEnd, "vt"))
+			{
+				// The optional third coordinate is ignored
+				pCurrent = ParseFloats(pCurrent + 2, pLineEnd, &elements.textureCoordinates[iTextureCoordinateCount++].x, 2);
+			}
+			else if (IsKeyword(pCurrent, pLineEnd, "vn"))
+			{
+				pCurrent = ParseFloats(pCurrent + 2, pLineEnd, &elements.normals[iNormalCount++].x, 3);
+			}
+			else if (IsKeyword(pCurrent, pLineEnd, "f"))
+			{
+				// Corners are "v", "v/vt", "v//vn" or "v/vt/vn"
+				ObjFace face = { static_cast<int>(chunk.corners.size()), 0 };
+				pCurrent = SkipSpaces(pCurrent + 1, pLineEnd);
+				while (pCurrent != nullptr && pCurrent < pLineEnd && static_cast<unsigned char>(*pCurrent) > ' ')
+				{
+					ObjCorner corner = { -1, -1, -1 };
+					int iIndex = 0;
+					pCurrent = NumberParser::ParseInt(pCurrent, pLineEnd, iIndex);
+					corner.iPosition = ResolveIndex(iIndex, iPositionCount);
+					if (pCurrent != nullptr && pCurrent < pLineEnd && *pCurrent == '/')
+					{
+						pCurrent++;
+						if (pCurrent < pLineEnd && *pCurrent != '/')
+						{
+							pCurrent = NumberParser::ParseInt(pCurrent, pLineEnd, iIndex);
+							corner.iTextureCoordinates = ResolveIndex(iIndex, iTextureCoordinateCount);
+						}
+						if (pCurrent != nullptr && pCurrent < pLineEnd && *pCurrent == '/')
+						{
+							pCurrent = NumberParser::ParseInt(pCurrent + 1, pLineEnd, iIndex);
+							corner.iNormal = ResolveIndex(iIndex, iNormalCount);
+						}
+					}
+					if (pCurrent == nullptr || corner.iPosition < 0)
+					{
+						pCurrent = nullptr;
+						break;
+					}
+
+					chunk.corners.push_back(corner);
+					face.iCornerCount++;
+					pCurrent = SkipSpaces(pCurrent, pLineEnd);
+				}
+				chunk.faces.push_back(face);
+			}
+			else if (IsKeyword(pCurrent, pLineEnd, "g") || IsKeyword(pCurrent, pLineEnd, "o"))
+			{
+				chunk.statements.push_back({ GroupStatement, static_cast<int>(chunk.faces.size()), GetRestOfLine(pCurrent + 1, pLineEnd) });
+			}
+			else if (IsKeyword(pCurrent, pLineEnd, "usemtl"))
+			{
+				chunk.statements.push_back({ MaterialStatement, static_cast<int>(chunk.faces.size()), GetRestOfLine(pCurrent + 6, pLineEnd) });
+			}
+			else if (IsKeyword(pCurrent, pLineEnd, "mtllib"))
+			{
+				chunk.materialLibraries.push_back(GetRestOfLine(pCurrent + 6, pLineEnd));
+			}
+
+			if (pCurrent == nullptr)
+			{
+				chunk.bIsValid = false;
+				return;
+			}
+		}
+	}
+
+	// Only the diffuse color and texture are used when rendering
+	void ParseMaterialLibrary(const std::string &strFilePath, std::map<std::string, ObjMaterial> &materials)
+	{
+		MappedFile file;
+		if (!file.Open(strFilePath.c_str()))
+		{
+			return;
+		}
+
+		const char *pEnd = file.GetData() + file.GetSize();
+		ObjMaterial *pMaterial = nullptr;
+		for (const char *pLine = file.GetData(); pLine < pEnd; )
+		{
+			const char *pLineEnd = FindLineEnd(pLine, pEnd);
+			const char *pCurrent = SkipSpaces(pLine, pLineEnd);
+			pLine = pLineEnd < pEnd ? pLineEnd + 1 : pEnd;
+
+			if (IsKeyword(pCurrent, pLineEnd, "newmtl"))
+			{
+				pMaterial = &materials[GetRestOfLine(pCurrent + 6, pLineEnd)];
+				*pMaterial = { { DEFAULT_DIFFUSE_COLOR, DEFAULT_DIFFUSE_COLOR, DEFAULT_DIFFUSE_COLOR }, "" };
+			}
+			else if (pMaterial != nullptr && IsKeyword(pCurrent, pLineEnd, "Kd"))
+			{
+				ParseFloats(pCurrent + 2, pLineEnd, pMaterial->diffuseColor, 3);
+			}
+			else if (pMaterial != nullptr && IsKeyword(pCurrent, pLineEnd, "map_Kd"))
+			{
+				pMaterial->strTexturePath = GetRestOfLine(pCurrent + 6, pLineEnd);
+			}
+		}
+	}
+
+	// Assimp starts fanning a quad from its concave corner (a quad has at most one)
+	int GetQuadStartCorner(const std::vector<Float3> &positions)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			const Float3 &position = positions[i];
+			Float3 left = Normalize(Subtract(positions[(i + 3) % 4], position));
+			Float3 diagonal = Normalize(Subtract(positions[(i + 2) % 4], position));
+			Float3 right = Normalize(Subtract(positions[(i + 1) % 4], position));
+			float fAngle = acosf(Dot(left, diagonal)) + acosf(Dot(right, diagonal));
+			if (fAngle > PI)
+			{
+				return i;
+			}
+		}
+		return 0;
+	}
+
+	// Positive if the corners are clockwise
+	double GetArea2D(const Float2 &a, const Float2 &b, const Float2 &c)
+	{
+		return 0.5 * (a.x * (static_cast<double>(c.y) - b.y) + b.x * (static_cast<double>(a.y) - c.y) + c.x * (static_cast<double>(b.y) - a.y));
+	}
+
+	bool IsPointInTriangle2D(const Float2 &a, const Float2 &b, const Float2 &c, const Float2 &point)
+	{
+		// Barycentric coordinates
+		Float2 ab = { b.x - a.x, b.y - a.y };
+		Float2 ac = { c.x - a.x, c.y - a.y };
+		Float2 ap = { point.x - a.x, point.y - a.y };
+		double abab = ab.x * ab.x + ab.y * ab.y;
+		double abac = ab.x * ac.x + ab.y * ac.y;
+		double abap = ab.x * ap.x + ab.y * ap.y;
+		double acac = ac.x * ac.x + ac.y * ac.y;
+		double acap = ac.x * ap.x + ac.y * ap.y;
+
+		double inverseDenominator = 1.0 / (abab * acac - abac * abac);
+		double u = (acac * abap - abac * acap) * inverseDenominator;
+		double v = (abab * acap - abac * abap) * inverseDenominator;
+		return u > 0.0 && v > 0.0 && u + v < 1.0;
+	}
+
+	// Assimp projects larger polygons onto the plane of their Newell normal and clips ears, falling back to a fan if the polygon is not simple
+	void ClipEars(const std::vector<Float3> &positions, std::vector<int> &triangleCorners)
+	{
+		int iCornerCount = static_cast<int>(positions.size());
+		Float3 normal = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < iCornerCount; i++)
+		{
+			const Float3 &low = positions[i];
+			const Float3 &current = positions[(i + 1) % iCornerCount];
+			const Float3 &high = positions[(i + 2) % iCornerCount];
+			normal.z += current.x * (high.y - low.y);
+			normal.x += current.y * (high.z - low.z);
+			normal.y += current.z * (high.x - low.x);
+		}
+
+		// Drop the largest normal coordinate, and swap the other two if it is negative so the polygon stays counter-clockwise
+		int iFirstAxis = 0;
+		int iSecondAxis = 1;
+		float fLargest = normal.z;
+		if (fabsf(normal.x) > fabsf(normal.y))
+		{
+			if (fabsf(normal.x) > fabsf(normal.z))
+			{
+				iFirstAxis = 1;
+				iSecondAxis = 2;
+				fLargest = normal.x;
+			}
+		}
+		else if (fabsf(normal.y) > fabsf(normal.z))
+		{
+			iFirstAxis = 2;
+			iSecondAxis = 0;
+			fLargest = normal.y;
+		}
+		if (fLargest < 0.0f)
+		{
+			std::swap(iFirstAxis, iSecondAxis);
+		}
+
+		std::vector<Float2> points(iCornerCount);
+		std::vector<bool> isClipped(iCornerCount, false);
+		for (int i = 0; i < iCornerCount; i++)
+		{
+			points[i] = { (&positions[i].x)[iFirstAxis], (&positions[i].x)[iSecondAxis] };
+		}
+
+		size_t firstTriangleCorner = triangleCorners.size();
+		int iRemainingCount = iCornerCount;
+		int iPrevious = iCornerCount - 1;
+		int iNext = 0;
+		while (iRemainingCount > 3)
+		{
+			// Find the next convex corner whose triangle contains no other corner, giving up after going around twice
+			int iWrapCount = 0;
+			int iEar = iNext;
+			for (;; iPrevious = iEar, iEar = iNext)
+			{
+				for (iNext = iEar + 1; ; iNext++)
+				{
+					iNext = iNext < iCornerCount ? iNext : 0;
+					if (!isClipped[iNext])
+					{
+						break;
+					}
+				}
+				if (iNext < iEar && ++iWrapCount == 2)
+				{
+					break;
+				}
+
+				const Float2 &previous = points[iPrevious];
+				const Float2 &ear = points[iEar];
+				const Float2 &next = points[iNext];
+				if (GetArea2D(previous, ear, next) > 0.0)
+				{
+					continue;
+				}
+
+				// Corners are compared by value, since several corners can share a position
+				int i = 0;
+				for (; i < iCornerCount; i++)
+				{
+					const Float2 &point = points[i];
+					bool bIsTriangleCorner = (point.x == ear.x && point.y == ear.y) || (point.x == next.x && point.y == next.y) ||
+											 (point.x == previous.x && point.y == previous.y);
+					if (!bIsTriangleCorner && IsPointInTriangle2D(previous, ear, next, point))
+					{
+						break;
+					}
+				}
+				if (i == iCornerCount)
+				{
+					break;
+				}
+			}
+
+			if (iWrapCount == 2)
+			{
+				triangleCorners.resize(firstTriangleCorner);
+				for (int i = 1; i + 1 < iCornerCount; i++)
+				{
+					triangleCorners.insert(triangleCorners.end(), { 0, i, i + 1 });
+				}
+				return;
+			}
+
+			triangleCorners.insert(triangleCorners.end(), { iPrevious, iEar, iNext });
+			isClipped[iEar] = true;
+			iRemainingCount--;
+		}
+
+		for (int i = 0; i < iCornerCount; i++)
+		{
+			if (!isClipped[i])
+			{
+				triangleCorners.push_back(i);
+			}
+		}
+	}
+
+	// Corners of each triangle, in the order Assimp's triangulation produces them
+	void Triangulate(const std::vector<Float3> &positions, std::vector<int> &triangleCorners)
+	{
+		triangleCorners.clear();
+		if (positions.size() == 3)
+		{
+			triangleCorners = { 0, 1, 2 };
+		}
+		else if (positions.size() == 4)
+		{
+			int iStart = GetQuadStartCorner(positions);
+			triangleCorners = { iStart, (iStart + 1) % 4, (iStart + 2) % 4, iStart, (iStart + 2) % 4, (iStart + 3) % 4 };
+		}
+		else
+		{
+			ClipEars(positions, triangleCorners);
+		}
+	}
+
+	void BuildSubmesh(const std::vector<ObjFaceReference> &faceReferences, const std::vector<ObjChunk> &chunks, const ObjElements &elements,
+					  ObjSubmesh &submesh)
+	{
+		std::unordered_map<ObjCorner, uint32_t, ObjCornerHasher> vertexIndices;
+		vertexIndices.reserve(faceReferences.size() * 3);
+		submesh.indices.reserve(faceReferences.size() * 3);
+
+		std::vector<uint32_t> faceVertexIndices;
+		std::vector<Float3> facePositions;
+		std::vector<int> triangleCorners;
+		for (auto &faceReference : faceReferences)
+		{
+			const ObjChunk &chunk = chunks[faceReference.iChunkIndex];
+			const ObjFace &face = chunk.faces[faceReference.iFaceIndex];
+			const ObjCorner *corners = &chunk.corners[face.iFirstCorner];
+
+			// Assimp reverses the winding before triangulating, so the corners are visited backwards
+			faceVertexIndices.clear();
+			facePositions.clear();
+			for (int i = face.iCornerCount - 1; i >= 0; i--)
+			{
+				const ObjCorner &corner = corners[i];
+				const Float3 &position = elements.positions[corner.iPosition];
+				facePositions.push_back({ position.x, position.y, -position.z });
+
+				// Corners without a normal get the face normal, so they are not shared with other faces
+				uint32_t uiVertexIndex = static_cast<uint32_t>(submesh.vertices.size());
+				if (corner.iNormal >= 0)
+				{
+					auto result = vertexIndices.emplace(corner, uiVertexIndex);
+					if (!result.second)
+					{
+						faceVertexIndices.push_back(result.first->second);
+						continue;
+					}
+				}
+
+				// Convert to left-handed coordinates and flip the texture coordinates vertically
+				Float3 normal;
+				if (corner.iNormal >= 0)
+				{
+					normal = elements.normals[corner.iNormal];
+				}
+				else
+				{
+					// Normal of the counter-clockwise source corners, converted like the file's normals
+					const Float3 &a = elements.positions[corners[0].iPosition];
+					const Float3 &b = elements.positions[corners[1].iPosition];
+					const Float3 &c = elements.positions[corners[2].iPosition];
+					normal = Normalize(Cross(Subtract(b, a), Subtract(c, a)));
+				}
+
+				CookedVertex vertex = { { position.x, position.y, -position.z }, { 0.0f, 0.0f }, { normal.x, normal.y, -normal.z } };
+				if (corner.iTextureCoordinates >= 0)
+				{
+					const Float2 &textureCoordinates = elements.textureCoordinates[corner.iTextureCoordinates];
+					vertex.textureCoordinates[0] = textureCoordinates.x;
+					vertex.textureCoordinates[1] = 1.0f - textureCoordinates.y;
+				}
+				submesh.vertices.push_back(vertex);
+				faceVertexIndices.push_back(uiVertexIndex);
+			}
+
+			Triangulate(facePositions, triangleCorners);
+			for (auto iCorner : triangleCorners)
+			{
+				submesh.indices.push_back(faceVertexIndices[iCorner]);
+			}
+		}
+	}
+}
+
+bool ObjModelParser::Parse(const char *filePath, std::vector<ObjSubmesh> &submeshes)
+{
+	MappedFile file;
+	if (!file.Open(filePath) || file.GetSize() == 0)
+	{
+		return false;
+	}
+
+	// Split the file at line ends into a chunk per thread
+	const char *pData = file.GetData();
+	const char *pEnd = pData + file.GetSize();
+	size_t chunkCount = file.GetSize() / MIN_CHUNK_SIZE;
+	size_t threadCount = std::thread::hardware_concurrency();
+	chunkCount = chunkCount < threadCount ? chunkCount : threadCount;
+	chunkCount = chunkCount > 1 ? chunkCount : 1;
+
+	std::vector<ObjChunk> chunks;
+	const char *pChunkBegin = pData;
+	for (size_t i = 1; i <= chunkCount && pChunkBegin < pEnd; i++)
+	{
+		const char *pChunkEnd = i == chunkCount ? pEnd : FindLineEnd(pData + file.GetSize() * i / chunkCount, pEnd);
+		pChunkEnd = pChunkEnd < pEnd ? pChunkEnd + 1 : pEnd;
+		if (pChunkEnd <= pChunkBegin)
+		{
+			continue;
+		}
+
+		ObjChunk chunk = {};
+		chunk.pBegin = pChunkBegin;
+		chunk.pEnd = pChunkEnd;
+		chunk.bIsValid = true;
+		chunks.push_back(chunk);
+		pChunkBegin = pChunkEnd;
+	}
+
+	// Count the elements first, so every chunk knows where its elements go (and which elements its relative indices refer to)
+	RunInParallel(static_cast<int>(chunks.size()), [&chunks](int i) { CountElements(chunks[i]); });
+
+	ObjElements elements;
+	int iPositionCount = 0;
+	int iTextureCoordinateCount = 0;
+	int iNormalCount = 0;
+	for (auto &chunk : chunks)
+	{
+		chunk.iPositionOffset = iPositionCount;
+		chunk.iTextureCoordinateOffset = iTextureCoordinateCount;
+		chunk.iNormalOffset = iNormalCount;
+		iPositionCount += chunk.iPositionCount;
+		iTextureCoordinateCount += chunk.iTextureCoordinateCount;
+		iNormalCount += chunk.iNormalCount;
+	}
+	elements.positions.resize(iPositionCount);
+	elements.textureCoordinates.resize(iTextureCoordinateCount);
+	elements.normals.resize(iNormalCount);
+
+	RunInParallel(static_cast<int>(chunks.size()), [&chunks, &elements](int i) { ParseChunk(chunks[i], elements); });
+
+	// Faces may refer to elements defined later in the file, so the indices are only checked once all of them are known
+	for (auto &chunk : chunks)
+	{
+		if (!chunk.bIsValid)
+		{
+			return false;
+		}
+		for (auto &corner : chunk.corners)
+		{
+			if (corner.iPosition >= iPositionCount || corner.iTextureCoordinates >= iTextureCoordinateCount || corner.iNormal >= iNormalCount)
+			{
+				return false;
+			}
+		}
+	}
+
+	// Group the faces into submeshes in file order, like Assimp does:
+	// a group or material change starts a new submesh (groups keep the current material), which is only added once it has a face
+	std::vector<std::vector<ObjFaceReference>> submeshFaces;
+	std::vector<std::string> submeshMaterialNames;
+	std::string strGroupName;
+	std::string strMaterialName;
+	bool bHasMaterial = false;
+	bool bStartsSubmesh = true;
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		const ObjChunk &chunk = chunks[i];
+		size_t statementIndex = 0;
+		for (size_t j = 0; j <= chunk.faces.size(); j++)
+		{
+			for (; statementIndex < chunk.statements.size() && chunk.statements[statementIndex].iFaceIndex <= static_cast<int>(j); statementIndex++)
+			{
+				const ObjStatement &statement = chunk.statements[statementIndex];
+				if (statement.type == GroupStatement && statement.strName != strGroupName)
+				{
+					strGroupName = statement.strName;
+					bStartsSubmesh = true;
+				}
+				else if (statement.type == MaterialStatement && (!bHasMaterial || statement.strName != strMaterialName))
+				{
+					strMaterialName = statement.strName;
+					bHasMaterial = true;
+					bStartsSubmesh = true;
+				}
+			}
+
+			// Lines and points are not rendered
+			if (j == chunk.faces.size() || chunk.faces[j].iCornerCount < 3)
+			{
+				continue;
+			}
+			if (bStartsSubmesh)
+			{
+				submeshFaces.emplace_back();
+				submeshMaterialNames.push_back(bHasMaterial ? strMaterialName : "");
+				bStartsSubmesh = false;
+			}
+			submeshFaces.back().push_back({ static_cast<int>(i), static_cast<int>(j) });
+		}
+	}
+
+	std::map<std::string, ObjMaterial> materials;
+	for (auto &chunk : chunks)
+	{
+		for (auto &strMaterialLibrary : chunk.materialLibraries)
+		{
+			ParseMaterialLibrary(GetMaterialLibraryPath(filePath, strMaterialLibrary), materials);
+		}
+	}
+
+	submeshes.clear();
+	submeshes.resize(submeshFaces.size());
+	RunInParallel(static_cast<int>(submeshes.size()), [&](int i)
+	{
+		ObjSubmesh &submesh = submeshes[i];
+		BuildSubmesh(submeshFaces[i], chunks, elements, submesh);
+
+		// Missing materials get Assimp's default material
+		auto material = materials.find(submeshMaterialNames[i]);
+		bool bHasMaterial = material != materials.end();
+		for (int j = 0; j < 3; j++)
+		{
+			submesh.diffuseColor[j] = bHasMaterial ? material->second.diffuseColor[j] : DEFAULT_DIFFUSE_COLOR;
+		}
+		bool bIsBlack = submesh.diffuseColor[0] == 0.0f && submesh.diffuseColor[1] == 0.0f && submesh.diffuseColor[2] == 0.0f;
+		submesh.diffuseColor[3] = bIsBlack ? 0.0f : 1.0f;
+		submesh.strTexturePath = bHasMaterial ? material->second.strTexturePath : "";
+	});
+
+	return true;
+}
+
+bool ObjModelParser::FindMaterialLibraries(const char *filePath, std::vector<std::string> &paths)
+{
+	paths.clear();
+	MappedFile file;
+	if (!file.Open(filePath))
+	{
+		return false;
+	}
+
+	const char *pEnd = file.GetData() + file.GetSize();
+	for (const char *pLine = file.GetData(); pLine < pEnd; )
+	{
+		const char *pLineEnd = FindLineEnd(pLine, pEnd);
+		const char *pCurrent = SkipSpaces(pLine, pLineEnd);
+		pLine = pLineEnd < pEnd ? pLineEnd + 1 : pEnd;
+
+		if (IsKeyword(pCurrent, pLineEnd, "mtllib"))
+		{
+			paths.push_back(GetMaterialLibraryPath(filePath, GetRestOfLine(pCurrent + 6, pLineEnd)));
+		}
+	}
+	return true;
+}
@@ -0,0 +1,36 @@
+//
+// ObjModelParser.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Wavefront .obj file (http://paulbourke.net/dataformats/obj/)
+// MTL material format (http://paulbourke.net/dataformats/mtl/)
+// Open Asset Import Library: ObjFileParser, TriangulateProcess and ConvertToLHProcess (https://github.com/assimp/assimp)
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CookedMeshFormat.h"
+
+// The parser does not depend on Direct3D or Assimp, so the asset cooker imports OBJ files with the same code as the game
+struct ObjSubmesh
+{
+	std::vector<CookedVertex> vertices;		// Corners with the same position, texture coordinates and normal share a vertex
+	std::vector<uint32_t> indices;
+	float diffuseColor[4];					// Alpha is 0 if the default texture is used
+	std::string strTexturePath;				// Relative to the directory of the OBJ file
+};
+
+class ObjModelParser
+{
+public:
+	// Produces the same triangles as the Assimp import (aiProcess_Triangulate | aiProcess_ConvertToLeftHanded), with welded vertices:
+	// one submesh per group and material, in file order, with left-handed positions, flipped texture coordinates and clockwise triangles
+	// Only v, vt, vn, f, g, o, mtllib and usemtl are read (and Kd and map_Kd from the material libraries)
+	// The file is split into line-aligned chunks that are parsed on separate threads
+	static bool Parse(const char *filePath, std::vector<ObjSubmesh> &submeshes);
+	// Paths of the material libraries the file refers to (mtllib), found without parsing the rest of the file
+	static bool FindMaterialLibraries(const char *filePath, std::vector<std::string> &paths);
+};
@@ -0,0 +1,154 @@
+//
+// ObjModelValidator.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Open Asset Import Library: ObjFileParser, TriangulateProcess and ConvertToLHProcess (https://github.com/assimp/assimp)
+//
+
+#include <chrono>
+#include <cmath>
+#include <windows.h>
+#include <Assimp/Importer.hpp>
+#include <Assimp/postprocess.h>
+#include <Assimp/scene.h>
+#include "AssetPackIOSystem.h"
+#include "ObjModelValidator.h"
+
+#define VALIDATION_TOLERANCE 1e-5f		// Assimp's float parsing is not correctly rounded, so the values can differ in the last bits
+
+namespace
+{
+	bool IsNearlyEqual(float a, float b)
+	{
+		float fScale = fabsf(a) > 1.0f ? fabsf(a) : 1.0f;
+		return fabsf(a - b) <= VALIDATION_TOLERANCE * fScale;
+	}
+
+	void GetMeshesInNodeOrder(const aiNode *pNode, const aiScene *pScene, std::vector<const aiMesh*> &meshes)
+	{
+		for (UINT i = 0; i < pNode->mNumMeshes; i++)
+		{
+			meshes.push_back(pScene->mMeshes[pNode->mMeshes[i]]);
+		}
+		for (UINT i = 0; i < pNode->mNumChildren; i++)
+		{
+			GetMeshesInNodeOrder(pNode->mChildren[i], pScene, meshes);
+		}
+	}
+
+	// Returns an empty string if the submesh matches the Assimp mesh
+	std::string CompareSubmesh(const ObjSubmesh &submesh, const aiMesh *pAiMesh, const aiMaterial *pMaterial)
+	{
+		if (submesh.indices.size() != pAiMesh->mNumFaces * 3)
+		{
+			return "triangle count";
+		}
+
+		for (UINT i = 0; i < pAiMesh->mNumFaces; i++)
+		{
+			const aiFace &face = pAiMesh->mFaces[i];
+			for (UINT j = 0; j < 3; j++)
+			{
+				const CookedVertex &vertex = submesh.vertices[submesh.indices[i * 3 + j]];
+				UINT uiAiIndex = face.mIndices[j];
+				const aiVector3D &position = pAiMesh->mVertices[uiAiIndex];
+				if (!IsNearlyEqual(vertex.position[0], position.x) || !IsNearlyEqual(vertex.position[1], position.y) ||
+					!IsNearlyEqual(vertex.position[2], position.z))
+				{
+					return "position of triangle " + std::to_string(i);
+				}
+				if (pAiMesh->mTextureCoords[0] != nullptr)
+				{
+					const aiVector3D &textureCoordinates = pAiMesh->mTextureCoords[0][uiAiIndex];
+					if (!IsNearlyEqual(vertex.textureCoordinates[0], textureCoordinates.x) ||
+						!IsNearlyEqual(vertex.textureCoordinates[1], textureCoordinates.y))
+					{
+						return "texture coordinates of triangle " + std::to_string(i);
+					}
+				}
+				if (pAiMesh->mNormals != nullptr)
+				{
+					const aiVector3D &normal = pAiMesh->mNormals[uiAiIndex];
+					if (!IsNearlyEqual(vertex.normal[0], normal.x) || !IsNearlyEqual(vertex.normal[1], normal.y) ||
+						!IsNearlyEqual(vertex.normal[2], normal.z))
+					{
+						return "normal of triangle " + std::to_string(i);
+					}
+				}
+			}
+		}
+
+		// Compared the way Model::LoadMaterialTextures reads the material
+		aiString texturePath;
+		std::string strTexturePath;
+		if (pMaterial->GetTextureCount(aiTextureType_DIFFUSE) > 0 && pMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS)
+		{
+			strTexturePath = texturePath.C_Str();
+		}
+		if (strTexturePath != submesh.strTexturePath)
+		{
+			return "texture path";
+		}
+		aiColor3D diffuseColor(0.0f, 0.0f, 0.0f);
+		pMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+		if (!IsNearlyEqual(diffuseColor.r, submesh.diffuseColor[0]) || !IsNearlyEqual(diffuseColor.g, submesh.diffuseColor[1]) ||
+			!IsNearlyEqual(diffuseColor.b, submesh.diffuseColor[2]) || diffuseColor.IsBlack() != (submesh.diffuseColor[3] == 0.0f))
+		{
+			return "diffuse color";
+		}
+
+		return "";
+	}
+}
+
+bool ObjModelValidator::Validate(const char *filePath)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	std::vector<ObjSubmesh> submeshes;
+	bool bIsParsed = ObjModelParser::Parse(filePath, submeshes);
+
+	auto assimpStartTime = std::chrono::high_resolution_clock::now();
+	Assimp::Importer importer;
+	importer.SetIOHandler(new AssetPackIOSystem()); // Reads the same files as the parser
+	const aiScene *pScene = importer.ReadFile(filePath, aiProcess_Triangulate | aiProcess_ConvertToLeftHanded);
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	// Assimp does not weld, so the triangle corners are compared rather than the vertices
+	std::string strDifference;
+	std::vector<const aiMesh*> aiMeshes;
+	size_t vertexCount = 0;
+	size_t cornerCount = 0;
+	if (!bIsParsed || pScene == nullptr)
+	{
+		strDifference = !bIsParsed ? "parser failed" : "Assimp failed";
+	}
+	else
+	{
+		GetMeshesInNodeOrder(pScene->mRootNode, pScene, aiMeshes);
+		if (aiMeshes.size() != submeshes.size())
+		{
+			strDifference = "submesh count";
+		}
+		for (size_t i = 0; i < submeshes.size() && strDifference.empty(); i++)
+		{
+			strDifference = CompareSubmesh(submeshes[i], aiMeshes[i], pScene->mMaterials[aiMeshes[i]->mMaterialIndex]);
+			if (!strDifference.empty())
+			{
+				strDifference += " of submesh " + std::to_string(i);
+			}
+			vertexCount += submeshes[i].vertices.size();
+			cornerCount += submeshes[i].indices.size();
+		}
+	}
+
+	float fParseMilliseconds = std::chrono::duration<float, std::milli>(assimpStartTime - startTime).count();
+	float fAssimpMilliseconds = std::chrono::duration<float, std::milli>(endTime - assimpStartTime).count();
+	std::string strReport = std::string(filePath) + ": " + std::to_string(submeshes.size()) + " submeshes, " + std::to_string(vertexCount) +
+							" vertices (" + std::to_string(cornerCount) + " triangle corners) parsed in " + std::to_string(fParseMilliseconds) +
+							" ms (Assimp: " + std::to_string(fAssimpMilliseconds) + " ms), " +
+							(strDifference.empty() ? "output matches\n" : "OUTPUT DIFFERS (" + strDifference + ")\n");
+	OutputDebugStringA(strReport.c_str());
+
+	return strDifference.empty();
+}
@@ -0,0 +1,19 @@
+//
+// ObjModelValidator.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Open Asset Import Library: ObjFileParser, TriangulateProcess and ConvertToLHProcess (https://github.com/assimp/assimp)
+//
+
+#pragma once
+
+#include "ObjModelParser.h"
+
+// Kept out of the parser, which is shared with the asset cooker (the cooker does not link Assimp)
+class ObjModelValidator
+{
+public:
+	// Compares the triangles and materials of ObjModelParser with the Assimp import and reports the timings to the debugger
+	static bool Validate(const char *filePath);
+};
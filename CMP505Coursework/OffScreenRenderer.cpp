@@ -30,6 +30,7 @@ OffScreenRenderer::~OffScreenRenderer()
 
 HRESULT OffScreenRenderer::Initialize(int iWindowWidth, int iWindowHeight)
 {
+	ProfileZone profileZone("OffScreenRenderer::Initialize");
 	HRESULT result = S_OK;
 
 	// Create the 2D texture
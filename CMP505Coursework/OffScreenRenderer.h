@@ -11,6 +11,7 @@
 #include <wincodec.h>
 #include <d3d11.h>
 #include <DirectXTK/ScreenGrab.h>
+#include "Profiler.h"
 #include "Utils.h"
 
 using namespace DirectX;
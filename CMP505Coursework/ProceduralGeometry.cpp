@@ -0,0 +1,127 @@
+//
+// ProceduralGeometry.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// UV sphere (https://en.wikipedia.org/wiki/UV_mapping)
+// XMVectorSinCos (https://docs.microsoft.com/en-us/windows/win32/api/directxmath/nf-directxmath-xmvectorsincos)
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ProceduralGeometry.h"
+
+VertexData* ProceduralGeometry::GenerateSphere(float fRadius, int iRingCount, int iSegmentCount, int &iVertexCount, uint32_t *&indexData, int &iIndexCount)
+{
+	// The angle from the top pole (per ring) and around the Y axis (per segment)
+	std::vector<float> ringSines, ringCosines, segmentSines, segmentCosines;
+	ComputeSinCos(XM_PI, iRingCount, ringSines, ringCosines);
+	ComputeSinCos(XM_2PI, iSegmentCount, segmentSines, segmentCosines);
+
+	// The last angles are set exactly, so the bottom pole is on the axis and the seam closes
+	ringSines[iRingCount] = 0.0f;
+	ringCosines[iRingCount] = -1.0f;
+	segmentSines[iSegmentCount] = 0.0f;
+	segmentCosines[iSegmentCount] = 1.0f;
+
+	// The first and last segment are at the same angle, with u 0 and 1, so the texture does not wrap back across the sphere
+	iVertexCount = (iRingCount + 1) * (iSegmentCount + 1);
+	VertexData *vertexData = new VertexData[iVertexCount];
+	XMVECTOR vRadius = XMVectorReplicate(fRadius);
+	for (int i = 0; i <= iRingCount; i++)
+	{
+		XMVECTOR vRing = XMVectorSet(ringSines[i], ringCosines[i], ringSines[i], 0.0f);
+		float fV = static_cast<float>(i) / iRingCount;
+		for (int j = 0; j <= iSegmentCount; j++)
+		{
+			VertexData &vertex = vertexData[i * (iSegmentCount + 1) + j];
+			XMVECTOR vNormal = XMVectorMultiply(vRing, XMVectorSet(segmentCosines[j], 1.0f, segmentSines[j], 0.0f));
+			XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&vertex.x), XMVectorMultiply(vNormal, vRadius));
+			XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&vertex.nx), vNormal);
+			vertex.tu = static_cast<float>(j) / iSegmentCount;
+			vertex.tv = fV;
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	AddCellIndices(iRingCount, iSegmentCount, true, true, indices);
+	iIndexCount = static_cast<int>(indices.size());
+	indexData = new uint32_t[iIndexCount];
+	std::copy(indices.begin(), indices.end(), indexData);
+
+	return vertexData;
+}
+
+VertexData* ProceduralGeometry::GenerateGrid(float fSize, int iCellCount, int &iVertexCount, uint32_t *&indexData, int &iIndexCount)
+{
+	// Each vertex is the corner at the far left (-X, +Z) moved by whole cells, its texture coordinates by whole cells of the texture
+	XMVECTOR vCorner = XMVectorSet(-fSize * 0.5f, 0.0f, fSize * 0.5f, 0.0f);
+	XMVECTOR vCellSize = XMVectorSet(fSize / iCellCount, 0.0f, -fSize / iCellCount, 0.0f);
+	XMVECTOR vTextureCellSize = XMVectorReplicate(1.0f / iCellCount);
+	XMFLOAT3 normal(0.0f, 1.0f, 0.0f);
+
+	iVertexCount = (iCellCount + 1) * (iCellCount + 1);
+	VertexData *vertexData = new VertexData[iVertexCount];
+	for (int i = 0; i <= iCellCount; i++)
+	{
+		for (int j = 0; j <= iCellCount; j++)
+		{
+			VertexData &vertex = vertexData[i * (iCellCount + 1) + j];
+			XMVECTOR vCell = XMVectorSet(static_cast<float>(j), 0.0f, static_cast<float>(i), 0.0f);
+			XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&vertex.x), XMVectorMultiplyAdd(vCell, vCellSize, vCorner));
+			XMStoreFloat2(reinterpret_cast<XMFLOAT2*>(&vertex.tu), XMVectorMultiply(XMVectorSwizzle<0, 2, 0, 2>(vCell), vTextureCellSize));
+			memcpy(&vertex.nx, &normal, sizeof(normal));
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	AddCellIndices(iCellCount, iCellCount, false, false, indices);
+	iIndexCount = static_cast<int>(indices.size());
+	indexData = new uint32_t[iIndexCount];
+	std::copy(indices.begin(), indices.end(), indexData);
+
+	return vertexData;
+}
+
+void ProceduralGeometry::ComputeSinCos(float fMaxAngle, int iCount, std::vector<float> &sines, std::vector<float> &cosines)
+{
+	// Rounded up to whole vectors, the extra angles are computed and never read
+	int iPaddedCount = (iCount + 1 + 3) & ~3;
+	sines.resize(iPaddedCount);
+	cosines.resize(iPaddedCount);
+
+	XMVECTOR vAngleStep = XMVectorReplicate(fMaxAngle / iCount);
+	for (int i = 0; i < iPaddedCount; i += 4)
+	{
+		XMVECTOR vSines, vCosines;
+		XMVECTOR vSteps = XMVectorSet(static_cast<float>(i), static_cast<float>(i + 1), static_cast<float>(i + 2), static_cast<float>(i + 3));
+		XMVectorSinCos(&vSines, &vCosines, XMVectorMultiply(vSteps, vAngleStep));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&sines[i]), vSines);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&cosines[i]), vCosines);
+	}
+}
+
+void ProceduralGeometry::AddCellIndices(int iRowCount, int iColumnCount, bool bSkipFirstRowTriangles, bool bSkipLastRowTriangles, std::vector<uint32_t> &indices)
+{
+	indices.reserve(indices.size() + iRowCount * iColumnCount * 6);
+	uint32_t uiRowLength = iColumnCount + 1;
+	for (int i = 0; i < iRowCount; i++)
+	{
+		for (int j = 0; j < iColumnCount; j++)
+		{
+			uint32_t uiTopLeft = i * uiRowLength + j;
+			uint32_t uiTopRight = uiTopLeft + 1;
+			uint32_t uiBottomLeft = uiTopLeft + uiRowLength;
+			uint32_t uiBottomRight = uiBottomLeft + 1;
+
+			if (!bSkipLastRowTriangles || i < iRowCount - 1)
+			{
+				indices.insert(indices.end(), { uiTopLeft, uiBottomRight, uiBottomLeft });
+			}
+			if (!bSkipFirstRowTriangles || i > 0)
+			{
+				indices.insert(indices.end(), { uiTopRight, uiBottomRight, uiTopLeft });
+			}
+		}
+	}
+}
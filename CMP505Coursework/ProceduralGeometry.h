@@ -0,0 +1,40 @@
+//
+// ProceduralGeometry.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// UV sphere (https://en.wikipedia.org/wiki/UV_mapping)
+// XMVectorSinCos (https://docs.microsoft.com/en-us/windows/win32/api/directxmath/nf-directxmath-xmvectorsincos)
+//
+
+#pragma once
+
+#include "TxtModel.h"
+
+enum GeometryQuality : int
+{
+	LowGeometryQuality = 0,
+	MediumGeometryQuality,		// The tessellation of the text models the generated shapes replace
+	HighGeometryQuality
+};
+
+// Indexed shapes generated in the same vertex layout as the text models, so they are created like a text model that has been read and welded
+// The vertex and index data are allocated with new[] (the model they are given to takes them over)
+// The triangles are wound like the text models' (clockwise seen from the side the normals point to)
+class ProceduralGeometry
+{
+public:
+	// Sphere around the origin with its poles on the Y axis and normals pointing outwards
+	// u goes once around it, v from 0 at the top pole to 1 at the bottom one, and the triangles that would be degenerate at the poles are left out
+	static VertexData* GenerateSphere(float fRadius, int iRingCount, int iSegmentCount, int &iVertexCount, uint32_t *&indexData, int &iIndexCount);
+	// Square on the XZ plane around the origin facing up, split into iCellCount by iCellCount cells
+	// The texture covers it once, u along X and v against Z
+	static VertexData* GenerateGrid(float fSize, int iCellCount, int &iVertexCount, uint32_t *&indexData, int &iIndexCount);
+
+private:
+	// Sines and cosines of iCount + 1 angles spaced evenly from 0 to fMaxAngle (four at a time)
+	static void ComputeSinCos(float fMaxAngle, int iCount, std::vector<float> &sines, std::vector<float> &cosines);
+	// Two triangles per cell of a grid of (iRowCount + 1) by (iColumnCount + 1) vertices stored row by row
+	// The first triangle of the cells in the last row and the second triangle of the cells in the first row can be left out
+	static void AddCellIndices(int iRowCount, int iColumnCount, bool bSkipFirstRowTriangles, bool bSkipLastRowTriangles, std::vector<uint32_t> &indices);
+};
@@ -0,0 +1,220 @@
+//
+// Profiler.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Trace Event Format (https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU)
+//
+
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include "Profiler.h"
+
+std::atomic<bool> Profiler::bIsCapturing(false);
+std::mutex Profiler::mutex;
+std::vector<ProfileEvent> Profiler::events;
+std::vector<std::string> Profiler::threadNames;
+std::chrono::high_resolution_clock::time_point Profiler::startTime;
+
+namespace
+{
+	thread_local int iCurrentThreadIndex = -1;
+	thread_local int iCurrentDepth = 0;
+
+	std::string EscapeJsonString(const std::string &strText)
+	{
+		std::string strEscaped;
+		for (char c : strText)
+		{
+			switch (c)
+			{
+			case '"':
+				strEscaped += "\\\"";
+				break;
+			case '\\':
+				strEscaped += "\\\\";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char code[8];
+					snprintf(code, sizeof(code), "\\u%04x", c);
+					strEscaped += code;
+				}
+				else
+				{
+					strEscaped += c;
+				}
+			}
+		}
+		return strEscaped;
+	}
+}
+
+#pragma region Capture
+
+void Profiler::StartCapture()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	events.clear();
+	startTime = std::chrono::high_resolution_clock::now();
+	bIsCapturing = true;
+}
+
+void Profiler::StopCapture()
+{
+	bIsCapturing = false;
+}
+
+bool Profiler::IsCapturing()
+{
+	return bIsCapturing;
+}
+
+void Profiler::SetThreadName(std::string strName)
+{
+	int iThreadIndex = GetThreadIndex();
+	std::lock_guard<std::mutex> lock(mutex);
+	threadNames[iThreadIndex] = strName;
+}
+
+int Profiler::GetThreadIndex()
+{
+	if (iCurrentThreadIndex < 0)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		iCurrentThreadIndex = static_cast<int>(threadNames.size());
+		threadNames.push_back("Thread " + std::to_string(iCurrentThreadIndex));
+	}
+	return iCurrentThreadIndex;
+}
+
+double Profiler::GetElapsedMicroseconds()
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+void Profiler::AddEvent(ProfileEvent &&event)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (bIsCapturing)
+	{
+		events.push_back(std::move(event));
+	}
+}
+
+#pragma endregion
+
+#pragma region Output
+
+bool Profiler::WriteChromeTrace(const char *filePath)
+{
+	std::ofstream file(filePath, std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Complete events ("X") nest by time on each thread, the thread names are metadata events ("M")
+	file << "{\"traceEvents\":[\n";
+	for (int i = 0; i < threadNames.size(); i++)
+	{
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":\"" << EscapeJsonString(threadNames[i]) << "\"}},\n";
+	}
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	for (int i = 0; i < events.size(); i++)
+	{
+		const ProfileEvent &event = events[i];
+		file << "{\"name\":\"" << EscapeJsonString(event.strName) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.iThreadIndex <<
+				",\"ts\":" << event.dStartMicroseconds << ",\"dur\":" << event.dDurationMicroseconds << "}" << (i + 1 < events.size() ? ",\n" : "\n");
+	}
+	file << "],\"displayTimeUnit\":\"ms\"}\n";
+
+	return file.good();
+}
+
+std::string Profiler::GetSummary()
+{
+	struct ZoneSummary
+	{
+		int iCount = 0;
+		double dTotalMicroseconds = 0.0;
+		double dLongestMicroseconds = 0.0;
+		int iDepth = 0;
+	};
+
+	std::map<std::string, ZoneSummary> zones;
+	double dCaptureMicroseconds = 0.0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto &event : events)
+		{
+			ZoneSummary &zone = zones[event.strName];
+			zone.iDepth = zone.iCount == 0 ? event.iDepth : std::min(zone.iDepth, event.iDepth);
+			zone.iCount++;
+			zone.dTotalMicroseconds += event.dDurationMicroseconds;
+			zone.dLongestMicroseconds = std::max(zone.dLongestMicroseconds, event.dDurationMicroseconds);
+			dCaptureMicroseconds = std::max(dCaptureMicroseconds, event.dStartMicroseconds + event.dDurationMicroseconds);
+		}
+	}
+
+	std::vector<std::pair<std::string, ZoneSummary>> sortedZones(zones.begin(), zones.end());
+	std::sort(sortedZones.begin(), sortedZones.end(), [](const std::pair<std::string, ZoneSummary> &a, const std::pair<std::string, ZoneSummary> &b)
+	{
+		return a.second.dTotalMicroseconds > b.second.dTotalMicroseconds;
+	});
+
+	// Zones on different threads overlap, so the totals can add up to more than the capture
+	char line[256];
+	snprintf(line, sizeof(line), "Profile: %.2f ms, %d zones\n", dCaptureMicroseconds / 1000.0, static_cast<int>(sortedZones.size()));
+	std::string strSummary = line;
+	strSummary += "   Total ms   Count    Avg ms    Max ms  Depth  Zone\n";
+	for (auto &zone : sortedZones)
+	{
+		snprintf(line, sizeof(line), "%11.2f %7d %9.3f %9.3f %6d  ", zone.second.dTotalMicroseconds / 1000.0, zone.second.iCount,
+				 zone.second.dTotalMicroseconds / 1000.0 / zone.second.iCount, zone.second.dLongestMicroseconds / 1000.0, zone.second.iDepth);
+		strSummary += line + zone.first + "\n";
+	}
+
+	return strSummary;
+}
+
+#pragma endregion
+
+#pragma region Zone
+
+ProfileZone::ProfileZone(const char *name, const char *detail)
+{
+	m_bIsRecording = Profiler::IsCapturing();
+	m_iDepth = 0;
+	m_dStartMicroseconds = 0.0;
+	if (m_bIsRecording)
+	{
+		m_strName = name;
+		if (detail != nullptr)
+		{
+			m_strName += detail;
+		}
+		m_iDepth = iCurrentDepth++;
+		m_dStartMicroseconds = Profiler::GetElapsedMicroseconds();
+	}
+}
+
+ProfileZone::~ProfileZone()
+{
+	if (!m_bIsRecording)
+	{
+		return;
+	}
+
+	double dEndMicroseconds = Profiler::GetElapsedMicroseconds();
+	iCurrentDepth--;
+	Profiler::AddEvent({ std::move(m_strName), Profiler::GetThreadIndex(), m_iDepth, m_dStartMicroseconds, dEndMicroseconds - m_dStartMicroseconds });
+}
+
+#pragma endregion
@@ -0,0 +1,71 @@
+//
+// Profiler.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Trace Event Format (https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU)
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+
+struct ProfileEvent
+{
+	std::string strName;
+	int iThreadIndex;					// In the order the threads first opened a zone (or were named)
+	int iDepth;							// Zones open on the same thread when it started
+	double dStartMicroseconds;			// Relative to the start of the capture
+	double dDurationMicroseconds;
+};
+
+// Records timing zones on any thread while a capture is running (zones cost almost nothing otherwise)
+// The capture can be written as Chrome trace events (open it in chrome://tracing or https://ui.perfetto.dev)
+class Profiler
+{
+public:
+	static void StartCapture();
+	// Zones still open when the capture stops are not recorded
+	static void StopCapture();
+	static bool IsCapturing();
+	// Names the calling thread in the trace
+	static void SetThreadName(std::string strName);
+	static bool WriteChromeTrace(const char *filePath);
+	// Total, average and longest time of each zone name, longest total first
+	static std::string GetSummary();
+
+private:
+	friend class ProfileZone;
+
+	static std::atomic<bool> bIsCapturing;
+	static std::mutex mutex;
+	static std::vector<ProfileEvent> events;
+	static std::vector<std::string> threadNames;
+	static std::chrono::high_resolution_clock::time_point startTime;
+
+	static int GetThreadIndex();
+	static double GetElapsedMicroseconds();
+	static void AddEvent(ProfileEvent &&event);
+};
+
+// Times the scope it is declared in, zones nest within each other on the same thread
+// The name (followed by the detail, e.g. a file path) is only copied while a capture is running, so zones do not allocate otherwise
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char *name, const char *detail = nullptr);
+	~ProfileZone();
+
+private:
+	std::string m_strName;
+	double m_dStartMicroseconds;
+	int m_iDepth;
+	bool m_bIsRecording;
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+};
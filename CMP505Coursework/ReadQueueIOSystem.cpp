@@ -0,0 +1,33 @@
+//
+// ReadQueueIOSystem.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Open Asset Import Library: IOSystem and MemoryIOStream (https://github.com/assimp/assimp)
+//
+
+#include "ReadQueueIOSystem.h"
+
+ReadQueueIOSystem::ReadQueueIOSystem(FileReadQueue *pReadQueue)
+{
+	m_pReadQueue = pReadQueue;
+}
+
+bool ReadQueueIOSystem::Exists(const char *filePath) const
+{
+	const char *pData = nullptr;
+	size_t size = 0;
+	return m_pReadQueue->Wait(filePath, pData, size) || AssetPackIOSystem::Exists(filePath);
+}
+
+Assimp::IOStream* ReadQueueIOSystem::Open(const char *filePath, const char *mode)
+{
+	const char *pData = nullptr;
+	size_t size = 0;
+	if (IsReadMode(mode) && m_pReadQueue->Wait(filePath, pData, size))
+	{
+		return OpenMemory(pData, size);
+	}
+
+	return AssetPackIOSystem::Open(filePath, mode);
+}
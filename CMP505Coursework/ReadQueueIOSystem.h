@@ -0,0 +1,27 @@
+//
+// ReadQueueIOSystem.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Open Asset Import Library: IOSystem and MemoryIOStream (https://github.com/assimp/assimp)
+//
+
+#pragma once
+
+#include "AssetPackIOSystem.h"
+#include "FileReadQueue.h"
+
+// Gives Assimp the files already read by a read queue (waiting for them if they are still being read), other files are read from the mounted
+// asset pack or from disk as usual
+// The importer takes over the IO system, the queue has to outlive the importer
+class ReadQueueIOSystem : public AssetPackIOSystem
+{
+public:
+	ReadQueueIOSystem(FileReadQueue *pReadQueue);
+
+	bool Exists(const char *filePath) const override;
+	Assimp::IOStream* Open(const char *filePath, const char *mode = "rb") override;
+
+private:
+	FileReadQueue *m_pReadQueue;
+};
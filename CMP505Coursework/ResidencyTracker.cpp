@@ -0,0 +1,141 @@
+//
+// ResidencyTracker.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// D3D11_TEXTURE2D_DESC (https://docs.microsoft.com/en-us/windows/win32/api/d3d11/ns-d3d11-d3d11_texture2d_desc)
+//
+
+#include "ResidencyTracker.h"
+#include <cstdio>
+#include "DdsFile.h"
+#include "Utils.h"
+
+ResidencyTracker::ResidencyTracker()
+{
+	for (int i = 0; i < ResidencyTypeCount; i++)
+	{
+		m_cpuTotals[i] = 0;
+		m_gpuTotals[i] = 0;
+	}
+}
+
+void ResidencyTracker::AddCpuBytes(const std::string &strAssetName, ResidencyType type, uint64_t byteCount)
+{
+	AssetResidency &asset = m_assets.emplace(strAssetName, AssetResidency{}).first->second;
+	asset.cpuByteCounts[type] += byteCount;
+	m_cpuTotals[type] += byteCount;
+}
+
+void ResidencyTracker::AddBuffer(const std::string &strAssetName, ResidencyType type, ID3D11Buffer *pBuffer)
+{
+	if (pBuffer == nullptr)
+	{
+		return;
+	}
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	pBuffer->GetDesc(&bufferDesc);
+	AddGpuBytes(strAssetName, type, pBuffer, bufferDesc.ByteWidth);
+}
+
+void ResidencyTracker::AddTexture(const std::string &strAssetName, ID3D11ShaderResourceView *pTextureView)
+{
+	if (pTextureView == nullptr)
+	{
+		return;
+	}
+
+	// The view holds a reference to the texture, so the pointer stays valid after this one is released
+	ID3D11Resource *pResource = nullptr;
+	pTextureView->GetResource(&pResource);
+	AddGpuBytes(strAssetName, TextureResidency, pResource, GetTextureByteSize(pTextureView));
+	SAFE_RELEASE(pResource);
+}
+
+void ResidencyTracker::AddGpuBytes(const std::string &strAssetName, ResidencyType type, ID3D11Resource *pResource, uint64_t byteCount)
+{
+	AssetResidency &asset = m_assets.emplace(strAssetName, AssetResidency{}).first->second;
+	asset.gpuByteCounts[type] += byteCount;
+	if (m_countedResources.insert(pResource).second)
+	{
+		m_gpuTotals[type] += byteCount;
+	}
+}
+
+uint64_t ResidencyTracker::GetCpuByteCount()
+{
+	uint64_t byteCount = 0;
+	for (int i = 0; i < ResidencyTypeCount; i++)
+	{
+		byteCount += m_cpuTotals[i];
+	}
+	return byteCount;
+}
+
+uint64_t ResidencyTracker::GetGpuByteCount()
+{
+	uint64_t byteCount = 0;
+	for (int i = 0; i < ResidencyTypeCount; i++)
+	{
+		byteCount += m_gpuTotals[i];
+	}
+	return byteCount;
+}
+
+std::string ResidencyTracker::GetSnapshot()
+{
+	auto formatByteCounts = [](const uint64_t byteCounts[ResidencyTypeCount])
+	{
+		std::string strByteCounts;
+		for (int i = 0; i < ResidencyTypeCount; i++)
+		{
+			strByteCounts += (i > 0 ? " / " : "") + FormatKilobytes(byteCounts[i]);
+		}
+		return strByteCounts;
+	};
+
+	std::string strSnapshot = "Residency in KB (vertex / index / instance / texture):\n";
+	for (auto &asset : m_assets)
+	{
+		strSnapshot += "  " + asset.first + ": CPU " + formatByteCounts(asset.second.cpuByteCounts) + ", GPU " + formatByteCounts(asset.second.gpuByteCounts) + "\n";
+	}
+	strSnapshot += "  Total (shared resources once): CPU " + formatByteCounts(m_cpuTotals) + " = " + FormatKilobytes(GetCpuByteCount()) +
+				   ", GPU " + formatByteCounts(m_gpuTotals) + " = " + FormatKilobytes(GetGpuByteCount()) + "\n";
+
+	return strSnapshot;
+}
+
+uint64_t ResidencyTracker::GetTextureByteSize(ID3D11ShaderResourceView *pTextureView)
+{
+	ID3D11Resource *pResource = nullptr;
+	pTextureView->GetResource(&pResource);
+	ID3D11Texture2D *pTexture = nullptr;
+	HRESULT result = pResource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&pTexture));
+	SAFE_RELEASE(pResource);
+	if (FAILED(result))
+	{
+		return 0; // Every texture loaded is 2D
+	}
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	pTexture->GetDesc(&textureDesc);
+	SAFE_RELEASE(pTexture);
+
+	uint64_t byteSize = 0;
+	for (UINT i = 0; i < textureDesc.MipLevels; i++)
+	{
+		UINT uiWidth = textureDesc.Width >> i;
+		UINT uiHeight = textureDesc.Height >> i;
+		byteSize += DdsFile::GetMipSize(textureDesc.Format, uiWidth > 0 ? uiWidth : 1, uiHeight > 0 ? uiHeight : 1);
+	}
+
+	return byteSize * textureDesc.ArraySize;
+}
+
+std::string ResidencyTracker::FormatKilobytes(uint64_t byteCount)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.1f", byteCount / 1024.0);
+	return buffer;
+}
@@ -0,0 +1,60 @@
+//
+// ResidencyTracker.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// D3D11_TEXTURE2D_DESC (https://docs.microsoft.com/en-us/windows/win32/api/d3d11/ns-d3d11-d3d11_texture2d_desc)
+//
+
+#pragma once
+
+#include <d3d11.h>
+#include <cstdint>
+#include <string>
+#include <map>
+#include <set>
+
+enum ResidencyType : int
+{
+	VertexResidency = 0,
+	IndexResidency,
+	InstanceResidency,
+	TextureResidency,
+	ResidencyTypeCount
+};
+
+// CPU and GPU bytes of each asset, by what they hold
+// The assets add their own memory (a snapshot is taken by adding every asset to an empty tracker)
+// Buffers and textures shared by several assets (models loaded from the same file, cached textures) are listed under each of them,
+// but only counted once in the totals
+class ResidencyTracker
+{
+public:
+	ResidencyTracker();
+
+	void AddCpuBytes(const std::string &strAssetName, ResidencyType type, uint64_t byteCount);
+	// Null buffers and textures are ignored
+	void AddBuffer(const std::string &strAssetName, ResidencyType type, ID3D11Buffer *pBuffer);
+	void AddTexture(const std::string &strAssetName, ID3D11ShaderResourceView *pTextureView);
+	uint64_t GetCpuByteCount();
+	uint64_t GetGpuByteCount();
+	// One line per asset and the totals, in KB
+	std::string GetSnapshot();
+	// Every mip of every array slice (0 if the format is not one the DDS loader supports)
+	static uint64_t GetTextureByteSize(ID3D11ShaderResourceView *pTextureView);
+
+private:
+	struct AssetResidency
+	{
+		uint64_t cpuByteCounts[ResidencyTypeCount];
+		uint64_t gpuByteCounts[ResidencyTypeCount];
+	};
+
+	std::map<std::string, AssetResidency> m_assets;
+	std::set<ID3D11Resource*> m_countedResources;
+	uint64_t m_cpuTotals[ResidencyTypeCount];
+	uint64_t m_gpuTotals[ResidencyTypeCount];
+
+	void AddGpuBytes(const std::string &strAssetName, ResidencyType type, ID3D11Resource *pResource, uint64_t byteCount);
+	static std::string FormatKilobytes(uint64_t byteCount);
+};
@@ -17,14 +17,25 @@ ResourceManager::ResourceManager(ID3D11Device *pDevice, ID3D11DeviceContext *pIm
 	m_bShouldRotateLeftLever = false;
 	m_bShouldRotateRightLever = false;
 	m_bShouldRotateClock = false;
+	m_pSkyDome = nullptr;
+	m_pStreamingGraph = nullptr;
+	m_pReloadGraph = nullptr;
+	m_pReadQueue = nullptr;
+	m_pLeverTexture = nullptr;
+	m_pTextureCache = new TextureCache(m_pDevice);
 
 	unsigned char color[] = { 200, 200, 220, 255 };
-	Model::Create1x1ColorTexture(m_pDevice, color, &m_pDefaultTexture);
+	m_pDefaultTexture = m_pTextureCache->GetColorTexture(color);
 }
 
 ResourceManager::~ResourceManager()
 {
+	// Cancelled first, since their running tasks still use the resources
+	SAFE_DELETE(m_pStreamingGraph);
+	SAFE_DELETE(m_pReloadGraph);
+	SAFE_DELETE(m_pReadQueue);
 	SAFE_RELEASE(m_pDefaultTexture)
+	SAFE_RELEASE(m_pLeverTexture);
 	for (auto &texture : m_ddsTextures)
 	{
 		SAFE_RELEASE(texture);
@@ -38,535 +49,1428 @@ ResourceManager::~ResourceManager()
 	{
 		SAFE_DELETE(model);
 	}
+	for (auto &model : m_proxyModels)
+	{
+		SAFE_DELETE(model);
+	}
+	SAFE_DELETE(m_pTextureCache);
+	SAFE_DELETE(m_pLSystem);
+}
+
+bool ResourceManager::LoadResources(int iThreadCount)
+{
+	ProfileZone profileZone("ResourceManager::LoadResources");
+	if (!PrepareLoading())
+	{
+		return false;
+	}
+
+	TaskGraph taskGraph;
+	AddLoadingTasks(taskGraph);
+	bool bResult = taskGraph.Run(iThreadCount > 0 ? iThreadCount : TaskGraph::GetDefaultThreadCount());
+
+	EndLoading(taskGraph);
+
+	return bResult;
+}
+
+bool ResourceManager::StartStreaming(int iThreadCount)
+{
+	ProfileZone profileZone("ResourceManager::StartStreaming");
+	if (!PrepareLoading())
+	{
+		return false;
+	}
+	CreateProxyModels();
+
+	// The render thread only runs the device work, between frames, so at least one worker thread is needed for the rest
+	if (iThreadCount <= 0)
+	{
+		iThreadCount = TaskGraph::GetDefaultThreadCount();
+	}
+	m_pStreamingGraph = new TaskGraph();
+	AddLoadingTasks(*m_pStreamingGraph);
+	m_pStreamingGraph->Start(iThreadCount > 2 ? iThreadCount : 2);
+
+	return true;
+}
+
+bool ResourceManager::UpdateStreaming(float fBudgetMilliseconds)
+{
+	if (m_pStreamingGraph == nullptr || !m_pStreamingGraph->Update(fBudgetMilliseconds))
+	{
+		return true;
+	}
+
+	bool bResult = !m_pStreamingGraph->HasFailed();
+	EndLoading(*m_pStreamingGraph);
+	SAFE_DELETE(m_pStreamingGraph);
+
+	return bResult;
+}
+
+void ResourceManager::ReloadFile(const std::string &strFilePath)
+{
+	m_pendingReloadFiles.insert(strFilePath);
+}
+
+bool ResourceManager::UpdateReloading(float fBudgetMilliseconds)
+{
+	bool bHasFinished = false;
+	if (m_pReloadGraph != nullptr)
+	{
+		if (!m_pReloadGraph->Update(fBudgetMilliseconds))
+		{
+			return false;
+		}
+
+		if (m_pReloadGraph->HasFailed())
+		{
+			OutputDebugStringA("Failed to reload resources (the ones that failed are kept as they were).\n");
+		}
+		EndLoading(*m_pReloadGraph);
+		SAFE_DELETE(m_pReloadGraph);
+		bHasFinished = true;
+	}
+
+	// Reloads wait for the streaming, since they replace what it loads
+	if (m_pendingReloadFiles.empty() || m_pStreamingGraph != nullptr)
+	{
+		return bHasFinished;
+	}
+
+	TaskGraph *pReloadGraph = new TaskGraph();
+	if (!AddReloadTasks(*pReloadGraph, m_pendingReloadFiles))
+	{
+		delete pReloadGraph;
+	}
+	else
+	{
+		int iThreadCount = TaskGraph::GetDefaultThreadCount();
+		m_pReloadGraph = pReloadGraph;
+		m_pReloadGraph->Start(iThreadCount > 2 ? iThreadCount : 2);
+	}
+	m_pendingReloadFiles.clear();
+
+	return bHasFinished;
+}
+
+bool ResourceManager::PrepareLoading()
+{
+	// Resources are stored at the index of their enum, so they can finish loading in any order
+
+	// Cooked meshes (and the level's instance table) are written here the first time their source is loaded
+	CreateDirectoryA(COOKED_MESH_DIRECTORY, nullptr);
+
+	// The placements are read before any task starts, and only read after that
+	if (!LoadLevel())
+	{
+		return false;
+	}
+
+	// Cogwheel sizes and rules (the number of cogwheels is needed up front for the model slots)
+
+	m_cogwheelToothCount = { 17.0f, 14.0f, 10.0f, 6.0f, 8.0f, 17.0f, 14.0f, 10.0f, 6.0f, 8.0f };
+	int iCogwheelCount = static_cast<int>(m_cogwheelToothCount.size());
+
+	m_cogwheelRadii = { 5.0f };
+	for (int i = 1; i < iCogwheelCount; i++)
+	{
+		float fRadius = 0.0f;
+		switch (i)
+		{
+		case 1:
+		case 2:
+		{
+			float fRatio = m_cogwheelToothCount[0] / m_cogwheelToothCount[i];
+			fRadius = m_cogwheelRadii[0] / fRatio;
+			break;
+		}
+		case 3:
+		{
+			float fRatio = m_cogwheelToothCount[2] / m_cogwheelToothCount[i];
+			fRadius = m_cogwheelRadii[2] / fRatio;
+			break;
+		}
+		case 4:
+		{
+			float fRatio = m_cogwheelToothCount[1] / m_cogwheelToothCount[i];
+			fRadius = m_cogwheelRadii[1] / fRatio;
+			break;
+		}
+		case 5:
+		case 6:
+		case 7:
+		case 8:
+		case 9:
+			fRadius = m_cogwheelRadii[i-5];
+			break;
+		}
+		m_cogwheelRadii.push_back(fRadius);
+	}
+
+	std::string strError;
+	if (!LoadCogwheelRules(*m_pLSystem, strError))
+	{
+		MessageBox(0, ("Failed to load cogwheel rules.\n" + strError).c_str(), "", 0);
+		return false;
+	}
+
+	m_ddsTextures.resize(DdsTextureResource::GroundTexture + 1, nullptr);
+	m_txtModels.resize(TxtModelResource::GroundModel + 1, nullptr);
+	m_txtModelReadyFlags.resize(TxtModelResource::SkyDomeModel + 1, false);
+	m_models.resize(ModelResource::CogwheelModel + iCogwheelCount, nullptr);
+	m_proxyModels.resize(m_models.size(), nullptr);
+
+	PlaceAnimatedModels();
+	SubmitModelReads();
+
+#if IMPORT_PROFILE_REPORT
+	for (auto resource : { CrystalPostModel, CrystalFenceModel, ClockModel1, LeverModel1 })
+	{
+		OutputDebugStringA(Model::CompareImportProfiles(GetModelFilePath(resource)).c_str());
+	}
+#endif
+
+	return true;
+}
+
+void ResourceManager::SubmitModelReads()
+{
+	// Files in the mounted asset pack are already mapped
+	AssetPack *pPack = AssetPack::GetMounted();
+	m_pReadQueue = new FileReadQueue();
+	auto submit = [this, pPack](const std::string &strFilePath)
+	{
+		if (!strFilePath.empty() && (pPack == nullptr || !pPack->Contains(strFilePath)))
+		{
+			m_pReadQueue->Submit(strFilePath);
+		}
+	};
+	for (int i = 0; i < ModelResource::CogwheelModel; i++)
+	{
+		// Models loaded from the same file share one read
+		ModelResource resource = static_cast<ModelResource>(i);
+		submit(GetModelFilePath(resource));
+
+		// The OBJ parser maps the material libraries itself
+		if (GetImportProfile(resource) != FastImportProfile)
+		{
+			std::vector<std::string> materialLibraries;
+			ObjModelParser::FindMaterialLibraries(GetModelFilePath(resource).c_str(), materialLibraries);
+			for (auto &strMaterialFilePath : materialLibraries)
+			{
+				submit(strMaterialFilePath);
+			}
+		}
+	}
+}
+
+void ResourceManager::PlaceAnimatedModels()
+{
+	// The clock hands and the lever handles are rotated between the scale and the position of their placements
+	XMVECTOR vScale;
+	XMVECTOR vRotation;
+	XMVECTOR vPosition;
+	XMMatrixDecompose(&vScale, &vRotation, &vPosition, GetModelWorldMatrix(ModelResource::ClockModel1));
+	m_clockScalingMatrix = XMMatrixScalingFromVector(vScale);
+	m_clockTranslationMatrix = XMMatrixTranslationFromVector(vPosition);
+
+	XMMatrixDecompose(&vScale, &vRotation, &vPosition, GetModelWorldMatrix(ModelResource::LeverModel1));
+	m_leverScalingMatrix = XMMatrixScalingFromVector(vScale);
+	m_leftLeverTranslationMatrix = XMMatrixTranslationFromVector(vPosition);
+	XMMatrixDecompose(&vScale, &vRotation, &vPosition, GetModelWorldMatrix(ModelResource::LeverModel2));
+	m_rightLeverTranslationMatrix = XMMatrixTranslationFromVector(vPosition);
+}
+
+void ResourceManager::AddLoadingTasks(TaskGraph &taskGraph)
+{
+	// File I/O, parsing, importing and mesh building run on worker threads
+	// The D3D resources are created on the device thread, either by device tasks or by calls forwarded from the worker tasks
+	// Models are only swapped in on the device thread, once they are complete, so loading can go on while the level is rendered
+
+	// Ground (drawn with the default texture until its own texture is created)
+
+	std::shared_ptr<DdsFile> pGroundTextureFile = std::make_shared<DdsFile>();
+	int iReadGroundTexture = taskGraph.AddTask("Read ground texture", WorkerThread, {}, [this, pGroundTextureFile]
+	{
+		if (!ReadDdsTexture(DdsTextureResource::GroundTexture, *pGroundTextureFile))
+		{
+			MessageBox(0, "Failed to read ground texture.", "", 0);
+			return false;
+		}
+		return true;
+	});
+
+	taskGraph.AddTask("Create ground texture", DeviceThread, { iReadGroundTexture }, [this, pGroundTextureFile]
+	{
+		HRESULT result = LoadDdsTexture(DdsTextureResource::GroundTexture, *pGroundTextureFile);
+		if (FAILED(result))
+		{
+			Utils::ShowError("Failed to load ground texture.", result);
+			return false;
+		}
+		if (m_txtModelReadyFlags[TxtModelResource::GroundModel])
+		{
+			m_txtModels[TxtModelResource::GroundModel]->SetTexture(m_ddsTextures[DdsTextureResource::GroundTexture]);
+		}
+		return true;
+	});
+
+	int iLoadGroundModel = taskGraph.AddTask("Load ground model", WorkerThread, {}, [this]
+	{
+		if (!LoadTxtModel(TxtModelResource::GroundModel))
+		{
+			MessageBox(0, "Failed to load ground model.", "", 0);
+			return false;
+		}
+		return true;
+	});
+
+	taskGraph.AddTask("Create ground buffers", DeviceThread, { iLoadGroundModel }, [this]
+	{
+		if (!InitializeGround(m_txtModels[TxtModelResource::GroundModel]))
+		{
+			return false;
+		}
+		m_txtModelReadyFlags[TxtModelResource::GroundModel] = m_txtModels[TxtModelResource::GroundModel]->GetInstanceCount() > 0;
+		return true;
+	});
+
+	// Sky dome
+
+	int iLoadSkyDomeModel = taskGraph.AddTask("Load sky dome model", WorkerThread, {}, [this]
+	{
+		if (!LoadTxtModel(TxtModelResource::SkyDomeModel))
+		{
+			MessageBox(0, "Failed to load sky dome model.", "", 0);
+			return false;
+		}
+		return true;
+	});
+
+	taskGraph.AddTask("Create sky dome buffers", DeviceThread, { iLoadSkyDomeModel }, [this]
+	{
+		if (!InitializeSkyDome(m_pSkyDome))
+		{
+			return false;
+		}
+		m_txtModelReadyFlags[TxtModelResource::SkyDomeModel] = true;
+		return true;
+	});
+
+	// Crystal post and crystal fence
+
+	taskGraph.AddTask("Load crystal post model", WorkerThread, {}, [this] { return LoadCrystalPosts(); });
+	taskGraph.AddTask("Load crystal fence model", WorkerThread, {}, [this] { return LoadCrystalFences(); });
+
+	// Clock (dense imported meshes use the 16-byte quantized vertex format and are split into meshlets for culling)
+	// The second clock shares the geometry of the first one, so it is loaded after it
+
+	int iLoadClock1 = taskGraph.AddTask("Load clock model 1", WorkerThread, {}, [this] { return LoadClock(ModelResource::ClockModel1); });
+	taskGraph.AddTask("Load clock model 2", WorkerThread, { iLoadClock1 }, [this] { return LoadClock(ModelResource::ClockModel2); });
+
+	// Lever (the second lever shares the geometry of the first one)
+
+	int iCreateLeverTexture = taskGraph.AddTask("Create lever texture", DeviceThread, {}, [this]
+	{
+		unsigned char leverColor[] = { 40, 50, 30, 255 };
+		m_pLeverTexture = m_pTextureCache->GetColorTexture(leverColor);
+		return m_pLeverTexture != nullptr;
+	});
+
+	int iLoadLever1 = taskGraph.AddTask("Load lever model 1", WorkerThread, { iCreateLeverTexture }, [this] { return LoadLever(ModelResource::LeverModel1); });
+	taskGraph.AddTask("Load lever model 2", WorkerThread, { iLoadLever1 }, [this] { return LoadLever(ModelResource::LeverModel2); });
+
+	// Cogwheels (the L-system and its random number engine are not thread safe, so each cogwheel waits for the previous one)
+
+	int iCogwheelCount = static_cast<int>(m_cogwheelToothCount.size());
+	int iPreviousCogwheel = -1;
+	for (int i = 0; i < iCogwheelCount; i++)
+	{
+		std::vector<int> dependencies;
+		if (iPreviousCogwheel >= 0)
+		{
+			dependencies.push_back(iPreviousCogwheel);
+		}
+		iPreviousCogwheel = taskGraph.AddTask("Generate cogwheel " + std::to_string(i), WorkerThread, dependencies, [this, i]
+		{
+			return LoadCogwheel(i);
+		});
+	}
+}
+
+void ResourceManager::EndLoading(TaskGraph &taskGraph)
+{
+	// Material textures replaced after loading (the lever's) are no longer used by anything
+	m_pTextureCache->ReleaseUnused();
+
+#if RELEASE_CPU_GEOMETRY
+	ReleaseCpuGeometry();
+#endif
+
+#if defined(_DEBUG) || LOADING_BENCHMARK
+	OutputDebugStringA(taskGraph.GetReport().c_str());
+	OutputDebugStringA(m_pTextureCache->GetReport().c_str());
+	OutputDebugStringA(m_pReadQueue->GetReport().c_str());
+	OutputDebugStringA(GetResidencySnapshot().c_str());
+#endif
+
+	// Reloads read the files that changed themselves
+	SAFE_DELETE(m_pReadQueue);
+}
+
+void ResourceManager::ReleaseCpuGeometry()
+{
+	// Nothing reads the geometry back (the collision boxes only use the placements, and a reload reads the files again)
+	for (auto pModel : m_txtModels)
+	{
+		if (pModel != nullptr)
+		{
+			pModel->ReleaseCpuGeometry();
+		}
+	}
+	if (m_pSkyDome != nullptr)
+	{
+		m_pSkyDome->ReleaseCpuGeometry();
+	}
+	for (auto pModel : m_models)
+	{
+		if (pModel != nullptr)
+		{
+			pModel->ReleaseCpuGeometry();
+		}
+	}
+}
+
+std::string ResourceManager::GetResidencySnapshot()
+{
+	ResidencyTracker tracker;
+	for (int i = 0; i < static_cast<int>(m_txtModels.size()); i++)
+	{
+		if (m_txtModels[i] != nullptr)
+		{
+			m_txtModels[i]->TrackResidency(tracker, GetLevelModelName(static_cast<TxtModelResource>(i)));
+		}
+	}
+	if (m_pSkyDome != nullptr)
+	{
+		m_pSkyDome->TrackResidency(tracker, "sky_dome");
+	}
+	for (int i = 0; i < static_cast<int>(m_models.size()); i++)
+	{
+		if (m_models[i] != nullptr)
+		{
+			m_models[i]->TrackResidency(tracker, GetModelAssetName(i));
+		}
+		else if (m_proxyModels[i] != nullptr)
+		{
+			m_proxyModels[i]->TrackResidency(tracker, GetModelAssetName(i) + " (proxy)");
+		}
+	}
+
+	return tracker.GetSnapshot();
+}
+
+std::string ResourceManager::GetModelAssetName(int iModelIndex)
+{
+	if (iModelIndex >= ModelResource::CogwheelModel)
+	{
+		return "cogwheel_" + std::to_string(iModelIndex - ModelResource::CogwheelModel);
+	}
+	return GetLevelModelName(static_cast<ModelResource>(iModelIndex));
+}
+
+bool ResourceManager::AddReloadTasks(TaskGraph &taskGraph, const std::set<std::string> &changedFiles)
+{
+	// Find what uses the changed files
+	std::set<int> changedModels;		// Models whose geometry, material or texture changed
+	bool bIsGroundTextureChanged = false;
+	bool bIsGroundChanged = false;
+	bool bIsSkyDomeChanged = false;
+	bool bIsLevelChanged = false;
+	bool bIsCogwheelRulesChanged = false;
+
+	// The files each model is loaded from, found once per reload rather than for each changed file (models loaded from the same file share the list)
+	std::map<std::string, std::vector<std::string>> modelDependencies;
+	for (int i = ModelResource::CrystalPostModel; i < ModelResource::CogwheelModel; i++)
+	{
+		ModelResource resource = static_cast<ModelResource>(i);
+		std::string strModelFilePath = GetModelFilePath(resource);
+		if (modelDependencies.count(strModelFilePath) == 0)
+		{
+			modelDependencies[strModelFilePath] = GetModelDependencies(resource);
+		}
+	}
+
+	for (auto &strFilePath : changedFiles)
+	{
+		bool bIsUsed = false;
+		if (strFilePath == LEVEL_FILE_PATH)
+		{
+			bIsLevelChanged = bIsUsed = true;
+		}
+		if (strFilePath == COGWHEEL_LSYSTEM_FILE_PATH)
+		{
+			bIsCogwheelRulesChanged = bIsUsed = true;
+		}
+		if (strFilePath == GetTextureFilePath(DdsTextureResource::GroundTexture))
+		{
+			bIsGroundTextureChanged = bIsUsed = true;
+		}
+		// Generated text models do not use their files
+		if (!PROCEDURAL_SKY_AND_GROUND && strFilePath == GetTxtModelFilePath(TxtModelResource::GroundModel))
+		{
+			bIsGroundChanged = bIsUsed = true;
+		}
+		if (!PROCEDURAL_SKY_AND_GROUND && strFilePath == GetTxtModelFilePath(TxtModelResource::SkyDomeModel))
+		{
+			bIsSkyDomeChanged = bIsUsed = true;
+		}
+
+		for (int i = ModelResource::CrystalPostModel; i < ModelResource::CogwheelModel; i++)
+		{
+			// The material libraries are part of the cooked mesh's source hash, so a changed library is imported again like a changed model
+			std::vector<std::string> &dependencies = modelDependencies[GetModelFilePath(static_cast<ModelResource>(i))];
+			if (std::find(dependencies.begin(), dependencies.end(), strFilePath) == dependencies.end())
+			{
+				continue;
+			}
+			changedModels.insert(i);
+			bIsUsed = true;
+		}
+
+#ifdef _DEBUG
+		OutputDebugStringA(((bIsUsed ? "Reloading " : "Nothing to reload for ") + strFilePath + "\n").c_str());
+#endif
+	}
+	if (changedModels.empty() && !bIsGroundTextureChanged && !bIsGroundChanged && !bIsSkyDomeChanged && !bIsLevelChanged && !bIsCogwheelRulesChanged)
+	{
+		return false;
+	}
+
+	// Models loaded from a changed file are imported again, rather than sharing the geometry they had
+	{
+		std::lock_guard<std::mutex> lock(m_geometryRegistryMutex);
+		for (int iModelIndex : changedModels)
+		{
+			std::string strKeyPrefix = GetModelFilePath(static_cast<ModelResource>(iModelIndex)) + '|';
+			for (auto entry = m_geometryRegistry.begin(); entry != m_geometryRegistry.end();)
+			{
+				entry = entry->first.compare(0, strKeyPrefix.size(), strKeyPrefix) == 0 ? m_geometryRegistry.erase(entry) : std::next(entry);
+			}
+		}
+	}
+
+	// Level (compiled on a worker thread, and swapped in on the device thread once the models it moved are known)
+	// Which placements changed is only known once the level is compiled, so the model tasks check it when they run
+
+	std::shared_ptr<LevelLayoutFile> pNewLevelLayout = std::make_shared<LevelLayoutFile>();
+	std::shared_ptr<std::set<std::string>> pMovedModelNames = std::make_shared<std::set<std::string>>();
+	std::vector<int> levelDependencies;
+	if (bIsLevelChanged)
+	{
+		int iCompileLevel = taskGraph.AddTask("Compile level", WorkerThread, {}, [pNewLevelLayout]
+		{
+			uint64_t sourceHash = CookedMeshWriter::HashFile(LEVEL_FILE_PATH);
+			std::string strError;
+			if (!LevelLayoutCompiler::Compile(LEVEL_FILE_PATH, LEVEL_TABLE_FILE_PATH, sourceHash, strError) || !pNewLevelLayout->Open(LEVEL_TABLE_FILE_PATH, sourceHash))
+			{
+				MessageBox(0, ("Failed to reload level layout.\n" + strError).c_str(), "", 0);
+				return false;
+			}
+			return true;
+		});
+
+		levelDependencies.push_back(taskGraph.AddTask("Swap level", DeviceThread, { iCompileLevel }, [this, pNewLevelLayout, pMovedModelNames]
+		{
+			for (int i = ModelResource::CrystalPostModel; i < ModelResource::CogwheelModel; i++)
+			{
+				const char *modelName = GetLevelModelName(static_cast<ModelResource>(i));
+				if (!m_levelLayout.HasSameInstances(*pNewLevelLayout, modelName))
+				{
+					pMovedModelNames->insert(modelName);
+				}
+			}
+			if (!m_levelLayout.HasSameInstances(*pNewLevelLayout, GetLevelModelName(TxtModelResource::GroundModel)))
+			{
+				pMovedModelNames->insert(GetLevelModelName(TxtModelResource::GroundModel));
+			}
+
+			std::swap(m_levelLayout, *pNewLevelLayout);
+			PlaceAnimatedModels();
+			return true;
+		}));
+	}
+
+	auto isModelChanged = [this, changedModels, pMovedModelNames](ModelResource resource)
+	{
+		return changedModels.count(resource) > 0 || pMovedModelNames->count(GetLevelModelName(resource)) > 0;
+	};
+
+	// Ground
+
+	if (bIsGroundTextureChanged)
+	{
+		std::shared_ptr<DdsFile> pGroundTextureFile = std::make_shared<DdsFile>();
+		int iReadGroundTexture = taskGraph.AddTask("Read ground texture", WorkerThread, {}, [this, pGroundTextureFile]
+		{
+			return ReadDdsTexture(DdsTextureResource::GroundTexture, *pGroundTextureFile);
+		});
+
+		taskGraph.AddTask("Swap ground texture", DeviceThread, { iReadGroundTexture }, [this, pGroundTextureFile]
+		{
+			ID3D11ShaderResourceView *pOldTexture = m_ddsTextures[DdsTextureResource::GroundTexture];
+			HRESULT result = LoadDdsTexture(DdsTextureResource::GroundTexture, *pGroundTextureFile);
+			if (FAILED(result))
+			{
+				Utils::ShowError("Failed to reload ground texture.", result);
+				return false;
+			}
+			if (m_txtModelReadyFlags[TxtModelResource::GroundModel])
+			{
+				m_txtModels[TxtModelResource::GroundModel]->SetTexture(m_ddsTextures[DdsTextureResource::GroundTexture]);
+			}
+			SAFE_RELEASE(pOldTexture);
+			return true;
+		});
+	}
+
+	if (bIsGroundChanged || bIsLevelChanged)
+	{
+		std::shared_ptr<std::unique_ptr<TxtModel>> pNewGroundModel = std::make_shared<std::unique_ptr<TxtModel>>();
+		int iReloadGroundModel = taskGraph.AddTask("Reload ground model", WorkerThread, levelDependencies, [this, bIsGroundChanged, pMovedModelNames, pNewGroundModel]
+		{
+			if (!bIsGroundChanged && pMovedModelNames->count(GetLevelModelName(TxtModelResource::GroundModel)) == 0)
+			{
+				return true;
+			}
+
+			int iVertexCount = 0;
+			int iIndexCount = 0;
+			uint32_t *indexData = nullptr;
+			VertexData *vertexData = ReadTxtModel(TxtModelResource::GroundModel, iVertexCount, indexData, iIndexCount);
+			if (vertexData == nullptr)
+			{
+				MessageBox(0, "Failed to reload ground model.", "", 0);
+				return false;
+			}
+			pNewGroundModel->reset(new TxtModel());
+			(*pNewGroundModel)->SetVertexCount(iVertexCount);
+			(*pNewGroundModel)->SetIndexCount(iIndexCount);
+			(*pNewGroundModel)->SetVertexData(vertexData);
+			(*pNewGroundModel)->SetIndexData(indexData);
+			return true;
+		});
+
+		taskGraph.AddTask("Swap ground model", DeviceThread, { iReloadGroundModel }, [this, pNewGroundModel]
+		{
+			if (*pNewGroundModel == nullptr)
+			{
+				return true; // Neither the ground nor its placements changed
+			}
+			if (!InitializeGround(pNewGroundModel->get()))
+			{
+				return false;
+			}
+			SAFE_DELETE(m_txtModels[TxtModelResource::GroundModel]);
+			m_txtModels[TxtModelResource::GroundModel] = pNewGroundModel->release();
+			m_txtModelReadyFlags[TxtModelResource::GroundModel] = m_txtModels[TxtModelResource::GroundModel]->GetInstanceCount() > 0;
+			return true;
+		});
+	}
+
+	// Sky dome
+
+	if (bIsSkyDomeChanged)
+	{
+		std::shared_ptr<std::unique_ptr<SkyDome>> pNewSkyDome = std::make_shared<std::unique_ptr<SkyDome>>();
+		int iReloadSkyDome = taskGraph.AddTask("Reload sky dome model", WorkerThread, {}, [this, pNewSkyDome]
+		{
+			int iVertexCount = 0;
+			int iIndexCount = 0;
+			uint32_t *indexData = nullptr;
+			VertexData *vertexData = ReadTxtModel(TxtModelResource::SkyDomeModel, iVertexCount, indexData, iIndexCount);
+			if (vertexData == nullptr)
+			{
+				MessageBox(0, "Failed to reload sky dome model.", "", 0);
+				return false;
+			}
+			pNewSkyDome->reset(new SkyDome());
+			(*pNewSkyDome)->SetVertexCount(iVertexCount);
+			(*pNewSkyDome)->SetIndexCount(iIndexCount);
+			(*pNewSkyDome)->SetVertexData(vertexData);
+			(*pNewSkyDome)->SetIndexData(indexData);
+			return true;
+		});
+
+		taskGraph.AddTask("Swap sky dome model", DeviceThread, { iReloadSkyDome }, [this, pNewSkyDome]
+		{
+			if (!InitializeSkyDome(pNewSkyDome->get()))
+			{
+				return false;
+			}
+			SAFE_DELETE(m_pSkyDome);
+			m_pSkyDome = pNewSkyDome->release();
+			m_txtModelReadyFlags[TxtModelResource::SkyDomeModel] = true;
+			return true;
+		});
+	}
+
+	// Models (the same functions as the first load, models that share geometry still wait for the model they share it with)
+
+	auto isModelAffected = [&](ModelResource resource) { return bIsLevelChanged || changedModels.count(resource) > 0; };
+	if (isModelAffected(ModelResource::CrystalPostModel))
+	{
+		taskGraph.AddTask("Reload crystal post model", WorkerThread, levelDependencies, [this, isModelChanged]
+		{
+			return !isModelChanged(ModelResource::CrystalPostModel) || LoadCrystalPosts();
+		});
+	}
+	if (isModelAffected(ModelResource::CrystalFenceModel))
+	{
+		taskGraph.AddTask("Reload crystal fence model", WorkerThread, levelDependencies, [this, isModelChanged]
+		{
+			return !isModelChanged(ModelResource::CrystalFenceModel) || LoadCrystalFences();
+		});
+	}
+	if (isModelAffected(ModelResource::ClockModel1) || isModelAffected(ModelResource::ClockModel2))
+	{
+		int iReloadClock1 = taskGraph.AddTask("Reload clock model 1", WorkerThread, levelDependencies, [this, isModelChanged]
+		{
+			return !isModelChanged(ModelResource::ClockModel1) || LoadClock(ModelResource::ClockModel1);
+		});
+		taskGraph.AddTask("Reload clock model 2", WorkerThread, { iReloadClock1 }, [this, isModelChanged]
+		{
+			return !isModelChanged(ModelResource::ClockModel2) || LoadClock(ModelResource::ClockModel2);
+		});
+	}
+	if (isModelAffected(ModelResource::LeverModel1) || isModelAffected(ModelResource::LeverModel2))
+	{
+		int iReloadLever1 = taskGraph.AddTask("Reload lever model 1", WorkerThread, levelDependencies, [this, isModelChanged]
+		{
+			return !isModelChanged(ModelResource::LeverModel1) || LoadLever(ModelResource::LeverModel1);
+		});
+		taskGraph.AddTask("Reload lever model 2", WorkerThread, { iReloadLever1 }, [this, isModelChanged]
+		{
+			return !isModelChanged(ModelResource::LeverModel2) || LoadLever(ModelResource::LeverModel2);
+		});
+	}
+
+	// Cogwheels (only the ones whose axiom, or a rule their derivation can use, changed are generated again, since the others would come out different)
+	// Which ones changed is only known once the rules are parsed, so the tasks check it when they run
+
+	if (bIsCogwheelRulesChanged)
+	{
+		std::shared_ptr<std::set<int>> pChangedCogwheels = std::make_shared<std::set<int>>();
+		int iPreviousCogwheel = taskGraph.AddTask("Reload cogwheel rules", WorkerThread, {}, [this, pChangedCogwheels]
+		{
+			std::unique_ptr<LSystem> pNewLSystem(new LSystem());
+			std::string strError;
+			if (!LoadCogwheelRules(*pNewLSystem, strError))
+			{
+				MessageBox(0, ("Failed to reload cogwheel rules.\n" + strError).c_str(), "", 0);
+				return false;
+			}
+			for (int i = 0; i < pNewLSystem->GetAxiomCount(); i++)
+			{
+				if (!pNewLSystem->HasSameDerivation(*m_pLSystem, i))
+				{
+					pChangedCogwheels->insert(i);
+				}
+			}
+#ifdef _DEBUG
+			OutputDebugStringA(("Cogwheels whose rules changed: " + std::to_string(pChangedCogwheels->size()) + " of " + std::to_string(pNewLSystem->GetAxiomCount()) + "\n").c_str());
+#endif
+
+			// Only the cogwheel tasks use the rules, and they run after this one
+			delete m_pLSystem;
+			m_pLSystem = pNewLSystem.release();
+			return true;
+		});
+
+		// The L-system's random number engine is not thread safe, so each cogwheel still waits for the previous one
+		int iCogwheelCount = static_cast<int>(m_cogwheelToothCount.size());
+		for (int i = 0; i < iCogwheelCount; i++)
+		{
+			iPreviousCogwheel = taskGraph.AddTask("Regenerate cogwheel " + std::to_string(i), WorkerThread, { iPreviousCogwheel }, [this, i, pChangedCogwheels]
+			{
+				return pChangedCogwheels->count(i) == 0 || LoadCogwheel(i);
+			});
+		}
+	}
+
+	return true;
 }
 
-bool ResourceManager::LoadResources()
-{
-	// Loading of resources should be in the same order as the enums
+void ResourceManager::CreateProxyModels()
+{
+	// The boxes come from the bounds stored in the cooked meshes, so only models that have been loaded before have a proxy
+	// (the cogwheels are generated, and quickly, so they have none)
+	ProfileZone profileZone("Create proxy models");
+	std::vector<Instance> crystalPostInstances = GetLevelInstances(GetLevelModelName(ModelResource::CrystalPostModel));
+	std::vector<Instance> crystalFenceInstances = GetLevelInstances(GetLevelModelName(ModelResource::CrystalFenceModel));
+
+	for (int i = ModelResource::CrystalPostModel; i < ModelResource::CogwheelModel; i++)
+	{
+		ModelResource resource = static_cast<ModelResource>(i);
+		std::vector<Instance> *pInstances = nullptr;
+		if (resource == ModelResource::CrystalPostModel)
+		{
+			pInstances = &crystalPostInstances;
+		}
+		else if (resource == ModelResource::CrystalFenceModel)
+		{
+			pInstances = &crystalFenceInstances;
+		}
+
+		if (pInstances != nullptr && pInstances->empty())
+		{
+			continue;
+		}
+
+		Model *pProxyModel = new Model(m_pDevice, m_pImmediateContext, m_pDefaultTexture, m_pTextureCache);
+		int iInstanceCount = pInstances != nullptr ? static_cast<int>(pInstances->size()) : 1;
+		if (!pProxyModel->InitializeProxy(GetModelFilePath(resource), iInstanceCount, pInstances != nullptr ? pInstances->data() : nullptr))
+		{
+			delete pProxyModel;
+			continue;
+		}
+		pProxyModel->SetWorldMatrix(GetModelWorldMatrix(resource));
+		m_proxyModels[resource] = pProxyModel;
+	}
+}
+
+bool ResourceManager::LoadCrystalPosts()
+{
+	std::vector<Instance> crystalPostInstances = GetLevelInstances(GetLevelModelName(ModelResource::CrystalPostModel)); // Meshes keep their own packed copy
+	if (crystalPostInstances.empty())
+	{
+		PublishModel(ModelResource::CrystalPostModel, nullptr); // Removes the posts of a level that has been reloaded without them
+		return true;
+	}
+	Model *pModel = LoadModel(ModelResource::CrystalPostModel, static_cast<int>(crystalPostInstances.size()), crystalPostInstances.data());
+	if (pModel == nullptr)
+	{
+		MessageBox(0, "Failed to load crystal post model.", "", 0);
+		return false;
+	}
+	PublishModel(ModelResource::CrystalPostModel, pModel);
+
+	return true;
+}
+
+bool ResourceManager::LoadCrystalFences()
+{
+	std::vector<Instance> crystalFenceInstances = GetLevelInstances(GetLevelModelName(ModelResource::CrystalFenceModel));
+	if (crystalFenceInstances.empty())
+	{
+		PublishModel(ModelResource::CrystalFenceModel, nullptr);
+		return true;
+	}
+	Model *pModel = LoadModel(ModelResource::CrystalFenceModel, static_cast<int>(crystalFenceInstances.size()), crystalFenceInstances.data());
+	if (pModel == nullptr)
+	{
+		MessageBox(0, "Failed to load crystal fence model.", "", 0);
+		return false;
+	}
+
+	pModel->SetPointLightPosition(XMFLOAT3(0.0f, 1.0f, 0.0f));
+	PublishModel(ModelResource::CrystalFenceModel, pModel);
+
+	return true;
+}
+
+bool ResourceManager::LoadClock(ModelResource resource)
+{
+	Model *pModel = LoadModel(resource, 1, nullptr, QuantizedVertexFormat, true);
+	if (pModel == nullptr)
+	{
+		MessageBox(0, "Failed to load clock model.", "", 0);
+		return false;
+	}
+
+	pModel->SetWorldMatrix(GetModelWorldMatrix(resource));
+	PublishModel(resource, pModel);
+
+	return true;
+}
+
+bool ResourceManager::LoadLever(ModelResource resource)
+{
+	Model *pModel = LoadModel(resource, 1, nullptr, QuantizedVertexFormat, true);
+	if (pModel == nullptr)
+	{
+		MessageBox(0, "Failed to load lever model.", "", 0);
+		return false;
+	}
+
+	pModel->SetTextures({ m_pLeverTexture });
+	pModel->SetWorldMatrix(GetModelWorldMatrix(resource));
+	pModel->SetSpecularColor(COLOR_XMF4(120.0f, 130.0f, 110.0f, 1.0f));
+	pModel->SetSpecularPower(76.0f);
+	PublishModel(resource, pModel);
+
+	return true;
+}
+
+bool ResourceManager::LoadCogwheel(int iCogwheelIndex)
+{
+	Model *pModel = new Model(m_pDevice, m_pImmediateContext, m_pDefaultTexture, m_pTextureCache);
+	//pModel->GenerateCogwheel();
+	pModel->SetMeshletsEnabled(true);
+	pModel->SetPointLightColor(COLOR_XMF4(0.0f, 0.0f, 0.0f, 1.0f));
+	pModel->SetPointLightStrength(0.0f);
+
+	// The axioms place the teeth with the sizes the cogwheels are meshed with
+	std::vector<float> variables = { m_cogwheelRadii[iCogwheelIndex], m_cogwheelToothCount[iCogwheelIndex], COGWHEEL_TOOTH_SIZE };
+	if (!m_pLSystem->GenerateModel(iCogwheelIndex, variables, pModel))
+	{
+		MessageBox(0, ("Failed to generate cogwheel " + std::to_string(iCogwheelIndex) + " (its rules do not stop rewriting it).").c_str(), "", 0);
+		delete pModel;
+		return false;
+	}
+	PublishModel(static_cast<ModelResource>(ModelResource::CogwheelModel + iCogwheelIndex), pModel);
+
+	return true;
+}
+
+bool ResourceManager::LoadCogwheelRules(LSystem &lSystem, std::string &strError)
+{
+	ProfileZone profileZone("Load cogwheel rules");
+
+	// R, N and S are the radius, the number of teeth and the tooth size of the cogwheel
+	if (!lSystem.Load(COGWHEEL_LSYSTEM_FILE_PATH, { "R", "N", "S" }, strError))
+	{
+		return false;
+	}
+	if (lSystem.GetAxiomCount() != static_cast<int>(m_cogwheelToothCount.size()))
+	{
+		strError = COGWHEEL_LSYSTEM_FILE_PATH ": expected " + std::to_string(m_cogwheelToothCount.size()) + " axioms (one for each cogwheel)";
+		return false;
+	}
+
+	return true;
+}
+
+const char* ResourceManager::GetTextureFilePath(DdsTextureResource resource)
+{
+	switch (resource)
+	{
+	case GroundTexture:
+		return GROUND_TEXTURE_FILE_PATH;
+	}
+
+	return "";
+}
+
+bool ResourceManager::ReadDdsTexture(DdsTextureResource resource, DdsFile &file)
+{
+	const char *filePath = GetTextureFilePath(resource);
+	ProfileZone profileZone("Read texture ", filePath);
+
+	// The file is mapped rather than read, and only the pages of the mips that will be uploaded are read in
+	// (a file the parser does not support is still mapped, and loaded whole by DirectXTK)
+	if (file.Open(filePath))
+	{
+		file.PrefetchMips(DDS_SKIPPED_MIP_COUNT, MAX_DDS_MIP_COUNT);
+		return true;
+	}
+	return file.GetData() != nullptr;
+}
+
+HRESULT ResourceManager::LoadDdsTexture(DdsTextureResource resource, DdsFile &file)
+{
+	HRESULT result = S_OK;
+
+	// Create texture (has to run on the device thread, since DirectXTK generates missing mipmaps with the immediate context)
+
+	ID3D11ShaderResourceView *pTexture;
+	const DdsTextureInfo &info = file.GetInfo();
+	if (info.uiFormat != 0 && info.uiMipCount > 1)
+	{
+		UINT uiFirstMip = DDS_SKIPPED_MIP_COUNT < info.uiMipCount ? DDS_SKIPPED_MIP_COUNT : info.uiMipCount - 1;
+		result = file.CreateTexture(m_pDevice, uiFirstMip, info.uiMipCount - uiFirstMip, &pTexture);
+	}
+	else
+	{
+		result = CreateDDSTextureFromMemory(m_pDevice, m_pImmediateContext, file.GetData(), file.GetSize(), nullptr, &pTexture, 0, nullptr);
+	}
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	// Store texture in vector
+	m_ddsTextures[resource] = pTexture;
+
+	return result;
+}
+
+bool ResourceManager::LoadTxtModel(TxtModelResource resource)
+{
+	// Reference:
+	// RasterTek Tutorial 8: Loading Maya 2011 Models (http://www.rastertek.com/dx11tut08.html)
+
+	int iVertexCount = 0;
+	int iIndexCount = 0;
+	uint32_t *indexData = nullptr;
+	VertexData *vertexData = ReadTxtModel(resource, iVertexCount, indexData, iIndexCount);
+	if (vertexData == nullptr)
+	{
+		return false;
+	}
+
+	// Create model
+	if (resource == SkyDomeModel)
+	{
+		m_pSkyDome = new SkyDome();
+		m_pSkyDome->SetVertexCount(iVertexCount);
+		m_pSkyDome->SetIndexCount(iIndexCount);
+		m_pSkyDome->SetVertexData(vertexData);
+		m_pSkyDome->SetIndexData(indexData);
+	}
+	else
+	{
+		TxtModel *pModel = new TxtModel();
+		pModel->SetVertexCount(iVertexCount);
+		pModel->SetIndexCount(iIndexCount);
+		pModel->SetVertexData(vertexData);
+		pModel->SetIndexData(indexData);
+
+		// Store model in vector
+		m_txtModels[resource] = pModel;
+	}
 
-	// Ground
+	return true;
+}
 
-	HRESULT result = LoadDdsTexture(DdsTextureResource::GroundTexture);
-	if (FAILED(result))
+const char* ResourceManager::GetTxtModelFilePath(TxtModelResource resource)
+{
+	switch (resource)
 	{
-		Utils::ShowError("Failed to load ground texture.", result);
-		return false;
+	case GroundModel:
+		return "Resources/plane.txt";
+	case SkyDomeModel:
+		return "Resources/skydome.txt";
 	}
 
-	if (!LoadTxtModel(TxtModelResource::GroundModel))
-	{
-		MessageBox(0, "Failed to load ground model.", "", 0);
-		return false;
-	}
+	return "";
+}
 
-	int iGroundCount = 5;
-	Instance *groundInstances = new Instance[iGroundCount];
-	groundInstances[0].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.4f, 0.0f, 0.0f) * XMMatrixScaling(0.348f, 0.348f, 0.348f));
-	groundInstances[0].textureTileCount = XMINT2(5, 5);
-	groundInstances[1].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-125.5f, 0.0f, 0.0f) * XMMatrixScaling(0.22f, 0.22f, 0.22f));
-	groundInstances[1].textureTileCount = XMINT2(3, 3);
-	groundInstances[2].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(126.7f, 0.0f, 0.0f) * XMMatrixScaling(0.22f, 0.22f, 0.22f));
-	groundInstances[2].textureTileCount = XMINT2(3, 3);
-	groundInstances[3].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-36.63f, 0.0f, 0.0f) * XMMatrixScaling(0.41f, 0.22f, 0.074f));
-	groundInstances[3].textureTileCount = XMINT2(6, 1);
-	groundInstances[4].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(37.3f, 0.0f, 0.0f) * XMMatrixScaling(0.41f, 0.22f, 0.074f));
-	groundInstances[4].textureTileCount = XMINT2(6, 1);
-	if (!m_txtModels[TxtModelResource::GroundModel]->InitializeBuffers(m_pDevice, iGroundCount, groundInstances))
+VertexData* ResourceManager::ReadTxtModel(TxtModelResource resource, int &iVertexCount, uint32_t *&indexData, int &iIndexCount)
+{
+#if PROCEDURAL_SKY_AND_GROUND
+	// Both are simple analytic shapes, so generating them is faster than reading and parsing them
+	return GenerateTxtModel(resource, iVertexCount, indexData, iIndexCount);
+#else
+	const char *filePath = GetTxtModelFilePath(resource);
+	ProfileZone profileZone("Load model ", filePath);
+
+	// Read the vertex count and the vertex data (from the cooked mesh unless the text file has changed since it was cooked)
+	iVertexCount = 0;
+	iIndexCount = 0;
+	indexData = nullptr;
+	uint64_t sourceHash = CookedMeshWriter::HashFile(filePath);
+	VertexData *vertexData = LoadCookedTxtModel(filePath, sourceHash, iVertexCount, indexData, iIndexCount);
+	if (vertexData == nullptr)
 	{
-		MessageBox(0, "Failed to initialize ground vertex and index buffers.", "", 0);
-		return false;
+		vertexData = TxtModelParser::Parse(filePath, iVertexCount);
+		if (vertexData == nullptr)
+		{
+			return nullptr;
+		}
+
+		// The welding is cooked, so it only runs when the text file changes
+		std::vector<uint32_t> indices = TxtModelParser::WeldVertices(vertexData, iVertexCount);
+		iIndexCount = static_cast<int>(indices.size());
+		indexData = new uint32_t[iIndexCount];
+		std::copy(indices.begin(), indices.end(), indexData);
+
+		CookTxtModel(filePath, sourceHash, vertexData, iVertexCount, indexData, iIndexCount);
 	}
-	m_txtModels[TxtModelResource::GroundModel]->SetTexture(m_ddsTextures[DdsTextureResource::GroundTexture]);
 
-	// Sky dome
+	return vertexData;
+#endif
+}
+
+VertexData* ResourceManager::GenerateTxtModel(TxtModelResource resource, int &iVertexCount, uint32_t *&indexData, int &iIndexCount)
+{
+	ProfileZone profileZone("Generate model ", GetTxtModelFilePath(resource));
 
-	if (!LoadTxtModel(TxtModelResource::SkyDomeModel))
+	// Medium quality has the sky dome's tessellation in its text file (20 rings of 20 segments), each level doubles the rings and segments
+	// The view direction is normalized per vertex, so the finer the ground the closer its specular highlight is to the one per pixel
+	int iSkyDomeTessellation = 10 << PROCEDURAL_GEOMETRY_QUALITY;
+	int iGroundCellCount = 1 << (PROCEDURAL_GEOMETRY_QUALITY * 2);
+	switch (resource)
 	{
-		MessageBox(0, "Failed to load sky dome model.", "", 0);
-		return false;
+	case GroundModel:
+		return ProceduralGeometry::GenerateGrid(GROUND_SIZE, iGroundCellCount, iVertexCount, indexData, iIndexCount);
+	case SkyDomeModel:
+		return ProceduralGeometry::GenerateSphere(SKY_DOME_RADIUS, iSkyDomeTessellation, iSkyDomeTessellation, iVertexCount, indexData, iIndexCount);
 	}
 
-	if (!m_pSkyDome->InitializeBuffers(m_pDevice))
+	return nullptr;
+}
+
+bool ResourceManager::InitializeGround(TxtModel *pModel)
+{
+	std::vector<Instance> groundInstances = GetLevelInstances(GetLevelModelName(TxtModelResource::GroundModel));
+	if (groundInstances.empty())
 	{
-		MessageBox(0, "Failed to initialize sky dome vertex and index buffers.", "", 0);
-		return false;
+		return true; // The level has no ground
 	}
 
-	m_pSkyDome->SetTopColor(COLOR_XMF4(17.0f, 0.0f, 50.0f, 1.0f));
-	m_pSkyDome->SetCenterColor(COLOR_XMF4(10.0f, 0.0f, 30.0f, 1.0f));
-	m_pSkyDome->SetBottomColor(COLOR_XMF4(7.0f, 0.0f, 20.0f, 1.0f));
-
-	// Crystal post
-
-	// Distance between 2 posts: 6.55f (3 fences between)
-	// 1.0f post movement = 1.1f fence z-movement
-
-	int iCrystalPostCount = 12;
-	Instance *crystalPostInstances = new Instance[iCrystalPostCount];
-	XMMATRIX crystalPostScalingMatrix = XMMatrixScaling(1.1f, 1.1f, 1.1f);
-
-	// Center room
-	// Back
-	crystalPostInstances[0].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-5.473f, 0.0f, 5.573f) * crystalPostScalingMatrix);
-	crystalPostInstances[1].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(5.623f, 0.0f, 5.573f) * crystalPostScalingMatrix);
-	// Front
-	crystalPostInstances[2].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-5.473f, 0.0f, -5.523f) * crystalPostScalingMatrix);
-	crystalPostInstances[3].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(5.623f, 0.0f, -5.523f) * crystalPostScalingMatrix);
-	
-	// Left room
-	float fDisplacementX = 25.123f;
-	// Back
-	crystalPostInstances[4].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-3.2f - fDisplacementX, 0.0f, 3.3f) * crystalPostScalingMatrix);
-	crystalPostInstances[5].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(3.35f - fDisplacementX, 0.0f, 3.3f) * crystalPostScalingMatrix);
-	// Front
-	crystalPostInstances[6].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-3.2f - fDisplacementX, 0.0f, -3.26f) * crystalPostScalingMatrix);
-	crystalPostInstances[7].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(3.35f - fDisplacementX, 0.0f, -3.26f) * crystalPostScalingMatrix);
-
-	// Right room
-	// Back
-	crystalPostInstances[8].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-3.2f + fDisplacementX, 0.0f, 3.3f) * crystalPostScalingMatrix);
-	crystalPostInstances[9].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(3.35f + fDisplacementX, 0.0f, 3.3f) * crystalPostScalingMatrix);
-	// Front
-	crystalPostInstances[10].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-3.2f + fDisplacementX, 0.0f, -3.25f) * crystalPostScalingMatrix);
-	crystalPostInstances[11].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(3.35f + fDisplacementX, 0.0f, -3.25f) * crystalPostScalingMatrix);
-	
-	for (int i = 0; i < iCrystalPostCount; i++)
-	{
-		crystalPostInstances[i].textureTileCount = XMINT2(1, 1);
-		crystalPostInstances[i].lightDirection = DEFAULT_LIGHT_DIRECTION;
-	}
-	if (!LoadModel(ModelResource::CrystalPostModel, iCrystalPostCount, crystalPostInstances))
+	if (!pModel->InitializeBuffers(m_pDevice, static_cast<int>(groundInstances.size()), groundInstances.data()))
 	{
-		MessageBox(0, "Failed to load crystal post model.", "", 0);
+		MessageBox(0, "Failed to initialize ground vertex and index buffers.", "", 0);
 		return false;
 	}
+	ID3D11ShaderResourceView *pGroundTexture = m_ddsTextures[DdsTextureResource::GroundTexture];
+	pModel->SetTexture(pGroundTexture != nullptr ? pGroundTexture : m_pDefaultTexture);
+
+	return true;
+}
 
-	// Crystal fence
-
-	float fDistanceBetweenFences = 2.5f;
-
-	int iCrystalFenceCount = 68;
-	Instance *crystalFenceInstances = new Instance[iCrystalFenceCount];
-	XMMATRIX crystalFenceRotationMatrix = XMMatrixRotationRollPitchYaw(XM_PI * 0.0f, XM_PI * 0.5f, XM_PI * 0.0f);
-	
-	// Center room
-
-	/*// Back
-	crystalFenceInstances[0].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f, 0.5f, 3.63f));
-	crystalFenceInstances[1].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f, 0.5f, 3.63f));
-	crystalFenceInstances[2].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f, 0.5f, 3.63f));
-	// Front
-	crystalFenceInstances[3].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f, 0.5f, -3.575f));
-	crystalFenceInstances[4].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f, 0.5f, -3.575f));
-	crystalFenceInstances[5].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f, 0.5f, -3.575f));
-	// Left
-	crystalFenceInstances[6].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - 0.11f, 0.5f, -3.575f + 0.05f) * crystalFenceRotationMatrix);
-	//crystalFenceInstances[7].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f - 0.11f, 0.5f, -3.575f + 0.05f) * crystalFenceRotationMatrix);
-	crystalFenceInstances[7].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - 0.11f, 0.5f, -3.575f + 0.05f) * crystalFenceRotationMatrix);
-	// Right
-	crystalFenceInstances[8].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - 0.11f, 0.5f, 3.63f + 0.05f) * crystalFenceRotationMatrix);
-	//crystalFenceInstances[10].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f - 0.11f, 0.5f, 3.63f + 0.05f) * crystalFenceRotationMatrix);
-	crystalFenceInstances[9].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - 0.11f, 0.5f, 3.63f + 0.05f) * crystalFenceRotationMatrix);*/
-	
-	// Back
-	crystalFenceInstances[0].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-5.0f, 0.5f, 6.13f));
-	crystalFenceInstances[1].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f, 0.5f, 6.13f));
-	crystalFenceInstances[2].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f, 0.5f, 6.13f));
-	crystalFenceInstances[3].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f, 0.5f, 6.13f));
-	crystalFenceInstances[4].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(5.0f, 0.5f, 6.13f));
-	// Front
-	crystalFenceInstances[5].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-5.0f, 0.5f, -6.075f));
-	crystalFenceInstances[6].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f, 0.5f, -6.075f));
-	crystalFenceInstances[7].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f, 0.5f, -6.075f));
-	crystalFenceInstances[8].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f, 0.5f, -6.075f));
-	crystalFenceInstances[9].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(5.0f, 0.5f, -6.075f));
-	// Left
-	crystalFenceInstances[10].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-5.0f - 0.11f, 0.5f, -6.075f + 0.05f) * crystalFenceRotationMatrix);
-	crystalFenceInstances[11].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - 0.11f, 0.5f, -6.075f + 0.05f) * crystalFenceRotationMatrix);
-	crystalFenceInstances[12].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - 0.11f, 0.5f, -6.075f + 0.05f) * crystalFenceRotationMatrix);
-	crystalFenceInstances[13].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(5.0f - 0.11f, 0.5f, -6.075f + 0.05f) * crystalFenceRotationMatrix);
-	// Right
-	crystalFenceInstances[14].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-5.0f - 0.11f, 0.5f, 6.13f + 0.05f) * crystalFenceRotationMatrix);
-	crystalFenceInstances[15].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - 0.11f, 0.5f, 6.13f + 0.05f) * crystalFenceRotationMatrix);
-	crystalFenceInstances[16].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - 0.11f, 0.5f, 6.13f + 0.05f) * crystalFenceRotationMatrix);
-	crystalFenceInstances[17].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(5.0f - 0.11f, 0.5f, 6.13f + 0.05f) * crystalFenceRotationMatrix);
-
-	// Left room
-	fDisplacementX = 27.63f;
-	// Back
-	crystalFenceInstances[18].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - fDisplacementX, 0.5f, 3.63f));
-	crystalFenceInstances[19].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f - fDisplacementX, 0.5f, 3.63f));
-	crystalFenceInstances[20].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - fDisplacementX, 0.5f, 3.63f));
-	// Front
-	crystalFenceInstances[21].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - fDisplacementX, 0.5f, -3.575f));
-	crystalFenceInstances[22].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f - fDisplacementX, 0.5f, -3.575f));
-	crystalFenceInstances[23].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - fDisplacementX, 0.5f, -3.575f));
-	// Left
-	crystalFenceInstances[24].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - 0.11f, 0.5f, -3.575f + 0.05f - fDisplacementX) * crystalFenceRotationMatrix);
-	crystalFenceInstances[25].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f - 0.11f, 0.5f, -3.575f + 0.05f - fDisplacementX) * crystalFenceRotationMatrix);
-	crystalFenceInstances[26].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - 0.11f, 0.5f, -3.575f + 0.05f - fDisplacementX) * crystalFenceRotationMatrix);
-	// Right
-	crystalFenceInstances[27].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - 0.11f, 0.5f, 3.63f + 0.05f - fDisplacementX) * crystalFenceRotationMatrix);
-	crystalFenceInstances[28].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - 0.11f, 0.5f, 3.63f + 0.05f - fDisplacementX) * crystalFenceRotationMatrix);
-
-	// Right room
-	// Back
-	crystalFenceInstances[29].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f + fDisplacementX, 0.5f, 3.63f));
-	crystalFenceInstances[30].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f + fDisplacementX, 0.5f, 3.63f));
-	crystalFenceInstances[31].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f + fDisplacementX, 0.5f, 3.63f));
-	// Front
-	crystalFenceInstances[32].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f + fDisplacementX, 0.5f, -3.575f));
-	crystalFenceInstances[33].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f + fDisplacementX, 0.5f, -3.575f));
-	crystalFenceInstances[34].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f + fDisplacementX, 0.5f, -3.575f));
-	// Left
-	crystalFenceInstances[35].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - 0.11f, 0.5f, -3.575f + 0.05f + fDisplacementX) * crystalFenceRotationMatrix);
-	crystalFenceInstances[36].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - 0.11f, 0.5f, -3.575f + 0.05f + fDisplacementX) * crystalFenceRotationMatrix);
-	// Right
-	crystalFenceInstances[37].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(-2.5f - 0.11f, 0.5f, 3.63f + 0.05f + fDisplacementX) * crystalFenceRotationMatrix);
-	crystalFenceInstances[38].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(0.0f - 0.11f, 0.5f, 3.63f + 0.05f + fDisplacementX) * crystalFenceRotationMatrix);
-	crystalFenceInstances[39].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(2.5f - 0.11f, 0.5f, 3.63f + 0.05f + fDisplacementX) * crystalFenceRotationMatrix);
-
-	// Left bridge
-	float fStartX = -7.57f;
-	int iStartIndex = 40;
-	int iNumberOfFences = 7;
-	float fFrontZ = -1.0f;
-	float fBackZ = 1.05f;
-	// Front
-	for (int i = iStartIndex; i < iStartIndex + iNumberOfFences; i++)
-	{
-		crystalFenceInstances[i].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(fStartX - (fDistanceBetweenFences * (i - iStartIndex)), 0.5f, fFrontZ));
-	}
-	// Back
-	iStartIndex += iNumberOfFences;
-	for (int i = iStartIndex; i < iStartIndex + iNumberOfFences; i++)
-	{
-		crystalFenceInstances[i].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(fStartX - (fDistanceBetweenFences * (i - iStartIndex)), 0.5f, fBackZ));
-	}
-
-	// Right bridge
-	fStartX = 22.56f;
-	iStartIndex += iNumberOfFences;
-	// Front
-	for (int i = iStartIndex; i < iStartIndex + iNumberOfFences; i++)
-	{
-		crystalFenceInstances[i].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(fStartX - (fDistanceBetweenFences * (i - iStartIndex)), 0.5f, fFrontZ));
-	}
-	// Back
-	iStartIndex += iNumberOfFences;
-	for (int i = iStartIndex; i < iStartIndex + iNumberOfFences; i++)
-	{
-		crystalFenceInstances[i].worldMatrix = XMMatrixTranspose(XMMatrixTranslation(fStartX - (fDistanceBetweenFences * (i - iStartIndex)), 0.5f, fBackZ));
-	}
-
-	for (int i = 0; i < iCrystalFenceCount; i++)
-	{
-		crystalFenceInstances[i].textureTileCount = XMINT2(1, 1);
-		crystalFenceInstances[i].lightDirection = DEFAULT_LIGHT_DIRECTION;
-	}
-	if (!LoadModel(ModelResource::CrystalFenceModel, iCrystalFenceCount, crystalFenceInstances))
+bool ResourceManager::InitializeSkyDome(SkyDome *pSkyDome)
+{
+	if (!pSkyDome->InitializeBuffers(m_pDevice))
 	{
-		MessageBox(0, "Failed to load crystal fence model.", "", 0);
+		MessageBox(0, "Failed to initialize sky dome vertex and index buffers.", "", 0);
 		return false;
 	}
 
-	m_models[ModelResource::CrystalFenceModel]->SetPointLightPosition(XMFLOAT3(0.0f, 1.0f, 0.0f));
+	pSkyDome->SetTopColor(COLOR_XMF4(17.0f, 0.0f, 50.0f, 1.0f));
+	pSkyDome->SetCenterColor(COLOR_XMF4(10.0f, 0.0f, 30.0f, 1.0f));
+	pSkyDome->SetBottomColor(COLOR_XMF4(7.0f, 0.0f, 20.0f, 1.0f));
 
-	// Clock
-	
-	m_clockScalingMatrix = XMMatrixScaling(11.0f, 11.0f, 11.0f);
-	m_clockTranslationMatrix = XMMatrixTranslation(0.0f, 0.85f, -0.9f);
+	return true;
+}
 
-	if (!LoadModel(ModelResource::ClockModel1, 1))
+VertexData* ResourceManager::LoadCookedTxtModel(const char *filePath, uint64_t sourceHash, int &iVertexCount, uint32_t *&indexData, int &iIndexCount)
+{
+	std::string strFilePath = filePath;
+	CookedMeshFile cookedMeshFile;
+	if (!cookedMeshFile.Open(Model::GetCookedFilePath(strFilePath.substr(strFilePath.find_last_of('/') + 1)).c_str(), sizeof(VertexData)))
 	{
-		MessageBox(0, "Failed to load clock model.", "", 0);
-		return false;
+		return nullptr;
 	}
 
-	m_models[ModelResource::ClockModel1]->SetWorldMatrix(m_clockTranslationMatrix * XMMatrixRotationRollPitchYaw(XM_PI * 0.0f, XM_PI * 1.0f, XM_PI * 0.0f) * m_clockScalingMatrix);
-
-	if (!LoadModel(ModelResource::ClockModel2, 1))
+	const CookedMeshHeader *pHeader = cookedMeshFile.GetHeader();
+	if (pHeader->sourceHash != sourceHash || pHeader->submeshCount != 1)
 	{
-		MessageBox(0, "Failed to load clock model.", "", 0);
-		return false;
+		return nullptr;
 	}
 
-	m_models[ModelResource::ClockModel2]->SetWorldMatrix(XMMatrixTranslation(0.0f, 0.0f, -0.2f) * XMMatrixRotationRollPitchYaw(XM_PI * -0.5f, XM_PI * 1.0f, XM_PI * 0.0f) * XMMatrixScaling(18.0f, 18.0f, 18.0f));
-
-	// Lever
-
-	unsigned char leverColor[] = { 40, 50, 30, 255 };
-	ID3D11ShaderResourceView *pLeverTexture;
-	Model::Create1x1ColorTexture(m_pDevice, leverColor, &pLeverTexture);
+	// Text models keep their own copy of the vertex and index data until their buffers are created, so the mapped data is copied once
+	const CookedSubmesh &submesh = *cookedMeshFile.GetSubmesh(0);
+	iVertexCount = submesh.vertexCount;
+	VertexData *vertexData = new VertexData[iVertexCount];
+	memcpy(vertexData, cookedMeshFile.GetVertexData(submesh), sizeof(VertexData) * iVertexCount);
+	iIndexCount = submesh.lods[0].indexCount;
+	indexData = new uint32_t[iIndexCount];
+	memcpy(indexData, cookedMeshFile.GetIndexData(submesh) + submesh.lods[0].indexOffset, sizeof(uint32_t) * iIndexCount);
 
-	m_leverScalingMatrix = XMMatrixScaling(0.011f, 0.011f, 0.011f);
-	XMMATRIX leverRotationMatrix = XMMatrixRotationRollPitchYaw(0.0f, XM_PI * 0.5f, 0.0f);
-	m_leftLeverTranslationMatrix = XMMatrixTranslation(LEFT_LEVER_POSITION.x, LEFT_LEVER_POSITION.y, LEFT_LEVER_POSITION.z);
+	return vertexData;
+}
 
-	if (!LoadModel(ModelResource::LeverModel1, 1))
+bool ResourceManager::CookTxtModel(const char *filePath, uint64_t sourceHash, VertexData *vertexData, int iVertexCount, const uint32_t *indexData, int iIndexCount)
+{
+	CookedSubmesh submesh = {};
+	submesh.lodCount = 1;
+	submesh.lods[0] = { 0, (uint32_t)iIndexCount, FLT_MAX };
+	XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(submesh.transform), XMMatrixIdentity());
+	if (iVertexCount > 0)
 	{
-		MessageBox(0, "Failed to load lever model.", "", 0);
-		return false;
+		BoundingBox boundingBox;
+		BoundingSphere boundingSphere;
+		BoundingBox::CreateFromPoints(boundingBox, iVertexCount, reinterpret_cast<XMFLOAT3*>(&vertexData[0].x), sizeof(VertexData));
+		BoundingSphere::CreateFromPoints(boundingSphere, iVertexCount, reinterpret_cast<XMFLOAT3*>(&vertexData[0].x), sizeof(VertexData));
+		memcpy(submesh.boxCenter, &boundingBox.Center, sizeof(submesh.boxCenter));
+		memcpy(submesh.boxExtents, &boundingBox.Extents, sizeof(submesh.boxExtents));
+		memcpy(submesh.sphereCenter, &boundingSphere.Center, sizeof(submesh.sphereCenter));
+		submesh.sphereRadius = boundingSphere.Radius;
 	}
 
-	m_models[ModelResource::LeverModel1]->SetTextures({ pLeverTexture });
-	m_models[ModelResource::LeverModel1]->SetWorldMatrix(m_leverScalingMatrix * leverRotationMatrix * m_leftLeverTranslationMatrix);
-	m_models[ModelResource::LeverModel1]->SetSpecularColor(COLOR_XMF4(120.0f, 130.0f, 110.0f, 1.0f));
-	m_models[ModelResource::LeverModel1]->SetSpecularPower(76.0f);
+	CookedMeshWriter writer(sizeof(VertexData));
+	writer.SetCompression(COOKED_MESH_COMPRESSION, COOKED_MESH_COMPRESSION);
+	writer.AddSubmesh(submesh, vertexData, iVertexCount, indexData, iIndexCount);
 
-	m_rightLeverTranslationMatrix = XMMatrixTranslation(RIGHT_LEVER_POSITION.x, RIGHT_LEVER_POSITION.y, RIGHT_LEVER_POSITION.z);
+	std::string strFilePath = filePath;
+	return writer.Write(Model::GetCookedFilePath(strFilePath.substr(strFilePath.find_last_of('/') + 1)), sourceHash, 0);
+}
 
-	if (!LoadModel(ModelResource::LeverModel2, 1))
+std::string ResourceManager::GetModelFilePath(ModelResource resource)
+{
+	switch (resource)
 	{
-		MessageBox(0, "Failed to load lever model.", "", 0);
-		return false;
+	case CrystalPostModel:
+		return "Resources/crystal_post.obj";
+	case CrystalFenceModel:
+		return "Resources/crystal_fence.obj";
+	case ClockModel1:
+	case ClockModel2:
+		return "Resources/clock.obj";
+	case LeverModel1:
+	case LeverModel2:
+		return "Resources/lever.obj";
 	}
 
-	m_models[ModelResource::LeverModel2]->SetTextures({ pLeverTexture });
-	m_models[ModelResource::LeverModel2]->SetWorldMatrix(m_leverScalingMatrix * leverRotationMatrix * m_rightLeverTranslationMatrix);
-	m_models[ModelResource::LeverModel2]->SetSpecularColor(COLOR_XMF4(120.0f, 130.0f, 110.0f, 1.0f));
-	m_models[ModelResource::LeverModel2]->SetSpecularPower(76.0f);
+	return "";
+}
 
-	// Cogwheels
+std::vector<std::string> ResourceManager::GetModelDependencies(ModelResource resource)
+{
+	// Every library the OBJ file names (wherever it names it), like the source hash of the cooked mesh
+	std::string strFilePath = GetModelFilePath(resource);
+	std::vector<std::string> materialLibraries;
+	ObjModelParser::FindMaterialLibraries(strFilePath.c_str(), materialLibraries);
 
-	m_cogwheelToothCount = { 17.0f, 14.0f, 10.0f, 6.0f, 8.0f, 17.0f, 14.0f, 10.0f, 6.0f, 8.0f };
-	int iCogwheelCount = static_cast<int>(m_cogwheelToothCount.size());
+	std::vector<std::string> dependencies = { strFilePath };
+	dependencies.insert(dependencies.end(), materialLibraries.begin(), materialLibraries.end());
+	std::vector<std::string> texturePaths = GetMaterialTexturePaths(materialLibraries);
+	dependencies.insert(dependencies.end(), texturePaths.begin(), texturePaths.end());
 
-	m_cogwheelRadii = { 5.0f };
-	for (int i = 1; i < iCogwheelCount; i++)
+	return dependencies;
+}
+
+std::vector<std::string> ResourceManager::GetMaterialTexturePaths(const std::vector<std::string> &materialLibraries)
+{
+	std::vector<std::string> texturePaths;
+	for (auto &strMaterialFilePath : materialLibraries)
 	{
-		float fRadius = 0.0f;
-		switch (i)
-		{
-		case 1:
-		case 2:
+		MappedFile materialFile;
+		if (!materialFile.Open(strMaterialFilePath.c_str()))
 		{
-			float fRatio = m_cogwheelToothCount[0] / m_cogwheelToothCount[i];
-			fRadius = m_cogwheelRadii[0] / fRatio;
-			break;
-		}
-		case 3:
-		{
-			float fRatio = m_cogwheelToothCount[2] / m_cogwheelToothCount[i];
-			fRadius = m_cogwheelRadii[2] / fRatio;
-			break;
+			continue;
 		}
-		case 4:
+		std::istringstream file(std::string(materialFile.GetData(), materialFile.GetSize()));
+		std::string strLine;
+		while (std::getline(file, strLine))
 		{
-			float fRatio = m_cogwheelToothCount[1] / m_cogwheelToothCount[i];
-			fRadius = m_cogwheelRadii[1] / fRatio;
-			break;
-		}
-		case 5:
-		case 6:
-		case 7:
-		case 8:
-		case 9:
-			fRadius = m_cogwheelRadii[i-5];
-			break;
+			// Texture maps name their file last ("map_Kd -s 2 2 texture.png")
+			strLine.erase(0, strLine.find_first_not_of(" \t"));
+			strLine.erase(strLine.find_last_not_of(" \t\r") + 1);
+			if (strLine.compare(0, 4, "map_") == 0)
+			{
+				texturePaths.push_back(Utils::GetDirectoryFromPath(strMaterialFilePath) + '/' + strLine.substr(strLine.find_last_of(" \t") + 1));
+			}
 		}
-		m_cogwheelRadii.push_back(fRadius);
 	}
 
-	for (int i = 0; i < iCogwheelCount; i++)
+	return texturePaths;
+}
+
+ImportProfile ResourceManager::GetImportProfile(ModelResource resource)
+{
+	// Static props drawn with many instances, so the vertex cache order matters most for them
+	// (listed next to the cooked mesh format, since the asset cooker has to leave them out)
+	std::string strFilePath = GetModelFilePath(resource);
+	if (IsStaticPropSource(strFilePath.substr(strFilePath.find_last_of('/') + 1).c_str()))
 	{
-		Model *pModel = new Model(m_pDevice, m_pImmediateContext, m_pDefaultTexture);
-		//pModel->GenerateCogwheel();
-		m_models.push_back(pModel);
-		pModel->SetPointLightColor(COLOR_XMF4(0.0f, 0.0f, 0.0f, 1.0f));
-		pModel->SetPointLightStrength(0.0f);
-		
-		switch (i)
-		{
-		case 0:
-			m_pLSystem->GenerateModel({ Module(TUBE_SYMBOL, { m_cogwheelRadii[i] - 1.5f, m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		case 1:
-			m_pLSystem->GenerateModel({ Module(TUBE_SYMBOL, { m_cogwheelRadii[i] - 3.0f, m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		case 2:
-			m_pLSystem->GenerateModel({ Module(TUBE_SYMBOL, { m_cogwheelRadii[i] - 1.0f, m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		case 3:
-			m_pLSystem->GenerateModel({ Module(CYLINDER_SYMBOL, { m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		case 4:
-			m_pLSystem->GenerateModel({ Module(TUBE_SYMBOL, { m_cogwheelRadii[i] - 0.5f, m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		case 5:
-			m_pLSystem->GenerateModel({ Module(TUBE_SYMBOL, { m_cogwheelRadii[i] - 2.2f, m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		case 6:
-			m_pLSystem->GenerateModel({ Module(TUBE_SYMBOL, { m_cogwheelRadii[i] - 0.75f, m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		case 7:
-			m_pLSystem->GenerateModel({ Module(CYLINDER_SYMBOL, { m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		case 8:
-			m_pLSystem->GenerateModel({ Module(TUBE_SYMBOL, { m_cogwheelRadii[i] - 0.8f, m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		case 9:
-			m_pLSystem->GenerateModel({ Module(TUBE_SYMBOL, { m_cogwheelRadii[i] - 0.85f, m_cogwheelRadii[i], m_cogwheelToothCount[i], 0.0f, COGWHEEL_TOOTH_SIZE, COGWHEEL_TOOTH_SIZE }) }, pModel);
-			break;
-		}
+		return StaticPropImportProfile;
 	}
 
-	return true;
+	// The clock hands and the lever handle are transformed by mesh index (the OBJ parser keeps the meshes and welds the vertices)
+	return FastImportProfile;
 }
 
-HRESULT ResourceManager::LoadDdsTexture(DdsTextureResource resource)
+XMMATRIX ResourceManager::GetModelWorldMatrix(ModelResource resource)
 {
-	HRESULT result = S_OK;
-
-	// Create texture
-
-	const wchar_t *filePath = L"";
+	// Instanced models are placed by their instances
 	switch (resource)
 	{
-	case GroundTexture:
-		filePath = L"Resources/cobblestone.dds";
+	case ClockModel1:
+	case ClockModel2:
+	case LeverModel1:
+	case LeverModel2:
+	{
+		std::vector<Instance> instances = GetLevelInstances(GetLevelModelName(resource));
+		if (!instances.empty())
+		{
+			return XMMatrixTranspose(instances[0].worldMatrix);
+		}
 		break;
 	}
-
-	ID3D11ShaderResourceView *pTexture;
-	result = CreateDDSTextureFromFile(m_pDevice, m_pImmediateContext, filePath, nullptr, &pTexture, 0, nullptr);
-	if (FAILED(result))
-	{
-		return result;
 	}
+	return XMMatrixIdentity();
+}
 
-	// Store texture in vector
-	m_ddsTextures.push_back(pTexture);
-
-	return result;
+XMFLOAT3 ResourceManager::GetModelPosition(ModelResource resource)
+{
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, GetModelWorldMatrix(resource).r[3]);
+	return position;
 }
 
-bool ResourceManager::LoadTxtModel(TxtModelResource resource)
+bool ResourceManager::LoadLevel()
 {
-	// Reference:
-	// RasterTek Tutorial 8: Loading Maya 2011 Models (http://www.rastertek.com/dx11tut08.html)
+	ProfileZone profileZone("Load level");
 
-	// Create model
-	TxtModel *pModel = nullptr;
-	if (resource == SkyDomeModel)
+	// The table is compiled again if it is missing, or the level file or the compiler changed since it was compiled
+	uint64_t sourceHash = CookedMeshWriter::HashFile(LEVEL_FILE_PATH);
+	if (m_levelLayout.Open(LEVEL_TABLE_FILE_PATH, sourceHash))
 	{
-		m_pSkyDome = new SkyDome();
+		return true;
 	}
-	else
+
+	std::string strError;
+	if (!LevelLayoutCompiler::Compile(LEVEL_FILE_PATH, LEVEL_TABLE_FILE_PATH, sourceHash, strError) || !m_levelLayout.Open(LEVEL_TABLE_FILE_PATH, sourceHash))
 	{
-		pModel = new TxtModel();
+		MessageBox(0, ("Failed to load level layout.\n" + strError).c_str(), "", 0);
+		return false;
 	}
 
-	// Open file
+#if defined(_DEBUG) || LOADING_BENCHMARK
+	OutputDebugStringA(("Compiled " LEVEL_FILE_PATH ": " + std::to_string(m_levelLayout.GetGroupCount()) + " models, " +
+						std::to_string(m_levelLayout.GetInstanceCount()) + " instances\n").c_str());
+#endif
+
+	return true;
+}
 
-	const char *filePath = "";
+const char* ResourceManager::GetLevelModelName(ModelResource resource)
+{
 	switch (resource)
 	{
-	case GroundModel:
-		filePath = "Resources/plane.txt";
-		break;
-	case SkyDomeModel:
-		filePath = "Resources/skydome.txt";
-		break;
+	case CrystalPostModel:
+		return "crystal_post";
+	case CrystalFenceModel:
+		return "crystal_fence";
+	case ClockModel1:
+		return "clock";
+	case ClockModel2:
+		return "floor_clock";
+	case LeverModel1:
+		return "left_lever";
+	case LeverModel2:
+		return "right_lever";
 	}
 
-	std::ifstream file;
-	file.open(filePath);
-	if (file.fail())
-	{
-		return false;
-	}
+	return "";
+}
+
+const char* ResourceManager::GetLevelModelName(TxtModelResource resource)
+{
+	return resource == GroundModel ? "ground" : "";
+}
+
+std::vector<Instance> ResourceManager::GetLevelInstances(const char *modelName)
+{
+	int iInstanceCount = 0;
+	const LevelInstance *pLevelInstances = m_levelLayout.GetInstances(modelName, iInstanceCount);
 
-	// Read up to the value of the vertex count
-	char input;
-	file.get(input);
-	while (input != ':')
+	// Instance matrices are stored transposed for the instance vertex shader
+	std::vector<Instance> instances(iInstanceCount);
+	for (int i = 0; i < iInstanceCount; i++)
 	{
-		file.get(input);
+		const float (&m)[4][3] = pLevelInstances[i].worldMatrix;
+		instances[i].worldMatrix = XMMatrixTranspose(XMMATRIX(m[0][0], m[0][1], m[0][2], 0.0f,
+															  m[1][0], m[1][1], m[1][2], 0.0f,
+															  m[2][0], m[2][1], m[2][2], 0.0f,
+															  m[3][0], m[3][1], m[3][2], 1.0f));
+		instances[i].textureTileCount = XMINT2(pLevelInstances[i].textureTileCount[0], pLevelInstances[i].textureTileCount[1]);
+		instances[i].lightDirection = DEFAULT_LIGHT_DIRECTION;
 	}
 
-	// Read the vertex count
-	int iVertexCount;
-	file >> iVertexCount;
-	if (resource == SkyDomeModel)
+	return instances;
+}
+
+Model* ResourceManager::LoadModel(ModelResource resource, int iInstanceCount, Instance *instances, VertexFormat vertexFormat, bool bBuildMeshlets)
+{
+	std::string strFilePath = GetModelFilePath(resource);
+	ImportProfile importProfile = GetImportProfile(resource);
+
+	Model *pModel = new Model(m_pDevice, m_pImmediateContext, m_pDefaultTexture, m_pTextureCache);
+	pModel->SetVertexFormat(vertexFormat);
+	pModel->SetImportProfile(importProfile);
+	pModel->SetMeshletsEnabled(bBuildMeshlets);
+	pModel->SetReadQueue(m_pReadQueue);
+	// Only the static props are batched, the clock and lever meshes are all animated apart from the clock face and lever base
+	// (which have nothing to be batched with), and the asset cooker can only cook models that are not batched
+	pModel->SetStaticBatchingEnabled(importProfile == StaticPropImportProfile); // Follows the profile, so not part of the registry key
+
+	// Each file is only imported once, models loaded from it again share its geometry
+	// (models are loaded on several threads, a model that shares geometry has to be loaded after the model it shares it with)
+	std::string strRegistryKey = strFilePath + '|' + std::to_string(vertexFormat) + '|' + std::to_string(importProfile) + '|' + 
+								 std::to_string(bBuildMeshlets);
+	Model *pSourceModel = nullptr;
 	{
-		m_pSkyDome->SetVertexCount(iVertexCount);
-		m_pSkyDome->SetIndexCount(iVertexCount);
+		std::lock_guard<std::mutex> lock(m_geometryRegistryMutex);
+		auto registryEntry = m_geometryRegistry.find(strRegistryKey);
+		if (registryEntry != m_geometryRegistry.end())
+		{
+			pSourceModel = registryEntry->second;
+		}
 	}
-	else
+	auto startTime = std::chrono::high_resolution_clock::now();
+	if (pSourceModel != nullptr)
 	{
-		pModel->SetVertexCount(iVertexCount);
-		pModel->SetIndexCount(iVertexCount);
+		// The source model may already be swapped in and rendered, so it is only read on the device thread (sharing is cheap)
+		bool bShared = false;
+		TaskGraph::RunOnDeviceThread([&] { bShared = pModel->InitializeShared(pSourceModel, iInstanceCount, instances); });
+		if (!bShared)
+		{
+			delete pModel;
+			return nullptr;
+		}
 	}
-
-	// Read up to the beginning of the vertex data
-	file.get(input);
-	while (input != ':')
+	else if (!pModel->Initialize(strFilePath, iInstanceCount, instances))
 	{
-		file.get(input);
+		delete pModel;
+		return nullptr;
 	}
-	file.get(input);
-	file.get(input);
+	float fMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
 
-	// Read the vertex data
-	VertexData *vertexData = new VertexData[iVertexCount];
-	for (int i = 0; i < iVertexCount; i++)
-	{
-		file >> vertexData[i].x >> vertexData[i].y >> vertexData[i].z;
-		file >> vertexData[i].tu >> vertexData[i].tv;
-		file >> vertexData[i].nx >> vertexData[i].ny >> vertexData[i].nz;
-	}
-	if (resource == SkyDomeModel)
+	std::lock_guard<std::mutex> lock(m_geometryRegistryMutex);
+	if (pSourceModel == nullptr)
 	{
-		m_pSkyDome->SetVertexData(vertexData);
+		m_geometryRegistry[strRegistryKey] = pModel;
+		m_geometryLoadTimes[strRegistryKey] = fMilliseconds;
 	}
+#ifdef _DEBUG
 	else
 	{
-		pModel->SetVertexData(vertexData);
-	}
-
-	// Close file
-	file.close();
-
-	if (resource != SkyDomeModel)
-	{
-		// Store model in vector
-		m_txtModels.push_back(pModel);
+		UINT uiSavedBytes = 0;
+		for (auto mesh : pModel->GetMeshes())
+		{
+			uiSavedBytes += mesh->GetGeometryByteSize();
+		}
+		std::string strReport = strFilePath + ": shared in " + std::to_string(fMilliseconds) + " ms (load took " + 
+								std::to_string(m_geometryLoadTimes[strRegistryKey]) + " ms), " + std::to_string(uiSavedBytes / 1024) + 
+								" KB of vertex and index buffers saved\n";
+		OutputDebugStringA(strReport.c_str());
 	}
+#endif
 
-	return true;
+	return pModel;
 }
 
-bool ResourceManager::LoadModel(ModelResource resource, int iInstanceCount, Instance *instances)
+void ResourceManager::PublishModel(ModelResource resource, Model *pModel)
 {
-	std::string strFilePath = "";
-	switch (resource)
-	{
-	case CrystalPostModel:
-		strFilePath = "Resources/crystal_post.obj";
-		break;
-	case CrystalFenceModel:
-		strFilePath = "Resources/crystal_fence.obj";
-		break;
-	case ClockModel1:
-	case ClockModel2:
-		strFilePath = "Resources/clock.obj";
-		break;
-	case LeverModel1:
-	case LeverModel2:
-		strFilePath = "Resources/lever.obj";
-		break;
-	}
-
-	Model *pModel = new Model(m_pDevice, m_pImmediateContext, m_pDefaultTexture);
-	if (!pModel->Initialize(strFilePath, iInstanceCount, instances))
+	TaskGraph::RunOnDeviceThread([&]
 	{
-		return false;
-	}
-
-	m_models.push_back(pModel);
+		Model *pOldModel = m_models[resource];
+		m_models[resource] = pModel;
+		SAFE_DELETE(m_proxyModels[resource]);
+		if (pOldModel == nullptr)
+		{
+			return;
+		}
 
-	return true;
+		// A reloaded model shares the geometry of the model it replaces (unless its file changed), so it takes its place in the registry
+		{
+			std::lock_guard<std::mutex> lock(m_geometryRegistryMutex);
+			for (auto &entry : m_geometryRegistry)
+			{
+				if (entry.second == pOldModel)
+				{
+					entry.second = pModel;
+				}
+			}
+		}
+		delete pOldModel;
+	});
 }
 
 #pragma endregion
@@ -588,6 +1492,16 @@ SkyDome* ResourceManager::GetSkyDome()
 	return m_pSkyDome;
 }
 
+bool ResourceManager::IsStreaming()
+{
+	return m_pStreamingGraph != nullptr;
+}
+
+bool ResourceManager::IsModelReady(TxtModelResource resource)
+{
+	return resource < m_txtModelReadyFlags.size() && m_txtModelReadyFlags[resource];
+}
+
 void ResourceManager::SetShouldRotateLeftCogwheels(bool bShouldRotate)
 {
 	m_bShouldRotateLeftCogwheels = bShouldRotate;
@@ -651,15 +1565,24 @@ void ResourceManager::RenderModel(TxtModelResource resource)
 
 bool ResourceManager::RenderModel(int iModelIndex, Camera *pCamera, LightShader *pLightShader)
 {
-	if (!pLightShader->PreRender(m_models[iModelIndex], pCamera))
+	// A model that is still loading is drawn as its proxy (if it has one)
+	Model *pModel = m_models[iModelIndex] != nullptr ? m_models[iModelIndex] : m_proxyModels[iModelIndex];
+	if (pModel == nullptr)
+	{
+		return true;
+	}
+
+	if (!pLightShader->PreRender(pModel, pCamera))
 	{
 		return false;
 	}
 
-	std::vector<Mesh*> meshes = m_models[iModelIndex]->GetMeshes();
+	std::vector<Mesh*> meshes = pModel->GetMeshes();
 
 	for (int i = 0; i < meshes.size(); i++)
 	{
+		meshes[i]->SelectLod(pCamera);
+		meshes[i]->CullMeshlets(pCamera);
 		meshes[i]->Render(m_pImmediateContext);
 		pLightShader->Render(meshes[i], pCamera);
 	}
@@ -669,9 +1592,8 @@ bool ResourceManager::RenderModel(int iModelIndex, Camera *pCamera, LightShader
 
 bool ResourceManager::RenderClock(Camera *pCamera, LightShader *pLightShader, float fRotation)
 {
-	if (m_bShouldRotateClock)
+	if (m_bShouldRotateClock && m_models[ModelResource::ClockModel1] != nullptr)
 	{
-		m_clockTranslationMatrix = XMMatrixTranslation(0.0f, 9.3f, 9.9f);
 		m_models[ModelResource::ClockModel1]->SetWorldMatrixOfMesh(m_clockScalingMatrix * XMMatrixRotationRollPitchYaw(XM_PI * 0.0f, XM_PI * 1.0f, fRotation) * m_clockTranslationMatrix, 0);
 		m_models[ModelResource::ClockModel1]->SetWorldMatrixOfMesh(m_clockScalingMatrix * XMMatrixRotationRollPitchYaw(XM_PI * 0.0f, XM_PI * 1.0f, fRotation / 60.0f) * m_clockTranslationMatrix, 2);
 		m_models[ModelResource::ClockModel1]->SetWorldMatrixOfMesh(m_clockScalingMatrix * XMMatrixRotationRollPitchYaw(XM_PI * 0.0f, XM_PI * 1.0f, fRotation / 3600.0f) * m_clockTranslationMatrix, 1);
@@ -686,11 +1608,13 @@ bool ResourceManager::RenderClock(Camera *pCamera, LightShader *pLightShader, fl
 	{
 		return false;
 	}
+
+	return true;
 }
 
 bool ResourceManager::RenderLever(Camera *pCamera, LightShader *pLightShader, float fLeftRotation, float fRightRotation)
 {
-	if (m_bShouldRotateLeftLever)
+	if (m_bShouldRotateLeftLever && m_models[ModelResource::LeverModel1] != nullptr)
 	{
 		XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(fLeftRotation * 3.0f, XM_PI * 0.5f, 0.0f);
 		m_models[ModelResource::LeverModel1]->SetWorldMatrixOfMesh(m_leverScalingMatrix * rotationMatrix * m_leftLeverTranslationMatrix, 0);
@@ -701,7 +1625,7 @@ bool ResourceManager::RenderLever(Camera *pCamera, LightShader *pLightShader, fl
 		return false;
 	}
 
-	if (m_bShouldRotateRightLever)
+	if (m_bShouldRotateRightLever && m_models[ModelResource::LeverModel2] != nullptr)
 	{
 		XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(fRightRotation * 3.0f, XM_PI * 0.5f, 0.0f);
 		m_models[ModelResource::LeverModel2]->SetWorldMatrixOfMesh(m_leverScalingMatrix * rotationMatrix * m_rightLeverTranslationMatrix, 0);
@@ -848,6 +1772,11 @@ bool ResourceManager::RenderCogwheels(Camera *pCamera, LightShader *pLightShader
 		}
 		}
 
+		if (m_models[i] == nullptr)
+		{
+			continue;
+		}
+
 		XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(0.0f, 0.0f, fRotationZ);
 		XMMATRIX translationMatrix = XMMatrixTranslation(positions[j].m128_f32[0], positions[j].m128_f32[1], positions[j].m128_f32[2]);
 		m_models[i]->SetWorldMatrix(rotationMatrix * translationMatrix);
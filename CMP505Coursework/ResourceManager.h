@@ -6,17 +6,42 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <mutex>
+#include <chrono>
 #include <fstream>
+#include <sstream>
+#include <memory>
 #include <DirectXTK/DDSTextureLoader.h>
 #include "SkyDome.h"
 #include "Model.h"
 #include "LightShader.h"
 #include "LSystem.h"
+#include "TxtModelParser.h"
+#include "TaskGraph.h"
+#include "DdsFile.h"
+#include "LevelLayout.h"
+#include "ResidencyTracker.h"
+#include "FileReadQueue.h"
+#include "ProceduralGeometry.h"
 #include "Utils.h"
 
-#define LEFT_LEVER_POSITION XMFLOAT3(-27.6f, 1.1f, -0.05f)
-#define RIGHT_LEVER_POSITION XMFLOAT3(27.6f, 1.1f, -0.05f)
+#define LEVEL_FILE_PATH "Resources/main.level"
+#define LEVEL_TABLE_FILE_PATH COOKED_MESH_DIRECTORY "main.level" LEVEL_TABLE_EXTENSION
 #define COGWHEEL_TOOTH_SIZE 0.85f
+#define COGWHEEL_LSYSTEM_FILE_PATH "Resources/cogwheels.lsystem"	// The L-system rules, and an axiom for each cogwheel
+#define LOADING_BENCHMARK false		// Load the resources with 1 to N threads before the real load and report the timings
+#define IMPORT_PROFILE_REPORT false	// Import each model file with every import profile before loading and report the stats
+#define DDS_SKIPPED_MIP_COUNT 0		// Top mips of the DDS textures that are not uploaded (each one quarters the memory, for low memory settings)
+#define STREAMING_BUDGET_MILLISECONDS 4.0f	// Time each frame can spend creating streamed resources on the device
+#define GROUND_TEXTURE_FILE_PATH "Resources/cobblestone.dds"
+#define PROCEDURAL_SKY_AND_GROUND true	// Generate the sky dome and the ground instead of reading their text files
+#define PROCEDURAL_GEOMETRY_QUALITY MediumGeometryQuality
+#define SKY_DOME_RADIUS 2.0f
+#define GROUND_SIZE 40.0f				// Width and depth of each ground instance before it is scaled
+#define RELEASE_CPU_GEOMETRY true	// Free the CPU copies of the geometry and instances once they are on the GPU (unless culling or moving the instances needs them)
 
 enum DdsTextureResource : int
 {
@@ -58,22 +83,51 @@ public:
 	void SetShouldRotateRightLever(bool bShouldRotate);
 	bool IsRotatingRightLever();
 	void SetShouldRotateClock(bool bShouldRotate);
+	// Where the level places the model (the origin for instanced models)
+	XMFLOAT3 GetModelPosition(ModelResource resource);
 
-	bool LoadResources();
+	// Loads on the default number of threads if the thread count is 0
+	bool LoadResources(int iThreadCount = 0);
+	// Loads the resources in the background, models are drawn as boxes (if they have been cooked before) until they are swapped in
+	// There are always worker threads, so the render thread only creates the D3D resources
+	bool StartStreaming(int iThreadCount = 0);
+	// Called by the render thread every frame, fails if a resource failed to load
+	bool UpdateStreaming(float fBudgetMilliseconds);
+	bool IsStreaming();
+	bool IsModelReady(TxtModelResource resource);
+	// Loads what uses a changed file again in the background (only the models, textures and placements that use it), and swaps it in between frames
+	// Files that change while a reload (or the streaming) is running are reloaded after it, and a file nothing uses is ignored
+	void ReloadFile(const std::string &strFilePath);
+	// Called by the render thread every frame, returns true when a reload has finished (the level may have moved the models)
+	// A reload that fails keeps the resources it could not load as they were
+	bool UpdateReloading(float fBudgetMilliseconds);
 	void RenderModel(TxtModelResource resource);
 	bool RenderModel(int iModelIndex, Camera *pCamera, LightShader *pLightShader);
 	bool RenderClock(Camera *pCamera, LightShader *pLightShader, float fRotation);
 	bool RenderLever(Camera *pCamera, LightShader *pLightShader, float fLeftRotation, float fRightRotation);
 	bool RenderCogwheels(Camera *pCamera, LightShader *pLightShader, float fLeftRotation, float fRightRotation);
+	// CPU and GPU memory of every loaded resource (models that are still loading are counted as their proxies)
+	std::string GetResidencySnapshot();
 
 private:
 	ID3D11Device *m_pDevice;
 	ID3D11DeviceContext *m_pImmediateContext;
 	ID3D11ShaderResourceView *m_pDefaultTexture;
+	TextureCache *m_pTextureCache;
 	std::vector<ID3D11ShaderResourceView*> m_ddsTextures;
 	std::vector<TxtModel*> m_txtModels;
 	SkyDome *m_pSkyDome;
+	std::vector<bool> m_txtModelReadyFlags;			// Set on the device thread once the buffers are created (sky dome included)
 	std::vector<Model*> m_models;
+	std::vector<Model*> m_proxyModels;				// Drawn until the model at the same index is swapped in
+	LevelLayoutFile m_levelLayout;
+	TaskGraph *m_pStreamingGraph;
+	TaskGraph *m_pReloadGraph;
+	FileReadQueue *m_pReadQueue;					// The model files the loading tasks import, read ahead while loading (nullptr once loaded)
+	std::set<std::string> m_pendingReloadFiles;
+	std::map<std::string, Model*> m_geometryRegistry;	// The first model loaded from each file (and vertex format), whose buffers the others share
+	std::map<std::string, float> m_geometryLoadTimes;	// Milliseconds the first load took
+	std::mutex m_geometryRegistryMutex;
 	LSystem *m_pLSystem;
 	std::vector<float> m_cogwheelToothCount;
 	std::vector<float> m_cogwheelRadii;
@@ -84,11 +138,60 @@ private:
 	XMMATRIX m_leverScalingMatrix;
 	XMMATRIX m_leftLeverTranslationMatrix;
 	XMMATRIX m_rightLeverTranslationMatrix;
+	ID3D11ShaderResourceView *m_pLeverTexture;
 	bool m_bShouldRotateClock;
 	XMMATRIX m_clockScalingMatrix;
 	XMMATRIX m_clockTranslationMatrix;
 
-	HRESULT LoadDdsTexture(DdsTextureResource resource);
+	// Fails if the level cannot be loaded
+	bool PrepareLoading();
+	// Starts reading every model file (and the material libraries Assimp imports) at once, so the reads overlap each other and the loading tasks
+	void SubmitModelReads();
+	void AddLoadingTasks(TaskGraph &taskGraph);
+	void EndLoading(TaskGraph &taskGraph);
+	void CreateProxyModels();
+	void ReleaseCpuGeometry();
+	std::string GetModelAssetName(int iModelIndex);
+	// The level's placements and the files that changed are only known when the reload starts, so the tasks decide what they load when they run
+	// Returns false if nothing uses the files
+	bool AddReloadTasks(TaskGraph &taskGraph, const std::set<std::string> &changedFiles);
+	// Derives the animation matrices of the clock hands and the lever handles from their placements
+	void PlaceAnimatedModels();
+	const char* GetTextureFilePath(DdsTextureResource resource);
+	bool ReadDdsTexture(DdsTextureResource resource, DdsFile &file);
+	HRESULT LoadDdsTexture(DdsTextureResource resource, DdsFile &file);
 	bool LoadTxtModel(TxtModelResource resource);
-	bool LoadModel(ModelResource resource, int iInstanceCount, Instance *instances = nullptr);
+	const char* GetTxtModelFilePath(TxtModelResource resource);
+	// Returns nullptr if the model cannot be read (from its cooked mesh unless the text file has changed since it was cooked)
+	// The vertices are welded, so the model is drawn with the index data (both allocated with new[])
+	VertexData* ReadTxtModel(TxtModelResource resource, int &iVertexCount, uint32_t *&indexData, int &iIndexCount);
+	// The shapes of the text models, with the tessellation of the quality level (nothing is read from disk)
+	VertexData* GenerateTxtModel(TxtModelResource resource, int &iVertexCount, uint32_t *&indexData, int &iIndexCount);
+	// Creates the buffers of the ground with the level's ground instances (the ground has no buffers, and is not drawn, if the level has no ground)
+	bool InitializeGround(TxtModel *pModel);
+	bool InitializeSkyDome(SkyDome *pSkyDome);
+	VertexData* LoadCookedTxtModel(const char *filePath, uint64_t sourceHash, int &iVertexCount, uint32_t *&indexData, int &iIndexCount);
+	bool CookTxtModel(const char *filePath, uint64_t sourceHash, VertexData *vertexData, int iVertexCount, const uint32_t *indexData, int iIndexCount);
+	std::string GetModelFilePath(ModelResource resource);
+	// The model's file, the material libraries it names and the textures they name (what a reload of the model is for)
+	std::vector<std::string> GetModelDependencies(ModelResource resource);
+	std::vector<std::string> GetMaterialTexturePaths(const std::vector<std::string> &materialLibraries);
+	ImportProfile GetImportProfile(ModelResource resource);
+	XMMATRIX GetModelWorldMatrix(ModelResource resource);
+	bool LoadLevel();
+	const char* GetLevelModelName(ModelResource resource);
+	const char* GetLevelModelName(TxtModelResource resource);
+	// Instances of the model in the level, in the order of the instance table (empty if the level does not place the model)
+	std::vector<Instance> GetLevelInstances(const char *modelName);
+	// Returns nullptr if the model fails to load, the model is not rendered until it is published
+	Model* LoadModel(ModelResource resource, int iInstanceCount, Instance *instances = nullptr, VertexFormat vertexFormat = FullPrecisionVertexFormat, bool bBuildMeshlets = false);
+	// Swaps the model in (and deletes its proxy, or the model it replaces) on the device thread, between frames
+	void PublishModel(ModelResource resource, Model *pModel);
+	bool LoadCrystalPosts();
+	bool LoadCrystalFences();
+	bool LoadClock(ModelResource resource);
+	bool LoadLever(ModelResource resource);
+	// Fails if the file cannot be parsed, or does not have an axiom for each cogwheel
+	bool LoadCogwheelRules(LSystem &lSystem, std::string &strError);
+	bool LoadCogwheel(int iCogwheelIndex);
 };
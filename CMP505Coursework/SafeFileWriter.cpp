@@ -0,0 +1,46 @@
+//
+// SafeFileWriter.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// MoveFileExA (https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-movefileexa)
+// rename(2) (https://man7.org/linux/man-pages/man2/rename.2.html)
+//
+
+#include <cstdio>
+#include <fstream>
+#include "SafeFileWriter.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+bool SafeFileWriter::Write(const std::string &strFilePath, const char *pData, size_t size)
+{
+	std::string strTemporaryFilePath = strFilePath + ".tmp";
+	std::ofstream file(strTemporaryFilePath, std::ios::binary | std::ios::trunc);
+	if (file.fail())
+	{
+		return false;
+	}
+	file.write(pData, size);
+	file.close();
+	if (file.fail())
+	{
+		std::remove(strTemporaryFilePath.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	// rename fails on Windows if the file exists, MoveFileEx replaces it without removing it first
+	if (!MoveFileExA(strTemporaryFilePath.c_str(), strFilePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+#else
+	if (std::rename(strTemporaryFilePath.c_str(), strFilePath.c_str()) != 0)
+#endif
+	{
+		std::remove(strTemporaryFilePath.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,22 @@
+//
+// SafeFileWriter.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// MoveFileExA (https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-movefileexa)
+// rename(2) (https://man7.org/linux/man-pages/man2/rename.2.html)
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Writes whole files so that readers only ever see the old file or the complete new one
+class SafeFileWriter
+{
+public:
+	// Writes to a temporary file next to the file, then moves it over the file in one step
+	// (a crash before the move leaves the old file, and the temporary file is overwritten next time)
+	static bool Write(const std::string &strFilePath, const char *pData, size_t size);
+};
@@ -28,6 +28,8 @@ Shader::~Shader()
 HRESULT Shader::Initialize(LPCWSTR vertexShaderFilename, LPCSTR vertexShaderEntryPoint, LPCWSTR pixelShaderFilename, LPCSTR pixelShaderEntryPoint, D3D11_INPUT_ELEMENT_DESC vertexInputDesc[], UINT uiElementCount)
 {
 	HRESULT result = S_OK;
+	AddSourceFile(vertexShaderFilename);
+	AddSourceFile(pixelShaderFilename);
 
 	// Compile the vertex shader
 	ID3DBlob *pCompiledVertexShader;
@@ -104,13 +106,22 @@ HRESULT Shader::Initialize(LPCWSTR vertexShaderFilename, LPCSTR vertexShaderEntr
 	return result;
 }
 
-HRESULT Shader::CompileShaderFromFile(LPCWSTR filename, LPCSTR entryPoint, LPCSTR target, ID3DBlob **ppCompiledShader)
+HRESULT Shader::CompileShaderFromFile(LPCWSTR filename, LPCSTR entryPoint, LPCSTR target, ID3DBlob **ppCompiledShader, const D3D_SHADER_MACRO *defines)
 {
 	HRESULT result = S_OK;
 
+	// The file name is only converted for the zone while a capture is running
+	std::string strZoneName;
+	if (Profiler::IsCapturing())
+	{
+		std::wstring wstrFilename(filename);
+		strZoneName = "Compile " + std::string(wstrFilename.begin(), wstrFilename.end()) + " (" + entryPoint + ")";
+	}
+	ProfileZone profileZone(strZoneName.c_str());
+
 	ID3DBlob *pError = nullptr;
 	result = D3DCompileFromFile(filename,
-								nullptr,										 // Array of shader macros
+								defines,										 // Array of shader macros (null-terminated)
 								nullptr,										 // Include interface the compiler will use if the shader contains #include
 								entryPoint,										 // Name of the shader entry point function where shader execution begins
 								target,											 // Target set of shader features / effect type
@@ -132,6 +143,28 @@ HRESULT Shader::CompileShaderFromFile(LPCWSTR filename, LPCSTR entryPoint, LPCST
 	return result;
 }
 
+bool Shader::UsesSourceFile(const std::string &strFilePath)
+{
+	for (auto &strSourceFilePath : m_sourceFilePaths)
+	{
+		if (strSourceFilePath == strFilePath)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Shader::AddSourceFile(LPCWSTR filename)
+{
+	std::wstring wstrFilename(filename);
+	std::string strFilePath(wstrFilename.begin(), wstrFilename.end());
+	if (!UsesSourceFile(strFilePath))
+	{
+		m_sourceFilePaths.push_back(strFilePath);
+	}
+}
+
 #pragma endregion
 
 #pragma region Render
@@ -8,6 +8,9 @@
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include <directxmath.h>
+#include <string>
+#include <vector>
+#include "Profiler.h"
 #include "Utils.h"
 
 // Link library
@@ -29,7 +32,9 @@ public:
 	virtual ~Shader();
 
 	HRESULT Initialize(LPCWSTR vertexShaderFilename, LPCSTR vertexShaderEntryPoint, LPCWSTR pixelShaderFilename, LPCSTR pixelShaderEntryPoint, D3D11_INPUT_ELEMENT_DESC vertexInputDesc[], UINT uiElementCount);
-	static HRESULT CompileShaderFromFile(LPCWSTR filename, LPCSTR entryPoint, LPCSTR target, ID3DBlob **ppCompiledCode);
+	static HRESULT CompileShaderFromFile(LPCWSTR filename, LPCSTR entryPoint, LPCSTR target, ID3DBlob **ppCompiledCode, const D3D_SHADER_MACRO *defines = nullptr);
+	// Whether the shader was compiled from the file ("Shaders/LightPixelShader.hlsl")
+	bool UsesSourceFile(const std::string &strFilePath);
 
 protected:
 	ID3D11Device *m_pDevice;
@@ -38,6 +43,8 @@ protected:
 	ID3D11PixelShader *m_pPixelShader;
 	ID3D11InputLayout *m_pVertexInputLayout;
 	ID3D11Buffer *m_pMatrixBuffer;
+	std::vector<std::string> m_sourceFilePaths;
 
+	void AddSourceFile(LPCWSTR filename);
 	HRESULT SetMatrixBuffer(XMMATRIX worldMatrix, XMMATRIX viewMatrix, XMMATRIX projectionMatrix);
 };
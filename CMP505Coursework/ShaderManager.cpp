@@ -4,11 +4,14 @@
 //
 
 #include "ShaderManager.h"
+#include <memory>
 
 #pragma region Init
 
 ShaderManager::ShaderManager(ID3D11Device *device, ID3D11DeviceContext *immediateContext)
 {
+	m_pDevice = device;
+	m_pImmediateContext = immediateContext;
 	m_pLightShader = new LightShader(device, immediateContext);
 	m_pSkyDomeShader = new SkyDomeShader(device, immediateContext);
 	m_pColorShader = new ColorShader(device, immediateContext);
@@ -23,6 +26,7 @@ ShaderManager::~ShaderManager()
 
 HRESULT ShaderManager::InitializeShaders()
 {
+	ProfileZone profileZone("ShaderManager::InitializeShaders");
 	HRESULT result = S_OK;
 	
 	result = m_pLightShader->Initialize();
@@ -46,6 +50,56 @@ HRESULT ShaderManager::InitializeShaders()
 	return result;
 }
 
+bool ShaderManager::AddReloadTasks(TaskGraph &taskGraph, const std::set<std::string> &changedFiles)
+{
+	// Each shader is compiled once, however many of its files changed
+	bool bIsLightShaderChanged = false;
+	bool bIsSkyDomeShaderChanged = false;
+	bool bIsColorShaderChanged = false;
+	for (auto &strFilePath : changedFiles)
+	{
+		bIsLightShaderChanged |= m_pLightShader->UsesSourceFile(strFilePath);
+		bIsSkyDomeShaderChanged |= m_pSkyDomeShader->UsesSourceFile(strFilePath);
+		bIsColorShaderChanged |= m_pColorShader->UsesSourceFile(strFilePath);
+	}
+
+	if (bIsLightShaderChanged)
+	{
+		AddShaderReloadTasks(taskGraph, "light shader", &m_pLightShader);
+	}
+	if (bIsSkyDomeShaderChanged)
+	{
+		AddShaderReloadTasks(taskGraph, "sky dome shader", &m_pSkyDomeShader);
+	}
+	if (bIsColorShaderChanged)
+	{
+		AddShaderReloadTasks(taskGraph, "color shader", &m_pColorShader);
+	}
+
+	return bIsLightShaderChanged || bIsSkyDomeShaderChanged || bIsColorShaderChanged;
+}
+
+template<class T>
+void ShaderManager::AddShaderReloadTasks(TaskGraph &taskGraph, std::string strName, T **ppShader)
+{
+	// The tasks own the new shader until it is swapped in, so it is deleted if it fails or the graph is cancelled
+	// (creating shaders only uses the device, which is thread safe, so the whole shader is built on the worker thread)
+	std::shared_ptr<std::unique_ptr<T>> pNewShader = std::make_shared<std::unique_ptr<T>>();
+
+	int iCompileShader = taskGraph.AddTask("Compile " + strName, WorkerThread, {}, [this, pNewShader]
+	{
+		pNewShader->reset(new T(m_pDevice, m_pImmediateContext));
+		return SUCCEEDED((*pNewShader)->Initialize());
+	});
+
+	taskGraph.AddTask("Swap " + strName, DeviceThread, { iCompileShader }, [ppShader, pNewShader]
+	{
+		delete *ppShader;
+		*ppShader = pNewShader->release();
+		return true;
+	});
+}
+
 #pragma endregion
 
 #pragma region Setters/Getters
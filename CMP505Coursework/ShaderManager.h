@@ -8,6 +8,8 @@
 #include "LightShader.h"
 #include "SkyDomeShader.h"
 #include "ColorShader.h"
+#include <set>
+#include "TaskGraph.h"
 
 class ShaderManager
 {
@@ -21,9 +23,17 @@ public:
 	bool RenderModel(TxtModel *pModel, Camera *pCamera);
 	bool RenderSkyDome(SkyDome *pSkyDome, Camera *pCamera, float fTime);
 	bool RenderModel(ColorModel *pModel, Camera *pCamera);
+	// Adds tasks that compile the shaders that use the files again on a worker thread, and swap them in on the device thread
+	// Returns false if no shader uses the files (a shader that fails to compile is kept as it was)
+	bool AddReloadTasks(TaskGraph &taskGraph, const std::set<std::string> &changedFiles);
 
 private:
+	ID3D11Device *m_pDevice;
+	ID3D11DeviceContext *m_pImmediateContext;
 	LightShader *m_pLightShader;
 	SkyDomeShader *m_pSkyDomeShader;
 	ColorShader *m_pColorShader;
+
+	template<class T>
+	void AddShaderReloadTasks(TaskGraph &taskGraph, std::string strName, T **ppShader);
 };
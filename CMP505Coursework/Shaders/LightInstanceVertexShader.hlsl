@@ -25,16 +25,36 @@ cbuffer LightVSBuffer
 	float3 padding;
 };
 
+#ifdef QUANTIZED_VERTEX
+cbuffer QuantizationVSBuffer
+{
+	float4 positionCenter;
+	float4 positionExtents;
+};
+#endif
+
 // Input/output
 
 struct VS_INPUT
 {
+#ifdef QUANTIZED_VERTEX
+	float4 position : POSITION;	// Normalized to [-1, 1] within the mesh bounds
+	float2 texCoord : TEXCOORD0;
+	float2 normal : NORMAL;		// Octahedral-encoded
+#else
 	float4 position : POSITION;
 	float2 texCoord : TEXCOORD0;
 	float3 normal : NORMAL;
+#endif
+#ifdef PACKED_INSTANCE
+	float4 worldMatrix0 : WORLDMATRIX0;	// First three columns of the affine world matrix
+	float4 worldMatrix1 : WORLDMATRIX1;
+	float4 worldMatrix2 : WORLDMATRIX2;
+#else
 	matrix worldMatrix : WORLDMATRIX;
     uint2 texTileCount : TEX_TILE;
     float3 lightDirection : LIGHT_DIR;
+#endif
 };
 
 struct PS_INPUT
@@ -48,31 +68,63 @@ struct PS_INPUT
     float3 instanceLightDirection : LIGHT_DIR;
 };
 
+// Helper functions
+
+#ifdef QUANTIZED_VERTEX
+float3 DecodeOctahedralNormal(float2 encodedNormal)
+{
+	float3 normal = float3(encodedNormal.xy, 1.0f - abs(encodedNormal.x) - abs(encodedNormal.y));
+	float t = saturate(-normal.z);
+	normal.xy += (normal.xy >= 0.0f) ? -t : t;
+	return normalize(normal);
+}
+#endif
+
 // Entry point
 
 PS_INPUT VS(VS_INPUT input)
 {
 	PS_INPUT output;
 
+#ifdef QUANTIZED_VERTEX
+	// Decode the position and the normal
+	input.position.xyz = input.position.xyz * positionExtents.xyz + positionCenter.xyz;
+	float3 normal = DecodeOctahedralNormal(input.normal);
+#else
+	float3 normal = input.normal;
+#endif
+
+#ifdef PACKED_INSTANCE
+	// Rebuild the world matrix (the last column of an affine matrix is always (0, 0, 0, 1))
+	// The texture tile count is shared by every instance and the pixel shader uses the light direction of the draw
+	matrix worldMatrix = transpose(matrix(input.worldMatrix0, input.worldMatrix1, input.worldMatrix2, float4(0.0f, 0.0f, 0.0f, 1.0f)));
+	uint2 texTileCount = uint2(textureTileCountX, textureTileCountY);
+	float3 lightDirection = float3(0.0f, 0.0f, 0.0f);
+#else
+	matrix worldMatrix = input.worldMatrix;
+	uint2 texTileCount = input.texTileCount;
+	float3 lightDirection = input.lightDirection;
+#endif
+
 	// Change the position vector to be 4 units for proper matrix calculations
 	input.position.w = 1.0f;
 
 	// Calculate the position of the vertex in the world
-    float4 worldPosition = mul(input.position, input.worldMatrix);
+    float4 worldPosition = mul(input.position, worldMatrix);
     output.position = worldPosition;
     output.worldPosition = worldPosition;
 
-    output.meshPosition = float3(input.worldMatrix._41, input.worldMatrix._42, input.worldMatrix._43);
+    output.meshPosition = float3(worldMatrix._41, worldMatrix._42, worldMatrix._43);
 
 	// Calculate the position of the vertex against the view and projection matrices
 	output.position = mul(output.position, viewMatrix);
 	output.position = mul(output.position, projectionMatrix);
 
 	// Store the texture coordinates for the pixel shader
-    output.texCoord = float2(input.texCoord.x * input.texTileCount.x, input.texCoord.y * input.texTileCount.y);
+    output.texCoord = float2(input.texCoord.x * texTileCount.x, input.texCoord.y * texTileCount.y);
 
 	// Calculate the normal vector against the world matrix only
-    output.normal = mul(input.normal, (float3x3) input.worldMatrix);
+    output.normal = mul(normal, (float3x3) worldMatrix);
 
 	// Normalize the normal vector
 	output.normal = normalize(output.normal);
@@ -84,7 +136,7 @@ PS_INPUT VS(VS_INPUT input)
 	output.viewDirection = normalize(output.viewDirection);
 
 	// Store the light direction for the pixel shader
-    output.instanceLightDirection = input.lightDirection;
+    output.instanceLightDirection = lightDirection;
 
 	return output;
 }
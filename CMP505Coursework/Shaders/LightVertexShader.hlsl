@@ -24,13 +24,27 @@ cbuffer LightVSBuffer
 	float3 padding;
 };
 
+#ifdef QUANTIZED_VERTEX
+cbuffer QuantizationVSBuffer
+{
+	float4 positionCenter;
+	float4 positionExtents;
+};
+#endif
+
 // Input/output
 
 struct VS_INPUT
 {
+#ifdef QUANTIZED_VERTEX
+	float4 position : POSITION;	// Normalized to [-1, 1] within the mesh bounds
+	float2 texCoord : TEXCOORD0;
+	float2 normal : NORMAL;		// Octahedral-encoded
+#else
 	float4 position : POSITION;
 	float2 texCoord : TEXCOORD0;
 	float3 normal : NORMAL;
+#endif
 };
 
 struct PS_INPUT
@@ -44,12 +58,32 @@ struct PS_INPUT
     float3 instanceLightDirection : LIGHT_DIR;
 };
 
+// Helper functions
+
+#ifdef QUANTIZED_VERTEX
+float3 DecodeOctahedralNormal(float2 encodedNormal)
+{
+	float3 normal = float3(encodedNormal.xy, 1.0f - abs(encodedNormal.x) - abs(encodedNormal.y));
+	float t = saturate(-normal.z);
+	normal.xy += (normal.xy >= 0.0f) ? -t : t;
+	return normalize(normal);
+}
+#endif
+
 // Entry point
 
 PS_INPUT VS(VS_INPUT input)
 {
 	PS_INPUT output;
 
+#ifdef QUANTIZED_VERTEX
+	// Decode the position and the normal
+	input.position.xyz = input.position.xyz * positionExtents.xyz + positionCenter.xyz;
+	float3 normal = DecodeOctahedralNormal(input.normal);
+#else
+	float3 normal = input.normal;
+#endif
+
 	// Change the position vector to be 4 units for proper matrix calculations
 	input.position.w = 1.0f;
 
@@ -68,7 +102,7 @@ PS_INPUT VS(VS_INPUT input)
 	output.texCoord = float2(input.texCoord.x * textureTileCountX, input.texCoord.y * textureTileCountY);
 
 	// Calculate the normal vector against the world matrix only
-    output.normal = mul(input.normal, (float3x3) worldMatrix);
+    output.normal = mul(normal, (float3x3) worldMatrix);
 
 	// Normalize the normal vector
 	output.normal = normalize(output.normal);
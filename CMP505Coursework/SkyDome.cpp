@@ -14,8 +14,11 @@ SkyDome::SkyDome()
 {
 	m_pVertexBuffer = nullptr;
 	m_iVertexCount = 0;
+	m_vertexData = nullptr;
 	m_pIndexBuffer = nullptr;
 	m_iIndexCount = 0;
+	m_indexData = nullptr;
+	m_indexFormat = DXGI_FORMAT_R32_UINT;
 	m_worldMatrix = XMMatrixIdentity();
 }
 
@@ -23,20 +26,19 @@ SkyDome::~SkyDome()
 {
 	SAFE_RELEASE(m_pVertexBuffer);
 	SAFE_RELEASE(m_pIndexBuffer);
+	SAFE_DELETE_ARRAY(m_vertexData);
+	SAFE_DELETE_ARRAY(m_indexData);
 }
 
 bool SkyDome::InitializeBuffers(ID3D11Device *pDevice)
 {
 	SkyDomeVertex *vertices = new SkyDomeVertex[m_iVertexCount];
-	unsigned long *indices = new unsigned long[m_iIndexCount];
 
-	// Load the model data into the vertex and index arrays
+	// Load the model data into the vertex array
 	for (int i = 0; i < m_iVertexCount; i++)
 	{
 		vertices[i].position = XMFLOAT3(m_vertexData[i].x, m_vertexData[i].y, m_vertexData[i].z);
 		vertices[i].textureCoordinates = XMFLOAT2(m_vertexData[i].tu, m_vertexData[i].tv);
-
-		indices[i] = i;
 	}
 
 	// Create the vertex buffer
@@ -59,25 +61,41 @@ bool SkyDome::InitializeBuffers(ID3D11Device *pDevice)
 
 	SAFE_DELETE_ARRAY(vertices);
 
-	// Create the index buffer
-
-	bufferDesc.ByteWidth = sizeof(unsigned long) * m_iIndexCount;
-	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;					// Bind the buffer as an index buffer to the input assembler stage
-
-	subresourceData.pSysMem = indices;
+	// Create the index buffer (the sky dome is drawn every frame, so it benefits most from the shared vertices)
 
-	result = pDevice->CreateBuffer(&bufferDesc, &subresourceData, &m_pIndexBuffer);
+	result = TxtModel::CreateIndexBuffer(pDevice, m_indexData, m_iIndexCount, m_iVertexCount, &m_pIndexBuffer, m_indexFormat);
 	if (FAILED(result))
 	{
 		Utils::ShowError("Failed to create sky dome index buffer.", result);
 		return false;
 	}
 
-	SAFE_DELETE_ARRAY(indices);
-
 	return true;
 }
 
+void SkyDome::ReleaseCpuGeometry()
+{
+	if (m_pVertexBuffer != nullptr)
+	{
+		SAFE_DELETE_ARRAY(m_vertexData);
+		SAFE_DELETE_ARRAY(m_indexData);
+	}
+}
+
+void SkyDome::TrackResidency(ResidencyTracker &tracker, const std::string &strAssetName)
+{
+	if (m_vertexData != nullptr)
+	{
+		tracker.AddCpuBytes(strAssetName, VertexResidency, sizeof(VertexData) * m_iVertexCount);
+	}
+	if (m_indexData != nullptr)
+	{
+		tracker.AddCpuBytes(strAssetName, IndexResidency, sizeof(uint32_t) * m_iIndexCount);
+	}
+	tracker.AddBuffer(strAssetName, VertexResidency, m_pVertexBuffer);
+	tracker.AddBuffer(strAssetName, IndexResidency, m_pIndexBuffer);
+}
+
 #pragma endregion
 
 #pragma region Setters/Getters
@@ -97,6 +115,11 @@ void SkyDome::SetIndexCount(int iCount)
 	m_iIndexCount = iCount;
 }
 
+void SkyDome::SetIndexData(uint32_t *indexData)
+{
+	m_indexData = indexData;
+}
+
 int SkyDome::GetIndexCount()
 {
 	return m_iIndexCount;
@@ -160,7 +183,7 @@ void SkyDome::Render(ID3D11DeviceContext *pImmediateContext)
 										  &uiOffsets);			// Number of bytes between the first element of a vertex buffer and the first element that will be used (one offset for each vertex buffer in the array)
 
 	pImmediateContext->IASetIndexBuffer(m_pIndexBuffer,
-									    DXGI_FORMAT_R32_UINT,	// 32-bit format that supports 32 bits for the red channel
+									    m_indexFormat,			// 16-bit if every vertex can be indexed with 16 bits, otherwise 32-bit
 									    0);						// Offset in bytes from the start of the index buffer to the first index to use
 
 	// Set the primitive topology (how the GPU obtains the three vertices it requires to render a triangle)
@@ -23,8 +23,11 @@ public:
 	~SkyDome();
 
 	void SetVertexCount(int iCount);
+	// The sky dome takes over the vertex data (allocated with new[])
 	void SetVertexData(VertexData *vertexData);
 	void SetIndexCount(int iCount);
+	// The sky dome takes over the index data (allocated with new[]), the vertices are drawn in order if there is none
+	void SetIndexData(uint32_t *indexData);
 	int GetIndexCount();
 	void SetWorldMatrix(XMMATRIX worldMatrix);
 	XMMATRIX GetWorldMatrix();
@@ -36,6 +39,9 @@ public:
 	XMFLOAT4 GetBottomColor();
 
 	bool InitializeBuffers(ID3D11Device *pDevice);
+	// Frees the vertex data once the buffers have been created
+	void ReleaseCpuGeometry();
+	void TrackResidency(ResidencyTracker &tracker, const std::string &strAssetName);
 	void Render(ID3D11DeviceContext *pImmediateContext);
 
 private:
@@ -44,6 +50,8 @@ private:
 	VertexData *m_vertexData;
 	ID3D11Buffer *m_pIndexBuffer;
 	int m_iIndexCount;
+	uint32_t *m_indexData;
+	DXGI_FORMAT m_indexFormat;
 	XMMATRIX m_worldMatrix;
 	XMFLOAT4 m_topColor;
 	XMFLOAT4 m_centerColor;
@@ -0,0 +1,323 @@
+//
+// TaskGraph.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Parallelizing the Naughty Dog Engine Using Fibers (https://www.gdcvault.com/play/1022186/Parallelizing-the-Naughty-Dog-Engine)
+// Introduction to Multithreaded Rendering and the Usage of Deferred Contexts in DirectX 11 (https://docs.microsoft.com/en-us/windows/win32/direct3d11/overviews-direct3d-11-render-multi-thread-intro)
+//
+
+#include "TaskGraph.h"
+#include "Profiler.h"
+
+namespace
+{
+	// Set on the worker threads of a running graph, so device calls made from their tasks can be forwarded to its device thread
+	thread_local TaskGraph *pWorkerGraph = nullptr;
+}
+
+TaskGraph::TaskGraph()
+{
+	m_iRemainingTaskCount = 0;
+	m_iRunningTaskCount = 0;
+	m_bHasFailed = false;
+	m_iThreadCount = 1;
+	m_bIsRunning = false;
+	m_fWallMilliseconds = 0.0f;
+	m_fDeviceCallMilliseconds = 0.0f;
+}
+
+TaskGraph::~TaskGraph()
+{
+	if (!m_bIsRunning)
+	{
+		return;
+	}
+
+	// No more tasks are started, but the running ones may still be waiting on device calls
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_bHasFailed = true;
+	m_workerCondition.notify_all();
+	while (!IsFinished())
+	{
+		if (!RunDeviceWork(lock))
+		{
+			m_deviceCondition.wait(lock);
+		}
+	}
+	lock.unlock();
+
+	Finish();
+}
+
+int TaskGraph::AddTask(std::string strName, TaskThread thread, std::vector<int> dependencies, std::function<bool()> function)
+{
+	int iTaskIndex = static_cast<int>(m_tasks.size());
+
+	Task task;
+	task.strName = strName;
+	task.thread = thread;
+	task.function = function;
+	task.iRemainingDependencyCount = static_cast<int>(dependencies.size());
+	task.iThreadIndex = -1;
+	task.fStartMilliseconds = 0.0f;
+	task.fEndMilliseconds = 0.0f;
+	task.bHasRun = false;
+	m_tasks.push_back(task);
+
+	for (auto dependency : dependencies)
+	{
+		m_tasks[dependency].dependents.push_back(iTaskIndex);
+	}
+
+	return iTaskIndex;
+}
+
+bool TaskGraph::Run(int iThreadCount)
+{
+	Start(iThreadCount);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!IsFinished())
+	{
+		if (!RunDeviceWork(lock))
+		{
+			m_deviceCondition.wait(lock);
+		}
+	}
+	lock.unlock();
+
+	Finish();
+
+	return !m_bHasFailed;
+}
+
+void TaskGraph::Start(int iThreadCount)
+{
+	m_iThreadCount = iThreadCount > 1 ? iThreadCount : 1;
+	m_iRemainingTaskCount = static_cast<int>(m_tasks.size());
+	m_iRunningTaskCount = 0;
+	m_bHasFailed = false;
+	m_fDeviceCallMilliseconds = 0.0f;
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		if (m_tasks[i].iRemainingDependencyCount == 0)
+		{
+			(m_tasks[i].thread == DeviceThread ? m_readyDeviceTasks : m_readyWorkerTasks).push_back(static_cast<int>(i));
+		}
+	}
+	m_startTime = std::chrono::high_resolution_clock::now();
+	m_bIsRunning = true;
+
+	for (int i = 1; i < m_iThreadCount; i++)
+	{
+		m_workers.emplace_back(&TaskGraph::RunWorker, this, i);
+	}
+}
+
+bool TaskGraph::Update(float fBudgetMilliseconds)
+{
+	if (!m_bIsRunning)
+	{
+		return true;
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!IsFinished() && RunDeviceWork(lock))
+	{
+		// At least one call or task runs each update, so the graph always makes progress
+		if (std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count() >= fBudgetMilliseconds)
+		{
+			break;
+		}
+	}
+	bool bIsFinished = IsFinished();
+	lock.unlock();
+
+	if (bIsFinished)
+	{
+		Finish();
+	}
+
+	return bIsFinished;
+}
+
+bool TaskGraph::HasFailed()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bHasFailed;
+}
+
+std::string TaskGraph::GetReport()
+{
+	std::string strReport = "Loaded in " + std::to_string(m_fWallMilliseconds) + " ms with " + std::to_string(m_iThreadCount) +
+							" thread(s), the device thread spent " + std::to_string(m_fDeviceCallMilliseconds) + " ms on calls from worker tasks\n";
+	for (auto &task : m_tasks)
+	{
+		strReport += "  " + task.strName + ": ";
+		if (!task.bHasRun)
+		{
+			strReport += "skipped\n";
+			continue;
+		}
+		strReport += std::to_string(task.fEndMilliseconds - task.fStartMilliseconds) + " ms (" + std::to_string(task.fStartMilliseconds) +
+					 " to " + std::to_string(task.fEndMilliseconds) + " ms) on " +
+					 (task.iThreadIndex == 0 ? std::string("the device thread") : "worker " + std::to_string(task.iThreadIndex)) + "\n";
+	}
+
+	return strReport;
+}
+
+void TaskGraph::RunOnDeviceThread(const std::function<void()> &function)
+{
+	TaskGraph *pGraph = pWorkerGraph;
+	if (pGraph == nullptr)
+	{
+		function();
+		return;
+	}
+
+	DeviceCall deviceCall = { &function, false };
+	std::unique_lock<std::mutex> lock(pGraph->m_mutex);
+	pGraph->m_deviceCalls.push_back(&deviceCall);
+	pGraph->m_deviceCondition.notify_one();
+	pGraph->m_deviceCallCondition.wait(lock, [&deviceCall] { return deviceCall.bIsDone; });
+}
+
+int TaskGraph::GetDefaultThreadCount()
+{
+	int iThreadCount = static_cast<int>(std::thread::hardware_concurrency());
+	return iThreadCount > 1 ? iThreadCount : 1;
+}
+
+bool TaskGraph::IsFinished()
+{
+	// After a failure, the tasks that are still running are waited for
+	return m_iRemainingTaskCount == 0 || (m_bHasFailed && m_iRunningTaskCount == 0);
+}
+
+bool TaskGraph::RunDeviceWork(std::unique_lock<std::mutex> &lock)
+{
+	// Calls forwarded from the workers come first, since a worker is waiting on each of them
+	if (!m_deviceCalls.empty())
+	{
+		DeviceCall *pDeviceCall = m_deviceCalls.front();
+		m_deviceCalls.pop_front();
+
+		lock.unlock();
+		float fStartMilliseconds = GetElapsedMilliseconds();
+		{
+			ProfileZone profileZone("Device call");
+			(*pDeviceCall->pFunction)();
+		}
+		float fEndMilliseconds = GetElapsedMilliseconds();
+		lock.lock();
+
+		m_fDeviceCallMilliseconds += fEndMilliseconds - fStartMilliseconds;
+		pDeviceCall->bIsDone = true;
+		m_deviceCallCondition.notify_all();
+	}
+	else if (!m_bHasFailed && !m_readyDeviceTasks.empty())
+	{
+		int iTaskIndex = m_readyDeviceTasks.front();
+		m_readyDeviceTasks.pop_front();
+		RunTask(iTaskIndex, 0, lock);
+	}
+	else if (!m_bHasFailed && m_iThreadCount == 1 && !m_readyWorkerTasks.empty())
+	{
+		int iTaskIndex = m_readyWorkerTasks.front();
+		m_readyWorkerTasks.pop_front();
+		RunTask(iTaskIndex, 0, lock);
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void TaskGraph::Finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_readyWorkerTasks.clear();
+		m_readyDeviceTasks.clear();
+	}
+
+	m_workerCondition.notify_all();
+	for (auto &worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+	m_fWallMilliseconds = GetElapsedMilliseconds();
+	m_bIsRunning = false;
+}
+
+void TaskGraph::RunWorker(int iThreadIndex)
+{
+	pWorkerGraph = this;
+	Profiler::SetThreadName("Task graph worker " + std::to_string(iThreadIndex));
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_workerCondition.wait(lock, [this] { return IsFinished() || (!m_bHasFailed && !m_readyWorkerTasks.empty()); });
+		if (IsFinished())
+		{
+			break;
+		}
+
+		int iTaskIndex = m_readyWorkerTasks.front();
+		m_readyWorkerTasks.pop_front();
+		RunTask(iTaskIndex, iThreadIndex, lock);
+	}
+
+	pWorkerGraph = nullptr;
+}
+
+void TaskGraph::RunTask(int iTaskIndex, int iThreadIndex, std::unique_lock<std::mutex> &lock)
+{
+	// The tasks are not added to or removed from while the graph runs, so the reference stays valid while unlocked
+	Task &task = m_tasks[iTaskIndex];
+	task.iThreadIndex = iThreadIndex;
+	task.fStartMilliseconds = GetElapsedMilliseconds();
+	m_iRunningTaskCount++;
+
+	lock.unlock();
+	bool bResult;
+	{
+		ProfileZone profileZone(task.strName.c_str());
+		bResult = task.function();
+	}
+	lock.lock();
+
+	task.fEndMilliseconds = GetElapsedMilliseconds();
+	task.bHasRun = true;
+	m_iRunningTaskCount--;
+	m_iRemainingTaskCount--;
+	if (!bResult)
+	{
+		m_bHasFailed = true;
+	}
+	else
+	{
+		for (auto dependent : task.dependents)
+		{
+			if (--m_tasks[dependent].iRemainingDependencyCount == 0)
+			{
+				(m_tasks[dependent].thread == DeviceThread ? m_readyDeviceTasks : m_readyWorkerTasks).push_back(dependent);
+			}
+		}
+	}
+
+	m_workerCondition.notify_all();
+	m_deviceCondition.notify_all();
+}
+
+float TaskGraph::GetElapsedMilliseconds()
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_startTime).count();
+}
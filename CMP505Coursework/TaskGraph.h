@@ -0,0 +1,99 @@
+//
+// TaskGraph.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Parallelizing the Naughty Dog Engine Using Fibers (https://www.gdcvault.com/play/1022186/Parallelizing-the-Naughty-Dog-Engine)
+// Introduction to Multithreaded Rendering and the Usage of Deferred Contexts in DirectX 11 (https://docs.microsoft.com/en-us/windows/win32/direct3d11/overviews-direct3d-11-render-multi-thread-intro)
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+enum TaskThread
+{
+	WorkerThread,		// File I/O, parsing, importing and building meshes on the CPU
+	DeviceThread		// Creating D3D resources (and anything else that uses the immediate context)
+};
+
+struct Task
+{
+	std::string strName;
+	TaskThread thread;
+	std::function<bool()> function;
+	std::vector<int> dependents;
+	int iRemainingDependencyCount;
+	int iThreadIndex;					// 0 is the device thread
+	float fStartMilliseconds;			// Relative to the start of the run
+	float fEndMilliseconds;
+	bool bHasRun;
+};
+
+class TaskGraph
+{
+public:
+	TaskGraph();
+	// A graph that is still running is cancelled (the tasks that are running are waited for)
+	~TaskGraph();
+
+	// Dependencies are the ids returned for tasks added earlier
+	int AddTask(std::string strName, TaskThread thread, std::vector<int> dependencies, std::function<bool()> function);
+	// The calling thread is the device thread, and runs every task if there are no worker threads
+	// Fails if a task fails (tasks that have not started by then are skipped)
+	bool Run(int iThreadCount);
+	// Starts the worker threads and returns right away, the device work then runs whenever the device thread calls Update
+	// (the worker tasks also run in Update if there are no worker threads)
+	void Start(int iThreadCount);
+	// Runs device calls and device tasks until the budget is spent, and returns true once the graph has finished
+	// At least one runs if any is ready, and one that has started is not interrupted, so the budget can be exceeded by the last one
+	bool Update(float fBudgetMilliseconds);
+	bool HasFailed();
+	// Wall time and per task timings of the last run
+	std::string GetReport();
+
+	// Called from a task on a worker thread, the function runs on the device thread and the worker waits for it to return
+	// Called from any other thread, the function runs right away
+	static void RunOnDeviceThread(const std::function<void()> &function);
+	static int GetDefaultThreadCount();
+
+private:
+	struct DeviceCall
+	{
+		const std::function<void()> *pFunction;
+		bool bIsDone;
+	};
+
+	std::vector<Task> m_tasks;
+	std::vector<std::thread> m_workers;
+	bool m_bIsRunning;
+	std::mutex m_mutex;
+	std::condition_variable m_workerCondition;
+	std::condition_variable m_deviceCondition;
+	std::condition_variable m_deviceCallCondition;
+	std::deque<int> m_readyWorkerTasks;
+	std::deque<int> m_readyDeviceTasks;
+	std::deque<DeviceCall*> m_deviceCalls;
+	int m_iRemainingTaskCount;
+	int m_iRunningTaskCount;
+	bool m_bHasFailed;
+	int m_iThreadCount;
+	float m_fWallMilliseconds;
+	float m_fDeviceCallMilliseconds;	// Time the device thread spent on calls made from worker tasks
+	std::chrono::high_resolution_clock::time_point m_startTime;
+
+	bool IsFinished();
+	// Runs one device call or ready task on the device thread, returns false if there was nothing to run
+	bool RunDeviceWork(std::unique_lock<std::mutex> &lock);
+	void Finish();
+	void RunWorker(int iThreadIndex);
+	void RunTask(int iTaskIndex, int iThreadIndex, std::unique_lock<std::mutex> &lock);
+	float GetElapsedMilliseconds();
+};
@@ -0,0 +1,104 @@
+//
+// TextureCache.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Fowler-Noll-Vo hash function (http://www.isthe.com/chongo/tech/comp/fnv/index.html)
+//
+
+#include <cstring>
+#include "TextureCache.h"
+#include "CookedMeshFormat.h"
+#include "Profiler.h"
+
+// Only needs the Direct3D interfaces, the textures are created by the functions passed to GetTexture (the loaders are in TextureCacheLoaders.cpp)
+
+uint64_t TextureCache::HashKey(const char *kind, const void *pData, size_t size)
+{
+	uint64_t hash = HashCookedMeshData(kind, strlen(kind));
+	return HashCookedMeshData(pData, size, hash);
+}
+
+TextureCache::TextureCache(ID3D11Device *pDevice)
+{
+	m_pDevice = pDevice;
+	m_uiHitCount = 0;
+	m_uiMissCount = 0;
+}
+
+TextureCache::~TextureCache()
+{
+	// Textures still used by meshes stay alive until the meshes release them
+	for (auto &entry : m_textures)
+	{
+		entry.second->Release();
+	}
+}
+
+ID3D11ShaderResourceView* TextureCache::GetTexture(uint64_t key, const CreateFunction &createFunction)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto entry = m_textures.find(key);
+		if (entry != m_textures.end())
+		{
+			m_uiHitCount++;
+			entry->second->AddRef();
+			return entry->second;
+		}
+	}
+
+	// Not locked while creating, since the device thread may need the cache to finish what it is doing before it can create the texture
+	ID3D11ShaderResourceView *pTexture = nullptr;
+	{
+		ProfileZone profileZone("Create cached texture");
+		if (FAILED(createFunction(&pTexture)) || pTexture == nullptr)
+		{
+			return nullptr;
+		}
+	}
+
+	// Another thread may have created the same texture in the meantime, in which case its texture is used
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_uiMissCount++;
+	auto insertion = m_textures.emplace(key, pTexture);
+	if (!insertion.second)
+	{
+		pTexture->Release();
+		pTexture = insertion.first->second;
+	}
+	pTexture->AddRef(); // The caller's reference
+
+	return pTexture;
+}
+
+int TextureCache::ReleaseUnused()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	int iReleasedCount = 0;
+	for (auto entry = m_textures.begin(); entry != m_textures.end();)
+	{
+		// Release returns the remaining reference count, which is 1 if the cache holds the only reference
+		entry->second->AddRef();
+		if (entry->second->Release() == 1)
+		{
+			entry->second->Release();
+			entry = m_textures.erase(entry);
+			iReleasedCount++;
+		}
+		else
+		{
+			++entry;
+		}
+	}
+
+	return iReleasedCount;
+}
+
+std::string TextureCache::GetReport()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return "Texture cache: " + std::to_string(m_textures.size()) + " textures, " + std::to_string(m_uiHitCount) + " hits, " +
+		   std::to_string(m_uiMissCount) + " misses\n";
+}
@@ -0,0 +1,51 @@
+//
+// TextureCache.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// Fowler-Noll-Vo hash function (http://www.isthe.com/chongo/tech/comp/fnv/index.html)
+//
+
+#pragma once
+
+#include <d3d11.h>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+
+// Shares one texture between every mesh that uses the same content (colour, file, or embedded file data)
+// Textures are keyed by a hash of their content, files by their path and modification time, so an edited file is loaded again
+// Every texture returned has a reference of its own for the caller to release, the cache keeps one more until it is released or trimmed
+class TextureCache
+{
+public:
+	typedef std::function<HRESULT(ID3D11ShaderResourceView**)> CreateFunction;
+
+	TextureCache(ID3D11Device *pDevice);
+	~TextureCache();
+
+	// The functions below return nullptr if the texture cannot be created
+	ID3D11ShaderResourceView* GetColorTexture(const unsigned char color[4]);
+	ID3D11ShaderResourceView* GetFileTexture(std::string strFilePath);
+	ID3D11ShaderResourceView* GetMemoryTexture(const uint8_t *pData, size_t size);
+	// Only calls the function if the key is not cached (the cache itself does not use the device, so any function can create the textures)
+	// The function can run on any thread, the cache is not locked while it runs
+	ID3D11ShaderResourceView* GetTexture(uint64_t key, const CreateFunction &createFunction);
+	// Releases the textures that nothing but the cache references, and returns how many were released
+	int ReleaseUnused();
+	std::string GetReport();
+
+	// The kind of content is hashed first, so a colour and a file can never share a key
+	static uint64_t HashKey(const char *kind, const void *pData, size_t size);
+
+private:
+	ID3D11Device *m_pDevice;
+	std::unordered_map<uint64_t, ID3D11ShaderResourceView*> m_textures;
+	std::mutex m_mutex;
+	UINT m_uiHitCount;
+	UINT m_uiMissCount;
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+};
@@ -0,0 +1,97 @@
+//
+// TextureCacheLoaders.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+
+#include <filesystem>
+#include <DirectXTK/DDSTextureLoader.h>
+#include <DirectXTK/WICTextureLoader.h>
+#include "TextureCache.h"
+#include "CookedMeshFormat.h"
+#include "TaskGraph.h"
+#include "Model.h"
+#include "AssetPack.h"
+
+using namespace DirectX;
+
+ID3D11ShaderResourceView* TextureCache::GetColorTexture(const unsigned char color[4])
+{
+	unsigned char textureColor[] = { color[0], color[1], color[2], color[3] };
+	return GetTexture(HashKey("color", textureColor, sizeof(textureColor)), [&](ID3D11ShaderResourceView **ppTexture)
+	{
+		return Model::Create1x1ColorTexture(m_pDevice, textureColor, ppTexture);
+	});
+}
+
+ID3D11ShaderResourceView* TextureCache::GetFileTexture(std::string strFilePath)
+{
+	// Packed files cannot change, so their content hash stands in for the modification time, and they are created from the pack's mapping
+	AssetPack *pPack = AssetPack::GetMounted();
+	uint64_t contentHash = 0;
+	if (pPack != nullptr && pPack->GetContentHash(strFilePath, contentHash))
+	{
+		uint64_t key = HashKey("file", strFilePath.data(), strFilePath.size());
+		key = HashCookedMeshData(&contentHash, sizeof(contentHash), key);
+		return GetTexture(key, [&](ID3D11ShaderResourceView **ppTexture)
+		{
+			const char *pData = nullptr;
+			size_t size = 0;
+			if (!pPack->Find(strFilePath, pData, size))
+			{
+				return E_FAIL;
+			}
+
+			const uint8_t *pBytes = reinterpret_cast<const uint8_t*>(pData);
+			HRESULT result = S_OK;
+			TaskGraph::RunOnDeviceThread([&]
+			{
+				if (Utils::GetFileExtension(strFilePath) == "dds")
+				{
+					result = CreateDDSTextureFromMemory(m_pDevice, pBytes, size, nullptr, ppTexture);
+				}
+				else {
+					result = CreateWICTextureFromMemory(m_pDevice, pBytes, size, nullptr, ppTexture);
+				}
+			});
+			return result;
+		});
+	}
+
+	std::error_code error;
+	auto modificationTime = std::filesystem::last_write_time(strFilePath, error);
+	if (error)
+	{
+		return nullptr;
+	}
+
+	int64_t timeCount = modificationTime.time_since_epoch().count();
+	uint64_t key = HashKey("file", strFilePath.data(), strFilePath.size());
+	key = HashCookedMeshData(&timeCount, sizeof(timeCount), key);
+
+	return GetTexture(key, [&](ID3D11ShaderResourceView **ppTexture)
+	{
+		std::wstring wstrFilePath(strFilePath.begin(), strFilePath.end());
+		HRESULT result = S_OK;
+		TaskGraph::RunOnDeviceThread([&]
+		{
+			if (Utils::GetFileExtension(strFilePath) == "dds")
+			{
+				result = CreateDDSTextureFromFile(m_pDevice, wstrFilePath.c_str(), nullptr, ppTexture);
+			}
+			else {
+				result = CreateWICTextureFromFile(m_pDevice, wstrFilePath.c_str(), nullptr, ppTexture);
+			}
+		});
+		return result;
+	});
+}
+
+ID3D11ShaderResourceView* TextureCache::GetMemoryTexture(const uint8_t *pData, size_t size)
+{
+	return GetTexture(HashKey("memory", pData, size), [&](ID3D11ShaderResourceView **ppTexture)
+	{
+		HRESULT result = S_OK;
+		TaskGraph::RunOnDeviceThread([&] { result = CreateWICTextureFromMemory(m_pDevice, pData, size, nullptr, ppTexture); });
+		return result;
+	});
+}
@@ -15,11 +15,15 @@
 
 TxtModel::TxtModel()
 {
+	m_pTexture = nullptr;
 	m_textureTileCount = XMINT2(1, 1);
 	m_pVertexBuffer = nullptr;
 	m_iVertexCount = 0;
+	m_vertexData = nullptr;
 	m_pIndexBuffer = nullptr;
 	m_iIndexCount = 0;
+	m_indexData = nullptr;
+	m_indexFormat = DXGI_FORMAT_R32_UINT;
 	m_pInstanceBuffer = nullptr;
 	m_iInstanceCount = 0;
 	m_worldMatrix = XMMatrixIdentity();
@@ -44,9 +48,11 @@ TxtModel::~TxtModel()
 	SAFE_RELEASE(m_pVertexBuffer);
 	SAFE_RELEASE(m_pIndexBuffer);
 	SAFE_RELEASE(m_pInstanceBuffer);
+	SAFE_DELETE_ARRAY(m_vertexData);
+	SAFE_DELETE_ARRAY(m_indexData);
 }
 
-void TxtModel::InitializeVerticesAndIndices(std::vector<Vertex> &vertices, std::vector<unsigned long> &indices)
+void TxtModel::InitializeVertices(std::vector<Vertex> &vertices)
 {
 	for (int i = 0; i < m_iVertexCount; i++)
 	{
@@ -55,19 +61,54 @@ void TxtModel::InitializeVerticesAndIndices(std::vector<Vertex> &vertices, std::
 		vertex.textureCoordinates = XMFLOAT2(m_vertexData[i].tu, m_vertexData[i].tv);
 		vertex.normal = XMFLOAT3(m_vertexData[i].nx, m_vertexData[i].ny, m_vertexData[i].nz);
 		vertices.push_back(vertex);
+	}
+}
 
-		unsigned long uiIndex;
-		uiIndex = i;
-		indices.push_back(uiIndex);
+HRESULT TxtModel::CreateIndexBuffer(ID3D11Device *pDevice, const uint32_t *indexData, int iIndexCount, int iVertexCount, 
+									ID3D11Buffer **ppIndexBuffer, DXGI_FORMAT &indexFormat)
+{
+	// Half the memory and index fetch bandwidth when every index fits in 16 bits
+	bool bIs16Bit = iVertexCount <= 0x10000;
+	std::vector<uint16_t> indices16;
+	std::vector<uint32_t> indices32;
+	for (int i = 0; i < iIndexCount; i++)
+	{
+		uint32_t uiIndex = indexData != nullptr ? indexData[i] : static_cast<uint32_t>(i);
+		if (bIs16Bit)
+		{
+			indices16.push_back(static_cast<uint16_t>(uiIndex));
+		}
+		else
+		{
+			indices32.push_back(uiIndex);
+		}
 	}
+	indexFormat = bIs16Bit ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = bIs16Bit ? sizeof(uint16_t) * indices16.size() : sizeof(uint32_t) * indices32.size();
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;					// Bind the buffer as an index buffer to the input assembler stage
+	bufferDesc.CPUAccessFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA subresourceData = {};
+	subresourceData.pSysMem = bIs16Bit ? static_cast<const void*>(indices16.data()) : static_cast<const void*>(indices32.data());
+
+	return pDevice->CreateBuffer(&bufferDesc, &subresourceData, ppIndexBuffer);
 }
 
 bool TxtModel::InitializeBuffers(ID3D11Device *pDevice, int iInstanceCount, Instance *instances)
 {
 	std::vector<Vertex> vertices;
-	std::vector<unsigned long> indices;
 
-	InitializeVerticesAndIndices(vertices, indices);
+	InitializeVertices(vertices);
+
+	// Compute the object space bounding box and bounding sphere
+	if (!vertices.empty())
+	{
+		BoundingBox::CreateFromPoints(m_boundingBox, vertices.size(), &vertices[0].position, sizeof(Vertex));
+		BoundingSphere::CreateFromPoints(m_boundingSphere, vertices.size(), &vertices[0].position, sizeof(Vertex));
+	}
 
 	// Create the vertex buffer
 
@@ -89,12 +130,7 @@ bool TxtModel::InitializeBuffers(ID3D11Device *pDevice, int iInstanceCount, Inst
 
 	// Create the index buffer
 
-	bufferDesc.ByteWidth = sizeof(unsigned long) * indices.size();
-	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;					// Bind the buffer as an index buffer to the input assembler stage
-
-	subresourceData.pSysMem = indices.data();
-
-	result = pDevice->CreateBuffer(&bufferDesc, &subresourceData, &m_pIndexBuffer);
+	result = CreateIndexBuffer(pDevice, m_indexData, m_iIndexCount, m_iVertexCount, &m_pIndexBuffer, m_indexFormat);
 	if (FAILED(result))
 	{
 		Utils::ShowError("Failed to create text model index buffer.", result);
@@ -118,11 +154,46 @@ bool TxtModel::InitializeBuffers(ID3D11Device *pDevice, int iInstanceCount, Inst
 			Utils::ShowError("Failed to create instance buffer.", result);
 			return false;
 		}
+
+		// Compute the world space bounds of each instance (instance matrices are stored transposed for the instance vertex shader)
+		m_instanceBoundingBoxes.resize(iInstanceCount);
+		m_instanceBoundingSpheres.resize(iInstanceCount);
+		for (int i = 0; i < iInstanceCount; i++)
+		{
+			XMMATRIX worldMatrix = XMMatrixTranspose(instances[i].worldMatrix);
+			m_boundingBox.Transform(m_instanceBoundingBoxes[i], worldMatrix);
+			m_boundingSphere.Transform(m_instanceBoundingSpheres[i], worldMatrix);
+		}
 	}
 
 	return true;
 }
 
+void TxtModel::ReleaseCpuGeometry()
+{
+	if (m_pVertexBuffer != nullptr)
+	{
+		SAFE_DELETE_ARRAY(m_vertexData);
+		SAFE_DELETE_ARRAY(m_indexData);
+	}
+}
+
+void TxtModel::TrackResidency(ResidencyTracker &tracker, const std::string &strAssetName)
+{
+	if (m_vertexData != nullptr)
+	{
+		tracker.AddCpuBytes(strAssetName, VertexResidency, sizeof(VertexData) * m_iVertexCount);
+	}
+	if (m_indexData != nullptr)
+	{
+		tracker.AddCpuBytes(strAssetName, IndexResidency, sizeof(uint32_t) * m_iIndexCount);
+	}
+	tracker.AddBuffer(strAssetName, VertexResidency, m_pVertexBuffer);
+	tracker.AddBuffer(strAssetName, IndexResidency, m_pIndexBuffer);
+	tracker.AddBuffer(strAssetName, InstanceResidency, m_pInstanceBuffer);
+	tracker.AddTexture(strAssetName, m_pTexture);
+}
+
 #pragma endregion
 
 #pragma region Setters/Getters
@@ -162,6 +233,11 @@ void TxtModel::SetIndexCount(int iCount)
 	m_iIndexCount = iCount;
 }
 
+void TxtModel::SetIndexData(uint32_t *indexData)
+{
+	m_indexData = indexData;
+}
+
 int TxtModel::GetIndexCount()
 {
 	return m_iIndexCount;
@@ -177,6 +253,38 @@ XMMATRIX TxtModel::GetWorldMatrix()
 	return m_worldMatrix;
 }
 
+BoundingBox TxtModel::GetBoundingBox()
+{
+	return m_boundingBox;
+}
+
+BoundingSphere TxtModel::GetBoundingSphere()
+{
+	return m_boundingSphere;
+}
+
+BoundingBox TxtModel::GetInstanceBoundingBox(int iInstanceIndex)
+{
+	if (m_instanceBoundingBoxes.empty())
+	{
+		BoundingBox worldBoundingBox;
+		m_boundingBox.Transform(worldBoundingBox, m_worldMatrix);
+		return worldBoundingBox;
+	}
+	return m_instanceBoundingBoxes[iInstanceIndex];
+}
+
+BoundingSphere TxtModel::GetInstanceBoundingSphere(int iInstanceIndex)
+{
+	if (m_instanceBoundingSpheres.empty())
+	{
+		BoundingSphere worldBoundingSphere;
+		m_boundingSphere.Transform(worldBoundingSphere, m_worldMatrix);
+		return worldBoundingSphere;
+	}
+	return m_instanceBoundingSpheres[iInstanceIndex];
+}
+
 void TxtModel::TransformWorldMatrix(XMMATRIX translationMatrix, XMMATRIX rotationMatrix, XMMATRIX scalingMatrix)
 {
 	m_worldMatrix = m_worldMatrix * translationMatrix * rotationMatrix * scalingMatrix;
@@ -264,7 +372,7 @@ void TxtModel::Render(ID3D11DeviceContext *pImmediateContext)
 	}
 
 	pImmediateContext->IASetIndexBuffer(m_pIndexBuffer,
-									    DXGI_FORMAT_R32_UINT,	// 32-bit format that supports 32 bits for the red channel
+									    m_indexFormat,			// 16-bit if every vertex can be indexed with 16 bits, otherwise 32-bit
 									    0);						// Offset in bytes from the start of the index buffer to the first index to use
 
 	// Set the primitive topology (how the GPU obtains the three vertices it requires to render a triangle)
@@ -14,35 +14,16 @@
 #include <vector>
 #include <d3d11.h>
 #include <directxmath.h>
+#include <DirectXCollision.h>
+#include "ResidencyTracker.h"
 #include "Utils.h"
+#include "Vertex.h"
+#include "TxtModelParser.h"
 
 #define DEFAULT_LIGHT_DIRECTION XMFLOAT3(0.0f, -0.8f, 0.5f)
 
 using namespace DirectX;
 
-struct Vertex
-{
-	XMFLOAT3 position;
-	XMFLOAT2 textureCoordinates;
-	XMFLOAT3 normal;
-
-	Vertex() {}
-
-	Vertex(XMFLOAT3 pos, XMFLOAT2 texCoord, XMFLOAT3 norm)
-	{
-		position = pos;
-		textureCoordinates = texCoord;
-		normal = norm;
-	}
-};
-
-struct VertexData
-{
-	float x, y, z;
-	float tu, tv;
-	float nx, ny, nz;
-};
-
 struct Instance
 {
 	XMMATRIX worldMatrix;
@@ -50,6 +31,11 @@ struct Instance
 	XMFLOAT3 lightDirection;
 };
 
+struct PackedInstance // 48 bytes instead of 96 (used by meshes, whose instances share the texture tile count and light direction)
+{
+	XMFLOAT4 worldMatrixColumns[3]; // The fourth column of an affine world matrix is always (0, 0, 0, 1)
+};
+
 class TxtModel
 {
 public:
@@ -61,11 +47,18 @@ public:
 	void SetTextureTileCount(int x, int y);
 	XMINT2 GetTextureTileCount();
 	void SetVertexCount(int iCount);
+	// The model takes over the vertex data (allocated with new[])
 	void SetVertexData(VertexData *vertexData);
 	void SetIndexCount(int iCount);
+	// The model takes over the index data (allocated with new[]), the vertices are drawn in order if there is none
+	void SetIndexData(uint32_t *indexData);
 	int GetIndexCount();
 	int GetInstanceCount();
 	XMMATRIX GetWorldMatrix();
+	BoundingBox GetBoundingBox();
+	BoundingSphere GetBoundingSphere();
+	BoundingBox GetInstanceBoundingBox(int iInstanceIndex);
+	BoundingSphere GetInstanceBoundingSphere(int iInstanceIndex);
 	void TransformWorldMatrix(XMMATRIX translationMatrix, XMMATRIX rotationMatrix, XMMATRIX scalingMatrix);
 	XMFLOAT4 GetAmbientColor();
 	XMFLOAT4 GetDiffuseColor();
@@ -78,19 +71,31 @@ public:
 	XMFLOAT3 GetPointLightPosition();
 
 	bool InitializeBuffers(ID3D11Device *pDevice, int iInstanceCount, Instance *instances = nullptr);
+	// Frees the vertex data once the buffers have been created (the bounds are kept, a reload reads the file again)
+	void ReleaseCpuGeometry();
+	void TrackResidency(ResidencyTracker &tracker, const std::string &strAssetName);
 	void Render(ID3D11DeviceContext *pImmediateContext);
+	// Uses 16-bit indices if every vertex can be indexed with them (sequential indices if there is no index data)
+	static HRESULT CreateIndexBuffer(ID3D11Device *pDevice, const uint32_t *indexData, int iIndexCount, int iVertexCount, 
+									 ID3D11Buffer **ppIndexBuffer, DXGI_FORMAT &indexFormat);
 
 protected:
 	ID3D11ShaderResourceView *m_pTexture;
 	XMINT2 m_textureTileCount;
 	ID3D11Buffer *m_pVertexBuffer;
 	int m_iVertexCount;
-	VertexData *m_vertexData;
+	VertexData *m_vertexData;							// Only kept until the buffers are created if CPU geometry is released
 	ID3D11Buffer *m_pIndexBuffer;
 	int m_iIndexCount;
+	uint32_t *m_indexData;								// Released with the vertex data
+	DXGI_FORMAT m_indexFormat;
 	ID3D11Buffer *m_pInstanceBuffer;
 	int m_iInstanceCount;
 	XMMATRIX m_worldMatrix;
+	BoundingBox m_boundingBox;							// Object space
+	BoundingSphere m_boundingSphere;
+	std::vector<BoundingBox> m_instanceBoundingBoxes;	// World space
+	std::vector<BoundingSphere> m_instanceBoundingSpheres;
 	XMFLOAT4 m_ambientColor;
 	XMFLOAT4 m_diffuseColor;
 	XMFLOAT4 m_specularColor;
@@ -100,5 +105,5 @@ protected:
 	float m_fPointLightStrength;
 	XMFLOAT3 m_pointLightPosition;
 
-	void InitializeVerticesAndIndices(std::vector<Vertex> &vertices, std::vector<unsigned long> &indices);
+	void InitializeVertices(std::vector<Vertex> &vertices);
 };
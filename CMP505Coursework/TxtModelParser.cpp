@@ -0,0 +1,156 @@
+//
+// TxtModelParser.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// RasterTek Tutorial 8: Loading Maya 2011 Models (http://www.rastertek.com/dx11tut08.html)
+//
+
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "CookedMeshFormat.h"
+#include "TxtModelParser.h"
+
+namespace
+{
+	struct VertexDataHasher
+	{
+		size_t operator()(const VertexData &vertex) const
+		{
+			return static_cast<size_t>(HashCookedMeshData(&vertex, sizeof(VertexData)));
+		}
+	};
+
+	struct VertexDataEqual
+	{
+		bool operator()(const VertexData &vertex, const VertexData &otherVertex) const
+		{
+			return memcmp(&vertex, &otherVertex, sizeof(VertexData)) == 0;
+		}
+	};
+}
+
+VertexData* TxtModelParser::Parse(const char *filePath, int &iVertexCount)
+{
+	MappedFile file;
+	if (!file.Open(filePath) || file.GetSize() == 0)
+	{
+		return nullptr;
+	}
+
+	const char *pCurrent = file.GetData();
+	const char *pEnd = pCurrent + file.GetSize();
+
+	// Skip to the value of the vertex count ("Vertex Count: 6")
+	pCurrent = static_cast<const char*>(memchr(pCurrent, ':', pEnd - pCurrent));
+	if (pCurrent == nullptr)
+	{
+		return nullptr;
+	}
+	pCurrent = NumberParser::ParseInt(pCurrent + 1, pEnd, iVertexCount);
+	if (pCurrent == nullptr || iVertexCount < 0)
+	{
+		return nullptr;
+	}
+
+	// Skip to the beginning of the vertex data ("Data:")
+	pCurrent = static_cast<const char*>(memchr(pCurrent, ':', pEnd - pCurrent));
+	if (pCurrent == nullptr)
+	{
+		return nullptr;
+	}
+	pCurrent++;
+
+	// Each vertex is 8 whitespace separated floats (position, texture coordinates and normal)
+	VertexData *vertexData = new VertexData[iVertexCount];
+	float *pValues = reinterpret_cast<float*>(vertexData);
+	int iValueCount = iVertexCount * (sizeof(VertexData) / sizeof(float));
+	for (int i = 0; i < iValueCount; i++)
+	{
+		pCurrent = NumberParser::ParseFloat(pCurrent, pEnd, pValues[i]);
+		if (pCurrent == nullptr)
+		{
+			delete[] vertexData;
+			return nullptr;
+		}
+	}
+
+	return vertexData;
+}
+
+VertexData* TxtModelParser::ParseWithStream(const char *filePath, int &iVertexCount)
+{
+	std::ifstream file;
+	file.open(filePath);
+	if (file.fail())
+	{
+		return nullptr;
+	}
+
+	// Read up to the value of the vertex count
+	char input;
+	file.get(input);
+	while (input != ':')
+	{
+		file.get(input);
+	}
+
+	// Read the vertex count
+	file >> iVertexCount;
+
+	// Read up to the beginning of the vertex data
+	file.get(input);
+	while (input != ':')
+	{
+		file.get(input);
+	}
+	file.get(input);
+	file.get(input);
+
+	// Read the vertex data
+	VertexData *vertexData = new VertexData[iVertexCount];
+	for (int i = 0; i < iVertexCount; i++)
+	{
+		file >> vertexData[i].x >> vertexData[i].y >> vertexData[i].z;
+		file >> vertexData[i].tu >> vertexData[i].tv;
+		file >> vertexData[i].nx >> vertexData[i].ny >> vertexData[i].nz;
+	}
+
+	// Close file
+	file.close();
+
+	return vertexData;
+}
+
+std::vector<uint32_t> TxtModelParser::WeldVertices(VertexData *&vertexData, int &iVertexCount)
+{
+	std::unordered_map<VertexData, uint32_t, VertexDataHasher, VertexDataEqual> uniqueVertices;
+	uniqueVertices.reserve(iVertexCount);
+
+	std::vector<uint32_t> indices(iVertexCount);
+	std::vector<VertexData> weldedVertices;
+	weldedVertices.reserve(iVertexCount);
+	for (int i = 0; i < iVertexCount; i++)
+	{
+		auto result = uniqueVertices.emplace(vertexData[i], static_cast<uint32_t>(weldedVertices.size()));
+		if (result.second)
+		{
+			weldedVertices.push_back(vertexData[i]);
+		}
+		indices[i] = result.first->second;
+	}
+
+	// The welded copy is allocated with new[] like the parsed one, so its owner can delete either
+	delete[] vertexData;
+	iVertexCount = static_cast<int>(weldedVertices.size());
+	vertexData = new VertexData[iVertexCount];
+	if (iVertexCount > 0)
+	{
+		memcpy(vertexData, weldedVertices.data(), sizeof(VertexData) * iVertexCount);
+	}
+
+	return indices;
+}
@@ -0,0 +1,34 @@
+//
+// TxtModelParser.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// RasterTek Tutorial 8: Loading Maya 2011 Models (http://www.rastertek.com/dx11tut08.html)
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Kept free of Direct3D, so the asset cooker builds it and its tests check it against the stream based loader
+
+struct VertexData
+{
+	float x, y, z;
+	float tu, tv;
+	float nx, ny, nz;
+};
+
+class TxtModelParser
+{
+public:
+	// Returns the vertex data (allocated with new[]) or nullptr if the file cannot be read
+	static VertexData* Parse(const char *filePath, int &iVertexCount);
+	// The original stream based loader, kept to test and benchmark the parser against (see TxtModelParserTests.cpp)
+	static VertexData* ParseWithStream(const char *filePath, int &iVertexCount);
+	// Text models list every corner of every triangle, so vertices shared by several triangles are repeated
+	// Replaces the vertex data with one copy of each distinct vertex (position, texture coordinates and normal compared bit for bit),
+	// in the order they first appear, and returns the indices that rebuild the triangles
+	static std::vector<uint32_t> WeldVertices(VertexData *&vertexData, int &iVertexCount);
+};
@@ -0,0 +1,30 @@
+//
+// Vertex.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// RasterTek Tutorial 7: 3D Model Rendering (http://www.rastertek.com/dx11tut07.html)
+//
+
+#pragma once
+
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+// Layout of the vertex buffers of the models and meshes (kept apart from TxtModel.h so code without Direct3D can use it)
+struct Vertex
+{
+	XMFLOAT3 position;
+	XMFLOAT2 textureCoordinates;
+	XMFLOAT3 normal;
+
+	Vertex() {}
+
+	Vertex(XMFLOAT3 pos, XMFLOAT2 texCoord, XMFLOAT3 norm)
+	{
+		position = pos;
+		textureCoordinates = texCoord;
+		normal = norm;
+	}
+};
@@ -0,0 +1,141 @@
+//
+// VertexQuantization.cpp
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// A Survey of Efficient Representations for Independent Unit Vectors (http://jcgt.org/published/0003/02/01)
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "VertexQuantization.h"
+
+#define MIN_QUANTIZATION_EXTENT 0.0001f		// Keeps flat meshes (e.g. planes) from dividing by zero
+#define MAX_NORMAL_ERROR 0.001f				// Octahedral snorm16 normals are accurate to roughly 0.0001 per component
+#define MAX_TEXCOORD_RELATIVE_ERROR 0.001f	// Half floats have an 11-bit significand
+
+QuantizationBounds VertexQuantization::ComputeBounds(const BoundingBox &boundingBox)
+{
+	QuantizationBounds bounds;
+	bounds.center = boundingBox.Center;
+	XMStoreFloat3(&bounds.extents, XMVectorMax(XMLoadFloat3(&boundingBox.Extents), XMVectorReplicate(MIN_QUANTIZATION_EXTENT)));
+	return bounds;
+}
+
+void VertexQuantization::Encode(const std::vector<Vertex> &vertices, const QuantizationBounds &bounds, std::vector<QuantizedVertex> &quantizedVertices)
+{
+	XMVECTOR vCenter = XMLoadFloat3(&bounds.center);
+	XMVECTOR vInverseExtents = XMVectorReciprocal(XMLoadFloat3(&bounds.extents));
+
+	quantizedVertices.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		// Position is mapped to [-1, 1] within the bounds (XMStoreShortN4 clamps and rounds)
+		XMVECTOR vPosition = (XMLoadFloat3(&vertices[i].position) - vCenter) * vInverseExtents;
+		XMStoreShortN4(&quantizedVertices[i].position, XMVectorSetW(vPosition, 0.0f));
+
+		XMStoreHalf2(&quantizedVertices[i].textureCoordinates, XMLoadFloat2(&vertices[i].textureCoordinates));
+
+		XMFLOAT2 encodedNormal = EncodeOctahedralNormal(vertices[i].normal);
+		XMStoreShortN2(&quantizedVertices[i].normal, XMLoadFloat2(&encodedNormal));
+	}
+}
+
+Vertex VertexQuantization::Decode(const QuantizedVertex &quantizedVertex, const QuantizationBounds &bounds)
+{
+	// Mirrors the decoding done by the light vertex shaders
+
+	Vertex vertex;
+
+	XMVECTOR vPosition = XMLoadShortN4(&quantizedVertex.position);
+	XMStoreFloat3(&vertex.position, vPosition * XMLoadFloat3(&bounds.extents) + XMLoadFloat3(&bounds.center));
+
+	XMStoreFloat2(&vertex.textureCoordinates, XMLoadHalf2(&quantizedVertex.textureCoordinates));
+
+	XMFLOAT2 encodedNormal;
+	XMStoreFloat2(&encodedNormal, XMLoadShortN2(&quantizedVertex.normal));
+	vertex.normal = DecodeOctahedralNormal(encodedNormal);
+
+	return vertex;
+}
+
+XMFLOAT2 VertexQuantization::EncodeOctahedralNormal(XMFLOAT3 normal)
+{
+	// Project the normal onto the octahedron |x| + |y| + |z| = 1, then fold the lower hemisphere over the diagonals
+
+	float fL1Norm = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	if (fL1Norm == 0.0f)
+	{
+		return XMFLOAT2(0.0f, 0.0f);
+	}
+
+	float x = normal.x / fL1Norm;
+	float y = normal.y / fL1Norm;
+
+	if (normal.z < 0.0f)
+	{
+		// Zero is treated as positive to match the shader's decoding
+		float fSignX = x >= 0.0f ? 1.0f : -1.0f;
+		float fSignY = y >= 0.0f ? 1.0f : -1.0f;
+		float fFoldedX = (1.0f - fabsf(y)) * fSignX;
+		float fFoldedY = (1.0f - fabsf(x)) * fSignY;
+		x = fFoldedX;
+		y = fFoldedY;
+	}
+
+	return XMFLOAT2(x, y);
+}
+
+XMFLOAT3 VertexQuantization::DecodeOctahedralNormal(XMFLOAT2 encodedNormal)
+{
+	XMFLOAT3 normal(encodedNormal.x, encodedNormal.y, 1.0f - fabsf(encodedNormal.x) - fabsf(encodedNormal.y));
+
+	float t = std::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -t : t;
+	normal.y += normal.y >= 0.0f ? -t : t;
+
+	XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&normal)));
+	return normal;
+}
+
+bool VertexQuantization::ValidateEncoding(const std::vector<Vertex> &vertices, const std::vector<QuantizedVertex> &quantizedVertices, const QuantizationBounds &bounds)
+{
+	// Positions are rounded to the nearest of 65535 steps across the bounds, so the error is at most half a step
+	// (plus the rounding of the float arithmetic, which grows with the distance from the origin)
+	XMVECTOR vExtents = XMLoadFloat3(&bounds.extents);
+	XMVECTOR vMaxPositionError = vExtents * (0.5f / 32767.0f) + (XMVectorAbs(XMLoadFloat3(&bounds.center)) + vExtents) * (4.0f * FLT_EPSILON);
+	XMVECTOR vMaxNormalError = XMVectorReplicate(MAX_NORMAL_ERROR);
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		Vertex decodedVertex = Decode(quantizedVertices[i], bounds);
+
+		XMVECTOR vPositionError = XMVectorAbs(XMLoadFloat3(&decodedVertex.position) - XMLoadFloat3(&vertices[i].position));
+		if (!XMVector3LessOrEqual(vPositionError, vMaxPositionError))
+		{
+			return false;
+		}
+
+		XMVECTOR vTextureCoordinates = XMLoadFloat2(&vertices[i].textureCoordinates);
+		XMVECTOR vMaxTextureCoordinateError = XMVectorAbs(vTextureCoordinates) * MAX_TEXCOORD_RELATIVE_ERROR + XMVectorReplicate(MAX_TEXCOORD_RELATIVE_ERROR);
+		XMVECTOR vTextureCoordinateError = XMVectorAbs(XMLoadFloat2(&decodedVertex.textureCoordinates) - vTextureCoordinates);
+		if (!XMVector2LessOrEqual(vTextureCoordinateError, vMaxTextureCoordinateError))
+		{
+			return false;
+		}
+
+		// Only unit normals survive encoding unchanged (the encoding stores a direction)
+		XMVECTOR vNormal = XMLoadFloat3(&vertices[i].normal);
+		if (XMVectorGetX(XMVector3LengthSq(vNormal)) > 0.0f)
+		{
+			XMVECTOR vNormalError = XMVectorAbs(XMLoadFloat3(&decodedVertex.normal) - XMVector3Normalize(vNormal));
+			if (!XMVector3LessOrEqual(vNormalError, vMaxNormalError))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
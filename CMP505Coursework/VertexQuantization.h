@@ -0,0 +1,48 @@
+//
+// VertexQuantization.h
+// Copyright  2019 Diel Barnes. All rights reserved.
+//
+// Reference:
+// A Survey of Efficient Representations for Independent Unit Vectors (http://jcgt.org/published/0003/02/01)
+//
+
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <DirectXCollision.h>
+#include "Vertex.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+enum VertexFormat : int
+{
+	FullPrecisionVertexFormat = 0,	// Vertex (32 bytes)
+	QuantizedVertexFormat			// QuantizedVertex (16 bytes)
+};
+
+struct QuantizedVertex
+{
+	XMSHORTN4 position;				// Relative to the mesh bounds (w is unused)
+	XMHALF2 textureCoordinates;
+	XMSHORTN2 normal;				// Octahedral-encoded
+};
+
+struct QuantizationBounds
+{
+	XMFLOAT3 center;
+	XMFLOAT3 extents;				// Half the size of the bounds on each axis
+};
+
+class VertexQuantization
+{
+public:
+	static QuantizationBounds ComputeBounds(const BoundingBox &boundingBox);
+	static void Encode(const std::vector<Vertex> &vertices, const QuantizationBounds &bounds, std::vector<QuantizedVertex> &quantizedVertices);
+	static Vertex Decode(const QuantizedVertex &quantizedVertex, const QuantizationBounds &bounds);
+	static XMFLOAT2 EncodeOctahedralNormal(XMFLOAT3 normal);
+	static XMFLOAT3 DecodeOctahedralNormal(XMFLOAT2 encodedNormal);
+	static bool ValidateEncoding(const std::vector<Vertex> &vertices, const std::vector<QuantizedVertex> &quantizedVertices, const QuantizationBounds &bounds);
+};